@@ -3,27 +3,74 @@ import argparse
 import os
 import sys
 import hashlib
-import shutil
+import json
+import zipfile
 import logging
 
 logging.basicConfig()
 logger = logging.getLogger("swicache")
 logger.setLevel(logging.INFO)
 
-def filehash(fname, blocksize=1024*1024):
-   h = hashlib.sha1()
-   with open(fname,'rb') as f:
-       block = 0
-       while block != b'':
-           block = f.read(blocksize)
-           h.update(block)
-   return h.hexdigest()
+def zipdigest(fname):
+    """Digest of the zip central directory (member names, sizes and CRCs).
 
-def write_hash(fname, digest):
-    open(fname, "w").write(digest)
+    Only the end of the file is read, so this is cheap even for
+    large SWIs on slow media. Returns None if fname is not a zip."""
+    try:
+        with zipfile.ZipFile(fname) as z:
+            h = hashlib.sha1()
+            for zi in z.infolist():
+                h.update(("%s:%d:%d:%08x\n" % (zi.filename, zi.file_size,
+                                               zi.compress_size, zi.CRC)).encode('utf-8'))
+            return h.hexdigest()
+    except (zipfile.BadZipfile, IOError, OSError):
+        return None
 
-def read_hash(fname):
-    return open(fname).read()
+def filestat(fname):
+    st = os.stat(fname)
+    return dict(size=st.st_size, mtime=int(st.st_mtime))
+
+def copyhash(src, dst, blocksize=1024*1024):
+    """Copy src to dst and SHA-1 the data in the same pass.
+
+    The data is written to a temporary file which is synced and then
+    renamed over dst, so a reader of dst never sees a partial image."""
+    h = hashlib.sha1()
+    tmp = dst + ".tmp"
+    with open(src, 'rb') as fsrc:
+        with open(tmp, 'wb') as fdst:
+            while True:
+                block = fsrc.read(blocksize)
+                if not block:
+                    break
+                h.update(block)
+                fdst.write(block)
+            fdst.flush()
+            os.fdatasync(fdst.fileno())
+    os.rename(tmp, dst)
+    return h.hexdigest()
+
+def write_cache(fname, data):
+    tmp = fname + ".tmp"
+    with open(tmp, "w") as f:
+        json.dump(data, f, indent=2, sort_keys=True)
+        f.flush()
+        os.fdatasync(f.fileno())
+    os.rename(tmp, fname)
+
+def read_cache(fname):
+    try:
+        with open(fname) as f:
+            return json.load(f)
+    except (IOError, OSError, ValueError):
+        return None
+
+def syncdir(dname):
+    fd = os.open(dname, os.O_RDONLY)
+    try:
+        os.fsync(fd)
+    finally:
+        os.close(fd)
 
 ap = argparse.ArgumentParser(description="SWI Cacher")
 ap.add_argument("src")
@@ -32,34 +79,48 @@ ap.add_argument("--force", action='store_true')
 
 ops = ap.parse_args()
 
-# Generate hash of the source file
-logger.info("Generating hash for %s..." % ops.src)
-src_hash = filehash(ops.src)
-logger.info("Generated hash for %s: %s" % (ops.src, src_hash))
+dst_cache_file = "%s.swicache" % ops.dst
 
-dst_hash_file = "%s.md5sum" % ops.dst
+src_stat = filestat(ops.src)
+src_digest = zipdigest(ops.src)
 
-if not ops.force:
-    if os.path.exists(ops.dst) and os.path.exists(dst_hash_file):
-        # Destination exists and the hash file exists.
-        dst_hash = read_hash(dst_hash_file)
-        if dst_hash == src_hash:
-           # Src and destination are the same.
-           logger.info("Cache file is up to date.")
-           sys.exit(0)
+if not ops.force and os.path.exists(ops.dst):
+    #
+    # Validate the cache from metadata only: the source size and
+    # central directory digest must match what was cached, and the
+    # cached file must still be the one we wrote.
+    #
+    cache = read_cache(dst_cache_file)
+    if cache is not None and src_digest is not None:
+        src_ok = (cache.get('size') == src_stat['size'] and
+                  cache.get('zipdigest') == src_digest)
+        dst_ok = (cache.get('dst') == filestat(ops.dst))
+        if src_ok and dst_ok:
+            if cache.get('mtime') != src_stat['mtime']:
+                logger.info("Source mtime changed but contents match.")
+            logger.info("Cache file is up to date.")
+            sys.exit(0)
 
 #
 # Either force==True, a destination file is missing, or the
 # current file is out of date.
 #
-logger.info("Updating %s --> %s, %s" % (ops.src, ops.dst, src_hash))
-if not os.path.isdir(os.path.dirname(ops.dst)):
-   os.makedirs(os.path.dirname(ops.dst))
-shutil.copyfile(ops.src, ops.dst)
-write_hash(dst_hash_file, src_hash);
-logger.info("Syncing...")
-os.system("sync")
-logger.info("Done.")
+logger.info("Updating %s --> %s" % (ops.src, ops.dst))
+dst_dir = os.path.dirname(os.path.abspath(ops.dst))
+if not os.path.isdir(dst_dir):
+   os.makedirs(dst_dir)
+src_hash = copyhash(ops.src, ops.dst)
+logger.info("Copied %s: sha1 %s" % (ops.src, src_hash))
 
+cache = dict(src_stat)
+cache['sha1'] = src_hash
+cache['zipdigest'] = src_digest
+cache['dst'] = filestat(ops.dst)
+write_cache(dst_cache_file, cache)
 
+# The old hash file held a SHA-1 under an .md5sum name.
+if os.path.exists("%s.md5sum" % ops.dst):
+    os.unlink("%s.md5sum" % ops.dst)
 
+syncdir(dst_dir)
+logger.info("Done.")
@@ -8,6 +8,7 @@ import logging
 import struct
 import argparse
 import time
+import mmap
 
 class FdtProperty:
     def __init__(self, name, offset, sz):
@@ -31,11 +32,16 @@ class Parser:
     FDT_NOP = 4
     FDT_END = 9
 
+    # chunk size for copying out large properties (kernel, initrd)
+    COPY_CHUNK = 1024*1024
+
     def __init__(self, path=None, stream=None, log=None):
         self.log = log or logging.getLogger(self.__class__.__name__)
         self.path = path
         self.stream = stream
         self.rootNodes = {}
+        self.nodeIndex = {}
+        self.buf = None
         self._parse()
 
     @classmethod
@@ -53,24 +59,47 @@ class Parser:
         magic = struct.unpack(">I", buf)[0]
         return magic == cls.FDT_MAGIC
 
+    def _map(self, fd):
+        """Map the whole file read-only.
+
+        Streams without a file descriptor are read into memory."""
+        try:
+            fno = fd.fileno()
+        except (AttributeError, IOError, ValueError):
+            fno = None
+        if fno is not None:
+            try:
+                return mmap.mmap(fno, 0, access=mmap.ACCESS_READ)
+            except (mmap.error, ValueError, OSError, EnvironmentError):
+                pass
+        pos = fd.tell()
+        try:
+            fd.seek(0, 0)
+            return fd.read()
+        finally:
+            fd.seek(pos, 0)
+
     def _parse(self):
         if self.stream is not None:
-            try:
-                pos = self.stream.tell()
-                self._parseStream(self.stream)
-            finally:
-                self.stream.seek(pos, 0)
+            self.buf = self._map(self.stream)
         elif self.path is not None:
-            with open(self.path) as fd:
-                self._parseStream(fd)
+            with open(self.path, "rb") as fd:
+                self.buf = self._map(fd)
         else:
             raise ValueError("missing file or stream")
+        self._parseBuffer(self.buf)
 
-    def _parseStream(self, fd):
+    def close(self):
+        buf, self.buf = self.buf, None
+        if isinstance(buf, mmap.mmap):
+            buf.close()
+
+    def _parseBuffer(self, buf):
         strings = {}
 
-        buf = fd.read(40)
-        hdr = list(struct.unpack(">10I", buf))
+        if len(buf) < 40:
+            raise ValueError("missing or invalid magic")
+        hdr = list(struct.unpack_from(">10I", buf, 0))
         magic = hdr.pop(0)
         if magic != self.FDT_MAGIC:
             raise ValueError("missing or invalid magic")
@@ -85,42 +114,30 @@ class Parser:
         self.stringSize = hdr.pop(0)
         self.structSize = hdr.pop(0)
 
-        fd.seek(self.structPos, 0)
-
-        def _align():
-            pos = fd.tell()
-            pos = (pos+3) & ~3
-            fd.seek(pos, 0)
-
-        def _label():
-            buf = ""
-            while True:
-                c = fd.read(1)
-                if c == '\x00': break
-                if c:
-                    buf += c
-            return buf
+        def _label(pos):
+            end = buf.find('\x00', pos)
+            if end < 0:
+                raise ValueError("unterminated string")
+            return buf[pos:end], end+1
 
         def _string(off):
-            if off in strings:
-                return strings[off]
-            pos = fd.tell()
-            fd.seek(self.stringPos, 0)
-            fd.seek(off, 1)
-            buf = _label()
-            fd.seek(pos)
-            return buf
+            if off not in strings:
+                strings[off] = _label(self.stringPos+off)[0]
+            return strings[off]
 
         nodeStack = []
+        pathStack = []
+        pos = self.structPos
 
         while True:
-            buf = fd.read(4)
-            s = list(struct.unpack(">I", buf))
-            tag = s.pop(0)
+            if pos+4 > len(buf):
+                raise ValueError("truncated structure block")
+            tag = struct.unpack_from(">I", buf, pos)[0]
+            pos += 4
 
             if tag == self.FDT_BEGIN_NODE:
-                name = _label()
-                _align()
+                name, pos = _label(pos)
+                pos = (pos+3) & ~3
 
                 newNode = FdtNode(name)
 
@@ -128,26 +145,25 @@ class Parser:
                     if name in nodeStack[-1].nodes:
                         raise ValueError("duplicate node")
                     nodeStack[-1].nodes[name] = newNode
-                    nodeStack.append(newNode)
+                    nodePath = pathStack[-1] + '/' + name
                 else:
                     if name in self.rootNodes:
                         raise ValueError("duplicate node")
                     self.rootNodes[name] = newNode
-                    nodeStack.append(newNode)
+                    nodePath = name
+                nodeStack.append(newNode)
+                pathStack.append(nodePath)
+                self.nodeIndex[nodePath] = newNode
 
                 continue
 
             if tag == self.FDT_PROP:
-                buf = fd.read(8)
-                s = list(struct.unpack(">2I", buf))
-                plen = s.pop(0)
-                nameoff = s.pop(0)
+                plen, nameoff = struct.unpack_from(">2I", buf, pos)
+                pos += 8
                 name = _string(nameoff)
-                pos = fd.tell()
-                fd.seek(plen, 1)
-                _align()
 
                 newProp = FdtProperty(name, pos, plen)
+                pos = (pos+plen+3) & ~3
 
                 if nodeStack:
                     if name in nodeStack[-1].properties:
@@ -161,6 +177,7 @@ class Parser:
             if tag == self.FDT_END_NODE:
                 if nodeStack:
                     nodeStack.pop(-1)
+                    pathStack.pop(-1)
                 else:
                     raise ValueError("missing begin node")
                 continue
@@ -198,34 +215,33 @@ class Parser:
     def getNode(self, path):
         if path == '/':
             return self.rootNodes.get('', None)
+        return self.nodeIndex.get(path, None)
 
-        els = path.split('/')
-        n = None
-        while els:
-            b = els.pop(0)
-            if n is None:
-                if b not in self.rootNodes: return None
-                n = self.rootNodes[b]
-            else:
-                if b not in n.nodes: return None
-                n = n.nodes[b]
-        return n
+    def getPropertyData(self, prop):
+        if prop.offset+prop.sz > len(self.buf):
+            raise ValueError("truncated property %s" % prop.name)
+        return self.buf[prop.offset:prop.offset+prop.sz]
 
     def getNodeProperty(self, node, propName):
         if propName not in node.properties: return None
-        prop = node.properties[propName]
-        def _get(fd):
-            fd.seek(self.structPos, 0)
-            fd.seek(prop.offset)
-            buf = fd.read(prop.sz)
-            if buf[-1] == '\x00':
-                return buf[:-1]
-            return buf
-        if self.stream is not None:
-            return _get(self.stream)
-        else:
-            with open(self.path) as fd:
-                return _get(fd)
+        buf = self.getPropertyData(node.properties[propName])
+        if buf[-1:] == '\x00':
+            return buf[:-1]
+        return buf
+
+    def copyProperty(self, prop, wfd):
+        """Write the property data to the file object wfd.
+
+        Large payloads are copied straight from the mapping in chunks,
+        without building the whole property as a string first."""
+        if prop.offset+prop.sz > len(self.buf):
+            raise ValueError("truncated property %s" % prop.name)
+        pos = prop.offset
+        end = prop.offset+prop.sz
+        while pos < end:
+            n = min(self.COPY_CHUNK, end-pos)
+            wfd.write(self.buf[pos:pos+n])
+            pos += n
 
     def dumpNodeProperty(self, node, propIsh, outPath):
         if isinstance(propIsh, FdtProperty):
@@ -234,20 +250,8 @@ class Parser:
             if propIsh not in node.properties:
                 raise ValueError("missing property")
             prop = node.properties[propIsh]
-        def _dump(fd):
-            with open(outPath, "w") as wfd:
-                fd.seek(prop.offset, 0)
-                buf = fd.read(prop.sz)
-                wfd.write(buf)
-        if self.stream is not None:
-            try:
-                pos = self.stream.tell()
-                _dump(self.stream)
-            finally:
-                self.stream.seek(pos, 0)
-        else:
-            with open(self.path) as fd:
-                _dump(fd)
+        with open(outPath, "wb") as wfd:
+            self.copyProperty(prop, wfd)
 
     def getInitrdNode(self, profile=None):
         """U-boot mechanism to retrieve boot profile."""
@@ -289,6 +293,7 @@ class DumpRunner:
     def run(self):
         p = Parser(stream=self.stream, log=self.log)
         p.report()
+        p.close()
         return 0
 
     def shutdown(self):
@@ -344,6 +349,8 @@ class ExtractBase:
         raise NotImplementedError
 
     def shutdown(self):
+        parser, self.parser = self.parser, None
+        if parser is not None: parser.close()
         stream, self.stream = self.stream, None
         if stream is not None: stream.close()
 
@@ -370,9 +377,11 @@ class ExtractRunner(ExtractBase):
         if (self.numeric or self.timestamp) and self.dataProp.sz != 4:
             self.log.error("invalid size for number")
             return 1
-        def _dump(rfd, wfd):
-            rfd.seek(self.dataProp.offset, 0)
-            buf = rfd.read(self.dataProp.sz)
+        def _dump(wfd):
+            if not (self.text or self.numeric or self.timestamp or self.hex):
+                self.parser.copyProperty(self.dataProp, wfd)
+                return 0
+            buf = self.parser.getPropertyData(self.dataProp)
             if self.text:
                 if buf[-1:] != '\x00':
                     self.log.error("missing NUL terminator")
@@ -391,12 +400,11 @@ class ExtractRunner(ExtractBase):
                 for c in buf:
                     wfd.write("%02x" % ord(c))
                 return 0
-            wfd.write(buf)
             return 0
         if self.outStream is not None:
-            return _dump(self.stream, self.outStream)
+            return _dump(self.outStream)
         else:
-            return _dump(self.stream, sys.stdout)
+            return _dump(sys.stdout)
 
 class OffsetRunner(ExtractBase):
 
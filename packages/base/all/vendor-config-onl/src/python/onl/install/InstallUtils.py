@@ -1169,17 +1169,17 @@ class UbootInitrdContext(SubprocessMixin):
         if prop is None:
             raise ValueError("cannot find initrd data property in FDT")
 
-        with open(self.path) as fd:
-            self.log.debug("reading initrd at [%x:%x]",
-                           prop.offset, prop.offset+prop.sz)
-            fd.seek(prop.offset, 0)
-            buf = fd.read(prop.sz)
+        self.log.debug("reading initrd at [%x:%x]",
+                       prop.offset, prop.offset+prop.sz)
 
         fno, self.initrd = tempfile.mkstemp(prefix="initrd-",
                                             suffix=".img")
         self.log.debug("+ cat > %s", self.initrd)
-        with os.fdopen(fno, "w") as fd:
-            fd.write(buf)
+        try:
+            with os.fdopen(fno, "wb") as fd:
+                p.copyProperty(prop, fd)
+        finally:
+            p.close()
 
     def _extractLegacy(self):
         self.log.debug("parsing legacy U-Boot image in %s", self.path)
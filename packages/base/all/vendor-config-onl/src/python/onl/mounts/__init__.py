@@ -9,6 +9,11 @@ import json
 import yaml
 import tempfile
 import shutil
+import glob
+import fcntl
+import struct
+
+LOOP_GET_STATUS64 = 0x4C05
 
 class MountManager(object):
 
@@ -288,15 +293,45 @@ class OnlMountManager(object):
 
         return rv
 
+    def __loop_backing(self, device):
+        """Return a loop device backed by a file on this device, if any.
+
+        The loader loop-mounts the rootfs in place from the SWI. The
+        filesystem holding the SWI stays in use even if it is not
+        mounted anywhere, so it must not be checked."""
+        try:
+            rdev = os.stat(device).st_rdev
+        except OSError:
+            return None
+        for loop in sorted(glob.glob("/dev/loop[0-9]*")):
+            try:
+                fd = os.open(loop, os.O_RDONLY)
+            except OSError:
+                continue
+            try:
+                # struct loop_info64; lo_device is the first member
+                info = fcntl.ioctl(fd, LOOP_GET_STATUS64, '\0' * 232)
+            except IOError:
+                # not attached
+                continue
+            finally:
+                os.close(fd)
+            if struct.unpack_from("=Q", info)[0] == rdev:
+                return loop
+        return None
+
     def fsck(self, labels, force=False):
         labels = self.validate_labels(labels)
         for label in labels:
             m = self.__label_entry(label)
             if force or m.get('fsck', False):
-                if not self.mm.is_dev_mounted(m['device']):
-                    self.__fsck(label, m['device'])
-                else:
+                loop = self.__loop_backing(m['device'])
+                if self.mm.is_dev_mounted(m['device']):
                     self.logger.error("%s (%s) is mounted." % (label, m['device']))
+                elif loop:
+                    self.logger.info("%s (%s) is in use by %s, skipping fsck." % (label, m['device'], loop))
+                else:
+                    self.__fsck(label, m['device'])
 
 
     def mount(self, labels, mode=None):
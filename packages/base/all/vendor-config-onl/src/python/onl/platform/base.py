@@ -18,6 +18,96 @@ import onl.YamlUtils
 import subprocess
 import platform
 import ast
+import ctypes
+import errno
+import threading
+import Queue
+
+############################################################
+#
+# Kernel module loading
+#
+# Modules are loaded with finit_module(2) directly rather than
+# through a shell and insmod. If the syscall is not available
+# for this architecture we fall back to the insmod binary.
+#
+############################################################
+SYS_FINIT_MODULE = {
+    'x86_64'  : 313,
+    'i386'    : 350,
+    'i686'    : 350,
+    'aarch64' : 273,
+    'armv7l'  : 379,
+    'ppc'     : 353,
+    }.get(platform.machine())
+
+try:
+    _libc = ctypes.CDLL(None, use_errno=True)
+except OSError:
+    _libc = None
+
+def finit_module(path, params=""):
+    """Load the kernel module at path. Returns False if finit_module
+    is not supported here and the caller should use insmod. Failures
+    raise CalledProcessError, as insmod does, with the errno as the
+    return code."""
+    if _libc is None or SYS_FINIT_MODULE is None:
+        return False
+    fd = os.open(path, os.O_RDONLY)
+    try:
+        rv = _libc.syscall(SYS_FINIT_MODULE, fd, ctypes.c_char_p(params), 0)
+    finally:
+        os.close(fd)
+    if rv != 0:
+        e = ctypes.get_errno()
+        if e == errno.ENOSYS:
+            return False
+        raise subprocess.CalledProcessError(e, "finit_module %s %s" % (path, params),
+                                            os.strerror(e))
+    return True
+
+def modinfo_depends(path):
+    """Module names listed in the 'depends=' entry of a module's .modinfo."""
+    with open(path, 'rb') as f:
+        m = re.search(br'(?:^|\0)depends=([^\0]*)\0', f.read())
+    if m is None or not m.group(1):
+        return []
+    return [ d.decode() for d in m.group(1).split(b',') ]
+
+def module_name(f):
+    """Kernel module name for a module file name or insmod argument."""
+    f = os.path.basename(f)
+    if f.endswith('.ko'):
+        f = f[:-3]
+    return f.replace('-', '_')
+
+def run_parallel(fn, items, maxthreads=16):
+    """Call fn(item) for each item from up to maxthreads threads.
+    The first exception raised by any call is re-raised here."""
+    q = Queue.Queue()
+    for item in items:
+        q.put(item)
+    errors = []
+
+    def worker():
+        while True:
+            try:
+                item = q.get_nowait()
+            except Queue.Empty:
+                return
+            try:
+                fn(item)
+            except Exception:
+                errors.append(sys.exc_info())
+
+    threads = [ threading.Thread(target=worker) for i in range(min(maxthreads, len(items))) ]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    if errors:
+        (t, v, tb) = errors[0]
+        raise t, v, tb
 
 class OnlInfoObject(object):
     DEFAULT_INDENT="    "
@@ -192,7 +282,7 @@ class OnlPlatformBase(object):
     def baseconfig(self):
         return True
 
-    def insmod(self, module, required=True, params={}):
+    def module_searchdirs(self):
         #
         # Search for modules in this order:
         #
@@ -214,39 +304,93 @@ class OnlPlatformBase(object):
         basename = "-".join(self.PLATFORM.split('-')[:-1])
         odir = "%s/onl" % kdir
         vdir = "%s/%s" % (odir, self.MANUFACTURER.lower())
-        bdir = "%s/%s" % (vdir, basename)
-        pdir = "%s/%s" % (vdir, self.PLATFORM)
-
-        searchdirs = [ os.path.join(vdir, self.PLATFORM),
-                       os.path.join(vdir, basename),
-                       os.path.join(vdir, "common"),
-                       os.path.join(odir, "onl", "common"),
-                       odir,
-                       kdir,
-                       ]
-
-        trypaths = []
-        for d in searchdirs:
-            for e in [ ".ko", "" ]:
-                path = os.path.join(d, "%s%s" % (module, e))
-                if os.path.exists(path):
-                    cmd = "insmod %s %s" % (path, " ".join([ "%s=%s" % (k,v) for (k,v) in params.iteritems() ]))
-                    subprocess.check_call(cmd, shell=True);
-                    return True
-                else:
-                    trypaths.append(path)
+
+        return [ os.path.join(vdir, self.PLATFORM),
+                 os.path.join(vdir, basename),
+                 os.path.join(vdir, "common"),
+                 os.path.join(odir, "onl", "common"),
+                 odir,
+                 kdir,
+                 ]
+
+    def module_index(self):
+        # Resolve every module file in the search directories once,
+        # first match wins, instead of probing each path per module.
+        if getattr(self, '_module_index', None) is None:
+            index = {}
+            for d in self.module_searchdirs():
+                try:
+                    entries = os.listdir(d)
+                except OSError:
+                    continue
+                for e in entries:
+                    path = os.path.join(d, e)
+                    if e not in index and os.path.isfile(path):
+                        index[e] = path
+            self._module_index = index
+        return self._module_index
+
+    def module_path(self, module):
+        index = self.module_index()
+        for e in [ ".ko", "" ]:
+            path = index.get("%s%s" % (module, e))
+            if path is not None:
+                return path
+        return None
+
+    def module_load(self, path, params={}):
+        args = " ".join([ "%s=%s" % (k,v) for (k,v) in params.iteritems() ])
+        if not finit_module(path, args):
+            subprocess.check_call("insmod %s %s" % (path, args), shell=True)
+
+    def insmod(self, module, required=True, params={}):
+        path = self.module_path(module)
+        if path is not None:
+            self.module_load(path, params)
+            return True
 
         if required:
+            trypaths = [ os.path.join(d, "%s%s" % (module, e))
+                         for d in self.module_searchdirs() for e in [ ".ko", "" ] ]
             raise RuntimeError("kernel module %s could not be found.\n The following paths were searched: \n    %s\n" % (module, "\n   ".join(trypaths)))
         else:
             return False
 
+    def insmod_batch(self, modules, required=True, params={}):
+        #
+        # Load a set of modules, in parallel where their .modinfo
+        # dependencies allow it. Dependencies outside the batch are
+        # assumed to be loaded already. 'params' maps module
+        # arguments (as passed to insmod) to their parameters.
+        #
+        pending = {}
+        for module in modules:
+            path = self.module_path(module)
+            if path is None:
+                self.insmod(module, required=required)
+                continue
+            pending[module_name(module)] = (path, params.get(module, {}))
+
+        deps = dict([ (name, set(modinfo_depends(path)) & set(pending))
+                      for (name, (path, p)) in pending.items() ])
+
+        loaded = set()
+        while pending:
+            ready = [ name for name in pending if deps[name] <= loaded ]
+            if not ready:
+                raise RuntimeError("circular module dependencies: %s" % " ".join(sorted(pending)))
+            run_parallel(lambda name: self.module_load(*pending[name]), ready)
+            for name in ready:
+                del pending[name]
+                loaded.add(name)
+
     def insmod_platform(self):
         kv = os.uname()[2]
         # Insert all modules in the platform module directories
         directories = [ self.PLATFORM,
                         '-'.join(self.PLATFORM.split('-')[:-1]) ]
 
+        modules = []
         for subdir in directories:
             d = "/lib/modules/%s/onl/%s/%s" % (kv,
                                                self.MANUFACTURER.lower(),
@@ -254,7 +398,8 @@ class OnlPlatformBase(object):
             if os.path.isdir(d):
                 for f in os.listdir(d):
                     if f.endswith(".ko"):
-                        self.insmod(f)
+                        modules.append(f)
+        self.insmod_batch(modules)
 
     def onie_machine_get(self):
         mc = self.basedir_onl("etc/onie/machine.json")
@@ -426,8 +571,46 @@ class OnlPlatformBase(object):
         return self.new_device(driver, addr, bus, devdir)
 
     def new_i2c_devices(self, new_device_list):
-        for (driver, addr, bus_number) in new_device_list:
-            self.new_i2c_device(driver, addr, bus_number)
+        #
+        # Devices are created in list order, except that consecutive
+        # devices on sibling buses (channels of the same mux, which
+        # must already exist) are created concurrently, keeping list
+        # order per bus. Anything else, such as a device on a bus
+        # created by an earlier entry, starts a new run once the
+        # previous run is done.
+        #
+        def parent(bus_number):
+            path = '/sys/bus/i2c/devices/i2c-%d' % bus_number
+            if not os.path.exists(path):
+                return None
+            return os.path.dirname(os.path.realpath(path))
+
+        def create(devices):
+            for (driver, addr, bus_number) in devices:
+                self.new_i2c_device(driver, addr, bus_number)
+
+        def run(devices):
+            buses = {}
+            for d in devices:
+                buses.setdefault(d[2], []).append(d)
+            if len(buses) > 1:
+                run_parallel(create, buses.values())
+            else:
+                create(devices)
+
+        devices = []
+        devices_parent = None
+        for d in new_device_list:
+            p = parent(d[2])
+            if devices and (p is None or p != devices_parent):
+                run(devices)
+                devices = []
+                # The previous run may have created this bus
+                p = parent(d[2])
+            devices.append(d)
+            devices_parent = p
+        if devices:
+            run(devices)
 
     def ifnumber(self):
         # The default assumption for any platform
@@ -25,6 +25,7 @@
 
 #include <faultd/faultd_config.h>
 #include <AIM/aim_pvs.h>
+#include <stdint.h>
 
 /**
  * This structure contains the full fault information. 
@@ -63,15 +64,74 @@ typedef struct faultd_info_s {
      * This will store the output from backtrace_symbols_fd(). 
      *
      * When writing the message to the pipe, set it to non-zero. 
-     * The reader will then read additional bytes until the null 
-     * terminating byte is found. 
+     * The symbols are then sent with the rest of the message.
      *
      * The pointer will then be replaced on the receiving side. 
      *
+     * FAULTD_INFO_SYMBOLS_RAW indicates a faultd_raw_t record follows
+     * instead. The server symbolizes it and replaces the pointer
+     * with the result.
+     *
      */
     char* backtrace_symbols;
 
 } faultd_info_t; 
+
+/**
+ * backtrace_symbols marker for a raw fault record.
+ */
+#define FAULTD_INFO_SYMBOLS_RAW ((char*)2)
+
+#define FAULTD_RAW_MAGIC   0x57524446   /* "FDRW" */
+#define FAULTD_RAW_VERSION 1
+
+/**
+ * Build ID of a mapped object, read from its in-memory ELF notes.
+ */
+typedef struct faultd_build_id_s {
+    /** Start address of the object's first mapping. */
+    uint64_t start;
+    /** Build ID size in bytes. */
+    uint32_t size;
+    uint8_t id[32];
+} faultd_build_id_t;
+
+/**
+ * Raw fault record.
+ *
+ * This is captured by the fault handler using only async-signal-safe
+ * operations. No symbol lookup is done in the faulting process.
+ *
+ * The record is followed by:
+ *    regs[regs_size]            The raw machine context.
+ *    stack[stack_size]          Stack contents starting at stack_start.
+ *    maps[maps_size]            /proc/self/maps lines for executable and
+ *                               file header mappings. Not terminated.
+ *    faultd_build_id_t[build_id_count]
+ */
+typedef struct faultd_raw_s {
+    uint32_t magic;
+    uint32_t version;
+
+    /** Faulting PC, stack, frame and link registers. */
+    uint64_t pc;
+    uint64_t sp;
+    uint64_t fp;
+    uint64_t lr;
+
+    /** Address of the first captured stack byte. */
+    uint64_t stack_start;
+
+    uint32_t regs_size;
+    uint32_t stack_size;
+    uint32_t maps_size;
+    uint32_t build_id_count;
+} faultd_raw_t;
+
+/** Payload size following a raw record. */
+#define FAULTD_RAW_PAYLOAD_SIZE(_raw)                                   \
+    ((_raw)->regs_size + (_raw)->stack_size + (_raw)->maps_size +       \
+     (_raw)->build_id_count * sizeof(faultd_build_id_t))
     
 
 
@@ -168,6 +228,17 @@ int faultd_client_create(faultd_client_t** fco, const char* pipename);
  */
 int faultd_client_write(faultd_client_t* fco, faultd_info_t* info); 
 
+/**
+ * @brief Send a raw fault message to the server.
+ * @param fco The faultd client object.
+ * @param info The fault information.
+ * @param raw The raw record, followed by its payload.
+ * @note This is async-signal-safe. It will not block for longer
+ * than FAULTD_CONFIG_WRITE_TIMEOUT_MS.
+ */
+int faultd_client_write_raw(faultd_client_t* fco, faultd_info_t* info,
+                            const faultd_raw_t* raw);
+
 /**
  * @brief Destroy a client object. 
  * @param fco The faultd client object. 
@@ -158,6 +158,56 @@
 #define FAULTD_CONFIG_BACKTRACE_SYMBOLS_SIZE 4096
 #endif
 
+/**
+ * FAULTD_CONFIG_STACK_DUMP_SIZE
+ *
+ * Bytes of the faulting stack captured by the fault handler. */
+
+
+#ifndef FAULTD_CONFIG_STACK_DUMP_SIZE
+#define FAULTD_CONFIG_STACK_DUMP_SIZE 8192
+#endif
+
+/**
+ * FAULTD_CONFIG_MAPS_SIZE
+ *
+ * Maximum size of the /proc/self/maps snapshot captured by the fault handler. */
+
+
+#ifndef FAULTD_CONFIG_MAPS_SIZE
+#define FAULTD_CONFIG_MAPS_SIZE 16384
+#endif
+
+/**
+ * FAULTD_CONFIG_BUILD_IDS_MAX
+ *
+ * Maximum number of mapped object build IDs captured by the fault handler. */
+
+
+#ifndef FAULTD_CONFIG_BUILD_IDS_MAX
+#define FAULTD_CONFIG_BUILD_IDS_MAX 64
+#endif
+
+/**
+ * FAULTD_CONFIG_WRITE_TIMEOUT_MS
+ *
+ * Maximum time the fault handler waits for the server pipe to drain. */
+
+
+#ifndef FAULTD_CONFIG_WRITE_TIMEOUT_MS
+#define FAULTD_CONFIG_WRITE_TIMEOUT_MS 1000
+#endif
+
+/**
+ * FAULTD_CONFIG_SYMBOL_CACHE_SIZE
+ *
+ * Number of per-binary symbol indexes cached by the server. */
+
+
+#ifndef FAULTD_CONFIG_SYMBOL_CACHE_SIZE
+#define FAULTD_CONFIG_SYMBOL_CACHE_SIZE 16
+#endif
+
 /**
  * FAULTD_CONFIG_INCLUDE_MAIN
  *
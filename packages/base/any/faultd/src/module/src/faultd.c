@@ -28,8 +28,64 @@
 #include <errno.h>
 
 #include <execinfo.h>
+#include <limits.h>
+#include <poll.h>
+#include <sys/uio.h>
+#include "faultd_int.h"
 #include "faultd_log.h"
 
+/** Sanity limit on raw record payloads read by the server. */
+#define FAULTD_RAW_PAYLOAD_MAX (1024*1024)
+
+/**
+ * Messages are sent as a sequence of chunks. Each chunk is written
+ * with a single write() of at most PIPE_BUF bytes, which the kernel
+ * guarantees is not interleaved with writes from other clients on
+ * the same pipe. The server reassembles each message by pid and
+ * drops a message if a chunk is missing.
+ */
+#define FAULTD_CHUNK_MAGIC 0x4b484446   /* "FDHK" */
+
+typedef struct faultd_chunk_s {
+    uint32_t magic;
+    /** Sending process. */
+    uint32_t pid;
+    /** Chunk number within the message, starting at 0. */
+    uint32_t seq;
+    /** Data bytes in this chunk. */
+    uint32_t len;
+    /** Total message size. */
+    uint32_t total;
+} faultd_chunk_t;
+
+#define FAULTD_CHUNK_DATA_MAX (PIPE_BUF - sizeof(faultd_chunk_t))
+
+/** Largest message accepted by the server. */
+#define FAULTD_MESSAGE_MAX                                              \
+    (sizeof(faultd_info_t) + sizeof(faultd_raw_t) + FAULTD_RAW_PAYLOAD_MAX)
+
+/** Messages being reassembled at the same time. */
+#define FAULTD_MESSAGES_MAX 8
+
+/**
+ * A message being reassembled.
+ */
+typedef struct faultd_message_s {
+    /** Service and process the message is from. */
+    int sid;
+    uint32_t pid;
+
+    /** The next expected chunk. */
+    uint32_t seq;
+
+    uint32_t total;
+    uint32_t size;
+    uint8_t* data;
+
+    /** Chunk counter value at the last chunk, for eviction. */
+    uint32_t used;
+} faultd_message_t;
+
 
 typedef struct faultd_service_s {
     /** The filename of the named pipe */
@@ -76,6 +132,13 @@ struct faultd_server_s {
     faultd_service_t services[FAULTD_CONFIG_SERVICE_PIPES_MAX]; 
     /** The last service from which we read a message */
     int sid_last;
+
+    /** Messages being reassembled */
+    faultd_message_t messages[FAULTD_MESSAGES_MAX];
+    uint32_t chunks;
+
+    /** Receive buffer for one chunk */
+    uint8_t chunk[PIPE_BUF];
 }; /* faultd_server_t */
 
 
@@ -102,6 +165,9 @@ faultd_server_destroy(faultd_server_t* fso)
         for(i = 0; i < AIM_ARRAYSIZE(fso->services); i++) { 
             faultd_server_remove(fso, NULL, i); 
         }
+        for(i = 0; i < AIM_ARRAYSIZE(fso->messages); i++) {
+            aim_free(fso->messages[i].data);
+        }
         AIM_FREE(fso); 
     }
 }
@@ -237,6 +303,12 @@ faultd_server_process(faultd_server_t* fdo, faultd_sid_t sid,
 
 struct faultd_client_s { 
     faultd_service_t s;
+
+    /**
+     * Send buffer for one chunk. This is preallocated so the fault
+     * handler does not need to allocate or use its own stack.
+     */
+    uint8_t chunk[PIPE_BUF];
 }; /* faultd_client_t */
 
 int
@@ -282,37 +354,6 @@ faultd_client_destroy(faultd_client_t* fco)
     }
 }
 
-static int
-read_until__(int fd, char terminator, char* dst, int size)
-{
-    int rv; 
-    int count = 0;
-    char c; 
-
-    do { 
-        rv = read(fd, &c, 1); 
-        if(rv < 0) { 
-            if(errno == EINTR) { 
-                continue; 
-            }
-            else {
-                return rv; 
-            }
-        }
-        if(count < size) { 
-            dst[count] = c; 
-        }
-        if(c == terminator) { 
-            return count; 
-        }
-        count++; 
-    
-        /* Fixme - need a timeout */
-    } while(1);
-}
-
-
-
 static int
 read_size__(int fd, char* dst, int size)
 {
@@ -361,6 +402,21 @@ write_size__(int fd, char* src, int size)
                 /* Keep trying */
                 continue; 
             }
+            else if(errno == EAGAIN) {
+                /*
+                 * The pipe is full. Give the server a bounded amount
+                 * of time to drain it. We must never hang a faulting
+                 * process.
+                 */
+                struct pollfd pfd = { fd, POLLOUT, 0 };
+                do {
+                    rv = poll(&pfd, 1, FAULTD_CONFIG_WRITE_TIMEOUT_MS);
+                } while(rv < 0 && errno == EINTR);
+                if(rv <= 0) {
+                    return -1;
+                }
+                continue;
+            }
             else {
                 /*
                  * Write failed. Probably not good. 
@@ -426,6 +482,219 @@ faultd_wait_services__(faultd_server_t* fso, int sid, fd_set* rfds)
 }
 
 
+/**
+ * Decode a raw record and its payload and replace it with
+ * the symbolized report.
+ */
+static int
+faultd_raw_decode__(faultd_info_t* info, const uint8_t* data, uint32_t size)
+{
+    faultd_raw_t raw;
+
+    if(size < sizeof(raw)) {
+        return -1;
+    }
+    FAULTD_MEMCPY(&raw, data, sizeof(raw));
+    if(raw.magic != FAULTD_RAW_MAGIC || raw.version != FAULTD_RAW_VERSION ||
+       raw.build_id_count > FAULTD_RAW_PAYLOAD_MAX / sizeof(faultd_build_id_t) ||
+       raw.regs_size > FAULTD_RAW_PAYLOAD_MAX ||
+       raw.stack_size > FAULTD_RAW_PAYLOAD_MAX ||
+       raw.maps_size > FAULTD_RAW_PAYLOAD_MAX) {
+        return -1;
+    }
+    if(FAULTD_RAW_PAYLOAD_SIZE(&raw) != size - sizeof(raw)) {
+        return -1;
+    }
+
+    info->backtrace_symbols = faultd_symbols_decode(info, &raw,
+                                                    data + sizeof(raw));
+    return 0;
+}
+
+/**
+ * Decode a complete message.
+ */
+static int
+faultd_message_decode__(faultd_info_t* info, const uint8_t* data, uint32_t size)
+{
+    if(size < sizeof(*info)) {
+        return -1;
+    }
+    FAULTD_MEMCPY(info, data, sizeof(*info));
+    data += sizeof(*info);
+    size -= sizeof(*info);
+
+    /**
+     * Backtrace symbols information available? 
+     */
+    if(info->backtrace_symbols == FAULTD_INFO_SYMBOLS_RAW) {
+        info->backtrace_symbols = NULL;
+        return faultd_raw_decode__(info, data, size);
+    }
+    else if(info->backtrace_symbols) { 
+        /*
+         * The backtrace symbol information is of variable length. 
+         */
+        if(size >= FAULTD_CONFIG_BACKTRACE_SYMBOLS_SIZE) {
+            size = FAULTD_CONFIG_BACKTRACE_SYMBOLS_SIZE - 1;
+        }
+        info->backtrace_symbols = aim_zmalloc(size + 1); 
+        FAULTD_MEMCPY(info->backtrace_symbols, data, size);
+    }
+    return 0;
+}
+
+/**
+ * Read the next chunk header from the pipe.
+ *
+ * Chunks are written atomically, so the pipe only loses
+ * alignment if something other than a faultd client writes to it.
+ * In that case, skip to the next chunk magic.
+ */
+static int
+faultd_chunk_header_read__(int fd, faultd_chunk_t* hdr)
+{
+    uint32_t magic;
+
+    if(read_size__(fd, (char*)&magic, sizeof(magic)) < 0) {
+        return -1;
+    }
+    while(magic != FAULTD_CHUNK_MAGIC) {
+        uint8_t c;
+        if(read_size__(fd, (char*)&c, 1) < 0) {
+            return -1;
+        }
+        magic = (magic >> 8) | ((uint32_t)c << 24);
+    }
+    hdr->magic = magic;
+    return read_size__(fd, (char*)hdr + sizeof(magic),
+                       sizeof(*hdr) - sizeof(magic));
+}
+
+static void
+faultd_message_drop__(faultd_message_t* m)
+{
+    aim_free(m->data);
+    FAULTD_MEMSET(m, 0, sizeof(*m));
+}
+
+/**
+ * Add a chunk to its message.
+ * Returns the completed message, or NULL.
+ */
+static faultd_message_t*
+faultd_message_add__(faultd_server_t* fso, int sid,
+                     const faultd_chunk_t* hdr, const uint8_t* data)
+{
+    int i;
+    faultd_message_t* m = NULL;
+    faultd_message_t* oldest = NULL;
+
+    fso->chunks++;
+
+    /*
+     * Find the message this chunk belongs to, and the slot to use if
+     * it starts a new one: a free slot, or else the message that has
+     * waited longest for its next chunk.
+     */
+    for(i = 0; i < AIM_ARRAYSIZE(fso->messages); i++) {
+        faultd_message_t* mp = fso->messages + i;
+        if(mp->data && mp->sid == sid && mp->pid == hdr->pid) {
+            m = mp;
+            break;
+        }
+        if(mp->data == NULL) {
+            if(oldest == NULL || oldest->data) {
+                oldest = mp;
+            }
+        }
+        else if(oldest == NULL ||
+                (oldest->data &&
+                 fso->chunks - mp->used > fso->chunks - oldest->used)) {
+            oldest = mp;
+        }
+    }
+
+    if(m && (hdr->seq != m->seq || hdr->total != m->total)) {
+        /*
+         * A chunk is missing, or the process started a new message
+         * after giving up on this one. Drop the partial message.
+         */
+        AIM_LOG_ERROR("incomplete message from pid %d dropped.", m->pid);
+        faultd_message_drop__(m);
+        m = NULL;
+    }
+
+    if(m == NULL) {
+        if(hdr->seq != 0) {
+            /* The start of this message was lost. */
+            return NULL;
+        }
+        if(hdr->total > FAULTD_MESSAGE_MAX) {
+            AIM_LOG_ERROR("oversized message from pid %d dropped.", hdr->pid);
+            return NULL;
+        }
+        m = oldest;
+        if(m->data) {
+            AIM_LOG_ERROR("incomplete message from pid %d dropped.", m->pid);
+            faultd_message_drop__(m);
+        }
+        m->sid = sid;
+        m->pid = hdr->pid;
+        m->total = hdr->total;
+        m->data = aim_zmalloc(hdr->total + 1);
+    }
+
+    if(hdr->len > m->total - m->size) {
+        AIM_LOG_ERROR("invalid message from pid %d dropped.", m->pid);
+        faultd_message_drop__(m);
+        return NULL;
+    }
+    FAULTD_MEMCPY(m->data + m->size, data, hdr->len);
+    m->size += hdr->len;
+    m->seq++;
+    m->used = fso->chunks;
+
+    return (m->size == m->total) ? m : NULL;
+}
+
+/**
+ * Read one chunk from the given service.
+ * Returns 1 if it completed a message, which is decoded into info.
+ */
+static int
+faultd_service_read__(faultd_server_t* fso, int sid, faultd_info_t* info)
+{
+    int rv;
+    faultd_chunk_t hdr;
+    faultd_message_t* m;
+    int fd = fso->services[sid].pipefd;
+
+    if(faultd_chunk_header_read__(fd, &hdr) < 0) {
+        return -1;
+    }
+    if(hdr.len > FAULTD_CHUNK_DATA_MAX) {
+        /* Not a chunk we sent. Look for the next one. */
+        return 0;
+    }
+    if(read_size__(fd, (char*)fso->chunk, hdr.len) < 0) {
+        return -1;
+    }
+
+    m = faultd_message_add__(fso, sid, &hdr, fso->chunk);
+    if(m == NULL) {
+        return 0;
+    }
+
+    rv = faultd_message_decode__(info, m->data, m->size);
+    faultd_message_drop__(m);
+    if(rv < 0) {
+        AIM_LOG_ERROR("invalid fault message on pipe.");
+        return 0;
+    }
+    return 1;
+}
+
 int 
 faultd_server_read(faultd_server_t* fso, faultd_info_t* info, int sid)
 {
@@ -434,75 +703,147 @@ faultd_server_read(faultd_server_t* fso, faultd_info_t* info, int sid)
     fd_set rfds;
     int count; 
 
-    rv = faultd_wait_services__(fso, sid, &rfds); 
-    
-    if(rv < 0) { 
-        /* Error on select or sid */
-        return rv; 
+    for(;;) {
+        rv = faultd_wait_services__(fso, sid, &rfds); 
+
+        if(rv < 0) { 
+            /* Error on select or sid */
+            return rv; 
+        }
+
+        /** 
+         * Read a chunk on each ready descriptor.
+         *
+         * If we're polling all services, we start looking for the 
+         * next sid after the last sid we've received a message on. 
+         * This avoids starvation if multiple services are producing
+         * messages. This is unlikely to be a problem under normal
+         * circumstances and use cases, but can be avoided easily nonetheless. 
+         */
+        for(i = fso->sid_last+1, count = 0; 
+            count < AIM_ARRAYSIZE(fso->services); 
+            i++, count++) { 
+            int s = i % AIM_ARRAYSIZE(fso->services); 
+            if(fso->services[s].pipefd && FD_ISSET(fso->services[s].pipefd, &rfds)) { 
+                rv = faultd_service_read__(fso, s, info);
+
+                if(rv < 0) { 
+                    /* Do something here, like restare the pipe */
+                    AIM_LOG_ERROR("truncated read on pipe."); 
+                    continue; 
+                }
+                if(rv == 1) {
+                    info->pipename = fso->services[s].pipename; 
+                    fso->sid_last = s; 
+                    return s; 
+                }
+            }
+        }
     }
+}
 
-    /** 
-     * Read message on a ready descriptor.
-     *
-     * If we're polling all services, we start looking for the 
-     * next sid after the last sid we've received a message on. 
-     * This avoids starvation if multiple services are producing
-     * messages. This is unlikely to be a problem under normal
-     * circumstances and use cases, but can be avoided easily nonetheless. 
-     */
-    for(i = fso->sid_last+1, count = 0; 
-        count < AIM_ARRAYSIZE(fso->services); 
-        i++, count++) { 
-        int s = i % AIM_ARRAYSIZE(fso->services); 
-        if(FD_ISSET(fso->services[s].pipefd, &rfds)) { 
-            rv = read_size__(fso->services[s].pipefd, (char*)info, sizeof(*info)); 
-    
-            if(rv < 0) { 
-                /* Do something here, like restare the pipe */
-                AIM_LOG_ERROR("truncated read on pipe."); 
-                continue; 
+/**
+ * Send one message as a sequence of chunks.
+ * This is async-signal-safe.
+ */
+static int
+faultd_client_send__(faultd_client_t* fco, const struct iovec* iov, int iovcnt)
+{
+    int i;
+    uint32_t total = 0;
+    faultd_chunk_t* hdr = (faultd_chunk_t*)fco->chunk;
+    uint8_t* data = fco->chunk + sizeof(*hdr);
+
+    for(i = 0; i < iovcnt; i++) {
+        total += iov[i].iov_len;
+    }
+
+    hdr->magic = FAULTD_CHUNK_MAGIC;
+    hdr->pid = getpid();
+    hdr->seq = 0;
+    hdr->len = 0;
+    hdr->total = total;
+
+    for(i = 0; i < iovcnt; i++) {
+        const uint8_t* p = iov[i].iov_base;
+        size_t remaining = iov[i].iov_len;
+        while(remaining) {
+            size_t len = FAULTD_CHUNK_DATA_MAX - hdr->len;
+            if(len > remaining) {
+                len = remaining;
             }
-            
-            /**
-             * Backtrace symbols information available? 
-             */
-            if(info->backtrace_symbols) { 
-                /*
-                 * The backtrace symbol information is of variable length. 
-                 */
-                info->backtrace_symbols = aim_zmalloc(FAULTD_CONFIG_BACKTRACE_SYMBOLS_SIZE); 
-                /* Backtrace symbols are terminated with a null character. */
-                read_until__(fso->services[s].pipefd, 0, info->backtrace_symbols, 
-                             FAULTD_CONFIG_BACKTRACE_SYMBOLS_SIZE); 
+            FAULTD_MEMCPY(data + hdr->len, p, len);
+            hdr->len += len;
+            p += len;
+            remaining -= len;
+
+            if(hdr->len == FAULTD_CHUNK_DATA_MAX) {
+                if(write_size__(fco->s.pipefd, (char*)fco->chunk,
+                                sizeof(*hdr) + hdr->len) < 0) {
+                    return -1;
+                }
+                hdr->seq++;
+                hdr->len = 0;
             }
-
-            info->pipename = fso->services[s].pipename; 
-            fso->sid_last = s; 
-            return s; 
         }
     }
-    /* Error while reading on the only ready descriptor */
-    return -1; 
+    if(hdr->len || hdr->seq == 0) {
+        if(write_size__(fco->s.pipefd, (char*)fco->chunk,
+                        sizeof(*hdr) + hdr->len) < 0) {
+            return -1;
+        }
+    }
+    return 0;
 }
-        
  
 int
 faultd_client_write(faultd_client_t* fco, faultd_info_t* info)
 {
-    int rv = write_size__(fco->s.pipefd, (char*)info, sizeof(*info)); 
-    
-    if(rv < 0) { 
-        return rv; 
-    }
+    int rv;
+    struct iovec iov[2];
+    char** symbols = NULL;
+    char* buffer = NULL;
+
+    iov[0].iov_base = info;
+    iov[0].iov_len = sizeof(*info);
+    iov[1].iov_base = NULL;
+    iov[1].iov_len = 0;
 
     if(info->backtrace_symbols) { 
-        char c = 0; 
-        backtrace_symbols_fd(info->backtrace, info->backtrace_size, 
-                             fco->s.pipefd); 
-        /* Terminate backtrace symbols with a null character. */
-        write_size__(fco->s.pipefd, &c, 1); 
+        int i;
+        int size = 0;
+        symbols = backtrace_symbols(info->backtrace, info->backtrace_size);
+        if(symbols) {
+            for(i = 0; i < info->backtrace_size; i++) {
+                size += strlen(symbols[i]) + 1;
+            }
+            buffer = aim_zmalloc(size + 1);
+            for(i = 0, size = 0; i < info->backtrace_size; i++) {
+                size += sprintf(buffer + size, "%s\n", symbols[i]);
+            }
+            free(symbols);
+            iov[1].iov_base = buffer;
+            iov[1].iov_len = size;
+        }
     }
-    return 0; 
+
+    rv = faultd_client_send__(fco, iov, 2);
+    aim_free(buffer);
+    return rv;
+}
+
+int
+faultd_client_write_raw(faultd_client_t* fco, faultd_info_t* info,
+                        const faultd_raw_t* raw)
+{
+    struct iovec iov[2];
+
+    info->backtrace_symbols = FAULTD_INFO_SYMBOLS_RAW;
+    iov[0].iov_base = info;
+    iov[0].iov_len = sizeof(*info);
+    iov[1].iov_base = (void*)raw;
+    iov[1].iov_len = sizeof(*raw) + FAULTD_RAW_PAYLOAD_SIZE(raw);
+    return faultd_client_send__(fco, iov, 2);
 }
 
 int
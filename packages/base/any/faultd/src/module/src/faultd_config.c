@@ -85,6 +85,31 @@ faultd_config_settings_t faultd_config_settings[] =
 #else
 { FAULTD_CONFIG_BACKTRACE_SYMBOLS_SIZE(__faultd_config_STRINGIFY_NAME), "__undefined__" },
 #endif
+#ifdef FAULTD_CONFIG_STACK_DUMP_SIZE
+    { __faultd_config_STRINGIFY_NAME(FAULTD_CONFIG_STACK_DUMP_SIZE), __faultd_config_STRINGIFY_VALUE(FAULTD_CONFIG_STACK_DUMP_SIZE) },
+#else
+{ FAULTD_CONFIG_STACK_DUMP_SIZE(__faultd_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef FAULTD_CONFIG_MAPS_SIZE
+    { __faultd_config_STRINGIFY_NAME(FAULTD_CONFIG_MAPS_SIZE), __faultd_config_STRINGIFY_VALUE(FAULTD_CONFIG_MAPS_SIZE) },
+#else
+{ FAULTD_CONFIG_MAPS_SIZE(__faultd_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef FAULTD_CONFIG_BUILD_IDS_MAX
+    { __faultd_config_STRINGIFY_NAME(FAULTD_CONFIG_BUILD_IDS_MAX), __faultd_config_STRINGIFY_VALUE(FAULTD_CONFIG_BUILD_IDS_MAX) },
+#else
+{ FAULTD_CONFIG_BUILD_IDS_MAX(__faultd_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef FAULTD_CONFIG_WRITE_TIMEOUT_MS
+    { __faultd_config_STRINGIFY_NAME(FAULTD_CONFIG_WRITE_TIMEOUT_MS), __faultd_config_STRINGIFY_VALUE(FAULTD_CONFIG_WRITE_TIMEOUT_MS) },
+#else
+{ FAULTD_CONFIG_WRITE_TIMEOUT_MS(__faultd_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef FAULTD_CONFIG_SYMBOL_CACHE_SIZE
+    { __faultd_config_STRINGIFY_NAME(FAULTD_CONFIG_SYMBOL_CACHE_SIZE), __faultd_config_STRINGIFY_VALUE(FAULTD_CONFIG_SYMBOL_CACHE_SIZE) },
+#else
+{ FAULTD_CONFIG_SYMBOL_CACHE_SIZE(__faultd_config_STRINGIFY_NAME), "__undefined__" },
+#endif
 #ifdef FAULTD_CONFIG_INCLUDE_MAIN
     { __faultd_config_STRINGIFY_NAME(FAULTD_CONFIG_INCLUDE_MAIN), __faultd_config_STRINGIFY_VALUE(FAULTD_CONFIG_INCLUDE_MAIN) },
 #else
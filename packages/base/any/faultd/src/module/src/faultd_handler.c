@@ -28,7 +28,8 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <stdlib.h>
-#include <execinfo.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <signal.h>
 #include <sys/ucontext.h>
 #include <sys/types.h>
@@ -41,6 +42,8 @@
 #include <string.h>
 #include <time.h>
 #include <pthread.h>
+#include <link.h>
+#include <elf.h>
 #define _XOPEN_SOURCE 600
 #include <sys/select.h>
 
@@ -50,32 +53,501 @@ static faultd_client_t* faultd_client__ = NULL;
 static faultd_info_t faultd_info__;
 static int localfd__ = -1;
 
-int signal_backtrace__(void** buffer, int size, ucontext_t* context,
-                              int distance)
-{
-#define IP_STACK_FRAME_NUMBER 3
+/*
+ * Everything below runs in the signal handler of a process that may
+ * have a corrupted heap, held malloc or loader locks, or a damaged
+ * stack. It must only use async-signal-safe calls and preallocated
+ * storage. In particular it cannot use backtrace(), which may load
+ * the unwinder and allocate, or backtrace_symbols*() and strsignal().
+ *
+ * The handler captures the raw PCs, registers, part of the stack and
+ * a /proc/self/maps snapshot. The faultd server symbolizes them.
+ */
 
-    int rv;
-    rv = backtrace(buffer, size);
+/** Maximum machine context captured. */
+#define FAULTD_REGS_SIZE_MAX 1024
+
+#if defined(__x86_64__)
+/** The stack below sp that leaf functions may use. */
+#define FAULTD_STACK_RED_ZONE 128
+#else
+#define FAULTD_STACK_RED_ZONE 0
+#endif
+
+static char maps__[FAULTD_CONFIG_MAPS_SIZE];
+static int maps_size__;
+static faultd_build_id_t build_ids__[FAULTD_CONFIG_BUILD_IDS_MAX];
+static int build_id_count__;
 
-    if(context) {
-        distance += IP_STACK_FRAME_NUMBER;
+/** The stack mapping containing the faulting sp. */
+static uintptr_t stack_lo__;
+static uintptr_t stack_hi__;
 
-#ifdef __i386__
-        buffer[distance] = (void*)(context->uc_mcontext.gregs[REG_EIP]);
+static struct {
+    faultd_raw_t raw;
+    uint8_t payload[FAULTD_REGS_SIZE_MAX + FAULTD_CONFIG_STACK_DUMP_SIZE +
+                    FAULTD_CONFIG_MAPS_SIZE + sizeof(build_ids__)];
+} record__;
+
+static void
+context_registers__(ucontext_t* uc, faultd_raw_t* raw,
+                    const void** regs, int* regs_size)
+{
+    *regs = NULL;
+    *regs_size = 0;
+
+    if(uc == NULL) {
+        return;
+    }
+
+#if defined(__x86_64__)
+    raw->pc = uc->uc_mcontext.gregs[REG_RIP];
+    raw->sp = uc->uc_mcontext.gregs[REG_RSP];
+    raw->fp = uc->uc_mcontext.gregs[REG_RBP];
+    *regs = uc->uc_mcontext.gregs;
+    *regs_size = sizeof(uc->uc_mcontext.gregs);
+#elif defined(__i386__)
+    raw->pc = uc->uc_mcontext.gregs[REG_EIP];
+    raw->sp = uc->uc_mcontext.gregs[REG_ESP];
+    raw->fp = uc->uc_mcontext.gregs[REG_EBP];
+    *regs = uc->uc_mcontext.gregs;
+    *regs_size = sizeof(uc->uc_mcontext.gregs);
+#elif defined(__PPC__) && !defined(__powerpc64__)
+    raw->pc = uc->uc_mcontext.regs->nip;
+    raw->sp = uc->uc_mcontext.regs->gpr[1];
+    raw->fp = uc->uc_mcontext.regs->gpr[1];
+    raw->lr = uc->uc_mcontext.regs->link;
+    *regs = uc->uc_mcontext.regs;
+    *regs_size = sizeof(*uc->uc_mcontext.regs);
+#elif defined(__aarch64__)
+    raw->pc = uc->uc_mcontext.pc;
+    raw->sp = uc->uc_mcontext.sp;
+    raw->fp = uc->uc_mcontext.regs[29];
+    raw->lr = uc->uc_mcontext.regs[30];
+    *regs = &uc->uc_mcontext;
+    *regs_size = offsetof(mcontext_t, __reserved);
+#elif defined(__arm__)
+    raw->pc = uc->uc_mcontext.arm_pc;
+    raw->sp = uc->uc_mcontext.arm_sp;
+    raw->fp = uc->uc_mcontext.arm_fp;
+    raw->lr = uc->uc_mcontext.arm_lr;
+    *regs = &uc->uc_mcontext;
+    *regs_size = sizeof(uc->uc_mcontext);
 #endif
-#ifdef __PPC__
-        buffer[distance] = (void*)(context->uc_mcontext.regs->nip);
+
+    if(*regs_size > FAULTD_REGS_SIZE_MAX) {
+        *regs_size = FAULTD_REGS_SIZE_MAX;
+    }
+}
+
+static const char*
+hex_parse__(const char* p, const char* end, uintptr_t* value)
+{
+    uintptr_t v = 0;
+    for(; p < end; p++) {
+        int d;
+        if(*p >= '0' && *p <= '9') {
+            d = *p - '0';
+        }
+        else if(*p >= 'a' && *p <= 'f') {
+            d = *p - 'a' + 10;
+        }
+        else {
+            break;
+        }
+        v = (v << 4) | d;
+    }
+    *value = v;
+    return p;
+}
+
+#define NOTE_ALIGN(_x) (((_x) + 3) & ~3)
+
+/**
+ * Read the GNU build ID from the ELF header mapped at start.
+ * The mapping is readable and starts at file offset 0 of a regular
+ * file. Only the first size bytes are read, which are backed by
+ * both the mapping and the file, so this cannot fault.
+ */
+static int
+build_id_read__(uintptr_t start, uintptr_t size, faultd_build_id_t* bid)
+{
+    const ElfW(Ehdr)* eh = (const ElfW(Ehdr)*)start;
+    const ElfW(Phdr)* ph;
+    int i;
+
+    if(size < sizeof(*eh) ||
+       memcmp(eh->e_ident, ELFMAG, SELFMAG) ||
+       eh->e_phentsize != sizeof(*ph) ||
+       eh->e_phoff + (uintptr_t)eh->e_phnum * sizeof(*ph) > size) {
+        return -1;
+    }
+
+    ph = (const ElfW(Phdr)*)(start + eh->e_phoff);
+    for(i = 0; i < eh->e_phnum; i++) {
+        uintptr_t n, end;
+        if(ph[i].p_type != PT_NOTE ||
+           ph[i].p_offset + ph[i].p_filesz > size) {
+            continue;
+        }
+        n = start + ph[i].p_offset;
+        end = n + ph[i].p_filesz;
+        while(n + sizeof(ElfW(Nhdr)) <= end) {
+            const ElfW(Nhdr)* nh = (const ElfW(Nhdr)*)n;
+            uintptr_t name = n + sizeof(*nh);
+            uintptr_t desc = name + NOTE_ALIGN(nh->n_namesz);
+            uintptr_t next = desc + NOTE_ALIGN(nh->n_descsz);
+            if(next > end || next <= n) {
+                break;
+            }
+            if(nh->n_type == NT_GNU_BUILD_ID && nh->n_namesz == 4 &&
+               !memcmp((const void*)name, "GNU", 4)) {
+                bid->start = start;
+                bid->size = nh->n_descsz;
+                if(bid->size > sizeof(bid->id)) {
+                    bid->size = sizeof(bid->id);
+                }
+                FAULTD_MEMCPY(bid->id, (const void*)desc, bid->size);
+                return 0;
+            }
+            n = next;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Return the number of bytes of a file mapping that can be read
+ * without faulting, or 0 if it is not a mapping of a regular file.
+ *
+ * Device mappings (/dev/mem, UIO) must never be probed, and reading
+ * a mapping past the end of a truncated file raises SIGBUS.
+ */
+static uintptr_t
+file_readable__(const char* path, int len, uintptr_t size)
+{
+    static char name[512];
+    struct stat st;
+
+    if(len <= 0 || len >= sizeof(name) || path[0] != '/' ||
+       !memcmp(path, "/dev/", 5)) {
+        return 0;
+    }
+    FAULTD_MEMCPY(name, path, len);
+    name[len] = 0;
+
+    /* stat() is async-signal-safe. Deleted files fail here. */
+    if(stat(name, &st) < 0 || !S_ISREG(st.st_mode)) {
+        return 0;
+    }
+    return ((uintptr_t)st.st_size < size) ? (uintptr_t)st.st_size : size;
+}
+
+/**
+ * Process one /proc/self/maps line.
+ *
+ * Executable mappings and the first mapping of each regular file are
+ * kept in the snapshot. The mapping containing sp bounds the stack.
+ */
+static void
+maps_line__(const char* line, int len, uintptr_t sp)
+{
+    const char* end = line + len;
+    const char* p;
+    const char* perms;
+    uintptr_t start, stop, offset, readable = 0;
+    int field, header;
+
+    p = hex_parse__(line, end, &start);
+    if(p >= end || *p != '-') {
+        return;
+    }
+    p = hex_parse__(p + 1, end, &stop);
+    /* " rwxp " */
+    if(p + 6 >= end) {
+        return;
+    }
+    perms = p + 1;
+    p = hex_parse__(p + 6, end, &offset);
+
+    /* Skip the device and inode to the path. */
+    for(field = 0; field < 2; field++) {
+        while(p < end && *p == ' ') p++;
+        while(p < end && *p != ' ') p++;
+    }
+    while(p < end && *p == ' ') p++;
+
+    if(sp >= start && sp < stop) {
+        stack_lo__ = start;
+        stack_hi__ = stop;
+    }
+
+    header = (offset == 0 && perms[0] == 'r' && p < end && *p == '/');
+    if(header) {
+        readable = file_readable__(p, end - p, stop - start);
+        header = (readable != 0);
+    }
+
+    if((perms[2] == 'x' || header) &&
+       maps_size__ + len + 1 <= sizeof(maps__)) {
+        FAULTD_MEMCPY(maps__ + maps_size__, line, len);
+        maps_size__ += len;
+        maps__[maps_size__++] = '\n';
+    }
+
+    if(header && build_id_count__ < AIM_ARRAYSIZE(build_ids__) &&
+       build_id_read__(start, readable, build_ids__ + build_id_count__) == 0) {
+        build_id_count__++;
+    }
+}
+
+static void
+maps_capture__(uintptr_t sp)
+{
+    static char buf[1024];
+    static char line[512];
+    int len = 0;
+    int fd, rv, i;
+
+    maps_size__ = 0;
+    build_id_count__ = 0;
+    stack_lo__ = stack_hi__ = 0;
+
+    if((fd = open("/proc/self/maps", O_RDONLY)) < 0) {
+        return;
+    }
+    for(;;) {
+        rv = read(fd, buf, sizeof(buf));
+        if(rv < 0 && errno == EINTR) {
+            continue;
+        }
+        if(rv <= 0) {
+            break;
+        }
+        for(i = 0; i < rv; i++) {
+            if(buf[i] == '\n') {
+                maps_line__(line, len, sp);
+                len = 0;
+            }
+            else if(len < sizeof(line)) {
+                /* Overlong paths are truncated. */
+                line[len++] = buf[i];
+            }
+        }
+    }
+    if(len) {
+        maps_line__(line, len, sp);
+    }
+    close(fd);
+}
+
+/**
+ * Walk the frame chain. Every frame is checked against the stack
+ * mapping before it is dereferenced, so garbage frame pointers
+ * (e.g. code built without them) end the walk instead of faulting.
+ * The server scans the captured stack for anything missed here.
+ */
+static int
+frames_walk__(const faultd_raw_t* raw, void** frames, int max)
+{
+    int count = 0;
+    uintptr_t frame;
+
+    frames[count++] = (void*)(uintptr_t)raw->pc;
+
+    if(stack_hi__ == 0) {
+        return count;
+    }
+
+#if defined(__PPC__) && !defined(__powerpc64__)
+    /* Back chain. The caller saves LR in the word after its back chain. */
+    frame = raw->sp;
+    while(count < max) {
+        uintptr_t next = ((uintptr_t*)frame)[0];
+        uintptr_t ret;
+        if(next <= frame || (next & 0xf) ||
+           next + 2*sizeof(uintptr_t) > stack_hi__) {
+            break;
+        }
+        if((ret = ((uintptr_t*)next)[1]) == 0) {
+            break;
+        }
+        frames[count++] = (void*)ret;
+        frame = next;
+    }
+#elif defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+    /* { previous frame, return address } records. */
+    frame = raw->fp;
+    while(count < max) {
+        uintptr_t next, ret;
+        if(frame < raw->sp || (frame & (sizeof(uintptr_t)-1)) ||
+           frame + 2*sizeof(uintptr_t) > stack_hi__) {
+            break;
+        }
+        next = ((uintptr_t*)frame)[0];
+        if((ret = ((uintptr_t*)frame)[1]) == 0) {
+            break;
+        }
+        frames[count++] = (void*)ret;
+        if(next <= frame) {
+            break;
+        }
+        frame = next;
+    }
+#else
+    (void)frame;
+    if(raw->lr && count < max) {
+        frames[count++] = (void*)(uintptr_t)raw->lr;
+    }
 #endif
-        /* Note -- 64bit does not require require modifications */
+    return count;
+}
+
+/**
+ * Capture the raw fault record into record__ and the frame
+ * PCs into faultd_info__.backtrace.
+ */
+static void
+fault_capture__(ucontext_t* uc)
+{
+    faultd_raw_t* raw = &record__.raw;
+    uint8_t* p = record__.payload;
+    const void* regs;
+    int regs_size;
+    uintptr_t start, stop;
+
+    FAULTD_MEMSET(raw, 0, sizeof(*raw));
+    raw->magic = FAULTD_RAW_MAGIC;
+    raw->version = FAULTD_RAW_VERSION;
+
+    context_registers__(uc, raw, &regs, &regs_size);
+    maps_capture__(raw->sp);
+
+    faultd_info__.backtrace_size =
+        frames_walk__(raw, faultd_info__.backtrace,
+                      AIM_ARRAYSIZE(faultd_info__.backtrace));
+
+    FAULTD_MEMCPY(p, regs, regs_size);
+    raw->regs_size = regs_size;
+    p += regs_size;
+
+    if(stack_hi__) {
+        start = raw->sp - FAULTD_STACK_RED_ZONE;
+        if(start < stack_lo__ || start > raw->sp) {
+            start = stack_lo__;
+        }
+        start &= ~(sizeof(uintptr_t)-1);
+        stop = start + FAULTD_CONFIG_STACK_DUMP_SIZE;
+        if(stop > stack_hi__ || stop < start) {
+            stop = stack_hi__;
+        }
+        FAULTD_MEMCPY(p, (const void*)start, stop - start);
+        raw->stack_start = start;
+        raw->stack_size = stop - start;
+        p += raw->stack_size;
     }
-    return rv;
+
+    FAULTD_MEMCPY(p, maps__, maps_size__);
+    raw->maps_size = maps_size__;
+    p += maps_size__;
+
+    FAULTD_MEMCPY(p, build_ids__, build_id_count__ * sizeof(build_ids__[0]));
+    raw->build_id_count = build_id_count__;
 }
-  #include <AIM/aim_pvs.h>
+
+
+/*
+ * Async-signal-safe output to the local descriptor.
+ */
+static void
+fd_puts__(int fd, const char* s)
+{
+    int rv = write(fd, s, strlen(s));
+    (void)rv;
+}
+
+static void
+fd_hex__(int fd, uintptr_t v)
+{
+    char buf[2 + 2*sizeof(v) + 1];
+    int i = sizeof(buf) - 1;
+    buf[i] = 0;
+    do {
+        buf[--i] = "0123456789abcdef"[v & 0xf];
+        v >>= 4;
+    } while(v);
+    buf[--i] = 'x';
+    buf[--i] = '0';
+    fd_puts__(fd, buf + i);
+}
+
+static void
+fd_dec__(int fd, int v)
+{
+    char buf[16];
+    int i = sizeof(buf) - 1;
+    unsigned int u = (v < 0) ? -v : v;
+    buf[i] = 0;
+    do {
+        buf[--i] = '0' + (u % 10);
+        u /= 10;
+    } while(u);
+    if(v < 0) {
+        buf[--i] = '-';
+    }
+    fd_puts__(fd, buf + i);
+}
+
+static const char*
+signal_name__(int signal)
+{
+    switch(signal)
+        {
+        case SIGSEGV: return "SIGSEGV";
+        case SIGILL: return "SIGILL";
+        case SIGFPE: return "SIGFPE";
+        case SIGBUS: return "SIGBUS";
+        case SIGQUIT: return "SIGQUIT";
+        case SIGALRM: return "SIGALRM";
+        case SIGUSR2: return "SIGUSR2";
+        default: return "signal";
+        }
+}
+
+/**
+ * Write the signal, raw PCs and maps snapshot to the local
+ * descriptor. This is enough to symbolize the fault offline with
+ * addr2line.
+ */
+static void
+local_write__(int fd)
+{
+    int i;
+
+    fd_puts__(fd, signal_name__(faultd_info__.signal));
+    fd_puts__(fd, " (");
+    fd_dec__(fd, faultd_info__.signal);
+    fd_puts__(fd, ") pid ");
+    fd_dec__(fd, faultd_info__.pid);
+    fd_puts__(fd, " tid ");
+    fd_dec__(fd, faultd_info__.tid);
+    fd_puts__(fd, " address ");
+    fd_hex__(fd, (uintptr_t)faultd_info__.fault_address);
+    fd_puts__(fd, "\nbacktrace:\n");
+    for(i = 0; i < faultd_info__.backtrace_size; i++) {
+        fd_puts__(fd, "    ");
+        fd_hex__(fd, (uintptr_t)faultd_info__.backtrace[i]);
+        fd_puts__(fd, "\n");
+    }
+    fd_puts__(fd, "maps:\n");
+    i = write(fd, maps__, maps_size__);
+}
+
 static void
 faultd_signal_handler__(int signal, siginfo_t* siginfo, void* context)
 {
     int rv;
+    int saved_errno = errno;
 
     /*
      * Make sure we syncronize properly with other threads that
@@ -93,33 +565,27 @@ faultd_signal_handler__(int signal, siginfo_t* siginfo, void* context)
      * Generate our fault information.
      */
     faultd_info__.pid = getpid();
-    faultd_info__.tid = 0;
+    faultd_info__.tid = syscall(SYS_gettid);
     faultd_info__.signal = signal;
     faultd_info__.signal_code = siginfo->si_code;
     faultd_info__.fault_address = siginfo->si_addr;
-    faultd_info__.last_errno = errno;
+    faultd_info__.last_errno = saved_errno;
+
+    fault_capture__(context);
 
-    faultd_info__.backtrace_size = signal_backtrace__(faultd_info__.backtrace,
-                                                      AIM_ARRAYSIZE(faultd_info__.backtrace),
-                                                      context, 0);
-    faultd_info__.backtrace_symbols = (void*)1;
     if(faultd_client__) {
-        faultd_client_write(faultd_client__, &faultd_info__);
+        faultd_client_write_raw(faultd_client__, &faultd_info__,
+                                &record__.raw);
     }
     if(localfd__ >= 0) {
-        char* signame = strsignal(faultd_info__.signal);
-        char* nl = "\n";
-        write(localfd__, signame, strlen(signame)+1);
-        write(localfd__, nl, 2);
-        backtrace_symbols_fd(faultd_info__.backtrace,
-                             faultd_info__.backtrace_size,
-                             localfd__);
+        local_write__(localfd__);
     }
 
     /*
      * Unlock spinlock, in case this signal wasn't fatal
      */
     pthread_spin_unlock(&thread_lock__);
+    errno = saved_errno;
 }
 
 
@@ -130,30 +596,11 @@ faultd_handler_register(int localfd,
 {
     int rv;
     struct sigaction saction;
-    void* dummy_backtrace[1];
-    int dummy_backtrace_size;
-    int fd;
 
     if ( (rv = pthread_spin_init(&thread_lock__, 0)) ) {
         return rv;
     }
 
-    /*
-     * These calls to backtrace are to assure that
-     * backtrace() and backtrace_symbols_fd() have actually
-     * been loaded into our process -- its possible they
-     * come from a dynamic library, and we don't want them
-     * to get loaded at fault-time.
-     */
-    dummy_backtrace_size = backtrace(dummy_backtrace, 1);
-
-    /** Note - we could just pass an invalid descriptor here, but it
-     * it flags errors in valgrind.
-     */
-    fd = open("/dev/null", O_WRONLY);
-    backtrace_symbols_fd(dummy_backtrace, dummy_backtrace_size, fd);
-    close(fd);
-
     AIM_MEMSET(&faultd_info__, 0, sizeof(faultd_info__));
     if(!binaryname) {
         binaryname = "Not specified.";
@@ -187,7 +634,7 @@ faultd_handler_register(int localfd,
 
     /*
      * The local fault handler will attempt to write a subset of
-     * the fault information (signal type and backtrace)
+     * the fault information (signal, raw backtrace and maps)
      * to the localfd descriptor if specified.
      */
     localfd__ = localfd;
@@ -25,6 +25,14 @@
 #define __FAULTD_INT_H__
 
 #include <faultd/faultd_config.h>
+#include <faultd/faultd.h>
+
+/**
+ * Symbolize a raw fault record.
+ * Returns an allocated report for info->backtrace_symbols.
+ */
+char* faultd_symbols_decode(faultd_info_t* info, const faultd_raw_t* raw,
+                            const uint8_t* payload);
 
 
 #endif /* __FAULTD_INT_H__ */
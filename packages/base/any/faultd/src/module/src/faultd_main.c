@@ -195,6 +195,9 @@ faultd_main(int argc, char* argv[])
             if(aim_pvs_isatty(&aim_pvs_stderr)) {
                 faultd_info_show(&faultd_info, &aim_pvs_stderr, 0);
             }
+            if(faultd_info.backtrace_symbols) {
+                aim_free(faultd_info.backtrace_symbols);
+            }
         }
     }
 }
@@ -0,0 +1,597 @@
+/**************************************************************************//**
+ * <bsn.cl fy=2013 v=onl>
+ *
+ *        Copyright 2013, 2014 BigSwitch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ *****************************************************************************
+ *
+ * Offline symbolization of raw fault records.
+ *
+ * Each PC is mapped to its object through the maps snapshot and looked
+ * up in a symbol index built from the object's ELF symbol table. The
+ * indexes are cached by build ID, so repeated faults in the same binary
+ * are cheap and faults in a binary that has since been replaced on disk
+ * still resolve as long as the old index is cached.
+ *
+ *****************************************************************************/
+#include <faultd/faultd_config.h>
+#include <faultd/faultd.h>
+#include <AIM/aim.h>
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <link.h>
+#include <elf.h>
+
+#include "faultd_int.h"
+
+#define SYMBOL_LOADS_MAX 16
+
+typedef struct symbol_s {
+    uintptr_t addr;
+    uintptr_t size;
+    /** Offset into the index string table. */
+    uint32_t name;
+} symbol_t;
+
+typedef struct symbol_index_s {
+    struct symbol_index_s* next;
+
+    char* path;
+    dev_t dev;
+    ino_t ino;
+    time_t mtime;
+    off_t size;
+
+    uint8_t build_id[32];
+    uint32_t build_id_size;
+
+    /** PT_LOAD segments, for file offset to address translation. */
+    struct {
+        uintptr_t offset;
+        uintptr_t filesz;
+        uintptr_t vaddr;
+    } loads[SYMBOL_LOADS_MAX];
+    int load_count;
+
+    symbol_t* symbols;
+    int symbol_count;
+    char* strings;
+
+    /** LRU stamp. */
+    uint64_t used;
+} symbol_index_t;
+
+static symbol_index_t* cache__;
+static int cache_count__;
+static uint64_t cache_clock__;
+
+
+/**************************************************************************//**
+ *
+ * Symbol index
+ *
+ *****************************************************************************/
+
+#define NOTE_ALIGN(_x) (((_x) + 3) & ~3)
+
+static void
+index_build_id__(symbol_index_t* si, const uint8_t* base, size_t size,
+                 uintptr_t offset, uintptr_t length)
+{
+    uintptr_t n, end;
+
+    if(offset > size || length > size - offset) {
+        return;
+    }
+    n = offset;
+    end = offset + length;
+    while(n + sizeof(ElfW(Nhdr)) <= end) {
+        const ElfW(Nhdr)* nh = (const ElfW(Nhdr)*)(base + n);
+        uintptr_t name = n + sizeof(*nh);
+        uintptr_t desc = name + NOTE_ALIGN(nh->n_namesz);
+        uintptr_t next = desc + NOTE_ALIGN(nh->n_descsz);
+        if(next > end || next <= n) {
+            return;
+        }
+        if(nh->n_type == NT_GNU_BUILD_ID && nh->n_namesz == 4 &&
+           !memcmp(base + name, "GNU", 4)) {
+            si->build_id_size = nh->n_descsz;
+            if(si->build_id_size > sizeof(si->build_id)) {
+                si->build_id_size = sizeof(si->build_id);
+            }
+            FAULTD_MEMCPY(si->build_id, base + desc, si->build_id_size);
+            return;
+        }
+        n = next;
+    }
+}
+
+static int
+symbol_compare__(const void* a, const void* b)
+{
+    const symbol_t* x = a;
+    const symbol_t* y = b;
+    return (x->addr > y->addr) - (x->addr < y->addr);
+}
+
+/**
+ * Build the index from the ELF image.
+ * .symtab is preferred. Stripped objects fall back to .dynsym.
+ */
+static int
+index_parse__(symbol_index_t* si, const uint8_t* base, size_t size)
+{
+    const ElfW(Ehdr)* eh = (const ElfW(Ehdr)*)base;
+    const ElfW(Phdr)* ph;
+    const ElfW(Shdr)* sh;
+    const ElfW(Shdr)* symtab = NULL;
+    const ElfW(Shdr)* strtab;
+    const ElfW(Sym)* syms;
+    int i, count;
+
+    if(size < sizeof(*eh) || memcmp(eh->e_ident, ELFMAG, SELFMAG) ||
+       eh->e_ident[EI_CLASS] != (sizeof(uintptr_t) == 8 ? ELFCLASS64 : ELFCLASS32)) {
+        return -1;
+    }
+
+    if(eh->e_phentsize == sizeof(*ph) &&
+       eh->e_phoff + (uintptr_t)eh->e_phnum * sizeof(*ph) <= size) {
+        ph = (const ElfW(Phdr)*)(base + eh->e_phoff);
+        for(i = 0; i < eh->e_phnum; i++) {
+            if(ph[i].p_type == PT_LOAD && si->load_count < SYMBOL_LOADS_MAX) {
+                si->loads[si->load_count].offset = ph[i].p_offset;
+                si->loads[si->load_count].filesz = ph[i].p_filesz;
+                si->loads[si->load_count].vaddr = ph[i].p_vaddr;
+                si->load_count++;
+            }
+            else if(ph[i].p_type == PT_NOTE && si->build_id_size == 0) {
+                index_build_id__(si, base, size, ph[i].p_offset, ph[i].p_filesz);
+            }
+        }
+    }
+
+    if(eh->e_shentsize != sizeof(*sh) ||
+       eh->e_shoff + (uintptr_t)eh->e_shnum * sizeof(*sh) > size) {
+        /* No section headers. The build ID is still useful. */
+        return 0;
+    }
+    sh = (const ElfW(Shdr)*)(base + eh->e_shoff);
+    for(i = 0; i < eh->e_shnum; i++) {
+        if(sh[i].sh_type == SHT_SYMTAB) {
+            symtab = sh + i;
+            break;
+        }
+        if(sh[i].sh_type == SHT_DYNSYM) {
+            symtab = sh + i;
+        }
+    }
+    if(symtab == NULL || symtab->sh_link >= eh->e_shnum ||
+       symtab->sh_entsize != sizeof(ElfW(Sym)) ||
+       symtab->sh_offset + symtab->sh_size > size) {
+        return 0;
+    }
+    strtab = sh + symtab->sh_link;
+    if(strtab->sh_offset + strtab->sh_size > size || strtab->sh_size == 0) {
+        return 0;
+    }
+
+    syms = (const ElfW(Sym)*)(base + symtab->sh_offset);
+    count = symtab->sh_size / sizeof(*syms);
+    si->symbols = aim_zmalloc(count * sizeof(*si->symbols) + 1);
+    for(i = 0; i < count; i++) {
+        /* ST_TYPE is the same for both ELF classes. */
+        if(ELF32_ST_TYPE(syms[i].st_info) != STT_FUNC ||
+           syms[i].st_shndx == SHN_UNDEF || syms[i].st_value == 0 ||
+           syms[i].st_name >= strtab->sh_size) {
+            continue;
+        }
+        si->symbols[si->symbol_count].addr = syms[i].st_value;
+        si->symbols[si->symbol_count].size = syms[i].st_size;
+        si->symbols[si->symbol_count].name = syms[i].st_name;
+        si->symbol_count++;
+    }
+    qsort(si->symbols, si->symbol_count, sizeof(*si->symbols), symbol_compare__);
+
+    si->strings = aim_zmalloc(strtab->sh_size + 1);
+    FAULTD_MEMCPY(si->strings, base + strtab->sh_offset, strtab->sh_size);
+    return 0;
+}
+
+static void
+index_destroy__(symbol_index_t* si)
+{
+    aim_free(si->path);
+    aim_free(si->symbols);
+    aim_free(si->strings);
+    aim_free(si);
+}
+
+static symbol_index_t*
+index_load__(const char* path)
+{
+    symbol_index_t* si;
+    struct stat st;
+    void* base;
+    int fd;
+
+    if((fd = open(path, O_RDONLY)) < 0) {
+        return NULL;
+    }
+    if(fstat(fd, &st) < 0 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(base == MAP_FAILED) {
+        return NULL;
+    }
+
+    si = aim_zmalloc(sizeof(*si));
+    si->path = aim_strdup(path);
+    si->dev = st.st_dev;
+    si->ino = st.st_ino;
+    si->mtime = st.st_mtime;
+    si->size = st.st_size;
+    if(index_parse__(si, base, st.st_size) < 0) {
+        index_destroy__(si);
+        si = NULL;
+    }
+    munmap(base, st.st_size);
+    return si;
+}
+
+static void
+cache_insert__(symbol_index_t* si)
+{
+    if(cache_count__ >= FAULTD_CONFIG_SYMBOL_CACHE_SIZE) {
+        /* Evict the least recently used index. */
+        symbol_index_t** p;
+        symbol_index_t** lru = &cache__;
+        for(p = &cache__; *p; p = &(*p)->next) {
+            if((*p)->used < (*lru)->used) {
+                lru = p;
+            }
+        }
+        if(*lru) {
+            symbol_index_t* victim = *lru;
+            *lru = victim->next;
+            index_destroy__(victim);
+            cache_count__--;
+        }
+    }
+    si->next = cache__;
+    cache__ = si;
+    cache_count__++;
+}
+
+static void
+cache_remove__(symbol_index_t* si)
+{
+    symbol_index_t** p;
+    for(p = &cache__; *p; p = &(*p)->next) {
+        if(*p == si) {
+            *p = si->next;
+            index_destroy__(si);
+            cache_count__--;
+            return;
+        }
+    }
+}
+
+/**
+ * Find the index for an object.
+ *
+ * An index with a matching build ID is used directly. Otherwise the
+ * file is (re)loaded if it changed on disk since it was indexed.
+ */
+static symbol_index_t*
+cache_get__(const char* path, const faultd_build_id_t* bid)
+{
+    symbol_index_t* si;
+    struct stat st;
+
+    for(si = cache__; si && bid; si = si->next) {
+        if(si->build_id_size == bid->size &&
+           !memcmp(si->build_id, bid->id, bid->size)) {
+            si->used = ++cache_clock__;
+            return si;
+        }
+    }
+
+    if(stat(path, &st) < 0) {
+        return NULL;
+    }
+    for(si = cache__; si; si = si->next) {
+        if(!strcmp(si->path, path)) {
+            if(si->dev == st.st_dev && si->ino == st.st_ino &&
+               si->mtime == st.st_mtime && si->size == st.st_size) {
+                si->used = ++cache_clock__;
+                return si;
+            }
+            cache_remove__(si);
+            break;
+        }
+    }
+
+    if((si = index_load__(path)) == NULL) {
+        return NULL;
+    }
+    si->used = ++cache_clock__;
+    cache_insert__(si);
+    return si;
+}
+
+static const char*
+index_lookup__(symbol_index_t* si, uintptr_t addr, uintptr_t* offset)
+{
+    int lo = 0, hi = si->symbol_count - 1;
+    symbol_t* s = NULL;
+
+    while(lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if(si->symbols[mid].addr <= addr) {
+            s = si->symbols + mid;
+            lo = mid + 1;
+        }
+        else {
+            hi = mid - 1;
+        }
+    }
+    /* Unsized symbols (e.g. assembly labels) would swallow everything after them. */
+    if(s == NULL || s->size == 0 || addr >= s->addr + s->size) {
+        return NULL;
+    }
+    *offset = addr - s->addr;
+    return si->strings + s->name;
+}
+
+
+/**************************************************************************//**
+ *
+ * Maps snapshot
+ *
+ *****************************************************************************/
+
+typedef struct map_s {
+    uintptr_t start;
+    uintptr_t end;
+    uintptr_t offset;
+    int exec;
+    const char* path;
+    /** Build ID of the object, if captured. */
+    const faultd_build_id_t* build_id;
+} map_t;
+
+typedef struct decode_s {
+    map_t* maps;
+    int map_count;
+    char* maps_text;
+    const faultd_build_id_t* build_ids;
+    int build_id_count;
+
+    char* out;
+    int out_size;
+    int out_len;
+} decode_t;
+
+static void
+maps_parse__(decode_t* d, const char* text, int size)
+{
+    char* p;
+    char* line;
+    char* saveptr = NULL;
+    int i, j, lines = 1;
+
+    d->maps_text = aim_zmalloc(size + 1);
+    FAULTD_MEMCPY(d->maps_text, text, size);
+    for(i = 0; i < size; i++) {
+        lines += (text[i] == '\n');
+    }
+    d->maps = aim_zmalloc(lines * sizeof(*d->maps));
+
+    for(line = strtok_r(d->maps_text, "\n", &saveptr); line;
+        line = strtok_r(NULL, "\n", &saveptr)) {
+        map_t* m = d->maps + d->map_count;
+        char perms[8];
+        unsigned long start, end, offset;
+        int n = 0;
+        if(sscanf(line, "%lx-%lx %7s %lx %*s %*s %n",
+                  &start, &end, perms, &offset, &n) < 4 || n == 0) {
+            continue;
+        }
+        m->start = start;
+        m->end = end;
+        m->offset = offset;
+        m->exec = (perms[2] == 'x');
+        p = line + n;
+        m->path = (*p == '/') ? p : NULL;
+        d->map_count++;
+    }
+
+    /* Associate the build IDs with every mapping of their object. */
+    for(i = 0; i < d->build_id_count; i++) {
+        const char* path = NULL;
+        for(j = 0; j < d->map_count; j++) {
+            if(d->maps[j].start == d->build_ids[i].start) {
+                path = d->maps[j].path;
+                break;
+            }
+        }
+        for(j = 0; path && j < d->map_count; j++) {
+            if(d->maps[j].path && !strcmp(d->maps[j].path, path)) {
+                d->maps[j].build_id = d->build_ids + i;
+            }
+        }
+    }
+}
+
+static map_t*
+maps_find__(decode_t* d, uintptr_t addr, int exec)
+{
+    int i;
+    for(i = 0; i < d->map_count; i++) {
+        if(addr >= d->maps[i].start && addr < d->maps[i].end &&
+           (!exec || d->maps[i].exec)) {
+            return d->maps + i;
+        }
+    }
+    return NULL;
+}
+
+
+/**************************************************************************//**
+ *
+ * Report
+ *
+ *****************************************************************************/
+
+static void
+out__(decode_t* d, const char* fmt, ...)
+{
+    va_list vargs;
+    int len;
+
+    for(;;) {
+        va_start(vargs, fmt);
+        len = vsnprintf(d->out + d->out_len, d->out_size - d->out_len, fmt, vargs);
+        va_end(vargs);
+        if(len < 0) {
+            return;
+        }
+        if(d->out_len + len < d->out_size) {
+            d->out_len += len;
+            return;
+        }
+        d->out_size = (d->out_size + len) * 2;
+        d->out = aim_realloc(d->out, d->out_size);
+    }
+}
+
+/**
+ * Symbolize one address.
+ * @param call Set for return addresses. The call site is looked up.
+ */
+static void
+symbolize__(decode_t* d, uintptr_t pc, int call)
+{
+    map_t* m = maps_find__(d, pc, 0);
+    symbol_index_t* si;
+    uintptr_t file_offset, addr = 0, offset;
+    const char* name = NULL;
+    int i;
+
+    out__(d, "0x%0*lx", (int)(2*sizeof(uintptr_t)), (unsigned long)pc);
+    if(m == NULL || m->path == NULL) {
+        out__(d, " ??\n");
+        return;
+    }
+
+    out__(d, " %s", m->path);
+    if((si = cache_get__(m->path, m->build_id)) == NULL) {
+        out__(d, " (unreadable)\n");
+        return;
+    }
+    if(m->build_id && (si->build_id_size != m->build_id->size ||
+                       memcmp(si->build_id, m->build_id->id, si->build_id_size))) {
+        out__(d, " (build-id mismatch)\n");
+        return;
+    }
+
+    file_offset = pc - call - m->start + m->offset;
+    for(i = 0; i < si->load_count; i++) {
+        if(file_offset >= si->loads[i].offset &&
+           file_offset < si->loads[i].offset + si->loads[i].filesz) {
+            addr = file_offset - si->loads[i].offset + si->loads[i].vaddr;
+            name = index_lookup__(si, addr, &offset);
+            break;
+        }
+    }
+    if(name) {
+        out__(d, " (%s+0x%lx)\n", name, (unsigned long)(offset + call));
+    }
+    else {
+        out__(d, " (+0x%lx)\n", (unsigned long)(addr + call));
+    }
+}
+
+char*
+faultd_symbols_decode(faultd_info_t* info, const faultd_raw_t* raw,
+                      const uint8_t* payload)
+{
+    decode_t d;
+    const uint8_t* regs = payload;
+    const uint8_t* stack = regs + raw->regs_size;
+    const char* maps = (const char*)(stack + raw->stack_size);
+    uintptr_t* words;
+    int i, count, scanned;
+
+    FAULTD_MEMSET(&d, 0, sizeof(d));
+    d.out_size = FAULTD_CONFIG_BACKTRACE_SYMBOLS_SIZE;
+    d.out = aim_zmalloc(d.out_size);
+    d.build_ids = (const faultd_build_id_t*)(maps + raw->maps_size);
+    d.build_id_count = raw->build_id_count;
+    maps_parse__(&d, maps, raw->maps_size);
+
+    out__(&d, "pc=0x%lx sp=0x%lx fp=0x%lx lr=0x%lx\n",
+          (unsigned long)raw->pc, (unsigned long)raw->sp,
+          (unsigned long)raw->fp, (unsigned long)raw->lr);
+
+    count = info->backtrace_size;
+    if(count < 0 || count > AIM_ARRAYSIZE(info->backtrace)) {
+        count = 0;
+    }
+    for(i = 0; i < count; i++) {
+        out__(&d, "#%-2d ", i);
+        symbolize__(&d, (uintptr_t)info->backtrace[i], i > 0);
+    }
+
+    /*
+     * Scan the stack for return addresses the frame walk missed,
+     * e.g. in code built without frame pointers. These are
+     * candidates only.
+     */
+    words = (uintptr_t*)stack;
+    for(i = 0, scanned = 0;
+        i < raw->stack_size / sizeof(uintptr_t) &&
+            scanned < FAULTD_CONFIG_BACKTRACE_SIZE_MAX;
+        i++) {
+        uintptr_t w;
+        FAULTD_MEMCPY(&w, words + i, sizeof(w));
+        if(maps_find__(&d, w, 1) == NULL) {
+            continue;
+        }
+        if(scanned++ == 0) {
+            out__(&d, "stack scan:\n");
+        }
+        out__(&d, "    sp%+-6ld ", (long)(raw->stack_start + i*sizeof(w) - raw->sp));
+        symbolize__(&d, w, 1);
+    }
+
+    aim_free(d.maps);
+    aim_free(d.maps_text);
+    return d.out;
+}
@@ -69,6 +69,14 @@ int onlp_denit(void);
 void onlp_platform_dump(aim_pvs_t* pvs, uint32_t flags);
 void onlp_platform_show(aim_pvs_t* pvs, uint32_t flags);
 
+/**
+ * @brief Write the system information and the state of every OID
+ * and SFP port as compact JSON.
+ * @param fd The output descriptor.
+ * @note The data is collected while holding the API lock once.
+ */
+int onlp_platform_json_dump(int fd);
+
 /** Standardized macros for dealing with sensor milli-values */
 #define ONLP_MILLI_NORMAL_INTEGER(_m) (_m / 1000)
 #define ONLP_MILLI_NORMAL_TENTHS(_m) ( (_m % 1000) / 100)
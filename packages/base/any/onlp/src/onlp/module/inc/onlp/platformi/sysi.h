@@ -149,6 +149,22 @@ int onlp_sysi_platform_manage_fans(void);
  */
 int onlp_sysi_platform_manage_leds(void);
 
+/**
+ * @brief Perform platform fan management using the shared tick status.
+ * @param status Read fan, PSU and thermal status through the
+ * onlp_sys_manage_status_*_get() accessors.
+ * @note Optional. If this returns ONLP_STATUS_E_UNSUPPORTED
+ * the platform manager calls onlp_sysi_platform_manage_fans() instead.
+ */
+int onlp_sysi_platform_manage_fans_status(onlp_sys_manage_status_t* status);
+
+/**
+ * @brief Perform platform LED management using the shared tick status.
+ * @note Optional. If this returns ONLP_STATUS_E_UNSUPPORTED
+ * the platform manager calls onlp_sysi_platform_manage_leds() instead.
+ */
+int onlp_sysi_platform_manage_leds_status(onlp_sys_manage_status_t* status);
+
 /**
  * @brief Return custom platform information.
  */
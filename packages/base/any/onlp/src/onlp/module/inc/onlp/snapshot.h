@@ -0,0 +1,150 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ *
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ ************************************************************
+ *
+ * Bulk Platform Snapshots.
+ *
+ * A snapshot is a single contiguous, versioned buffer holding
+ * the state of every platform OID (and optionally every SFP
+ * port) captured while holding the API lock once.
+ *
+ * The buffer layout is:
+ *
+ *    onlp_snapshot_hdr_t
+ *    onlp_snapshot_oid_t[hdr.oid_count]
+ *    onlp_snapshot_sfp_t[hdr.sfp_count]
+ *
+ * All structures are packed and use host byte order. Consumers
+ * must honor the entry sizes given in the header rather than
+ * sizeof() so that newer libraries remain readable.
+ *
+ ***********************************************************/
+#ifndef __ONLP_SNAPSHOT_H__
+#define __ONLP_SNAPSHOT_H__
+
+#include <onlp/onlp_config.h>
+#include <onlp/oids.h>
+#include <stdint.h>
+
+#define ONLP_SNAPSHOT_MAGIC   0x534c4e4f /* "ONLS" */
+#define ONLP_SNAPSHOT_VERSION 1
+
+/** Snapshot request flags. */
+#define ONLP_SNAPSHOT_F_SFP_PRESENCE (1 << 0)
+#define ONLP_SNAPSHOT_F_SFP_EEPROM   (1 << 1)
+#define ONLP_SNAPSHOT_F_SFP_DOM      (1 << 2)
+
+/** Any of these flags causes SFP entries to be generated. */
+#define ONLP_SNAPSHOT_F_SFP (ONLP_SNAPSHOT_F_SFP_PRESENCE |   \
+                             ONLP_SNAPSHOT_F_SFP_EEPROM |     \
+                             ONLP_SNAPSHOT_F_SFP_DOM)
+
+typedef struct __attribute__((packed)) onlp_snapshot_hdr_s {
+    /** ONLP_SNAPSHOT_MAGIC */
+    uint32_t magic;
+    /** ONLP_SNAPSHOT_VERSION */
+    uint16_t version;
+    /** sizeof(onlp_snapshot_hdr_t) */
+    uint16_t hdr_size;
+    /** The flags used to generate this snapshot. */
+    uint32_t flags;
+    /** Total size of the snapshot, in bytes. */
+    uint32_t size;
+    /** Monotonic capture time, in microseconds. */
+    uint64_t timestamp;
+    /** Duration of the capture, in microseconds. */
+    uint32_t duration;
+    /** sizeof(onlp_snapshot_oid_t) */
+    uint16_t oid_entry_size;
+    /** Number of OID entries. */
+    uint16_t oid_count;
+    /** sizeof(onlp_snapshot_sfp_t) */
+    uint16_t sfp_entry_size;
+    /** Number of SFP entries. */
+    uint16_t sfp_count;
+    uint32_t reserved;
+} onlp_snapshot_hdr_t;
+
+/**
+ * Type-specific indices into onlp_snapshot_oid_t.values.
+ */
+#define ONLP_SNAPSHOT_VALUE_COUNT 6
+
+#define ONLP_SNAPSHOT_THERMAL_MCELSIUS  0
+#define ONLP_SNAPSHOT_THERMAL_WARNING   1
+#define ONLP_SNAPSHOT_THERMAL_ERROR     2
+#define ONLP_SNAPSHOT_THERMAL_SHUTDOWN  3
+
+#define ONLP_SNAPSHOT_FAN_RPM           0
+#define ONLP_SNAPSHOT_FAN_PERCENTAGE    1
+#define ONLP_SNAPSHOT_FAN_MODE          2
+
+#define ONLP_SNAPSHOT_PSU_MVIN          0
+#define ONLP_SNAPSHOT_PSU_MVOUT         1
+#define ONLP_SNAPSHOT_PSU_MIIN          2
+#define ONLP_SNAPSHOT_PSU_MIOUT         3
+#define ONLP_SNAPSHOT_PSU_MPIN          4
+#define ONLP_SNAPSHOT_PSU_MPOUT         5
+
+#define ONLP_SNAPSHOT_LED_MODE          0
+#define ONLP_SNAPSHOT_LED_CHAR          1
+
+typedef struct __attribute__((packed)) onlp_snapshot_oid_s {
+    /** The OID */
+    uint32_t oid;
+    /** The parent OID */
+    uint32_t poid;
+    /** Result of the info request for this OID. */
+    int32_t rv;
+    /** Status flags (type-specific). */
+    uint32_t status;
+    /** Capability flags (type-specific). */
+    uint32_t caps;
+    /** Type-specific values. See ONLP_SNAPSHOT_<TYPE>_* */
+    int32_t values[ONLP_SNAPSHOT_VALUE_COUNT];
+} onlp_snapshot_oid_t;
+
+typedef struct __attribute__((packed)) onlp_snapshot_sfp_s {
+    /** The port number. */
+    int32_t port;
+    /** 1 if present, 0 if missing, or a negative status. */
+    int32_t present;
+    /** Result of the eeprom read, if requested. */
+    int32_t eeprom_rv;
+    /** Result of the dom read, if requested. */
+    int32_t dom_rv;
+    uint8_t eeprom[256];
+    uint8_t dom[256];
+} onlp_snapshot_sfp_t;
+
+/**
+ * @brief Capture a platform snapshot.
+ * @param flags ONLP_SNAPSHOT_F_* flags.
+ * @param buffer The destination buffer.
+ * @param size The size of the destination buffer.
+ * @returns The number of bytes required for the complete snapshot.
+ * If this is larger than size the snapshot is truncated to the
+ * entries which fit and the caller should retry with a larger buffer.
+ * Passing a NULL buffer and a size of zero returns the required size.
+ * A negative value indicates an error.
+ */
+int onlp_snapshot_get(uint32_t flags, uint8_t* buffer, int size);
+
+#endif /* __ONLP_SNAPSHOT_H__ */
@@ -31,6 +31,9 @@
 #include <onlplib/onie.h>
 #include <onlplib/pi.h>
 #include <onlp/oids.h>
+#include <onlp/fan.h>
+#include <onlp/psu.h>
+#include <onlp/thermal.h>
 
 
 typedef struct onlp_sys_info_s {
@@ -122,6 +125,43 @@ int onlp_sys_platform_manage_join(void);
 
 void onlp_sys_platform_manage_now(void);
 
+/**
+ * Platform manager status.
+ *
+ * The platform manager gathers fan, PSU and thermal status at most
+ * once per tick and hands the same status to every management task
+ * that runs in that tick. Each class of object is read on first
+ * access only, so a tick that only needs fans does not touch the
+ * PSUs or thermals.
+ *
+ * The status is the platform-level information from
+ * onlp_fani_info_get(), onlp_psui_info_get() and
+ * onlp_thermali_info_get(), without the core overrides.
+ */
+typedef struct onlp_sys_manage_status_s onlp_sys_manage_status_t;
+
+/**
+ * @brief Get a fan's status for the current tick.
+ * @param status The status passed to the management callback.
+ * @param oid The fan OID.
+ * @param[out] info Receives the fan information.
+ * @returns The result of the underlying onlp_fani_info_get().
+ */
+int onlp_sys_manage_status_fan_get(onlp_sys_manage_status_t* status,
+                                   onlp_oid_t oid, onlp_fan_info_t* info);
+
+/**
+ * @brief Get a PSU's status for the current tick.
+ */
+int onlp_sys_manage_status_psu_get(onlp_sys_manage_status_t* status,
+                                   onlp_oid_t oid, onlp_psu_info_t* info);
+
+/**
+ * @brief Get a thermal's status for the current tick.
+ */
+int onlp_sys_manage_status_thermal_get(onlp_sys_manage_status_t* status,
+                                       onlp_oid_t oid, onlp_thermal_info_t* info);
+
 int onlp_sys_debug(aim_pvs_t* pvs, int argc, char** argv);
 
 #endif /* __ONLP_SYS_H_ */
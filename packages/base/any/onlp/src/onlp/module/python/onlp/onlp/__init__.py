@@ -636,6 +636,137 @@ def onlp_sfp_init_prototypes():
     libonlp.onlp_sfp_control_flags_get.restype = ctypes.c_int
     libonlp.onlp_sfp_control_flags_get.argtyeps = (ctypes.c_int, ctypes.POINTER(ctypes.c_uint32),)
 
+# onlp/snapshot.h
+
+ONLP_SNAPSHOT_MAGIC = 0x534c4e4f
+ONLP_SNAPSHOT_VERSION = 1
+
+ONLP_SNAPSHOT_F_SFP_PRESENCE = (1 << 0)
+ONLP_SNAPSHOT_F_SFP_EEPROM = (1 << 1)
+ONLP_SNAPSHOT_F_SFP_DOM = (1 << 2)
+
+ONLP_SNAPSHOT_VALUE_COUNT = 6
+
+class onlp_snapshot_hdr(ctypes.Structure):
+    _pack_ = 1
+    _fields_ = [("magic", ctypes.c_uint32,),
+                ("version", ctypes.c_uint16,),
+                ("hdr_size", ctypes.c_uint16,),
+                ("flags", ctypes.c_uint32,),
+                ("size", ctypes.c_uint32,),
+                ("timestamp", ctypes.c_uint64,),
+                ("duration", ctypes.c_uint32,),
+                ("oid_entry_size", ctypes.c_uint16,),
+                ("oid_count", ctypes.c_uint16,),
+                ("sfp_entry_size", ctypes.c_uint16,),
+                ("sfp_count", ctypes.c_uint16,),
+                ("reserved", ctypes.c_uint32,),]
+
+class onlp_snapshot_oid(ctypes.Structure):
+    _pack_ = 1
+    _fields_ = [("oid", onlp_oid,),
+                ("poid", onlp_oid,),
+                ("rv", ctypes.c_int32,),
+                ("status", ctypes.c_uint32,),
+                ("caps", ctypes.c_uint32,),
+                ("values", ctypes.c_int32 * ONLP_SNAPSHOT_VALUE_COUNT,),]
+
+class onlp_snapshot_sfp(ctypes.Structure):
+    _pack_ = 1
+    _fields_ = [("port", ctypes.c_int32,),
+                ("present", ctypes.c_int32,),
+                ("eeprom_rv", ctypes.c_int32,),
+                ("dom_rv", ctypes.c_int32,),
+                ("eeprom", ctypes.c_ubyte * 256,),
+                ("dom", ctypes.c_ubyte * 256,),]
+
+# NumPy structured dtypes matching the packed layouts above
+ONLP_SNAPSHOT_OID_DTYPE = [("oid", "=u4",),
+                           ("poid", "=u4",),
+                           ("rv", "=i4",),
+                           ("status", "=u4",),
+                           ("caps", "=u4",),
+                           ("values", "=i4", (ONLP_SNAPSHOT_VALUE_COUNT,),),]
+
+ONLP_SNAPSHOT_SFP_DTYPE = [("port", "=i4",),
+                           ("present", "=i4",),
+                           ("eeprom_rv", "=i4",),
+                           ("dom_rv", "=i4",),
+                           ("eeprom", "u1", (256,),),
+                           ("dom", "u1", (256,),),]
+
+class OnlpSnapshot(object):
+    """A platform snapshot captured with a single call into libonlp.
+
+    The snapshot owns one bytearray; the header and entry views
+    reference it directly without copying.
+    """
+
+    def __init__(self, flags=0, size=65536):
+        while True:
+            self.buffer = bytearray(size)
+            cbuf = (ctypes.c_ubyte * size).from_buffer(self.buffer)
+            rv = libonlp.onlp_snapshot_get(flags, cbuf, size)
+            del cbuf
+            if rv < 0:
+                raise RuntimeError("onlp_snapshot_get: %d" % rv)
+            if rv <= size:
+                break
+            size = rv
+
+        self.size = rv
+        self.hdr = onlp_snapshot_hdr.from_buffer(self.buffer)
+        if self.hdr.magic != ONLP_SNAPSHOT_MAGIC:
+            raise AssertionError("bad snapshot magic 0x%x" % self.hdr.magic)
+        if self.hdr.version != ONLP_SNAPSHOT_VERSION:
+            raise AssertionError("unsupported snapshot version %d" % self.hdr.version)
+
+    def oidOffset(self):
+        return self.hdr.hdr_size
+
+    def sfpOffset(self):
+        return self.oidOffset() + self.hdr.oid_count * self.hdr.oid_entry_size
+
+    def memoryview(self):
+        return memoryview(self.buffer)[:self.size]
+
+    def oids(self):
+        """Iterate over the OID entries as ctypes views."""
+        for i in range(self.hdr.oid_count):
+            yield onlp_snapshot_oid.from_buffer(self.buffer,
+                                                self.oidOffset() + i * self.hdr.oid_entry_size)
+
+    def sfps(self):
+        """Iterate over the SFP entries as ctypes views."""
+        for i in range(self.hdr.sfp_count):
+            yield onlp_snapshot_sfp.from_buffer(self.buffer,
+                                                self.sfpOffset() + i * self.hdr.sfp_entry_size)
+
+    def oidArray(self):
+        """Return the OID entries as a zero-copy NumPy structured array."""
+        import numpy
+        dtype = numpy.dtype({'names' : [f[0] for f in ONLP_SNAPSHOT_OID_DTYPE],
+                             'formats' : [f[1] if len(f) == 2 else (f[1], f[2])
+                                          for f in ONLP_SNAPSHOT_OID_DTYPE],
+                             'itemsize' : self.hdr.oid_entry_size,})
+        return numpy.frombuffer(self.buffer, dtype=dtype,
+                                count=self.hdr.oid_count, offset=self.oidOffset())
+
+    def sfpArray(self):
+        """Return the SFP entries as a zero-copy NumPy structured array."""
+        import numpy
+        dtype = numpy.dtype({'names' : [f[0] for f in ONLP_SNAPSHOT_SFP_DTYPE],
+                             'formats' : [f[1] if len(f) == 2 else (f[1], f[2])
+                                          for f in ONLP_SNAPSHOT_SFP_DTYPE],
+                             'itemsize' : self.hdr.sfp_entry_size,})
+        return numpy.frombuffer(self.buffer, dtype=dtype,
+                                count=self.hdr.sfp_count, offset=self.sfpOffset())
+
+def onlp_snapshot_init_prototypes():
+
+    libonlp.onlp_snapshot_get.restype = ctypes.c_int
+    libonlp.onlp_snapshot_get.argtypes = (ctypes.c_uint32, ctypes.POINTER(ctypes.c_ubyte), ctypes.c_int,)
+
 # onlp/onlp.h
 
 def init_prototypes():
@@ -658,5 +789,6 @@ def init_prototypes():
     onlp_psu_init_prototypes()
     sff_init_prototypes()
     onlp_sfp_init_prototypes()
+    onlp_snapshot_init_prototypes()
 
 init_prototypes()
@@ -1536,6 +1536,50 @@ class SfpTest(OnlpTestMixin,
         else:
             self.log.warn("RESET not supported by this SFP")
 
+class SnapshotTest(OnlpTestMixin,
+                   unittest.TestCase):
+    """Test interfaces in onlp/snapshot.h."""
+
+    def setUp(self):
+        OnlpTestMixin.setUp(self)
+
+    def tearDown(self):
+        OnlpTestMixin.tearDown(self)
+
+    def testSize(self):
+
+        sz = libonlp.onlp_snapshot_get(0, None, 0)
+        self.assertGreaterEqual(sz, ctypes.sizeof(onlp.onlp.onlp_snapshot_hdr))
+
+    def testSnapshot(self):
+
+        # force at least one resize
+        snap = onlp.onlp.OnlpSnapshot(flags=onlp.onlp.ONLP_SNAPSHOT_F_SFP_PRESENCE,
+                                      size=ctypes.sizeof(onlp.onlp.onlp_snapshot_hdr))
+
+        self.assertEqual(ctypes.sizeof(onlp.onlp.onlp_snapshot_hdr), snap.hdr.hdr_size)
+        self.assertEqual(ctypes.sizeof(onlp.onlp.onlp_snapshot_oid), snap.hdr.oid_entry_size)
+        self.assertEqual(ctypes.sizeof(onlp.onlp.onlp_snapshot_sfp), snap.hdr.sfp_entry_size)
+        self.assertEqual(snap.size, len(snap.memoryview()))
+
+        oids = list(snap.oids())
+        self.assertEqual(snap.hdr.oid_count, len(oids))
+        self.assertEqual(onlp.onlp.ONLP_OID_SYS, oids[0].oid)
+
+        # every thermal should agree with the per-OID API
+        for e in oids:
+            if (e.oid >> 24) != onlp.onlp.ONLP_OID_TYPE.THERMAL: continue
+            if e.rv < 0: continue
+            thm = onlp.onlp.onlp_thermal_info()
+            libonlp.onlp_thermal_info_get(e.oid, ctypes.byref(thm))
+            self.assertEqual(thm.status, e.status)
+            self.assertEqual(thm.caps, e.caps)
+
+        bmap = onlp.onlp.aim_bitmap256()
+        libonlp.onlp_sfp_bitmap_get(ctypes.byref(bmap))
+        ports = [p for p in range(256) if onlp.onlp.aim_bitmap_get(bmap.hdr, p)]
+        self.assertEqual(ports, [e.port for e in snap.sfps()])
+
 if __name__ == "__main__":
     logging.basicConfig()
     unittest.main()
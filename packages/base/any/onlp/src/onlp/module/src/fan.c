@@ -55,36 +55,50 @@ ONLP_LOCKED_API0(onlp_fan_init)
 
 #if ONLP_CONFIG_INCLUDE_PLATFORM_OVERRIDES == 1
 
-static int
-onlp_fani_info_from_json__(cJSON* data, onlp_fan_info_t* fip, int errorcheck)
+static void
+onlp_fan_info_override__(const onlp_json_override_t* o, onlp_fan_info_t* fip)
 {
-    int rv;
-
-    if(data == NULL) {
-        return (errorcheck) ? ONLP_STATUS_E_PARAM : 0;
+    if(ONLP_JSON_OVERRIDE_IS_SET(o, ONLP_JSON_OVERRIDE_STATUS)) {
+        fip->status = o->values[ONLP_JSON_OVERRIDE_STATUS];
     }
+    if(ONLP_JSON_OVERRIDE_IS_SET(o, ONLP_JSON_OVERRIDE_CAPS)) {
+        fip->caps = o->values[ONLP_JSON_OVERRIDE_CAPS];
+    }
+    if(ONLP_JSON_OVERRIDE_IS_SET(o, ONLP_JSON_OVERRIDE_RPM)) {
+        fip->rpm = o->values[ONLP_JSON_OVERRIDE_RPM];
+    }
+    if(ONLP_JSON_OVERRIDE_IS_SET(o, ONLP_JSON_OVERRIDE_PERCENTAGE)) {
+        fip->percentage = o->values[ONLP_JSON_OVERRIDE_PERCENTAGE];
+    }
+    if(ONLP_JSON_OVERRIDE_IS_SET(o, ONLP_JSON_OVERRIDE_MODE)) {
+        fip->mode = o->values[ONLP_JSON_OVERRIDE_MODE];
+    }
+}
 
-    rv = cjson_util_lookup_int(data, (int*) &fip->status, "status");
-    if(rv < 0 && errorcheck) return rv;
-
-    rv = cjson_util_lookup_int(data, (int*) &fip->caps, "caps");
-    if(rv < 0 && errorcheck) return rv;
-
-    rv = cjson_util_lookup_int(data, (int*) &fip->rpm, "rpm");
-    if(rv < 0 && errorcheck) return rv;
-
-    rv = cjson_util_lookup_int(data, (int*) &fip->percentage, "percentage");
-    if(rv < 0 && errorcheck) return rv;
+#endif
 
-    rv = cjson_util_lookup_int(data, (int*) &fip->mode, "mode");
-    if(rv < 0 && errorcheck) return rv;
+void
+onlp_fan_info_adjust__(onlp_oid_t oid, onlp_fan_info_t* fip)
+{
+#if ONLP_CONFIG_INCLUDE_PLATFORM_OVERRIDES == 1
+    /*
+     * Optional override from the config file.
+     * This is usually just for testing.
+     */
+    const onlp_json_override_t* o =
+        ONLP_JSON_OVERRIDE(ONLP_OID_TYPE_FAN, ONLP_OID_ID_GET(oid));
+    if(o) {
+        onlp_fan_info_override__(o, fip);
+    }
+#endif
 
-    return 0;
+    if(fip->percentage && fip->rpm == 0) {
+        /* Approximate RPM based on a 10,000 RPM Maximum */
+        fip->rpm = fip->percentage * 100;
+    }
 }
 
-#endif
-
-static int
+int
 onlp_fan_info_get_locked__(onlp_oid_t oid, onlp_fan_info_t* fip)
 {
     int rv;
@@ -95,24 +109,7 @@ onlp_fan_info_get_locked__(onlp_oid_t oid, onlp_fan_info_t* fip)
     rv = onlp_fani_info_get(oid, fip);
 
     if(rv >= 0) {
-
-#if ONLP_CONFIG_INCLUDE_PLATFORM_OVERRIDES == 1
-        /*
-         * Optional override from the config file.
-         * This is usually just for testing.
-         */
-        int id = ONLP_OID_ID_GET(oid);
-        cJSON* entry = NULL;
-
-
-        cjson_util_lookup(onlp_json_get(0), &entry, "overrides.fan.%d", id);
-        onlp_fani_info_from_json__(entry, fip, 0);
-#endif
-
-        if(fip->percentage && fip->rpm == 0) {
-            /* Approximate RPM based on a 10,000 RPM Maximum */
-            fip->rpm = fip->percentage * 100;
-        }
+        onlp_fan_info_adjust__(oid, fip);
     }
 
     return rv;
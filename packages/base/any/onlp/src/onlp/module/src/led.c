@@ -76,7 +76,7 @@ onlp_led_init_locked__(void)
 }
 ONLP_LOCKED_API0(onlp_led_init);
 
-static int
+int
 onlp_led_info_get_locked__(onlp_oid_t id, onlp_led_info_t* info)
 {
     VALIDATE(id);
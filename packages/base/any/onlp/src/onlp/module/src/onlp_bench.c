@@ -0,0 +1,390 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ *
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ ************************************************************
+ *
+ * ONLP API latency and throughput benchmark.
+ *
+ * Each test runs the same API call from N concurrent clients
+ * and reports the per-call latency distribution and the total
+ * throughput. Objects are visited round-robin so every client
+ * touches every fan, PSU, thermal or port.
+ *
+ ***********************************************************/
+#include <onlp/onlp.h>
+#include <onlp/oids.h>
+#include <onlp/sys.h>
+#include <onlp/sfp.h>
+#include <onlp/fan.h>
+#include <onlp/psu.h>
+#include <onlp/thermal.h>
+#include <onlp/snapshot.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include "onlp_log.h"
+
+typedef struct bench_objects_s {
+    onlp_oid_t thermals[ONLP_OID_TABLE_SIZE];
+    int thermal_count;
+    onlp_oid_t fans[ONLP_OID_TABLE_SIZE];
+    int fan_count;
+    onlp_oid_t psus[ONLP_OID_TABLE_SIZE];
+    int psu_count;
+    int ports[256];
+    int port_count;
+    int snapshot_size;
+} bench_objects_t;
+
+static bench_objects_t objects__;
+
+/* Returns < 0 on error. */
+typedef int (*bench_op_f)(int i);
+
+static int
+op_sys_info__(int i)
+{
+    onlp_sys_info_t si;
+    int rv = onlp_sys_info_get(&si);
+    if(rv >= 0) {
+        onlp_sys_info_free(&si);
+    }
+    return rv;
+}
+
+static int
+op_thermal_info__(int i)
+{
+    onlp_thermal_info_t ti;
+    if(objects__.thermal_count == 0) {
+        return ONLP_STATUS_E_UNSUPPORTED;
+    }
+    return onlp_thermal_info_get(objects__.thermals[i % objects__.thermal_count], &ti);
+}
+
+static int
+op_fan_info__(int i)
+{
+    onlp_fan_info_t fi;
+    if(objects__.fan_count == 0) {
+        return ONLP_STATUS_E_UNSUPPORTED;
+    }
+    return onlp_fan_info_get(objects__.fans[i % objects__.fan_count], &fi);
+}
+
+static int
+op_psu_info__(int i)
+{
+    onlp_psu_info_t pi;
+    if(objects__.psu_count == 0) {
+        return ONLP_STATUS_E_UNSUPPORTED;
+    }
+    return onlp_psu_info_get(objects__.psus[i % objects__.psu_count], &pi);
+}
+
+static int
+op_sfp_present__(int i)
+{
+    if(objects__.port_count == 0) {
+        return ONLP_STATUS_E_UNSUPPORTED;
+    }
+    return onlp_sfp_is_present(objects__.ports[i % objects__.port_count]);
+}
+
+static int
+op_sfp_presence_bitmap__(int i)
+{
+    onlp_sfp_bitmap_t bmap;
+    onlp_sfp_bitmap_t_init(&bmap);
+    return onlp_sfp_presence_bitmap_get(&bmap);
+}
+
+static int
+op_sfp_eeprom__(int i)
+{
+    uint8_t* data = NULL;
+    int rv;
+    if(objects__.port_count == 0) {
+        return ONLP_STATUS_E_UNSUPPORTED;
+    }
+    rv = onlp_sfp_eeprom_read(objects__.ports[i % objects__.port_count], &data);
+    aim_free(data);
+    /* Empty ports are expected. */
+    return (rv == ONLP_STATUS_E_MISSING) ? 0 : rv;
+}
+
+static int
+op_snapshot__(int i)
+{
+    uint8_t* buffer = aim_zmalloc(objects__.snapshot_size);
+    int rv = onlp_snapshot_get(ONLP_SNAPSHOT_F_SFP_PRESENCE, buffer, objects__.snapshot_size);
+    aim_free(buffer);
+    return rv;
+}
+
+typedef struct bench_test_s {
+    const char* name;
+    bench_op_f op;
+} bench_test_t;
+
+static bench_test_t tests__[] = {
+    { "sys_info", op_sys_info__ },
+    { "thermal_info", op_thermal_info__ },
+    { "fan_info", op_fan_info__ },
+    { "psu_info", op_psu_info__ },
+    { "sfp_present", op_sfp_present__ },
+    { "sfp_presence_bitmap", op_sfp_presence_bitmap__ },
+    { "sfp_eeprom", op_sfp_eeprom__ },
+    { "snapshot", op_snapshot__ },
+    { NULL, NULL },
+};
+
+typedef struct bench_client_s {
+    pthread_t thread;
+    bench_op_f op;
+    int id;
+    int iterations;
+    uint64_t* latency;
+    int errors;
+    int first_error;
+} bench_client_t;
+
+static pthread_barrier_t start__;
+
+static uint64_t
+now_ns__(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void*
+client__(void* arg)
+{
+    bench_client_t* c = arg;
+    int i;
+
+    pthread_barrier_wait(&start__);
+
+    for(i = 0; i < c->iterations; i++) {
+        uint64_t start = now_ns__();
+        /* Stagger the clients so they do not all hit the same object. */
+        int rv = c->op(i + c->id);
+        c->latency[i] = now_ns__() - start;
+        if(rv < 0) {
+            if(c->errors++ == 0) {
+                c->first_error = rv;
+            }
+        }
+    }
+    return NULL;
+}
+
+static int
+u64_compare__(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static void
+bench_run__(bench_test_t* test, int clients, int iterations)
+{
+    bench_client_t* c = aim_zmalloc(clients * sizeof(*c));
+    int total = clients * iterations;
+    uint64_t* all = aim_zmalloc(total * sizeof(*all));
+    uint64_t start, elapsed;
+    int i, errors = 0, first_error = 0;
+
+    pthread_barrier_init(&start__, NULL, clients + 1);
+    for(i = 0; i < clients; i++) {
+        c[i].op = test->op;
+        c[i].id = i;
+        c[i].iterations = iterations;
+        c[i].latency = all + i * iterations;
+        pthread_create(&c[i].thread, NULL, client__, c + i);
+    }
+
+    pthread_barrier_wait(&start__);
+    start = now_ns__();
+    for(i = 0; i < clients; i++) {
+        pthread_join(c[i].thread, NULL);
+        if(c[i].errors && errors == 0) {
+            first_error = c[i].first_error;
+        }
+        errors += c[i].errors;
+    }
+    elapsed = now_ns__() - start;
+    pthread_barrier_destroy(&start__);
+
+    qsort(all, total, sizeof(*all), u64_compare__);
+
+    aim_printf(&aim_pvs_stdout,
+               "%-20s %7d %10.0f %9.1f %9.1f %9.1f %9.1f %7d",
+               test->name, clients,
+               elapsed ? (double)total * 1e9 / elapsed : 0.0,
+               all[0] / 1e3,
+               all[total / 2] / 1e3,
+               all[(int)((uint64_t)total * 99 / 100)] / 1e3,
+               all[total - 1] / 1e3,
+               errors);
+    if(errors) {
+        aim_printf(&aim_pvs_stdout, " (%{onlp_status})", first_error);
+    }
+    aim_printf(&aim_pvs_stdout, "\n");
+
+    aim_free(all);
+    aim_free(c);
+}
+
+static void
+objects_init__(void)
+{
+    onlp_sys_info_t si;
+    onlp_sfp_bitmap_t bmap;
+    onlp_oid_t* oidp;
+    int port;
+
+    if(onlp_sys_info_get(&si) >= 0) {
+        ONLP_OID_TABLE_ITER(si.hdr.coids, oidp) {
+            if(ONLP_OID_IS_THERMAL(*oidp)) {
+                objects__.thermals[objects__.thermal_count++] = *oidp;
+            }
+            else if(ONLP_OID_IS_FAN(*oidp)) {
+                objects__.fans[objects__.fan_count++] = *oidp;
+            }
+            else if(ONLP_OID_IS_PSU(*oidp)) {
+                objects__.psus[objects__.psu_count++] = *oidp;
+            }
+        }
+        onlp_sys_info_free(&si);
+    }
+
+    onlp_sfp_bitmap_t_init(&bmap);
+    onlp_sfp_bitmap_get(&bmap);
+    AIM_BITMAP_ITER(&bmap, port) {
+        objects__.ports[objects__.port_count++] = port;
+    }
+
+    objects__.snapshot_size = onlp_snapshot_get(ONLP_SNAPSHOT_F_SFP_PRESENCE, NULL, 0);
+    if(objects__.snapshot_size < 0) {
+        objects__.snapshot_size = 0;
+    }
+}
+
+static bench_test_t*
+test_find__(const char* name)
+{
+    bench_test_t* t;
+    for(t = tests__; t->name; t++) {
+        if(!strcmp(t->name, name)) {
+            return t;
+        }
+    }
+    return NULL;
+}
+
+int
+onlp_bench_main(int argc, char* argv[])
+{
+    int clients[32];
+    int client_count = 0;
+    int iterations = 1000;
+    char* names = NULL;
+    char* name;
+    char* list;
+    char* saveptr = NULL;
+    bench_test_t* t;
+    int c, i;
+
+    while( (c = getopt(argc, argv, "c:n:t:lh")) != -1) {
+        switch(c)
+            {
+            case 'c':
+                if(client_count < AIM_ARRAYSIZE(clients)) {
+                    clients[client_count++] = atoi(optarg);
+                }
+                break;
+            case 'n': iterations = atoi(optarg); break;
+            case 't': names = optarg; break;
+            case 'l':
+                for(t = tests__; t->name; t++) {
+                    printf("%s\n", t->name);
+                }
+                return 0;
+            default:
+                printf("Usage: %s [OPTIONS]\n", argv[0]);
+                printf("  -c N   Number of concurrent clients. May be repeated. Default 1.\n");
+                printf("  -n N   Calls per client. Default 1000.\n");
+                printf("  -t T   Comma separated list of tests. Default all.\n");
+                printf("  -l     List the tests.\n");
+                return (c == 'h') ? 0 : 1;
+            }
+    }
+
+    if(client_count == 0) {
+        clients[client_count++] = 1;
+    }
+    for(i = 0; i < client_count; i++) {
+        if(clients[i] <= 0) {
+            AIM_LOG_ERROR("Invalid client count %d", clients[i]);
+            return 1;
+        }
+    }
+    if(iterations <= 0) {
+        AIM_LOG_ERROR("Invalid iteration count %d", iterations);
+        return 1;
+    }
+
+    onlp_init();
+    objects_init__();
+
+    aim_printf(&aim_pvs_stdout, "thermals=%d fans=%d psus=%d ports=%d calls/client=%d\n\n",
+               objects__.thermal_count, objects__.fan_count,
+               objects__.psu_count, objects__.port_count, iterations);
+    aim_printf(&aim_pvs_stdout, "%-20s %7s %10s %9s %9s %9s %9s %7s\n",
+               "test", "clients", "calls/s", "min(us)", "p50(us)",
+               "p99(us)", "max(us)", "errors");
+
+    names = aim_strdup(names ? names : "");
+    for(i = 0; i < client_count; i++) {
+        if(*names == 0) {
+            for(t = tests__; t->name; t++) {
+                bench_run__(t, clients[i], iterations);
+            }
+            continue;
+        }
+        list = aim_strdup(names);
+        for(name = strtok_r(list, ",", &saveptr); name;
+            name = strtok_r(NULL, ",", &saveptr)) {
+            if((t = test_find__(name)) == NULL) {
+                AIM_LOG_ERROR("Unknown test '%s'", name);
+                continue;
+            }
+            bench_run__(t, clients[i], iterations);
+        }
+        aim_free(list);
+    }
+    aim_free(names);
+
+    onlp_denit();
+    return 0;
+}
@@ -44,4 +44,32 @@ void onlp_oid_show_description(iof_t* iof, onlp_oid_hdr_t* hdr);
 /** Standard message when an OID is missing. */
 void onlp_oid_show_state_missing(iof_t* iof);
 
+/**
+ * Unlocked API implementations.
+ * These may only be called while already holding the API lock.
+ */
+#include <onlp/thermal.h>
+#include <onlp/fan.h>
+#include <onlp/psu.h>
+#include <onlp/led.h>
+#include <onlp/sfp.h>
+
+int onlp_thermal_info_get_locked__(onlp_oid_t oid, onlp_thermal_info_t* info);
+int onlp_fan_info_get_locked__(onlp_oid_t oid, onlp_fan_info_t* fip);
+
+/* Apply the core overrides and defaults to platform fan information. */
+void onlp_fan_info_adjust__(onlp_oid_t oid, onlp_fan_info_t* fip);
+
+int onlp_psu_info_get_locked__(onlp_oid_t id, onlp_psu_info_t* info);
+int onlp_led_info_get_locked__(onlp_oid_t id, onlp_led_info_t* info);
+
+int onlp_sfp_bitmap_get_locked__(onlp_sfp_bitmap_t* bmap);
+int onlp_sfp_presence_bitmap_get_locked__(onlp_sfp_bitmap_t* dst);
+int onlp_sfp_eeprom_read_locked__(int port, uint8_t** datap);
+int onlp_sfp_dom_read_locked__(int port, uint8_t** datap);
+
+#include <onlp/sys.h>
+int onlp_sys_info_get_locked__(onlp_sys_info_t* rv);
+int onlp_snapshot_get_locked__(uint32_t flags, uint8_t* buffer, int size);
+
 #endif /* __ONLP_INT_H__ */
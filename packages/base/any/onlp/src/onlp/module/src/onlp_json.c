@@ -25,24 +25,113 @@
 #include "onlp_json.h"
 #include "onlp_log.h"
 #include <onlp/onlp.h>
+#include <stdlib.h>
 
 static cJSON* root__ = NULL;
 static char* file__ = NULL;
 
+onlp_json_override_table_t onlp_json_overrides__[ONLP_OID_TYPE_RTC+1];
+
+/** Sanity limit on override ids. */
+#define OVERRIDE_ID_MAX 0xFFFF
+
+typedef struct override_field_s {
+    onlp_json_override_field_t field;
+    const char* key;
+} override_field_t;
+
+static const override_field_t fan_fields__[] = {
+    { ONLP_JSON_OVERRIDE_STATUS, "status" },
+    { ONLP_JSON_OVERRIDE_CAPS, "caps" },
+    { ONLP_JSON_OVERRIDE_RPM, "rpm" },
+    { ONLP_JSON_OVERRIDE_PERCENTAGE, "percentage" },
+    { ONLP_JSON_OVERRIDE_MODE, "mode" },
+    { 0, NULL },
+};
+
+static const override_field_t thermal_fields__[] = {
+    { ONLP_JSON_OVERRIDE_STATUS, "status" },
+    { ONLP_JSON_OVERRIDE_MCELSIUS, "mcelsius" },
+    { 0, NULL },
+};
+
+static void
+overrides_compile__(onlp_oid_type_t type, const char* name,
+                    const override_field_t* fields)
+{
+    onlp_json_override_table_t* table = onlp_json_overrides__ + type;
+    cJSON* entries = NULL;
+    cJSON* entry;
+    int id, max = -1;
+
+    if(cjson_util_lookup(root__, &entries, "overrides.%s", name) < 0 ||
+       entries == NULL || entries->type != cJSON_Object) {
+        return;
+    }
+
+    for(entry = entries->child; entry; entry = entry->next) {
+        if(entry->string && (id = atoi(entry->string)) > max &&
+           id <= OVERRIDE_ID_MAX) {
+            max = id;
+        }
+    }
+    if(max < 0) {
+        return;
+    }
+
+    table->count = max + 1;
+    table->entries = aim_zmalloc(table->count * sizeof(*table->entries));
+
+    for(entry = entries->child; entry; entry = entry->next) {
+        const override_field_t* f;
+        onlp_json_override_t* o;
+
+        if(entry->string == NULL || (id = atoi(entry->string)) < 0 ||
+           id > max) {
+            continue;
+        }
+        o = table->entries + id;
+        for(f = fields; f->key; f++) {
+            if(cjson_util_lookup_int(entry, o->values + f->field, f->key) >= 0) {
+                o->set |= (1 << f->field);
+            }
+        }
+    }
+}
+
+static void
+overrides_clear__(void)
+{
+    int i;
+    for(i = 0; i < AIM_ARRAYSIZE(onlp_json_overrides__); i++) {
+        aim_free(onlp_json_overrides__[i].entries);
+        onlp_json_overrides__[i].entries = NULL;
+        onlp_json_overrides__[i].count = 0;
+    }
+}
+
 void
 onlp_json_init(const char* fname)
 {
     int rv;
+    /* fname may be file__, which is released below. */
+    char* name = fname ? aim_strdup(fname) : NULL;
+
     onlp_json_denit();
 
-    rv = cjson_util_parse_file(fname, &root__);
+    rv = name ? cjson_util_parse_file(name, &root__) : -1;
     if(rv < 0 || root__ == NULL) {
         root__ = cJSON_Parse("{}");
+        aim_free(name);
     }
     else {
-        file__ = aim_strdup(fname);
+        file__ = name;
     }
 
+#if ONLP_CONFIG_INCLUDE_PLATFORM_OVERRIDES == 1
+    overrides_compile__(ONLP_OID_TYPE_FAN, "fan", fan_fields__);
+    overrides_compile__(ONLP_OID_TYPE_THERMAL, "thermal", thermal_fields__);
+#endif
 }
 
 cJSON*
@@ -57,6 +146,7 @@ onlp_json_get(int reload)
 void
 onlp_json_denit(void)
 {
+    overrides_clear__();
     if(root__) {
         cJSON_Delete(root__);
         root__ = NULL;
@@ -45,4 +45,50 @@ cJSON* onlp_json_get(int reload);
 void onlp_json_denit(void);
 
 
+/**
+ * Platform overrides.
+ *
+ * The "overrides.<type>.<id>" entries in the configuration file are
+ * resolved once when it is loaded (or reloaded with onlp_json_get(1))
+ * into per-type tables indexed by OID id. Looking up an override is
+ * then a table check rather than a walk of the JSON tree.
+ */
+typedef enum onlp_json_override_field_e {
+    ONLP_JSON_OVERRIDE_STATUS,
+    ONLP_JSON_OVERRIDE_CAPS,
+    ONLP_JSON_OVERRIDE_RPM,
+    ONLP_JSON_OVERRIDE_PERCENTAGE,
+    ONLP_JSON_OVERRIDE_MODE,
+    ONLP_JSON_OVERRIDE_MCELSIUS,
+    ONLP_JSON_OVERRIDE_COUNT,
+} onlp_json_override_field_t;
+
+typedef struct onlp_json_override_s {
+    /** Bitmap of the fields which are set. */
+    uint32_t set;
+    int values[ONLP_JSON_OVERRIDE_COUNT];
+} onlp_json_override_t;
+
+#define ONLP_JSON_OVERRIDE_IS_SET(_o, _field) ((_o)->set & (1 << (_field)))
+
+typedef struct onlp_json_override_table_s {
+    /** Indexed by OID id. NULL if there are no overrides for this type. */
+    onlp_json_override_t* entries;
+    int count;
+} onlp_json_override_table_t;
+
+/** Indexed by OID type. */
+extern onlp_json_override_table_t onlp_json_overrides__[ONLP_OID_TYPE_RTC+1];
+
+/**
+ * @brief Get the override for an OID.
+ * @returns NULL if the OID has no override.
+ */
+#define ONLP_JSON_OVERRIDE(_type, _id)                                  \
+    ((onlp_json_overrides__[_type].entries &&                           \
+      (_id) < onlp_json_overrides__[_type].count &&                     \
+      onlp_json_overrides__[_type].entries[_id].set) ?                  \
+     &onlp_json_overrides__[_type].entries[_id] : NULL)
+
+
 #endif /* __ONLP_JSON_H__ */
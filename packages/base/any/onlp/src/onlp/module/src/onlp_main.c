@@ -25,6 +25,7 @@
 #include <onlp/onlp.h>
 #include <onlp/oids.h>
 #include <unistd.h>
+#include <getopt.h>
 #include <onlp/sys.h>
 #include <onlp/sfp.h>
 #include <sff/sff.h>
@@ -181,6 +182,7 @@ onlpdump_main(int argc, char* argv[])
     int l = 0;
     int M = 0;
     int b = 0;
+    int A = 0;
     char* pidfile = NULL;
     const char* O = NULL;
     const char* t = NULL;
@@ -199,9 +201,16 @@ onlpdump_main(int argc, char* argv[])
         }
     }
 
-    while( (c = getopt(argc, argv, "srehdojmyM:ipxlSt:O:bJ:")) != -1) {
+    static struct option long_options[] = {
+        { "json-all", no_argument, NULL, 'A' },
+        { NULL, 0, NULL, 0 },
+    };
+
+    while( (c = getopt_long(argc, argv, "srehdojmyM:ipxlSt:O:bJ:",
+                            long_options, NULL)) != -1) {
         switch(c)
             {
+            case 'A': A=1; break;
             case 's': show=1; break;
             case 'r': show=1; showflags |= ONLP_OID_SHOW_RECURSE; break;
             case 'e': show=1; showflags |= ONLP_OID_SHOW_EXTENDED; break;
@@ -245,6 +254,7 @@ onlpdump_main(int argc, char* argv[])
         printf("  -b   Decode SFP Inventory into SFF database entries.\n");
         printf("  -l   API Lock test.\n");
         printf("  -J   Decode ONIE JSON data.\n");
+        printf("  --json-all  Dump the system, OID and SFP state as JSON.\n");
         return rv;
     }
 
@@ -296,6 +306,16 @@ onlpdump_main(int argc, char* argv[])
         }
     }
 
+    if(A) {
+        fflush(stdout);
+        rv = onlp_platform_json_dump(STDOUT_FILENO);
+        if(rv < 0) {
+            fprintf(stderr, "onlp_platform_json_dump() failed: %d\n", rv);
+            return 1;
+        }
+        return 0;
+    }
+
     if(S) {
         show_inventory__(&aim_pvs_stdout, b);
         return 0;
@@ -0,0 +1,483 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ *
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ ************************************************************
+ *
+ * Full platform JSON export.
+ *
+ * The system information and a snapshot of every OID and SFP
+ * port are collected while holding the API lock once. The
+ * result is then written as compact JSON through a fixed
+ * buffer which is flushed to the output descriptor as it fills.
+ *
+ ***********************************************************/
+#include <onlp/onlp.h>
+#include <onlp/sys.h>
+#include <onlp/snapshot.h>
+#include <sff/sff.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <inttypes.h>
+#include "onlp_int.h"
+#include "onlp_locks.h"
+#include "onlp_log.h"
+
+#define JSON_BUFFER_SIZE 16384
+/** Nesting depth supported by the writer. */
+#define JSON_DEPTH_MAX 8
+
+typedef struct json_writer_s {
+    int fd;
+    char buffer[JSON_BUFFER_SIZE];
+    int len;
+    /** Set once a write fails. Later output is dropped. */
+    int error;
+    int depth;
+    /** Whether the current container has any members yet. */
+    int members[JSON_DEPTH_MAX];
+} json_writer_t;
+
+static void
+jw_flush__(json_writer_t* jw)
+{
+    char* p = jw->buffer;
+    while(jw->len > 0 && !jw->error) {
+        int rv = write(jw->fd, p, jw->len);
+        if(rv < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            jw->error = errno;
+            break;
+        }
+        p += rv;
+        jw->len -= rv;
+    }
+    jw->len = 0;
+}
+
+static void
+jw_raw__(json_writer_t* jw, const char* s, int len)
+{
+    while(len > 0) {
+        int n = JSON_BUFFER_SIZE - jw->len;
+        if(n == 0) {
+            jw_flush__(jw);
+            continue;
+        }
+        if(n > len) {
+            n = len;
+        }
+        ONLP_MEMCPY(jw->buffer + jw->len, s, n);
+        jw->len += n;
+        s += n;
+        len -= n;
+    }
+}
+
+static void
+jw_char__(json_writer_t* jw, char c)
+{
+    if(jw->len == JSON_BUFFER_SIZE) {
+        jw_flush__(jw);
+    }
+    jw->buffer[jw->len++] = c;
+}
+
+static void
+jw_printf__(json_writer_t* jw, const char* fmt, ...)
+{
+    char s[64];
+    int len;
+    va_list vargs;
+    va_start(vargs, fmt);
+    len = vsnprintf(s, sizeof(s), fmt, vargs);
+    va_end(vargs);
+    if(len > 0) {
+        jw_raw__(jw, s, (len < sizeof(s)) ? len : sizeof(s) - 1);
+    }
+}
+
+/*
+ * Length of the valid UTF-8 sequence at s, or 0 if it is not one.
+ * Overlong forms, surrogates and code points past U+10FFFF are
+ * not valid.
+ */
+static int
+utf8_length__(const unsigned char* s)
+{
+    int len, i;
+    unsigned int cp;
+
+    if(s[0] < 0x80) {
+        return 1;
+    }
+    else if(s[0] >= 0xc2 && s[0] <= 0xdf) {
+        len = 2;
+        cp = s[0] & 0x1f;
+    }
+    else if(s[0] >= 0xe0 && s[0] <= 0xef) {
+        len = 3;
+        cp = s[0] & 0x0f;
+    }
+    else if(s[0] >= 0xf0 && s[0] <= 0xf4) {
+        len = 4;
+        cp = s[0] & 0x07;
+    }
+    else {
+        return 0;
+    }
+
+    for(i = 1; i < len; i++) {
+        /* The NUL terminator also ends a truncated sequence here. */
+        if((s[i] & 0xc0) != 0x80) {
+            return 0;
+        }
+        cp = (cp << 6) | (s[i] & 0x3f);
+    }
+
+    if((len == 3 && cp < 0x800) || (len == 4 && cp < 0x10000) ||
+       (cp >= 0xd800 && cp <= 0xdfff) || cp > 0x10ffff) {
+        return 0;
+    }
+    return len;
+}
+
+/*
+ * Strings come from platform EEPROMs and drivers and are not always
+ * UTF-8. Bytes which are not part of a valid UTF-8 sequence are
+ * written as the Latin-1 character with that value.
+ */
+static void
+jw_string__(json_writer_t* jw, const char* s)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    if(s == NULL) {
+        jw_raw__(jw, "null", 4);
+        return;
+    }
+    jw_char__(jw, '"');
+    for(; *s; s++) {
+        unsigned char c = *s;
+        if(c == '"' || c == '\\') {
+            jw_char__(jw, '\\');
+            jw_char__(jw, c);
+        }
+        else if(c < 0x20) {
+            jw_raw__(jw, "\\u00", 4);
+            jw_char__(jw, hex[c >> 4]);
+            jw_char__(jw, hex[c & 0xf]);
+        }
+        else if(c < 0x80) {
+            jw_char__(jw, c);
+        }
+        else {
+            int len = utf8_length__((const unsigned char*)s);
+            if(len) {
+                jw_raw__(jw, s, len);
+                s += len - 1;
+            }
+            else {
+                jw_raw__(jw, "\\u00", 4);
+                jw_char__(jw, hex[c >> 4]);
+                jw_char__(jw, hex[c & 0xf]);
+            }
+        }
+    }
+    jw_char__(jw, '"');
+}
+
+/* Separator and key for the next member of the current container. */
+static void
+jw_key__(json_writer_t* jw, const char* key)
+{
+    if(jw->members[jw->depth]++) {
+        jw_char__(jw, ',');
+    }
+    if(key) {
+        jw_string__(jw, key);
+        jw_char__(jw, ':');
+    }
+}
+
+static void
+jw_open__(json_writer_t* jw, const char* key, char c)
+{
+    jw_key__(jw, key);
+    jw_char__(jw, c);
+    if(jw->depth + 1 >= JSON_DEPTH_MAX) {
+        AIM_DIE("JSON nesting too deep.");
+    }
+    jw->members[++jw->depth] = 0;
+}
+
+static void
+jw_close__(json_writer_t* jw, char c)
+{
+    jw_char__(jw, c);
+    jw->depth--;
+}
+
+static void
+jw_str__(json_writer_t* jw, const char* key, const char* value)
+{
+    jw_key__(jw, key);
+    jw_string__(jw, value);
+}
+
+static void
+jw_int__(json_writer_t* jw, const char* key, int64_t value)
+{
+    jw_key__(jw, key);
+    jw_printf__(jw, "%"PRId64, value);
+}
+
+static void
+jw_hex__(json_writer_t* jw, const char* key, uint32_t value)
+{
+    jw_key__(jw, key);
+    jw_printf__(jw, "\"0x%x\"", value);
+}
+
+static void
+jw_bytes__(json_writer_t* jw, const char* key, const uint8_t* data, int size)
+{
+    static const char hex[] = "0123456789abcdef";
+    int i;
+    jw_key__(jw, key);
+    jw_char__(jw, '"');
+    for(i = 0; i < size; i++) {
+        jw_char__(jw, hex[data[i] >> 4]);
+        jw_char__(jw, hex[data[i] & 0xf]);
+    }
+    jw_char__(jw, '"');
+}
+
+
+/*
+ * Collection.
+ */
+static int
+platform_json_collect_locked__(onlp_sys_info_t* si, uint8_t** snapshot)
+{
+    onlp_sfp_bitmap_t bitmap;
+    uint32_t flags = ONLP_SNAPSHOT_F_SFP;
+    int size, rv;
+
+    onlp_sys_info_get_locked__(si);
+
+    /*
+     * Size the snapshot buffer for the worst case instead of asking
+     * for the required size, which would read the hardware twice.
+     */
+    onlp_sfp_bitmap_t_init(&bitmap);
+    onlp_sfp_bitmap_get_locked__(&bitmap);
+    size = sizeof(onlp_snapshot_hdr_t) +
+        ONLP_OID_TABLE_SIZE * 4 * sizeof(onlp_snapshot_oid_t) +
+        AIM_BITMAP_COUNT(&bitmap) * sizeof(onlp_snapshot_sfp_t);
+
+    for(;;) {
+        *snapshot = aim_zmalloc(size);
+        rv = onlp_snapshot_get_locked__(flags, *snapshot, size);
+        if(rv <= size) {
+            break;
+        }
+        /* Truncated. Unlikely, but retry at the required size. */
+        aim_free(*snapshot);
+        size = rv;
+    }
+    if(rv < 0) {
+        aim_free(*snapshot);
+        *snapshot = NULL;
+        onlp_sys_info_free(si);
+    }
+    return rv;
+}
+
+
+/*
+ * Output.
+ */
+static void
+json_onie__(json_writer_t* jw, onlp_onie_info_t* info)
+{
+    char mac[32];
+
+    /* The same keys as onlp_onie_show_json(). */
+    jw_open__(jw, "onie", '{');
+    jw_str__(jw, "Product Name", info->product_name);
+    jw_str__(jw, "Part Number", info->part_number);
+    jw_str__(jw, "Serial Number", info->serial_number);
+    snprintf(mac, sizeof(mac), "%02x:%02x:%02x:%02x:%02x:%02x",
+             info->mac[0], info->mac[1], info->mac[2],
+             info->mac[3], info->mac[4], info->mac[5]);
+    jw_str__(jw, "MAC", mac);
+    jw_str__(jw, "Manufacturer", info->manufacturer);
+    jw_str__(jw, "Manufacture Date", info->manufacture_date);
+    jw_str__(jw, "Vendor", info->vendor);
+    jw_str__(jw, "Platform Name", info->platform_name);
+    jw_str__(jw, "Label Revision", info->label_revision);
+    jw_str__(jw, "Country Code", info->country_code);
+    jw_str__(jw, "Diag Version", info->diag_version);
+    jw_str__(jw, "Service Tag", info->service_tag);
+    jw_str__(jw, "ONIE Version", info->onie_version);
+    jw_int__(jw, "Device Version", info->device_version);
+    jw_int__(jw, "MAC Range", info->mac_range);
+    jw_hex__(jw, "CRC", info->crc);
+    jw_close__(jw, '}');
+}
+
+static void
+json_platform__(json_writer_t* jw, onlp_platform_info_t* pi)
+{
+    /* The same keys as onlp_platform_info_show_json(). */
+    jw_open__(jw, "platform", '{');
+    jw_str__(jw, "CPLD Versions", pi->cpld_versions);
+    jw_str__(jw, "Other Versions", pi->other_versions);
+    jw_close__(jw, '}');
+}
+
+static void
+json_oid__(json_writer_t* jw, onlp_snapshot_oid_t* e)
+{
+    static const char* thermal[] = { "mcelsius", "warning", "error", "shutdown" };
+    static const char* fan[] = { "rpm", "percentage", "mode" };
+    static const char* psu[] = { "mvin", "mvout", "miin", "miout", "mpin", "mpout" };
+    static const char* led[] = { "mode", "character" };
+    const char** names = NULL;
+    int count = 0, i;
+
+    jw_open__(jw, NULL, '{');
+    jw_hex__(jw, "oid", e->oid);
+    jw_str__(jw, "type", onlp_oid_type_name(ONLP_OID_TYPE_GET(e->oid)));
+    jw_int__(jw, "id", ONLP_OID_ID_GET(e->oid));
+    jw_hex__(jw, "parent", e->poid);
+    jw_int__(jw, "rv", e->rv);
+
+    if(e->rv >= 0) {
+        jw_hex__(jw, "status", e->status);
+        jw_hex__(jw, "caps", e->caps);
+        switch(ONLP_OID_TYPE_GET(e->oid))
+            {
+            case ONLP_OID_TYPE_THERMAL: names = thermal; count = AIM_ARRAYSIZE(thermal); break;
+            case ONLP_OID_TYPE_FAN: names = fan; count = AIM_ARRAYSIZE(fan); break;
+            case ONLP_OID_TYPE_PSU: names = psu; count = AIM_ARRAYSIZE(psu); break;
+            case ONLP_OID_TYPE_LED: names = led; count = AIM_ARRAYSIZE(led); break;
+            default: break;
+            }
+        for(i = 0; i < count; i++) {
+            jw_int__(jw, names[i], e->values[i]);
+        }
+    }
+    jw_close__(jw, '}');
+}
+
+static void
+json_sfp__(json_writer_t* jw, onlp_snapshot_sfp_t* e)
+{
+    jw_open__(jw, NULL, '{');
+    jw_int__(jw, "port", e->port);
+    if(e->present < 0) {
+        jw_int__(jw, "present", e->present);
+    }
+    else {
+        jw_key__(jw, "present");
+        jw_raw__(jw, e->present ? "true" : "false", e->present ? 4 : 5);
+    }
+
+    if(e->present == 1) {
+        jw_int__(jw, "eeprom_rv", e->eeprom_rv);
+        if(e->eeprom_rv >= 0) {
+            sff_eeprom_t sff;
+            sff_eeprom_parse(&sff, e->eeprom);
+            if(sff.identified) {
+                jw_open__(jw, "identity", '{');
+                jw_str__(jw, "type", sff.info.module_type_name);
+                jw_str__(jw, "media", sff.info.media_type_name);
+                jw_str__(jw, "length", sff.info.length_desc);
+                jw_str__(jw, "vendor", sff.info.vendor);
+                jw_str__(jw, "model", sff.info.model);
+                jw_str__(jw, "serial", sff.info.serial);
+                jw_close__(jw, '}');
+            }
+            jw_bytes__(jw, "eeprom", e->eeprom, sizeof(e->eeprom));
+        }
+        jw_int__(jw, "dom_rv", e->dom_rv);
+        if(e->dom_rv >= 0) {
+            jw_bytes__(jw, "dom", e->dom, sizeof(e->dom));
+        }
+    }
+    jw_close__(jw, '}');
+}
+
+int
+onlp_platform_json_dump(int fd)
+{
+    onlp_sys_info_t si;
+    uint8_t* snapshot = NULL;
+    onlp_snapshot_hdr_t* hdr;
+    json_writer_t* jw;
+    uint8_t* p;
+    int rv, i;
+
+    ONLP_API_LOCK("onlp_platform_json_dump");
+    rv = platform_json_collect_locked__(&si, &snapshot);
+    ONLP_API_UNLOCK();
+
+    if(rv < 0) {
+        return rv;
+    }
+
+    jw = aim_zmalloc(sizeof(*jw));
+    jw->fd = fd;
+    hdr = (onlp_snapshot_hdr_t*)snapshot;
+
+    jw_open__(jw, NULL, '{');
+    jw_int__(jw, "version", 1);
+    jw_int__(jw, "timestamp_us", hdr->timestamp);
+    jw_int__(jw, "duration_us", hdr->duration);
+
+    json_onie__(jw, &si.onie_info);
+    json_platform__(jw, &si.platform_info);
+
+    p = snapshot + hdr->hdr_size;
+    jw_open__(jw, "oids", '[');
+    for(i = 0; i < hdr->oid_count; i++, p += hdr->oid_entry_size) {
+        json_oid__(jw, (onlp_snapshot_oid_t*)p);
+    }
+    jw_close__(jw, ']');
+
+    jw_open__(jw, "sfps", '[');
+    for(i = 0; i < hdr->sfp_count; i++, p += hdr->sfp_entry_size) {
+        json_sfp__(jw, (onlp_snapshot_sfp_t*)p);
+    }
+    jw_close__(jw, ']');
+
+    jw_close__(jw, '}');
+    jw_char__(jw, '\n');
+    jw_flush__(jw);
+
+    rv = jw->error ? ONLP_STATUS_E_INTERNAL : ONLP_STATUS_OK;
+    aim_free(jw);
+    aim_free(snapshot);
+    onlp_sys_info_free(&si);
+    return rv;
+}
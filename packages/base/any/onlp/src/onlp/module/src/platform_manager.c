@@ -25,14 +25,20 @@
 #include <onlp/sys.h>
 #include <onlp/psu.h>
 #include <onlp/fan.h>
+#include <onlp/thermal.h>
 #include <onlp/platformi/sysi.h>
+#include <onlp/platformi/fani.h>
+#include <onlp/platformi/psui.h>
+#include <onlp/platformi/thermali.h>
 #include <onlplib/mmap.h>
+#include <onlplib/logring.h>
 #include <timer_wheel/timer_wheel.h>
 #include <OS/os_time.h>
 #include <OS/os_thread.h>
 #include <AIM/aim.h>
 #include "onlp_log.h"
 #include "onlp_int.h"
+#include "onlp_locks.h"
 #include <sys/eventfd.h>
 #include <errno.h>
 #include <pthread.h>
@@ -47,6 +53,12 @@ typedef struct management_entry_s {
     /** This is the callback for this timer */
     int (*manage)(void);
 
+    /**
+     * The status callback for this timer. It is called first, and
+     * replaced by manage if it returns ONLP_STATUS_E_UNSUPPORTED.
+     */
+    int (*manage_status)(onlp_sys_manage_status_t* status);
+
     /** This is the callback rate in microseconds */
     uint64_t rate;
 
@@ -56,8 +68,85 @@ typedef struct management_entry_s {
     /** The number of times this has been called. */
     int calls;
 
+    /** The status callback is not implemented. */
+    int legacy;
+
 } management_entry_t;
 
+/**
+ * The status of one class of objects for the current tick.
+ */
+typedef struct manage_class_s {
+    /** The system OIDs of this class */
+    onlp_oid_t oids[ONLP_OID_TABLE_SIZE];
+    int count;
+
+    /** info_get() results, indexed like oids */
+    void* info;
+    int* rv;
+    int info_size;
+    int (*info_get)(onlp_oid_t oid, void* info);
+
+    /** The information has been read during this tick. */
+    int valid;
+} manage_class_t;
+
+struct onlp_sys_manage_status_s {
+    /** The system OIDs have been discovered. */
+    int discovered;
+    manage_class_t fans;
+    manage_class_t psus;
+    manage_class_t thermals;
+};
+
+/*
+ * The status holds the platform's own information, as the platform
+ * management tasks have always read it. The core notifiers apply
+ * the core adjustments to their copy.
+ */
+static int
+fan_info_get__(onlp_oid_t oid, void* info)
+{
+    int rv;
+    ONLP_API_LOCK("fan_info_get__");
+    rv = onlp_fani_info_get(oid, info);
+    ONLP_API_UNLOCK();
+    return rv;
+}
+
+static int
+psu_info_get__(onlp_oid_t oid, void* info)
+{
+    int rv;
+    ONLP_API_LOCK("psu_info_get__");
+    rv = onlp_psui_info_get(oid, info);
+    ONLP_API_UNLOCK();
+    return rv;
+}
+
+static int
+thermal_info_get__(onlp_oid_t oid, void* info)
+{
+    int rv;
+    ONLP_API_LOCK("thermal_info_get__");
+    rv = onlp_thermali_info_get(oid, info);
+    ONLP_API_UNLOCK();
+    return rv;
+}
+
+static onlp_sys_manage_status_t status__ = {
+    0,
+    { .info_size = sizeof(onlp_fan_info_t), .info_get = fan_info_get__ },
+    { .info_size = sizeof(onlp_psu_info_t), .info_get = psu_info_get__ },
+    { .info_size = sizeof(onlp_thermal_info_t), .info_get = thermal_info_get__ },
+};
+
+/*
+ * Entries due within this window of a tick run in that tick, so
+ * they share the same status.
+ */
+#define MANAGE_COALESCE_US (100*1000)
+
 /**
  * Platform management control structure.
  */
@@ -73,18 +162,30 @@ typedef struct management_ctrl_s {
 static management_ctrl_t control__ = { NULL };
 
 
+/*
+ * PSU and fan transitions are posted to the log ring rather than
+ * written to syslog from this thread. The syslog name is the
+ * message id key and the OID is the instance, so a flapping unit
+ * is reported once per interval with a repeat count, and its
+ * transitions stay in order. The name and description are written
+ * to syslog unchanged.
+ */
+#define PM_SYSLOG(_level, _name, _desc, _oid, ...)                      \
+    onlp_logring_post(_name, _desc, _oid, ONLP_LOGRING_LEVEL_##_level,  \
+                      ONLP_LOGRING_F_SYSLOG, __VA_ARGS__)
+
 /*
  * Internal notification handler for PSU
  * status changes (all platforms)
  */
-static int platform_psus_notify__(void);
+static int platform_psus_notify__(onlp_sys_manage_status_t* status);
 
 
 /*
  * Internal notification handler for FAN
  * status changes (all platforms)
  */
-static int platform_fans_notify__(void);
+static int platform_fans_notify__(onlp_sys_manage_status_t* status);
 
 
 
@@ -98,6 +199,7 @@ static management_entry_t management_entries[] =
         {
             { },
             onlp_sysi_platform_manage_fans,
+            onlp_sysi_platform_manage_fans_status,
             /* Every 10 seconds */
             10*1000*1000,
             "Fans",
@@ -105,6 +207,7 @@ static management_entry_t management_entries[] =
         {
             { },
             onlp_sysi_platform_manage_leds,
+            onlp_sysi_platform_manage_leds_status,
             /* Every 2 seconds */
             2*1000*1000,
             "LEDs",
@@ -112,6 +215,7 @@ static management_entry_t management_entries[] =
         },
         {
             { },
+            NULL,
             platform_psus_notify__,
             /* Every second */
             1*1000*1000,
@@ -119,6 +223,7 @@ static management_entry_t management_entries[] =
         },
         {
             { },
+            NULL,
             platform_fans_notify__,
             /* Every second */
             1*1000*1000,
@@ -145,20 +250,144 @@ onlp_sys_platform_manage_init(void)
 }
 
 
+static int
+status_discover__(onlp_sys_manage_status_t* status)
+{
+    onlp_sys_info_t si;
+    onlp_oid_t* oidp;
+
+    if(status->discovered) {
+        return 0;
+    }
+
+    if(onlp_sys_info_get(&si) < 0) {
+        AIM_LOG_ERROR("onlp_sys_info_get() failed.");
+        return -1;
+    }
+
+    status->fans.count = status->psus.count = status->thermals.count = 0;
+    ONLP_OID_TABLE_ITER(si.hdr.coids, oidp) {
+        manage_class_t* c = NULL;
+        if(ONLP_OID_IS_FAN(*oidp)) {
+            c = &status->fans;
+        }
+        else if(ONLP_OID_IS_PSU(*oidp)) {
+            c = &status->psus;
+        }
+        else if(ONLP_OID_IS_THERMAL(*oidp)) {
+            c = &status->thermals;
+        }
+        if(c) {
+            c->oids[c->count++] = *oidp;
+        }
+    }
+    /* free allocated memory */
+    onlp_sys_info_free(&si);
+
+    status->fans.info = aim_zmalloc(status->fans.count * sizeof(onlp_fan_info_t) + 1);
+    status->fans.rv = aim_zmalloc(status->fans.count * sizeof(int) + 1);
+    status->psus.info = aim_zmalloc(status->psus.count * sizeof(onlp_psu_info_t) + 1);
+    status->psus.rv = aim_zmalloc(status->psus.count * sizeof(int) + 1);
+    status->thermals.info = aim_zmalloc(status->thermals.count * sizeof(onlp_thermal_info_t) + 1);
+    status->thermals.rv = aim_zmalloc(status->thermals.count * sizeof(int) + 1);
+    status->discovered = 1;
+    return 0;
+}
+
+static void
+status_invalidate__(onlp_sys_manage_status_t* status)
+{
+    status->fans.valid = 0;
+    status->psus.valid = 0;
+    status->thermals.valid = 0;
+}
+
+static int
+status_get__(onlp_sys_manage_status_t* status, manage_class_t* c,
+             onlp_oid_t oid, void* info)
+{
+    int i;
+
+    if(status_discover__(status) < 0) {
+        return c->info_get(oid, info);
+    }
+
+    for(i = 0; i < c->count && c->oids[i] != oid; i++);
+    if(i == c->count) {
+        /* Not a system object (e.g. a PSU fan). */
+        return c->info_get(oid, info);
+    }
+
+    if(!c->valid) {
+        int j;
+        for(j = 0; j < c->count; j++) {
+            c->rv[j] = c->info_get(c->oids[j],
+                                   (uint8_t*)c->info + j*c->info_size);
+        }
+        c->valid = 1;
+    }
+
+    memcpy(info, (uint8_t*)c->info + i*c->info_size, c->info_size);
+    return c->rv[i];
+}
+
+int
+onlp_sys_manage_status_fan_get(onlp_sys_manage_status_t* status,
+                               onlp_oid_t oid, onlp_fan_info_t* info)
+{
+    return status_get__(status, &status->fans, oid, info);
+}
+
+int
+onlp_sys_manage_status_psu_get(onlp_sys_manage_status_t* status,
+                               onlp_oid_t oid, onlp_psu_info_t* info)
+{
+    return status_get__(status, &status->psus, oid, info);
+}
+
+int
+onlp_sys_manage_status_thermal_get(onlp_sys_manage_status_t* status,
+                                   onlp_oid_t oid, onlp_thermal_info_t* info)
+{
+    return status_get__(status, &status->thermals, oid, info);
+}
+
+static void
+manage_entry_call__(management_entry_t* e)
+{
+    if(e->manage_status && !e->legacy) {
+        if(e->manage_status(&status__) != ONLP_STATUS_E_UNSUPPORTED) {
+            return;
+        }
+        /* The platform does not use the shared status. */
+        e->legacy = 1;
+    }
+    if(e->manage) {
+        e->manage();
+    }
+}
+
 void
 onlp_sys_platform_manage_now(void)
 {
     management_entry_t* e;
+    uint64_t now;
 
     onlp_sys_platform_manage_init();
 
+    /*
+     * All entries due in this tick share one status and are
+     * rescheduled relative to the tick, so entries with related
+     * rates stay in phase and keep sharing it.
+     */
+    now = os_time_monotonic();
+    status_invalidate__(&status__);
+
     while( (e = (management_entry_t*) timer_wheel_next(control__.tw,
-                                                       os_time_monotonic())) ) {
-        if(e->manage) {
-            e->manage();
-        }
+                                                       now + MANAGE_COALESCE_US)) ) {
+        manage_entry_call__(e);
         e->calls++;
-        timer_wheel_insert(control__.tw, &e->twe, os_time_monotonic() + e->rate);
+        timer_wheel_insert(control__.tw, &e->twe, now + e->rate);
     }
 }
 
@@ -243,6 +472,8 @@ onlp_sys_platform_manage_start(int block)
         return -1;
     }
 
+    onlp_logring_start();
+
     if( (pthread_create(&control__.thread, NULL, onlp_sys_platform_manage_thread__,
                         &control__)) != 0) {
         AIM_LOG_ERROR("pthread create failed.");
@@ -281,44 +512,29 @@ onlp_sys_platform_manage_join(void)
         pthread_join(control__.thread, NULL);
         close(control__.eventfd);
         control__.eventfd = -1;
+        onlp_logring_stop();
     }
     return 0;
 }
 
 
 static int
-platform_psus_notify__(void)
+platform_psus_notify__(onlp_sys_manage_status_t* status)
 {
-    static onlp_oid_t psu_oid_table[ONLP_OID_TABLE_SIZE] = {0};
     static onlp_psu_info_t psu_info_table[ONLP_OID_TABLE_SIZE];
     int i = 0;
     static int flag[ONLP_OID_TABLE_SIZE] = {0};
 
-    if(psu_oid_table[0] == 0) {
-        /* We haven't retreived the system PSU oids yet. */
-        onlp_sys_info_t si;
-        onlp_oid_t* oidp;
-
-        if(onlp_sys_info_get(&si) < 0) {
-            AIM_LOG_ERROR("onlp_sys_info_get() failed.");
-            return -1;
-        }
-        ONLP_OID_TABLE_ITER_TYPE(si.hdr.coids, oidp, PSU) {
-            psu_oid_table[i++] = *oidp;
-        }
-        /* free allocated memory */
-        onlp_sys_info_free(&si);
+    if(status_discover__(status) < 0) {
+        return -1;
     }
 
-    for(i = 0; i < AIM_ARRAYSIZE(psu_oid_table); i++) {
+    for(i = 0; i < status->psus.count; i++) {
         onlp_psu_info_t pi;
-        int pid = ONLP_OID_ID_GET(psu_oid_table[i]);
+        onlp_oid_t oid = status->psus.oids[i];
+        int pid = ONLP_OID_ID_GET(oid);
 
-        if(psu_oid_table[i] == 0) {
-            break;
-        }
-
-        if(onlp_psu_info_get(psu_oid_table[i], &pi) < 0) {
+        if(onlp_sys_manage_status_psu_get(status, oid, &pi) < 0) {
             AIM_LOG_ERROR("Failure retreiving status of PSU ID %d",
                           pid);
             continue;
@@ -327,19 +543,19 @@ platform_psus_notify__(void)
         /* report initial failed state */
         if ( !flag[i] ) {
             if ( !(pi.status & 0x1) ) {
-                AIM_SYSLOG_WARN("PSU <id> is not present.",
-                                "The given PSU is not present.",
-                                "PSU %d is not present.", pid);
+                PM_SYSLOG(WARN, "PSU <id> is not present.",
+                          "The given PSU is not present.",
+                          oid, "PSU %d is not present.", pid);
             }
             if ( pi.status & ONLP_PSU_STATUS_FAILED ) {
-                AIM_SYSLOG_CRIT("PSU <id> has failed.",
-                                "The given PSU has failed.",
-                                "PSU %d has failed.", pid);
+                PM_SYSLOG(CRIT, "PSU <id> has failed.",
+                          "The given PSU has failed.",
+                          oid, "PSU %d has failed.", pid);
             }
             if ((pi.status & 0x01) && !(pi.status & ONLP_PSU_STATUS_FAILED) && (pi.status & ONLP_PSU_STATUS_UNPLUGGED)) {
-                AIM_SYSLOG_WARN("PSU <id> power cord not plugged.",
-                                "The given PSU does not have power cord plugged.",
-                                "PSU %d power cord not plugged.", pid);
+                PM_SYSLOG(WARN, "PSU <id> power cord not plugged.",
+                          "The given PSU does not have power cord plugged.",
+                          oid, "PSU %d power cord not plugged.", pid);
             }
             flag[i] = 1;
         }
@@ -353,43 +569,43 @@ platform_psus_notify__(void)
 
             if( !(old & 0x1) && (new & 0x1) ) {
                 /* PSU Inserted */
-                AIM_SYSLOG_INFO("PSU <id> has been inserted.",
-                                "A PSU has been inserted in the given slot.",
-                                "PSU %d has been inserted.", pid);
+                PM_SYSLOG(INFO, "PSU <id> has been inserted.",
+                          "A PSU has been inserted in the given slot.",
+                          oid, "PSU %d has been inserted.", pid);
             }
             if( (old & 0x1) && !(new & 0x1) ) {
                 /* PSU Removed */
-                AIM_SYSLOG_WARN("PSU <id> has been removed.",
-                                "A PSU has been removed from the given slot.",
-                                "PSU %d has been removed.", pid);
+                PM_SYSLOG(WARN, "PSU <id> has been removed.",
+                          "A PSU has been removed from the given slot.",
+                          oid, "PSU %d has been removed.", pid);
             }
             if( (new & 0x1) && (old & ONLP_PSU_STATUS_FAILED) && !(new & ONLP_PSU_STATUS_FAILED) ) {
                 /* PSU recovery (seems unlikely) */
-                AIM_SYSLOG_INFO("PSU <id> has recovered.",
-                                "The given PSU has recovered from a failure.",
-                                "PSU %d has recovered.", pid);
+                PM_SYSLOG(INFO, "PSU <id> has recovered.",
+                          "The given PSU has recovered from a failure.",
+                          oid, "PSU %d has recovered.", pid);
             }
 
             if( !(old & ONLP_PSU_STATUS_FAILED) && (new & ONLP_PSU_STATUS_FAILED) ) {
                 /* PSU Failure */
-                AIM_SYSLOG_CRIT("PSU <id> has failed.",
-                                "The given PSU has failed.",
-                                "PSU %d has failed.", pid);
+                PM_SYSLOG(CRIT, "PSU <id> has failed.",
+                          "The given PSU has failed.",
+                          oid, "PSU %d has failed.", pid);
             }
 
             if(!(new & ONLP_PSU_STATUS_FAILED) && (new & ONLP_PSU_STATUS_PRESENT)) {
                 if( (old & ONLP_PSU_STATUS_UNPLUGGED) && !(new & ONLP_PSU_STATUS_UNPLUGGED)) {
                     /* PSU has been plugged in */
-                    AIM_SYSLOG_INFO("PSU <id> has been plugged in.",
-                                    "The given PSU has been plugged in.",
-                                    "PSU %d has been plugged in.", pid);
+                    PM_SYSLOG(INFO, "PSU <id> has been plugged in.",
+                              "The given PSU has been plugged in.",
+                              oid, "PSU %d has been plugged in.", pid);
                 }
 
                 if(!(old & ONLP_PSU_STATUS_UNPLUGGED) && (new & ONLP_PSU_STATUS_UNPLUGGED)) {
                     /* PSU has been unplugged. */
-                    AIM_SYSLOG_WARN("PSU <id> has been unplugged.",
-                                    "The given PSU has been unplugged.",
-                                    "PSU %d has been unplugged.", pid);
+                    PM_SYSLOG(WARN, "PSU <id> has been unplugged.",
+                              "The given PSU has been unplugged.",
+                              oid, "PSU %d has been unplugged.", pid);
                 }
             }
 
@@ -400,54 +616,39 @@ platform_psus_notify__(void)
 }
 
 static int
-platform_fans_notify__(void)
+platform_fans_notify__(onlp_sys_manage_status_t* status)
 {
-    static onlp_oid_t fan_oid_table[ONLP_OID_TABLE_SIZE] = {0};
     static onlp_fan_info_t fan_info_table[ONLP_OID_TABLE_SIZE];
     int i = 0;
     static int flag[ONLP_OID_TABLE_SIZE] = {0};
 
-    if(fan_oid_table[0] == 0) {
-        /* We haven't retreived the system FAN oids yet. */
-        onlp_sys_info_t si;
-        onlp_oid_t* oidp;
-
-        if(onlp_sys_info_get(&si) < 0) {
-            AIM_LOG_ERROR("onlp_sys_info_get() failed.");
-            return -1;
-        }
-        ONLP_OID_TABLE_ITER_TYPE(si.hdr.coids, oidp, FAN) {
-            fan_oid_table[i++] = *oidp;
-        }
-        /* free allocated memory */
-        onlp_sys_info_free(&si);
+    if(status_discover__(status) < 0) {
+        return -1;
     }
 
-    for(i = 0; i < AIM_ARRAYSIZE(fan_oid_table); i++) {
+    for(i = 0; i < status->fans.count; i++) {
         onlp_fan_info_t fi;
-        int fid = ONLP_OID_ID_GET(fan_oid_table[i]);
-
-        if(fan_oid_table[i] == 0) {
-            break;
-        }
+        onlp_oid_t oid = status->fans.oids[i];
+        int fid = ONLP_OID_ID_GET(oid);
 
-        if(onlp_fan_info_get(fan_oid_table[i], &fi) < 0) {
+        if(onlp_sys_manage_status_fan_get(status, oid, &fi) < 0) {
             AIM_LOG_ERROR("Failure retreiving status of FAN ID %d",
                           fid);
             continue;
         }
+        onlp_fan_info_adjust__(oid, &fi);
 
         /* report initial failed state */
         if ( !flag[i] ) {
             if ( !(fi.status & 0x1) ) {
-                    AIM_SYSLOG_WARN("Fan <id> is not present.",
-                                "The given Fan is not present.",
-                                "Fan %d is not present.", fid);
+                    PM_SYSLOG(WARN, "Fan <id> is not present.",
+                              "The given Fan is not present.",
+                              oid, "Fan %d is not present.", fid);
             }
             if ( fi.status & ONLP_FAN_STATUS_FAILED ) {
-                    AIM_SYSLOG_CRIT("Fan <id> has failed.",
-                                "The given fan has failed.",
-                                "Fan %d has failed.", fid);
+                    PM_SYSLOG(CRIT, "Fan <id> has failed.",
+                              "The given fan has failed.",
+                              oid, "Fan %d has failed.", fid);
             }
            flag[i] = 1;
         }
@@ -461,27 +662,27 @@ platform_fans_notify__(void)
 
             if( !(old & 0x1) && (new & 0x1) ) {
                 /* FAN Inserted */
-                AIM_SYSLOG_INFO("Fan <id> has been inserted.",
-                                "The given Fan has been inserted.",
-                                "Fan %d has been inserted.", fid);
+                PM_SYSLOG(INFO, "Fan <id> has been inserted.",
+                          "The given Fan has been inserted.",
+                          oid, "Fan %d has been inserted.", fid);
             }
             if( (old & 0x1) && !(new & 0x1) ) {
                 /* FAN Removed */
-                AIM_SYSLOG_WARN("Fan <id> has been removed.",
-                                "The given Fan has been removed.",
-                                "Fan %d has been removed.", fid);
+                PM_SYSLOG(WARN, "Fan <id> has been removed.",
+                          "The given Fan has been removed.",
+                          oid, "Fan %d has been removed.", fid);
             }
             if( (old & ONLP_FAN_STATUS_FAILED) && !(new & ONLP_FAN_STATUS_FAILED) ) {
-                AIM_SYSLOG_INFO("Fan <id> has recovered.",
-                                "The given Fan has recovered from failure.",
-                                "Fan %d has recovered.", fid);
+                PM_SYSLOG(INFO, "Fan <id> has recovered.",
+                          "The given Fan has recovered from failure.",
+                          oid, "Fan %d has recovered.", fid);
             }
 
             if( !(old & ONLP_FAN_STATUS_FAILED) && (new & ONLP_FAN_STATUS_FAILED) ) {
                 /* FAN Failure */
-                AIM_SYSLOG_CRIT("Fan <id> has failed.",
-                                "The given fan has failed.",
-                                "Fan %d has failed.", fid);
+                PM_SYSLOG(CRIT, "Fan <id> has failed.",
+                          "The given fan has failed.",
+                          oid, "Fan %d has failed.", fid);
             }
 
             memcpy(fan_info_table+i, &fi, sizeof(fi));
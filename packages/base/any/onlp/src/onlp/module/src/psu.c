@@ -52,7 +52,7 @@ onlp_psu_init_locked__(void)
 }
 ONLP_LOCKED_API0(onlp_psu_init);
 
-static int
+int
 onlp_psu_info_get_locked__(onlp_oid_t id,  onlp_psu_info_t* info)
 {
     VALIDATE(id);
@@ -71,7 +71,7 @@ ONLP_LOCKED_API0(onlp_sfp_init)
 
 
 
-static int
+int
 onlp_sfp_bitmap_get_locked__(onlp_sfp_bitmap_t* bmap)
 {
     AIM_BITMAP_ASSIGN(bmap, &sfpi_bitmap__);
@@ -107,7 +107,7 @@ onlp_sfp_is_present_locked__(int port)
 }
 ONLP_LOCKED_API1(onlp_sfp_is_present, int, port);
 
-static int
+int
 onlp_sfp_presence_bitmap_get_locked__(onlp_sfp_bitmap_t* dst)
 {
     onlp_sfp_bitmap_t_init(dst);
@@ -139,7 +139,7 @@ onlp_sfp_port_valid(int port)
     return AIM_BITMAP_GET(&sfpi_bitmap__, port);
 }
 
-static int
+int
 onlp_sfp_eeprom_read_locked__(int port, uint8_t** datap)
 {
     int rv;
@@ -156,7 +156,7 @@ onlp_sfp_eeprom_read_locked__(int port, uint8_t** datap)
 }
 ONLP_LOCKED_API2(onlp_sfp_eeprom_read, int, port, uint8_t**, rv);
 
-static int
+int
 onlp_sfp_dom_read_locked__(int port, uint8_t** datap)
 {
     int rv;
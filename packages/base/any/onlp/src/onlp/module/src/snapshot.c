@@ -0,0 +1,243 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ *
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ ************************************************************
+ *
+ * Bulk Platform Snapshots.
+ *
+ ***********************************************************/
+#include <onlp/snapshot.h>
+#include <onlp/platformi/sysi.h>
+#include <AIM/aim_time.h>
+#include "onlp_int.h"
+#include "onlp_locks.h"
+#include "onlp_log.h"
+
+typedef struct snapshot_ctrl_s {
+    uint8_t* buffer;
+    int size;
+    /** Bytes required for the full snapshot. */
+    int required;
+    onlp_snapshot_hdr_t hdr;
+} snapshot_ctrl_t;
+
+/*
+ * Reserve space for the next entry. Returns NULL once the buffer
+ * is exhausted but continues to account for the required size.
+ */
+static void*
+snapshot_reserve__(snapshot_ctrl_t* ctrl, int size)
+{
+    void* rv = NULL;
+    if(ctrl->required + size <= ctrl->size) {
+        rv = ctrl->buffer + ctrl->required;
+        ONLP_MEMSET(rv, 0, size);
+    }
+    ctrl->required += size;
+    return rv;
+}
+
+static void
+snapshot_oid__(snapshot_ctrl_t* ctrl, onlp_oid_t oid, onlp_oid_hdr_t* hdr)
+{
+    onlp_snapshot_oid_t* e;
+    onlp_oid_t* oidp;
+    union {
+        onlp_thermal_info_t ti;
+        onlp_fan_info_t fi;
+        onlp_psu_info_t pi;
+        onlp_led_info_t li;
+    } u;
+    onlp_snapshot_oid_t scratch;
+
+    e = snapshot_reserve__(ctrl, sizeof(*e));
+    if(e) {
+        ctrl->hdr.oid_count++;
+    }
+    else {
+        /* Use a scratch entry so the child walk still accounts for its size. */
+        ONLP_MEMSET(&scratch, 0, sizeof(scratch));
+        e = &scratch;
+    }
+
+    e->oid = oid;
+
+    switch(ONLP_OID_TYPE_GET(oid))
+        {
+        case ONLP_OID_TYPE_THERMAL:
+            if((e->rv = onlp_thermal_info_get_locked__(oid, &u.ti)) >= 0) {
+                hdr = &u.ti.hdr;
+                e->status = u.ti.status;
+                e->caps = u.ti.caps;
+                e->values[ONLP_SNAPSHOT_THERMAL_MCELSIUS] = u.ti.mcelsius;
+                e->values[ONLP_SNAPSHOT_THERMAL_WARNING] = u.ti.thresholds.warning;
+                e->values[ONLP_SNAPSHOT_THERMAL_ERROR] = u.ti.thresholds.error;
+                e->values[ONLP_SNAPSHOT_THERMAL_SHUTDOWN] = u.ti.thresholds.shutdown;
+            }
+            break;
+
+        case ONLP_OID_TYPE_FAN:
+            if((e->rv = onlp_fan_info_get_locked__(oid, &u.fi)) >= 0) {
+                hdr = &u.fi.hdr;
+                e->status = u.fi.status;
+                e->caps = u.fi.caps;
+                e->values[ONLP_SNAPSHOT_FAN_RPM] = u.fi.rpm;
+                e->values[ONLP_SNAPSHOT_FAN_PERCENTAGE] = u.fi.percentage;
+                e->values[ONLP_SNAPSHOT_FAN_MODE] = u.fi.mode;
+            }
+            break;
+
+        case ONLP_OID_TYPE_PSU:
+            if((e->rv = onlp_psu_info_get_locked__(oid, &u.pi)) >= 0) {
+                hdr = &u.pi.hdr;
+                e->status = u.pi.status;
+                e->caps = u.pi.caps;
+                e->values[ONLP_SNAPSHOT_PSU_MVIN] = u.pi.mvin;
+                e->values[ONLP_SNAPSHOT_PSU_MVOUT] = u.pi.mvout;
+                e->values[ONLP_SNAPSHOT_PSU_MIIN] = u.pi.miin;
+                e->values[ONLP_SNAPSHOT_PSU_MIOUT] = u.pi.miout;
+                e->values[ONLP_SNAPSHOT_PSU_MPIN] = u.pi.mpin;
+                e->values[ONLP_SNAPSHOT_PSU_MPOUT] = u.pi.mpout;
+            }
+            break;
+
+        case ONLP_OID_TYPE_LED:
+            if((e->rv = onlp_led_info_get_locked__(oid, &u.li)) >= 0) {
+                hdr = &u.li.hdr;
+                e->status = u.li.status;
+                e->caps = u.li.caps;
+                e->values[ONLP_SNAPSHOT_LED_MODE] = u.li.mode;
+                e->values[ONLP_SNAPSHOT_LED_CHAR] = u.li.character;
+            }
+            break;
+
+        case ONLP_OID_TYPE_SYS:
+            /* The caller provides the SYS header. */
+            e->rv = ONLP_STATUS_OK;
+            break;
+
+        default:
+            e->rv = ONLP_STATUS_E_UNSUPPORTED;
+            break;
+        }
+
+    if(e->rv < 0 || hdr == NULL) {
+        return;
+    }
+
+    e->poid = hdr->poid;
+
+    /* The child OIDs are taken from the info we just retrieved. */
+    onlp_oid_table_t coids;
+    ONLP_OID_TABLE_COPY(coids, hdr->coids);
+    ONLP_OID_TABLE_ITER(coids, oidp) {
+        snapshot_oid__(ctrl, *oidp, NULL);
+    }
+}
+
+static void
+snapshot_sfps__(snapshot_ctrl_t* ctrl, uint32_t flags)
+{
+    int p;
+    onlp_sfp_bitmap_t bitmap;
+    onlp_sfp_bitmap_t present;
+    int prv;
+
+    onlp_sfp_bitmap_t_init(&bitmap);
+    onlp_sfp_bitmap_get_locked__(&bitmap);
+
+    /* Presence is always gathered in bulk. */
+    prv = onlp_sfp_presence_bitmap_get_locked__(&present);
+
+    AIM_BITMAP_ITER(&bitmap, p) {
+        onlp_snapshot_sfp_t* e = snapshot_reserve__(ctrl, sizeof(*e));
+        if(e == NULL) {
+            continue;
+        }
+        ctrl->hdr.sfp_count++;
+
+        e->port = p;
+        e->present = (prv < 0) ? prv : AIM_BITMAP_GET(&present, p) ? 1 : 0;
+        e->eeprom_rv = ONLP_STATUS_E_MISSING;
+        e->dom_rv = ONLP_STATUS_E_MISSING;
+
+        if(e->present != 1) {
+            continue;
+        }
+
+        uint8_t* data;
+        if(flags & ONLP_SNAPSHOT_F_SFP_EEPROM) {
+            if((e->eeprom_rv = onlp_sfp_eeprom_read_locked__(p, &data)) >= 0) {
+                ONLP_MEMCPY(e->eeprom, data, sizeof(e->eeprom));
+                aim_free(data);
+            }
+        }
+        if(flags & ONLP_SNAPSHOT_F_SFP_DOM) {
+            if((e->dom_rv = onlp_sfp_dom_read_locked__(p, &data)) >= 0) {
+                ONLP_MEMCPY(e->dom, data, sizeof(e->dom));
+                aim_free(data);
+            }
+        }
+    }
+}
+
+int
+onlp_snapshot_get_locked__(uint32_t flags, uint8_t* buffer, int size)
+{
+    snapshot_ctrl_t ctrl;
+    onlp_oid_hdr_t sys;
+    uint64_t start;
+
+    if(size < 0 || (buffer == NULL && size > 0)) {
+        return ONLP_STATUS_E_PARAM;
+    }
+
+    start = aim_time_monotonic();
+
+    ONLP_MEMSET(&ctrl, 0, sizeof(ctrl));
+    ctrl.buffer = buffer;
+    ctrl.size = size;
+    ctrl.required = sizeof(onlp_snapshot_hdr_t);
+
+    ctrl.hdr.magic = ONLP_SNAPSHOT_MAGIC;
+    ctrl.hdr.version = ONLP_SNAPSHOT_VERSION;
+    ctrl.hdr.hdr_size = sizeof(onlp_snapshot_hdr_t);
+    ctrl.hdr.flags = flags;
+    ctrl.hdr.timestamp = start;
+    ctrl.hdr.oid_entry_size = sizeof(onlp_snapshot_oid_t);
+    ctrl.hdr.sfp_entry_size = sizeof(onlp_snapshot_sfp_t);
+
+    ONLP_MEMSET(&sys, 0, sizeof(sys));
+    sys.id = ONLP_OID_SYS;
+    onlp_sysi_oids_get(sys.coids, AIM_ARRAYSIZE(sys.coids));
+    snapshot_oid__(&ctrl, ONLP_OID_SYS, &sys);
+
+    if(flags & ONLP_SNAPSHOT_F_SFP) {
+        snapshot_sfps__(&ctrl, flags);
+    }
+
+    ctrl.hdr.size = ctrl.required;
+    ctrl.hdr.duration = aim_time_monotonic() - start;
+
+    if(size >= (int)sizeof(ctrl.hdr)) {
+        ONLP_MEMCPY(buffer, &ctrl.hdr, sizeof(ctrl.hdr));
+    }
+    return ctrl.required;
+}
+ONLP_LOCKED_API3(onlp_snapshot_get, uint32_t, flags, uint8_t*, buffer, int, size);
@@ -120,7 +120,7 @@ onie_data_get__(int* free)
     return ma;
 }
 
-static int
+int
 onlp_sys_info_get_locked__(onlp_sys_info_t* rv)
 {
     if(rv == NULL) {
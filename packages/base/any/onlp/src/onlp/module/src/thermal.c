@@ -52,29 +52,21 @@ ONLP_LOCKED_API0(onlp_thermal_init);
 
 #if ONLP_CONFIG_INCLUDE_PLATFORM_OVERRIDES == 1
 
-static int
-onlp_thermali_info_from_json__(cJSON* data, onlp_thermal_info_t* info, int errorcheck)
+static void
+onlp_thermal_info_override__(const onlp_json_override_t* o,
+                             onlp_thermal_info_t* info)
 {
-    int rv;
-    int t;
-
-    if(data == NULL) {
-        return (errorcheck) ? ONLP_STATUS_E_PARAM : 0;
+    if(ONLP_JSON_OVERRIDE_IS_SET(o, ONLP_JSON_OVERRIDE_STATUS)) {
+        info->status = o->values[ONLP_JSON_OVERRIDE_STATUS];
+    }
+    if(ONLP_JSON_OVERRIDE_IS_SET(o, ONLP_JSON_OVERRIDE_MCELSIUS)) {
+        info->mcelsius = o->values[ONLP_JSON_OVERRIDE_MCELSIUS];
     }
-
-    rv = cjson_util_lookup_int(data, (int*) &info->status, "status");
-    if(rv < 0 && errorcheck) return rv;
-
-    rv = cjson_util_lookup_int(data, &t, "mcelsius");
-    if(rv < 0 && errorcheck) return rv;
-    info->mcelsius = t;
-
-    return 0;
 }
 
 #endif
 
-static int
+int
 onlp_thermal_info_get_locked__(onlp_oid_t oid, onlp_thermal_info_t* info)
 {
     int rv;
@@ -84,11 +76,11 @@ onlp_thermal_info_get_locked__(onlp_oid_t oid, onlp_thermal_info_t* info)
     if(rv >= 0) {
 
 #if ONLP_CONFIG_INCLUDE_PLATFORM_OVERRIDES == 1
-        int id = ONLP_OID_ID_GET(oid);
-        cJSON* entry = NULL;
-
-        cjson_util_lookup(onlp_json_get(0), &entry, "overrides.thermal.%d", id);
-        onlp_thermali_info_from_json__(entry, info, 0);
+        const onlp_json_override_t* o =
+            ONLP_JSON_OVERRIDE(ONLP_OID_TYPE_THERMAL, ONLP_OID_ID_GET(oid));
+        if(o) {
+            onlp_thermal_info_override__(o, info);
+        }
 #endif
 
     }
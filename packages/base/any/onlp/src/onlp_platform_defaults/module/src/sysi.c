@@ -68,4 +68,6 @@ __ONLP_DEFAULTI_IMPLEMENTATION(onlp_sysi_ioctl(int id, va_list vargs));
 __ONLP_DEFAULTI_IMPLEMENTATION(onlp_sysi_platform_manage_init(void));
 __ONLP_DEFAULTI_IMPLEMENTATION(onlp_sysi_platform_manage_fans(void));
 __ONLP_DEFAULTI_IMPLEMENTATION(onlp_sysi_platform_manage_leds(void));
+__ONLP_DEFAULTI_IMPLEMENTATION(onlp_sysi_platform_manage_fans_status(onlp_sys_manage_status_t* status));
+__ONLP_DEFAULTI_IMPLEMENTATION(onlp_sysi_platform_manage_leds_status(onlp_sys_manage_status_t* status));
 
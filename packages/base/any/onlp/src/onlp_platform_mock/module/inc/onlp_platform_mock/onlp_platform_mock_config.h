@@ -0,0 +1,212 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ *
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ ************************************************************
+ *
+ *
+ *
+ ***********************************************************/
+
+/**************************************************************************//**
+ *
+ * @file
+ * @brief onlp_platform_mock Configuration Header
+ *
+ * @addtogroup onlp_platform_mock-config
+ * @{
+ *
+ *****************************************************************************/
+#ifndef __ONLP_PLATFORM_MOCK_CONFIG_H__
+#define __ONLP_PLATFORM_MOCK_CONFIG_H__
+
+#ifdef GLOBAL_INCLUDE_CUSTOM_CONFIG
+#include <global_custom_config.h>
+#endif
+#ifdef ONLP_PLATFORM_MOCK_INCLUDE_CUSTOM_CONFIG
+#include <onlp_platform_mock_custom_config.h>
+#endif
+
+/* <auto.start.cdefs(ONLP_PLATFORM_MOCK_CONFIG_HEADER).header> */
+#include <AIM/aim.h>
+/**
+ * ONLP_PLATFORM_MOCK_CONFIG_INCLUDE_LOGGING
+ *
+ * Include or exclude logging. */
+
+
+#ifndef ONLP_PLATFORM_MOCK_CONFIG_INCLUDE_LOGGING
+#define ONLP_PLATFORM_MOCK_CONFIG_INCLUDE_LOGGING 1
+#endif
+
+/**
+ * ONLP_PLATFORM_MOCK_CONFIG_LOG_OPTIONS_DEFAULT
+ *
+ * Default enabled log options. */
+
+
+#ifndef ONLP_PLATFORM_MOCK_CONFIG_LOG_OPTIONS_DEFAULT
+#define ONLP_PLATFORM_MOCK_CONFIG_LOG_OPTIONS_DEFAULT AIM_LOG_OPTIONS_DEFAULT
+#endif
+
+/**
+ * ONLP_PLATFORM_MOCK_CONFIG_LOG_BITS_DEFAULT
+ *
+ * Default enabled log bits. */
+
+
+#ifndef ONLP_PLATFORM_MOCK_CONFIG_LOG_BITS_DEFAULT
+#define ONLP_PLATFORM_MOCK_CONFIG_LOG_BITS_DEFAULT AIM_LOG_BITS_DEFAULT
+#endif
+
+/**
+ * ONLP_PLATFORM_MOCK_CONFIG_LOG_CUSTOM_BITS_DEFAULT
+ *
+ * Default enabled custom log bits. */
+
+
+#ifndef ONLP_PLATFORM_MOCK_CONFIG_LOG_CUSTOM_BITS_DEFAULT
+#define ONLP_PLATFORM_MOCK_CONFIG_LOG_CUSTOM_BITS_DEFAULT 0
+#endif
+
+/**
+ * ONLP_PLATFORM_MOCK_CONFIG_PORTING_STDLIB
+ *
+ * Default all porting macros to use the C standard libraries. */
+
+
+#ifndef ONLP_PLATFORM_MOCK_CONFIG_PORTING_STDLIB
+#define ONLP_PLATFORM_MOCK_CONFIG_PORTING_STDLIB 1
+#endif
+
+/**
+ * ONLP_PLATFORM_MOCK_CONFIG_PORTING_INCLUDE_STDLIB_HEADERS
+ *
+ * Include standard library headers for stdlib porting macros. */
+
+
+#ifndef ONLP_PLATFORM_MOCK_CONFIG_PORTING_INCLUDE_STDLIB_HEADERS
+#define ONLP_PLATFORM_MOCK_CONFIG_PORTING_INCLUDE_STDLIB_HEADERS ONLP_PLATFORM_MOCK_CONFIG_PORTING_STDLIB
+#endif
+
+/**
+ * ONLP_PLATFORM_MOCK_CONFIG_INCLUDE_UCLI
+ *
+ * Include generic uCli support. */
+
+
+#ifndef ONLP_PLATFORM_MOCK_CONFIG_INCLUDE_UCLI
+#define ONLP_PLATFORM_MOCK_CONFIG_INCLUDE_UCLI 0
+#endif
+
+/**
+ * ONLP_PLATFORM_MOCK_CONFIG_PORT_COUNT
+ *
+ * Default number of simulated ports. */
+
+
+#ifndef ONLP_PLATFORM_MOCK_CONFIG_PORT_COUNT
+#define ONLP_PLATFORM_MOCK_CONFIG_PORT_COUNT 64
+#endif
+
+/**
+ * ONLP_PLATFORM_MOCK_CONFIG_FAN_COUNT
+ *
+ * Default number of simulated fans. */
+
+
+#ifndef ONLP_PLATFORM_MOCK_CONFIG_FAN_COUNT
+#define ONLP_PLATFORM_MOCK_CONFIG_FAN_COUNT 6
+#endif
+
+/**
+ * ONLP_PLATFORM_MOCK_CONFIG_PSU_COUNT
+ *
+ * Default number of simulated PSUs. */
+
+
+#ifndef ONLP_PLATFORM_MOCK_CONFIG_PSU_COUNT
+#define ONLP_PLATFORM_MOCK_CONFIG_PSU_COUNT 2
+#endif
+
+/**
+ * ONLP_PLATFORM_MOCK_CONFIG_THERMAL_COUNT
+ *
+ * Default number of simulated thermal sensors. */
+
+
+#ifndef ONLP_PLATFORM_MOCK_CONFIG_THERMAL_COUNT
+#define ONLP_PLATFORM_MOCK_CONFIG_THERMAL_COUNT 5
+#endif
+
+/**
+ * ONLP_PLATFORM_MOCK_CONFIG_I2C_LATENCY_US
+ *
+ * Default latency of each simulated I2C transaction in microseconds. */
+
+
+#ifndef ONLP_PLATFORM_MOCK_CONFIG_I2C_LATENCY_US
+#define ONLP_PLATFORM_MOCK_CONFIG_I2C_LATENCY_US 0
+#endif
+
+/**
+ * ONLP_PLATFORM_MOCK_CONFIG_ROOT
+ *
+ * Default root of the simulated sysfs tree. */
+
+
+#ifndef ONLP_PLATFORM_MOCK_CONFIG_ROOT
+#define ONLP_PLATFORM_MOCK_CONFIG_ROOT "/dev/shm/onlp-mock"
+#endif
+
+
+
+/**
+ * All compile time options can be queried or displayed
+ */
+
+/** Configuration settings structure. */
+typedef struct onlp_platform_mock_config_settings_s {
+    /** name */
+    const char* name;
+    /** value */
+    const char* value;
+} onlp_platform_mock_config_settings_t;
+
+/** Configuration settings table. */
+/** onlp_platform_mock_config_settings table. */
+extern onlp_platform_mock_config_settings_t onlp_platform_mock_config_settings[];
+
+/**
+ * @brief Lookup a configuration setting.
+ * @param setting The name of the configuration option to lookup.
+ */
+const char* onlp_platform_mock_config_lookup(const char* setting);
+
+/**
+ * @brief Show the compile-time configuration.
+ * @param pvs The output stream.
+ */
+int onlp_platform_mock_config_show(struct aim_pvs_s* pvs);
+
+/* <auto.end.cdefs(ONLP_PLATFORM_MOCK_CONFIG_HEADER).header> */
+
+#include "onlp_platform_mock_porting.h"
+
+#endif /* __ONLP_PLATFORM_MOCK_CONFIG_H__ */
+/* @} */
@@ -0,0 +1,122 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ * 
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.       
+ * 
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ * 
+ *        http://www.eclipse.org/legal/epl-v10.html
+ * 
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ * 
+ * </bsn.cl>
+ ************************************************************
+ *
+ *
+ *
+ ***********************************************************/
+
+/********************************************************//**
+ *
+ * @file
+ * @brief onlp_platform_mock Porting Macros.
+ *
+ * @addtogroup onlp_platform_mock-porting
+ * @{
+ *
+ ***********************************************************/
+#ifndef __ONLP_PLATFORM_MOCK_PORTING_H__
+#define __ONLP_PLATFORM_MOCK_PORTING_H__
+
+
+/* <auto.start.portingmacro(ALL).define> */
+#if ONLP_PLATFORM_MOCK_CONFIG_PORTING_INCLUDE_STDLIB_HEADERS == 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <memory.h>
+#endif
+
+#ifndef ONLP_PLATFORM_MOCK_MALLOC
+    #if defined(GLOBAL_MALLOC)
+        #define ONLP_PLATFORM_MOCK_MALLOC GLOBAL_MALLOC
+    #elif ONLP_PLATFORM_MOCK_CONFIG_PORTING_STDLIB == 1
+        #define ONLP_PLATFORM_MOCK_MALLOC malloc
+    #else
+        #error The macro ONLP_PLATFORM_MOCK_MALLOC is required but cannot be defined.
+    #endif
+#endif
+
+#ifndef ONLP_PLATFORM_MOCK_FREE
+    #if defined(GLOBAL_FREE)
+        #define ONLP_PLATFORM_MOCK_FREE GLOBAL_FREE
+    #elif ONLP_PLATFORM_MOCK_CONFIG_PORTING_STDLIB == 1
+        #define ONLP_PLATFORM_MOCK_FREE free
+    #else
+        #error The macro ONLP_PLATFORM_MOCK_FREE is required but cannot be defined.
+    #endif
+#endif
+
+#ifndef ONLP_PLATFORM_MOCK_MEMSET
+    #if defined(GLOBAL_MEMSET)
+        #define ONLP_PLATFORM_MOCK_MEMSET GLOBAL_MEMSET
+    #elif ONLP_PLATFORM_MOCK_CONFIG_PORTING_STDLIB == 1
+        #define ONLP_PLATFORM_MOCK_MEMSET memset
+    #else
+        #error The macro ONLP_PLATFORM_MOCK_MEMSET is required but cannot be defined.
+    #endif
+#endif
+
+#ifndef ONLP_PLATFORM_MOCK_MEMCPY
+    #if defined(GLOBAL_MEMCPY)
+        #define ONLP_PLATFORM_MOCK_MEMCPY GLOBAL_MEMCPY
+    #elif ONLP_PLATFORM_MOCK_CONFIG_PORTING_STDLIB == 1
+        #define ONLP_PLATFORM_MOCK_MEMCPY memcpy
+    #else
+        #error The macro ONLP_PLATFORM_MOCK_MEMCPY is required but cannot be defined.
+    #endif
+#endif
+
+#ifndef ONLP_PLATFORM_MOCK_VSNPRINTF
+    #if defined(GLOBAL_VSNPRINTF)
+        #define ONLP_PLATFORM_MOCK_VSNPRINTF GLOBAL_VSNPRINTF
+    #elif ONLP_PLATFORM_MOCK_CONFIG_PORTING_STDLIB == 1
+        #define ONLP_PLATFORM_MOCK_VSNPRINTF vsnprintf
+    #else
+        #error The macro ONLP_PLATFORM_MOCK_VSNPRINTF is required but cannot be defined.
+    #endif
+#endif
+
+#ifndef ONLP_PLATFORM_MOCK_SNPRINTF
+    #if defined(GLOBAL_SNPRINTF)
+        #define ONLP_PLATFORM_MOCK_SNPRINTF GLOBAL_SNPRINTF
+    #elif ONLP_PLATFORM_MOCK_CONFIG_PORTING_STDLIB == 1
+        #define ONLP_PLATFORM_MOCK_SNPRINTF snprintf
+    #else
+        #error The macro ONLP_PLATFORM_MOCK_SNPRINTF is required but cannot be defined.
+    #endif
+#endif
+
+#ifndef ONLP_PLATFORM_MOCK_STRLEN
+    #if defined(GLOBAL_STRLEN)
+        #define ONLP_PLATFORM_MOCK_STRLEN GLOBAL_STRLEN
+    #elif ONLP_PLATFORM_MOCK_CONFIG_PORTING_STDLIB == 1
+        #define ONLP_PLATFORM_MOCK_STRLEN strlen
+    #else
+        #error The macro ONLP_PLATFORM_MOCK_STRLEN is required but cannot be defined.
+    #endif
+#endif
+
+/* <auto.end.portingmacro(ALL).define> */
+
+
+#endif /* __ONLP_PLATFORM_MOCK_PORTING_H__ */
+/* @} */
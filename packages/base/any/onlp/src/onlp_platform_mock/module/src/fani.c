@@ -0,0 +1,100 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ *
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ ************************************************************
+ *
+ * Simulated fans.
+ *
+ ***********************************************************/
+#include <onlp/platformi/fani.h>
+#include "onlp_platform_mock_int.h"
+#include "onlp_platform_mock_log.h"
+
+/* Full speed */
+#define MOCK_FAN_RPM_MAX 20000
+
+#define VALIDATE(_id)                                                   \
+    do {                                                                \
+        if(!ONLP_OID_IS_FAN(_id) || ONLP_OID_ID_GET(_id) < 1 ||          \
+           ONLP_OID_ID_GET(_id) > onlp_platform_mock.fans) {            \
+            return ONLP_STATUS_E_INVALID;                               \
+        }                                                               \
+    } while(0)
+
+int
+onlp_fani_init(void)
+{
+    return onlp_platform_mock_init();
+}
+
+int
+onlp_fani_info_get(onlp_oid_t id, onlp_fan_info_t* info)
+{
+    int fid, value, rv;
+    VALIDATE(id);
+
+    fid = ONLP_OID_ID_GET(id);
+
+    ONLP_PLATFORM_MOCK_MEMSET(info, 0, sizeof(*info));
+    info->hdr.id = id;
+    ONLP_PLATFORM_MOCK_SNPRINTF(info->hdr.description, sizeof(info->hdr.description),
+                                "Mock Fan %d", fid);
+    info->caps = ONLP_FAN_CAPS_F2B | ONLP_FAN_CAPS_SET_PERCENTAGE |
+        ONLP_FAN_CAPS_GET_RPM | ONLP_FAN_CAPS_GET_PERCENTAGE;
+
+    if((rv = onlp_platform_mock_read_int(&value, "fan/%d/present", fid)) < 0) {
+        return rv;
+    }
+    if(!value) {
+        return ONLP_STATUS_OK;
+    }
+    info->status = ONLP_FAN_STATUS_PRESENT | ONLP_FAN_STATUS_F2B;
+
+    if((rv = onlp_platform_mock_read_int(&value, "fan/%d/failed", fid)) < 0) {
+        return rv;
+    }
+    if(value) {
+        info->status |= ONLP_FAN_STATUS_FAILED;
+    }
+
+    if((rv = onlp_platform_mock_read_int(&info->rpm, "fan/%d/rpm", fid)) < 0 ||
+       (rv = onlp_platform_mock_read_int(&info->percentage, "fan/%d/percentage", fid)) < 0) {
+        return rv;
+    }
+    ONLP_PLATFORM_MOCK_SNPRINTF(info->model, sizeof(info->model), "MOCK-FAN");
+    ONLP_PLATFORM_MOCK_SNPRINTF(info->serial, sizeof(info->serial), "MOCKFAN%04d", fid);
+    return ONLP_STATUS_OK;
+}
+
+int
+onlp_fani_percentage_set(onlp_oid_t id, int p)
+{
+    int fid, rv;
+    VALIDATE(id);
+
+    if(p < 0 || p > 100) {
+        return ONLP_STATUS_E_PARAM;
+    }
+
+    fid = ONLP_OID_ID_GET(id);
+    if((rv = onlp_platform_mock_write_int(p, "fan/%d/percentage", fid)) < 0) {
+        return rv;
+    }
+    return onlp_platform_mock_write_int(MOCK_FAN_RPM_MAX * p / 100, "fan/%d/rpm", fid);
+}
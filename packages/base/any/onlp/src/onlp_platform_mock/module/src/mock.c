@@ -0,0 +1,394 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ *
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ ************************************************************
+ *
+ * Simulated platform state.
+ *
+ ***********************************************************/
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <onlplib/file.h>
+#include <onlp/sfp.h>
+#include "onlp_platform_mock_int.h"
+#include "onlp_platform_mock_log.h"
+
+onlp_platform_mock_t onlp_platform_mock;
+
+static pthread_once_t init_once__ = PTHREAD_ONCE_INIT;
+static int init_rv__;
+
+/* All ports hang off a single simulated adapter. */
+static pthread_mutex_t i2c_lock__ = PTHREAD_MUTEX_INITIALIZER;
+
+static int
+env_int__(const char* name, int dflt, int max)
+{
+    char* s = getenv(name);
+    int v;
+
+    if(s == NULL || *s == 0) {
+        return dflt;
+    }
+    v = atoi(s);
+    if(v < 0) {
+        v = 0;
+    }
+    if(max > 0 && v > max) {
+        AIM_LOG_WARN("%s=%d exceeds the maximum of %d", name, v, max);
+        v = max;
+    }
+    return v;
+}
+
+static int
+mkdirf__(const char* fmt, ...)
+{
+    char path[512];
+    va_list vargs;
+
+    va_start(vargs, fmt);
+    ONLP_PLATFORM_MOCK_VSNPRINTF(path, sizeof(path), fmt, vargs);
+    va_end(vargs);
+
+    if(mkdir(path, 0755) < 0 && errno != EEXIST) {
+        AIM_LOG_ERROR("mkdir(%s): %{errno}", path, errno);
+        return ONLP_STATUS_E_INTERNAL;
+    }
+    return 0;
+}
+
+/*
+ * Create the given file with the given contents unless it exists.
+ */
+static int
+create__(const uint8_t* data, int len, const char* fmt, ...)
+{
+    char path[512];
+    va_list vargs;
+    int fd, rv = 0;
+
+    va_start(vargs, fmt);
+    ONLP_PLATFORM_MOCK_VSNPRINTF(path, sizeof(path), fmt, vargs);
+    va_end(vargs);
+
+    if((fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0644)) < 0) {
+        if(errno == EEXIST) {
+            return 0;
+        }
+        AIM_LOG_ERROR("open(%s): %{errno}", path, errno);
+        return ONLP_STATUS_E_INTERNAL;
+    }
+    if(write(fd, data, len) != len) {
+        AIM_LOG_ERROR("write(%s): %{errno}", path, errno);
+        rv = ONLP_STATUS_E_INTERNAL;
+    }
+    close(fd);
+    return rv;
+}
+
+#define CREATE_INT(_value, _fmt, ...)                                   \
+    do {                                                                \
+        char _s[16];                                                    \
+        int _len = ONLP_PLATFORM_MOCK_SNPRINTF(_s, sizeof(_s), "%d\n", (_value)); \
+        if((rv = create__((uint8_t*)_s, _len, _fmt, __VA_ARGS__)) < 0) { \
+            return rv;                                                  \
+        }                                                               \
+    } while(0)
+
+static void
+sff_string__(uint8_t* dst, const char* src, int len)
+{
+    int i;
+    for(i = 0; i < len; i++) {
+        dst[i] = *src ? *src++ : ' ';
+    }
+}
+
+/*
+ * A 10GBASE-SR SFP+ with a unique serial number per port.
+ */
+static void
+sff_eeprom__(int port, uint8_t eeprom[256])
+{
+    char sn[17];
+    int i, sum;
+
+    ONLP_PLATFORM_MOCK_MEMSET(eeprom, 0, 256);
+    eeprom[0] = 0x03;           /* SFP */
+    eeprom[1] = 0x04;
+    eeprom[2] = 0x07;           /* LC */
+    eeprom[3] = 0x10;           /* 10GBASE-SR */
+    eeprom[11] = 0x06;          /* 64B/66B */
+    eeprom[12] = 0x67;          /* 10.3 Gbps */
+    eeprom[16] = 0x08;
+    eeprom[17] = 0x03;
+    sff_string__(eeprom + 20, "ONL", 16);
+    sff_string__(eeprom + 40, "MOCK-SFP-10G-SR", 16);
+    sff_string__(eeprom + 56, "A", 4);
+    eeprom[60] = 0x03;          /* 850nm */
+    eeprom[61] = 0x52;
+    for(sum = 0, i = 0; i < 63; i++) {
+        sum += eeprom[i];
+    }
+    eeprom[63] = sum & 0xFF;
+
+    ONLP_PLATFORM_MOCK_SNPRINTF(sn, sizeof(sn), "MOCK%08d", port);
+    sff_string__(eeprom + 68, sn, 16);
+    sff_string__(eeprom + 84, "260101", 8);
+    eeprom[92] = 0x68;
+    eeprom[93] = 0xF0;
+    eeprom[94] = 0x08;
+    for(sum = 0, i = 64; i < 95; i++) {
+        sum += eeprom[i];
+    }
+    eeprom[95] = sum & 0xFF;
+}
+
+static int
+tree_create__(void)
+{
+    onlp_platform_mock_t* m = &onlp_platform_mock;
+    uint8_t image[256];
+    int i, rv;
+
+    if((rv = mkdirf__("%s", m->root)) < 0 ||
+       (rv = mkdirf__("%s/sfp", m->root)) < 0 ||
+       (rv = mkdirf__("%s/fan", m->root)) < 0 ||
+       (rv = mkdirf__("%s/psu", m->root)) < 0 ||
+       (rv = mkdirf__("%s/thermal", m->root)) < 0) {
+        return rv;
+    }
+
+    for(i = 0; i < m->ports; i++) {
+        if((rv = mkdirf__("%s/sfp/%d", m->root, i)) < 0) {
+            return rv;
+        }
+        /* Every fourth port is empty. */
+        CREATE_INT((i % 4) != 3, "%s/sfp/%d/present", m->root, i);
+        CREATE_INT(0, "%s/sfp/%d/rx_los", m->root, i);
+        CREATE_INT(0, "%s/sfp/%d/tx_disable", m->root, i);
+        sff_eeprom__(i, image);
+        if((rv = create__(image, sizeof(image), "%s/sfp/%d/i2c-80", m->root, i)) < 0) {
+            return rv;
+        }
+        ONLP_PLATFORM_MOCK_MEMSET(image, 0, sizeof(image));
+        if((rv = create__(image, sizeof(image), "%s/sfp/%d/i2c-81", m->root, i)) < 0) {
+            return rv;
+        }
+    }
+
+    for(i = 1; i <= m->fans; i++) {
+        if((rv = mkdirf__("%s/fan/%d", m->root, i)) < 0) {
+            return rv;
+        }
+        CREATE_INT(1, "%s/fan/%d/present", m->root, i);
+        CREATE_INT(0, "%s/fan/%d/failed", m->root, i);
+        CREATE_INT(50, "%s/fan/%d/percentage", m->root, i);
+        CREATE_INT(10000, "%s/fan/%d/rpm", m->root, i);
+    }
+
+    for(i = 1; i <= m->psus; i++) {
+        if((rv = mkdirf__("%s/psu/%d", m->root, i)) < 0) {
+            return rv;
+        }
+        CREATE_INT(1, "%s/psu/%d/present", m->root, i);
+        CREATE_INT(0, "%s/psu/%d/failed", m->root, i);
+        CREATE_INT(230000, "%s/psu/%d/vin", m->root, i);
+        CREATE_INT(12000, "%s/psu/%d/vout", m->root, i);
+        CREATE_INT(1000, "%s/psu/%d/iin", m->root, i);
+        CREATE_INT(18000, "%s/psu/%d/iout", m->root, i);
+        CREATE_INT(230000, "%s/psu/%d/pin", m->root, i);
+        CREATE_INT(216000, "%s/psu/%d/pout", m->root, i);
+    }
+
+    for(i = 1; i <= m->thermals; i++) {
+        if((rv = mkdirf__("%s/thermal/%d", m->root, i)) < 0) {
+            return rv;
+        }
+        CREATE_INT(30000 + i*1000, "%s/thermal/%d/temp", m->root, i);
+    }
+
+    return 0;
+}
+
+static void
+init__(void)
+{
+    onlp_platform_mock_t* m = &onlp_platform_mock;
+    char* root = getenv("ONLP_MOCK_ROOT");
+
+    ONLP_PLATFORM_MOCK_SNPRINTF(m->root, sizeof(m->root), "%s",
+                                (root && *root) ? root : ONLP_PLATFORM_MOCK_CONFIG_ROOT);
+    /* onlp_sfp_bitmap_t is an aim_bitmap256_t. */
+    m->ports = env_int__("ONLP_MOCK_PORTS", ONLP_PLATFORM_MOCK_CONFIG_PORT_COUNT, 256);
+    /* Fans, PSUs and thermals are all children of the chassis. */
+    m->fans = env_int__("ONLP_MOCK_FANS", ONLP_PLATFORM_MOCK_CONFIG_FAN_COUNT, 32);
+    m->psus = env_int__("ONLP_MOCK_PSUS", ONLP_PLATFORM_MOCK_CONFIG_PSU_COUNT, 8);
+    m->thermals = env_int__("ONLP_MOCK_THERMALS", ONLP_PLATFORM_MOCK_CONFIG_THERMAL_COUNT, 64);
+    m->i2c_latency_us = env_int__("ONLP_MOCK_I2C_LATENCY_US",
+                                  ONLP_PLATFORM_MOCK_CONFIG_I2C_LATENCY_US, 0);
+
+    init_rv__ = tree_create__();
+}
+
+int
+onlp_platform_mock_init(void)
+{
+    pthread_once(&init_once__, init__);
+    return init_rv__;
+}
+
+int
+onlp_platform_mock_read_int(int* value, const char* fmt, ...)
+{
+    char path[512];
+    va_list vargs;
+
+    va_start(vargs, fmt);
+    ONLP_PLATFORM_MOCK_VSNPRINTF(path, sizeof(path), fmt, vargs);
+    va_end(vargs);
+
+    return onlp_file_read_int(value, "%s/%s", onlp_platform_mock.root, path);
+}
+
+int
+onlp_platform_mock_write_int(int value, const char* fmt, ...)
+{
+    char path[512];
+    va_list vargs;
+
+    va_start(vargs, fmt);
+    ONLP_PLATFORM_MOCK_VSNPRINTF(path, sizeof(path), fmt, vargs);
+    va_end(vargs);
+
+    return onlp_file_write_int(value, "%s/%s", onlp_platform_mock.root, path);
+}
+
+static int
+i2c_xfer__(const char* path, uint8_t addr, uint8_t* data, int size, int write)
+{
+    int fd, rv;
+
+    if(size < 0 || addr + size > 256) {
+        return ONLP_STATUS_E_PARAM;
+    }
+
+    pthread_mutex_lock(&i2c_lock__);
+
+    if(onlp_platform_mock.i2c_latency_us) {
+        usleep(onlp_platform_mock.i2c_latency_us);
+    }
+
+    fd = onlp_file_open(write ? O_WRONLY : O_RDONLY, 0, "%s", path);
+    if(fd < 0) {
+        /* No such device: the transaction is not acknowledged. */
+        rv = ONLP_STATUS_E_I2C;
+    }
+    else {
+        rv = write ? pwrite(fd, data, size, addr) : pread(fd, data, size, addr);
+        rv = (rv == size) ? ONLP_STATUS_OK : ONLP_STATUS_E_I2C;
+        close(fd);
+    }
+
+    pthread_mutex_unlock(&i2c_lock__);
+    return rv;
+}
+
+static int
+port_xfer__(int port, uint8_t devaddr, uint8_t addr, uint8_t* data, int size,
+            int write)
+{
+    char path[512];
+
+    if(port < 0 || port >= onlp_platform_mock.ports) {
+        return ONLP_STATUS_E_PARAM;
+    }
+    ONLP_PLATFORM_MOCK_SNPRINTF(path, sizeof(path), "%s/sfp/%d/i2c-%d",
+                                onlp_platform_mock.root, port, devaddr);
+    return i2c_xfer__(path, addr, data, size, write);
+}
+
+int
+onlp_platform_mock_i2c_read(int port, uint8_t devaddr, uint8_t addr,
+                            uint8_t* data, int size)
+{
+    return port_xfer__(port, devaddr, addr, data, size, 0);
+}
+
+int
+onlp_platform_mock_i2c_write(int port, uint8_t devaddr, uint8_t addr,
+                             uint8_t* data, int size)
+{
+    return port_xfer__(port, devaddr, addr, data, size, 1);
+}
+
+static int
+bus_xfer__(int bus, uint8_t devaddr, uint8_t addr, uint8_t* data, int size,
+           int write)
+{
+    char path[512];
+    ONLP_PLATFORM_MOCK_SNPRINTF(path, sizeof(path), "%s/i2c/%d/%02x",
+                                onlp_platform_mock.root, bus, devaddr);
+    return i2c_xfer__(path, addr, data, size, write);
+}
+
+int
+onlp_platform_mock_bus_read(int bus, uint8_t devaddr, uint8_t addr,
+                            uint8_t* data, int size)
+{
+    return bus_xfer__(bus, devaddr, addr, data, size, 0);
+}
+
+int
+onlp_platform_mock_bus_write(int bus, uint8_t devaddr, uint8_t addr,
+                             uint8_t* data, int size)
+{
+    return bus_xfer__(bus, devaddr, addr, data, size, 1);
+}
+
+int
+onlp_platform_mock_bus_image_set(int bus, uint8_t devaddr,
+                                 const uint8_t image[256])
+{
+    char path[512];
+    int fd, rv = 0;
+
+    if(mkdirf__("%s/i2c", onlp_platform_mock.root) < 0 ||
+       mkdirf__("%s/i2c/%d", onlp_platform_mock.root, bus) < 0) {
+        return ONLP_STATUS_E_INTERNAL;
+    }
+
+    ONLP_PLATFORM_MOCK_SNPRINTF(path, sizeof(path), "%s/i2c/%d/%02x",
+                                onlp_platform_mock.root, bus, devaddr);
+    if((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+        AIM_LOG_ERROR("open(%s): %{errno}", path, errno);
+        return ONLP_STATUS_E_INTERNAL;
+    }
+    if(write(fd, image, 256) != 256) {
+        AIM_LOG_ERROR("write(%s): %{errno}", path, errno);
+        rv = ONLP_STATUS_E_INTERNAL;
+    }
+    close(fd);
+    return rv;
+}
@@ -0,0 +1,100 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ * 
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.       
+ * 
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ * 
+ *        http://www.eclipse.org/legal/epl-v10.html
+ * 
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ * 
+ * </bsn.cl>
+ ************************************************************
+ *
+ *
+ *
+ ***********************************************************/
+
+#ifndef __ONLP_PLATFORM_MOCK_INT_H__
+#define __ONLP_PLATFORM_MOCK_INT_H__
+
+#include <onlp_platform_mock/onlp_platform_mock_config.h>
+#include <onlp/onlp.h>
+
+#define ONLP_PLATFORM_MOCK_NAME "onlp-mock"
+
+/**
+ * The simulated platform.
+ *
+ * All state lives in a sysfs-like tree of small text files under
+ * root, so tests can inspect or change it from the shell while
+ * clients are running. The defaults come from the compile time
+ * configuration and can be overridden at run time with the
+ * ONLP_MOCK_ROOT, ONLP_MOCK_PORTS, ONLP_MOCK_FANS, ONLP_MOCK_PSUS,
+ * ONLP_MOCK_THERMALS and ONLP_MOCK_I2C_LATENCY_US environment
+ * variables.
+ */
+typedef struct onlp_platform_mock_s {
+    char root[256];
+    int ports;
+    int fans;
+    int psus;
+    int thermals;
+    /** Added to every simulated I2C transaction. */
+    int i2c_latency_us;
+} onlp_platform_mock_t;
+
+extern onlp_platform_mock_t onlp_platform_mock;
+
+/**
+ * @brief Load the configuration and create the tree if necessary.
+ * @note Existing files are left alone. Safe to call more than once.
+ */
+int onlp_platform_mock_init(void);
+
+/**
+ * @brief Read or write an integer file below the mock root.
+ */
+int onlp_platform_mock_read_int(int* value, const char* fmt, ...);
+int onlp_platform_mock_write_int(int value, const char* fmt, ...);
+
+/**
+ * @brief Simulated I2C transactions to a port device.
+ * @param port The port.
+ * @param devaddr The device address. The contents of each device are
+ * the file sfp/<port>/i2c-<devaddr> below the mock root.
+ * @note All ports share a single simulated adapter. Transactions are
+ * serialized and each one costs i2c_latency_us.
+ */
+int onlp_platform_mock_i2c_read(int port, uint8_t devaddr, uint8_t addr,
+                                uint8_t* data, int size);
+int onlp_platform_mock_i2c_write(int port, uint8_t devaddr, uint8_t addr,
+                                 uint8_t* data, int size);
+
+/**
+ * @brief Simulated I2C transactions to an arbitrary bus device.
+ * @param bus The bus.
+ * @param devaddr The device address. The contents of each device are
+ * the file i2c/<bus>/<devaddr in hex> below the mock root.
+ * @note These share the port adapter and its latency.
+ */
+int onlp_platform_mock_bus_read(int bus, uint8_t devaddr, uint8_t addr,
+                                uint8_t* data, int size);
+int onlp_platform_mock_bus_write(int bus, uint8_t devaddr, uint8_t addr,
+                                 uint8_t* data, int size);
+
+/**
+ * @brief Create or replace the contents of a bus device.
+ */
+int onlp_platform_mock_bus_image_set(int bus, uint8_t devaddr,
+                                     const uint8_t image[256]);
+
+#endif /* __ONLP_PLATFORM_MOCK_INT_H__ */
@@ -0,0 +1,105 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ *
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ ************************************************************
+ *
+ * Simulated power supplies.
+ *
+ ***********************************************************/
+#include <onlp/platformi/psui.h>
+#include <onlplib/file.h>
+#include "onlp_platform_mock_int.h"
+#include "onlp_platform_mock_log.h"
+
+#define VALIDATE(_id)                                                   \
+    do {                                                                \
+        if(!ONLP_OID_IS_PSU(_id) || ONLP_OID_ID_GET(_id) < 1 ||          \
+           ONLP_OID_ID_GET(_id) > onlp_platform_mock.psus) {            \
+            return ONLP_STATUS_E_INVALID;                               \
+        }                                                               \
+    } while(0)
+
+/* Read in a single pass, in this order. */
+static const char* psu_files__[] = {
+    "present", "failed", "vin", "vout", "iin", "iout", "pin", "pout",
+};
+#define PSU_FILE_COUNT AIM_ARRAYSIZE(psu_files__)
+
+int
+onlp_psui_init(void)
+{
+    return onlp_platform_mock_init();
+}
+
+int
+onlp_psui_info_get(onlp_oid_t id, onlp_psu_info_t* info)
+{
+    char paths[PSU_FILE_COUNT][512];
+    const char* pathp[PSU_FILE_COUNT];
+    int values[PSU_FILE_COUNT];
+    int status[PSU_FILE_COUNT];
+    int pid, i;
+    VALIDATE(id);
+
+    pid = ONLP_OID_ID_GET(id);
+
+    ONLP_PLATFORM_MOCK_MEMSET(info, 0, sizeof(*info));
+    info->hdr.id = id;
+    ONLP_PLATFORM_MOCK_SNPRINTF(info->hdr.description, sizeof(info->hdr.description),
+                                "Mock PSU %d", pid);
+
+    for(i = 0; i < PSU_FILE_COUNT; i++) {
+        ONLP_PLATFORM_MOCK_SNPRINTF(paths[i], sizeof(paths[i]), "%s/psu/%d/%s",
+                                    onlp_platform_mock.root, pid, psu_files__[i]);
+        pathp[i] = paths[i];
+    }
+    if(onlp_file_read_ints(pathp, values, status, PSU_FILE_COUNT) < 0 ||
+       status[0] < 0) {
+        return ONLP_STATUS_E_INTERNAL;
+    }
+
+    if(!values[0]) {
+        info->status = ONLP_PSU_STATUS_UNPLUGGED;
+        return ONLP_STATUS_OK;
+    }
+    info->status = ONLP_PSU_STATUS_PRESENT;
+    if(status[1] >= 0 && values[1]) {
+        info->status |= ONLP_PSU_STATUS_FAILED;
+    }
+
+    info->caps = ONLP_PSU_CAPS_AC;
+#define PSU_VALUE(_index, _field, _cap)         \
+    do {                                        \
+        if(status[_index] >= 0) {               \
+            info->_field = values[_index];      \
+            info->caps |= _cap;                 \
+        }                                       \
+    } while(0)
+    PSU_VALUE(2, mvin, ONLP_PSU_CAPS_VIN);
+    PSU_VALUE(3, mvout, ONLP_PSU_CAPS_VOUT);
+    PSU_VALUE(4, miin, ONLP_PSU_CAPS_IIN);
+    PSU_VALUE(5, miout, ONLP_PSU_CAPS_IOUT);
+    PSU_VALUE(6, mpin, ONLP_PSU_CAPS_PIN);
+    PSU_VALUE(7, mpout, ONLP_PSU_CAPS_POUT);
+#undef PSU_VALUE
+
+    ONLP_PLATFORM_MOCK_SNPRINTF(info->model, sizeof(info->model), "MOCK-PSU");
+    ONLP_PLATFORM_MOCK_SNPRINTF(info->serial, sizeof(info->serial), "MOCKPSU%04d", pid);
+    return ONLP_STATUS_OK;
+}
@@ -0,0 +1,267 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ *
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ ************************************************************
+ *
+ * Simulated ports.
+ *
+ ***********************************************************/
+#include <onlp/platformi/sfpi.h>
+#include <onlplib/file.h>
+#include "onlp_platform_mock_int.h"
+#include "onlp_platform_mock_log.h"
+
+#define VALIDATE_PORT(_port)                                    \
+    do {                                                        \
+        if((_port) < 0 || (_port) >= onlp_platform_mock.ports) { \
+            return ONLP_STATUS_E_INVALID;                       \
+        }                                                       \
+    } while(0)
+
+/*
+ * The presence and rx_los files of all ports are kept open
+ * for the bitmap requests.
+ */
+static onlp_file_ints_t* presence__;
+static onlp_file_ints_t* rx_los__;
+
+static onlp_file_ints_t*
+ints_open__(const char* name)
+{
+    int n = onlp_platform_mock.ports;
+    char** paths = aim_zmalloc(n * sizeof(*paths));
+    onlp_file_ints_t* set;
+    int p;
+
+    for(p = 0; p < n; p++) {
+        paths[p] = aim_fstrdup("%s/sfp/%d/%s", onlp_platform_mock.root, p, name);
+    }
+    set = onlp_file_ints_open((const char**)paths, n);
+    for(p = 0; p < n; p++) {
+        aim_free(paths[p]);
+    }
+    aim_free(paths);
+    return set;
+}
+
+static int
+ints_bitmap__(onlp_file_ints_t* set, onlp_sfp_bitmap_t* dst)
+{
+    int n = onlp_platform_mock.ports;
+    int* values = aim_zmalloc(n * sizeof(*values));
+    int* status = aim_zmalloc(n * sizeof(*status));
+    int p;
+
+    AIM_BITMAP_CLR_ALL(dst);
+    onlp_file_ints_read(set, values, status);
+    for(p = 0; p < n; p++) {
+        if(status[p] >= 0 && values[p]) {
+            AIM_BITMAP_SET(dst, p);
+        }
+    }
+    aim_free(values);
+    aim_free(status);
+    return ONLP_STATUS_OK;
+}
+
+int
+onlp_sfpi_init(void)
+{
+    int rv;
+
+    if((rv = onlp_platform_mock_init()) < 0) {
+        return rv;
+    }
+    if(onlp_platform_mock.ports && presence__ == NULL) {
+        presence__ = ints_open__("present");
+        rx_los__ = ints_open__("rx_los");
+    }
+    return ONLP_STATUS_OK;
+}
+
+int
+onlp_sfpi_bitmap_get(onlp_sfp_bitmap_t* bmap)
+{
+    int p;
+    for(p = 0; p < onlp_platform_mock.ports; p++) {
+        AIM_BITMAP_SET(bmap, p);
+    }
+    return ONLP_STATUS_OK;
+}
+
+int
+onlp_sfpi_is_present(int port)
+{
+    int value, rv;
+    VALIDATE_PORT(port);
+
+    if((rv = onlp_platform_mock_read_int(&value, "sfp/%d/present", port)) < 0) {
+        return rv;
+    }
+    return value ? 1 : 0;
+}
+
+int
+onlp_sfpi_presence_bitmap_get(onlp_sfp_bitmap_t* dst)
+{
+    if(presence__ == NULL) {
+        return ONLP_STATUS_E_UNSUPPORTED;
+    }
+    return ints_bitmap__(presence__, dst);
+}
+
+int
+onlp_sfpi_rx_los_bitmap_get(onlp_sfp_bitmap_t* dst)
+{
+    if(rx_los__ == NULL) {
+        return ONLP_STATUS_E_UNSUPPORTED;
+    }
+    return ints_bitmap__(rx_los__, dst);
+}
+
+int
+onlp_sfpi_eeprom_read(int port, uint8_t data[256])
+{
+    VALIDATE_PORT(port);
+
+    if(onlp_sfpi_is_present(port) != 1) {
+        return ONLP_STATUS_E_MISSING;
+    }
+    return onlp_platform_mock_i2c_read(port, 0x50, 0, data, 256);
+}
+
+int
+onlp_sfpi_dom_read(int port, uint8_t data[256])
+{
+    VALIDATE_PORT(port);
+
+    if(onlp_sfpi_is_present(port) != 1) {
+        return ONLP_STATUS_E_MISSING;
+    }
+    return onlp_platform_mock_i2c_read(port, 0x51, 0, data, 256);
+}
+
+int
+onlp_sfpi_dev_readb(int port, uint8_t devaddr, uint8_t addr)
+{
+    uint8_t value;
+    int rv;
+    VALIDATE_PORT(port);
+
+    if((rv = onlp_platform_mock_i2c_read(port, devaddr, addr, &value, 1)) < 0) {
+        return rv;
+    }
+    return value;
+}
+
+int
+onlp_sfpi_dev_writeb(int port, uint8_t devaddr, uint8_t addr, uint8_t value)
+{
+    VALIDATE_PORT(port);
+    return onlp_platform_mock_i2c_write(port, devaddr, addr, &value, 1);
+}
+
+int
+onlp_sfpi_dev_readw(int port, uint8_t devaddr, uint8_t addr)
+{
+    uint8_t value[2];
+    int rv;
+    VALIDATE_PORT(port);
+
+    if((rv = onlp_platform_mock_i2c_read(port, devaddr, addr, value, 2)) < 0) {
+        return rv;
+    }
+    return value[0] | (value[1] << 8);
+}
+
+int
+onlp_sfpi_dev_writew(int port, uint8_t devaddr, uint8_t addr, uint16_t value)
+{
+    uint8_t data[2] = { value & 0xFF, value >> 8 };
+    VALIDATE_PORT(port);
+    return onlp_platform_mock_i2c_write(port, devaddr, addr, data, 2);
+}
+
+int
+onlp_sfpi_dev_read(int port, uint8_t devaddr, uint8_t addr, uint8_t* rdata, int size)
+{
+    VALIDATE_PORT(port);
+    return onlp_platform_mock_i2c_read(port, devaddr, addr, rdata, size);
+}
+
+int
+onlp_sfpi_dev_write(int port, uint8_t devaddr, uint8_t addr, uint8_t* data, int size)
+{
+    VALIDATE_PORT(port);
+    return onlp_platform_mock_i2c_write(port, devaddr, addr, data, size);
+}
+
+int
+onlp_sfpi_control_supported(int port, onlp_sfp_control_t control, int* rv)
+{
+    VALIDATE_PORT(port);
+
+    switch(control)
+        {
+        case ONLP_SFP_CONTROL_RX_LOS:
+        case ONLP_SFP_CONTROL_TX_DISABLE:
+            *rv = 1;
+            break;
+        default:
+            *rv = 0;
+            break;
+        }
+    return ONLP_STATUS_OK;
+}
+
+int
+onlp_sfpi_control_set(int port, onlp_sfp_control_t control, int value)
+{
+    VALIDATE_PORT(port);
+
+    if(control != ONLP_SFP_CONTROL_TX_DISABLE) {
+        return ONLP_STATUS_E_UNSUPPORTED;
+    }
+    return onlp_platform_mock_write_int(value ? 1 : 0, "sfp/%d/tx_disable", port);
+}
+
+int
+onlp_sfpi_control_get(int port, onlp_sfp_control_t control, int* value)
+{
+    VALIDATE_PORT(port);
+
+    switch(control)
+        {
+        case ONLP_SFP_CONTROL_RX_LOS:
+            return onlp_platform_mock_read_int(value, "sfp/%d/rx_los", port);
+        case ONLP_SFP_CONTROL_TX_DISABLE:
+            return onlp_platform_mock_read_int(value, "sfp/%d/tx_disable", port);
+        default:
+            return ONLP_STATUS_E_UNSUPPORTED;
+        }
+}
+
+int
+onlp_sfpi_denit(void)
+{
+    onlp_file_ints_close(presence__);
+    onlp_file_ints_close(rx_los__);
+    presence__ = rx_los__ = NULL;
+    return ONLP_STATUS_OK;
+}
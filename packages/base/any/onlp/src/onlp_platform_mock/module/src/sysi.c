@@ -0,0 +1,136 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ *
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ ************************************************************
+ *
+ * Simulated system.
+ *
+ ***********************************************************/
+#include <onlp/platformi/sysi.h>
+#include <onlp/thermal.h>
+#include <onlp/fan.h>
+#include <onlp/psu.h>
+#include "onlp_platform_mock_int.h"
+#include "onlp_platform_mock_log.h"
+
+const char*
+onlp_sysi_platform_get(void)
+{
+    return ONLP_PLATFORM_MOCK_NAME;
+}
+
+int
+onlp_sysi_platform_set(const char* platform)
+{
+    /* The simulation can stand in for any platform. */
+    AIM_LOG_VERBOSE("simulating platform %s", platform);
+    return ONLP_STATUS_OK;
+}
+
+int
+onlp_sysi_init(void)
+{
+    return onlp_platform_mock_init();
+}
+
+int
+onlp_sysi_onie_data_get(uint8_t** data, int* size)
+{
+    static uint8_t onie_data[] = {
+        'T', 'l', 'v','I','n','f','o', 0,
+        0x1, 0x0, 0x0,
+        0x21, 0x9, 'O', 'N', 'L', '-', 'M', 'O', 'C', 'K', 0,
+        0x22, 0x3, 'O', 'N', 'L',
+        0xFE, 0x4, 0x00, 0x00, 0x00, 0x00,
+    };
+
+    if(onie_data[9] == 0 && onie_data[10] == 0) {
+        int len = sizeof(onie_data);
+        len -= 11;
+        onie_data[9] = (len & 0xFF00) >> 8;
+        onie_data[10] = (len & 0xFF);
+    }
+
+    *data = onie_data;
+    if(size) {
+        *size = sizeof(onie_data);
+    }
+    return 0;
+}
+
+void
+onlp_sysi_onie_data_free(uint8_t* data)
+{
+    /*
+     * We returned a static array in onlp_sysi_onie_data_get()
+     * so no free operation is required.
+     */
+}
+
+int
+onlp_sysi_platform_info_get(onlp_platform_info_t* pi)
+{
+    pi->cpld_versions = aim_fstrdup("mock");
+    pi->other_versions = aim_fstrdup("ports=%d fans=%d psus=%d thermals=%d i2c_latency_us=%d",
+                                     onlp_platform_mock.ports,
+                                     onlp_platform_mock.fans,
+                                     onlp_platform_mock.psus,
+                                     onlp_platform_mock.thermals,
+                                     onlp_platform_mock.i2c_latency_us);
+    return ONLP_STATUS_OK;
+}
+
+void
+onlp_sysi_platform_info_free(onlp_platform_info_t* pi)
+{
+    aim_free(pi->cpld_versions);
+    aim_free(pi->other_versions);
+}
+
+int
+onlp_sysi_oids_get(onlp_oid_t* table, int max)
+{
+    onlp_oid_t* e = table;
+    int i;
+
+    ONLP_PLATFORM_MOCK_MEMSET(table, 0, max*sizeof(onlp_oid_t));
+
+    for(i = 1; i <= onlp_platform_mock.thermals && e - table < max; i++) {
+        *e++ = ONLP_THERMAL_ID_CREATE(i);
+    }
+    for(i = 1; i <= onlp_platform_mock.fans && e - table < max; i++) {
+        *e++ = ONLP_FAN_ID_CREATE(i);
+    }
+    for(i = 1; i <= onlp_platform_mock.psus && e - table < max; i++) {
+        *e++ = ONLP_PSU_ID_CREATE(i);
+    }
+    return 0;
+}
+
+int
+onlp_sysi_platform_manage_fans(void)
+{
+    return ONLP_STATUS_OK;
+}
+
+int
+onlp_sysi_platform_manage_leds(void)
+{
+    return ONLP_STATUS_OK;
+}
@@ -0,0 +1,62 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ *
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ ************************************************************
+ *
+ * Simulated thermal sensors.
+ *
+ ***********************************************************/
+#include <onlp/platformi/thermali.h>
+#include "onlp_platform_mock_int.h"
+#include "onlp_platform_mock_log.h"
+
+#define VALIDATE(_id)                                                   \
+    do {                                                                \
+        if(!ONLP_OID_IS_THERMAL(_id) || ONLP_OID_ID_GET(_id) < 1 ||      \
+           ONLP_OID_ID_GET(_id) > onlp_platform_mock.thermals) {        \
+            return ONLP_STATUS_E_INVALID;                               \
+        }                                                               \
+    } while(0)
+
+int
+onlp_thermali_init(void)
+{
+    return onlp_platform_mock_init();
+}
+
+int
+onlp_thermali_info_get(onlp_oid_t id, onlp_thermal_info_t* info)
+{
+    int tid;
+    VALIDATE(id);
+
+    tid = ONLP_OID_ID_GET(id);
+
+    ONLP_PLATFORM_MOCK_MEMSET(info, 0, sizeof(*info));
+    info->hdr.id = id;
+    ONLP_PLATFORM_MOCK_SNPRINTF(info->hdr.description, sizeof(info->hdr.description),
+                                "Mock Thermal %d", tid);
+    info->status = ONLP_THERMAL_STATUS_PRESENT;
+    info->caps = ONLP_THERMAL_CAPS_ALL;
+    info->thresholds.warning = 70000;
+    info->thresholds.error = 80000;
+    info->thresholds.shutdown = 90000;
+
+    return onlp_platform_mock_read_int(&info->mcelsius, "thermal/%d/temp", tid);
+}
@@ -0,0 +1,596 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ *
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ ************************************************************
+ *
+ * onlp-trace: inspect and replay onlplib access traces.
+ *
+ *   report  Where the time went, per bus, device and file.
+ *   dump    Print every event.
+ *   replay  Run the trace against the simulated platform.
+ *
+ * Replay seeds each simulated I2C device with the data its first
+ * reads returned in the trace, and each file (below
+ * <root>/replay/<original path>) with its first read contents.
+ * The accesses are then re-issued in order, either back to back
+ * or with the original spacing.
+ *
+ ***********************************************************/
+#include <onlplib/trace.h>
+#include <onlplib/file.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <time.h>
+#include "onlp_platform_mock_int.h"
+#include "onlp_platform_mock_log.h"
+
+typedef struct trace_event_s {
+    onlp_trace_record_t r;
+    uint8_t* data;
+    /* Index of the target */
+    int target;
+} trace_event_t;
+
+typedef struct trace_target_s {
+    int is_file;
+    int bus;
+    uint8_t addr;
+    char* path;
+    uint64_t count;
+    uint64_t errors;
+    uint64_t bytes;
+    uint64_t total_ns;
+    uint32_t max_ns;
+    /* Replay seed */
+    uint8_t image[256];
+    uint8_t valid[256];
+    int seeded;
+    int written;
+} trace_target_t;
+
+typedef struct trace_s {
+    onlp_trace_file_header_t header;
+    trace_event_t* events;
+    int event_count;
+    trace_target_t* targets;
+    int target_count;
+    int target_max;
+    /* Target index + 1 for each path id */
+    int* file_targets;
+    uint32_t file_target_max;
+} trace_t;
+
+static int
+target_get__(trace_t* t, const onlp_trace_record_t* r, const char* path)
+{
+    int is_file = !ONLP_TRACE_OP_IS_I2C(r->op);
+    int i;
+
+    if(is_file) {
+        if(r->id >= t->file_target_max) {
+            uint32_t max = r->id * 2 + 64;
+            t->file_targets = aim_realloc(t->file_targets,
+                                          max * sizeof(*t->file_targets));
+            ONLP_PLATFORM_MOCK_MEMSET(t->file_targets + t->file_target_max, 0,
+                                      (max - t->file_target_max) * sizeof(*t->file_targets));
+            t->file_target_max = max;
+        }
+        if(t->file_targets[r->id]) {
+            return t->file_targets[r->id] - 1;
+        }
+    }
+    else {
+        /* There are few devices. */
+        for(i = 0; i < t->target_count; i++) {
+            trace_target_t* tt = t->targets + i;
+            if(!tt->is_file && tt->bus == r->bus && tt->addr == r->addr) {
+                return i;
+            }
+        }
+    }
+
+    if(t->target_count == t->target_max) {
+        t->target_max = t->target_max ? t->target_max * 2 : 64;
+        t->targets = aim_realloc(t->targets, t->target_max * sizeof(*t->targets));
+    }
+    i = t->target_count++;
+    ONLP_PLATFORM_MOCK_MEMSET(t->targets + i, 0, sizeof(t->targets[i]));
+    t->targets[i].is_file = is_file;
+    t->targets[i].bus = r->bus;
+    t->targets[i].addr = r->addr;
+    t->targets[i].path = aim_strdup(is_file ? (path ? path : "") : "");
+    if(is_file) {
+        t->file_targets[r->id] = i + 1;
+    }
+    return i;
+}
+
+static void
+trace_free__(trace_t* t)
+{
+    int i;
+    for(i = 0; i < t->event_count; i++) {
+        aim_free(t->events[i].data);
+    }
+    for(i = 0; i < t->target_count; i++) {
+        aim_free(t->targets[i].path);
+    }
+    aim_free(t->events);
+    aim_free(t->targets);
+    aim_free(t->file_targets);
+}
+
+static int
+trace_load__(trace_t* t, const char* fname)
+{
+    onlp_trace_reader_t* reader;
+    onlp_trace_record_t r;
+    const uint8_t* data;
+    const char* path;
+    int max = 0;
+    int rv;
+
+    ONLP_PLATFORM_MOCK_MEMSET(t, 0, sizeof(*t));
+    if((reader = onlp_trace_reader_open(fname, &t->header)) == NULL) {
+        return ONLP_STATUS_E_PARAM;
+    }
+
+    while((rv = onlp_trace_reader_next(reader, &r, &data, &path)) > 0) {
+        trace_event_t* e;
+        trace_target_t* tt;
+
+        if(t->event_count == max) {
+            max = max ? max * 2 : 4096;
+            t->events = aim_realloc(t->events, max * sizeof(*t->events));
+        }
+        e = t->events + t->event_count++;
+        e->r = r;
+        e->data = NULL;
+        if(r.size) {
+            e->data = aim_zmalloc(r.size);
+            ONLP_PLATFORM_MOCK_MEMCPY(e->data, data, r.size);
+        }
+        e->target = target_get__(t, &r, path);
+
+        tt = t->targets + e->target;
+        tt->count++;
+        tt->total_ns += r.duration_ns;
+        if(r.duration_ns > tt->max_ns) {
+            tt->max_ns = r.duration_ns;
+        }
+        if(r.rv < 0) {
+            tt->errors++;
+        }
+        else {
+            tt->bytes += r.length;
+        }
+    }
+
+    onlp_trace_reader_close(reader);
+    if(rv < 0) {
+        AIM_LOG_ERROR("%s: corrupt record after %d events", fname, t->event_count);
+        trace_free__(t);
+        return rv;
+    }
+    return 0;
+}
+
+static void
+target_name__(const trace_target_t* tt, char* dst, int size)
+{
+    if(tt->is_file) {
+        ONLP_PLATFORM_MOCK_SNPRINTF(dst, size, "%s", tt->path);
+    }
+    else {
+        ONLP_PLATFORM_MOCK_SNPRINTF(dst, size, "i2c-%d@0x%02x", tt->bus, tt->addr);
+    }
+}
+
+static uint64_t
+span_ns__(const trace_t* t)
+{
+    const onlp_trace_record_t* last;
+    if(t->event_count == 0) {
+        return 0;
+    }
+    last = &t->events[t->event_count - 1].r;
+    return last->start_ns + last->duration_ns - t->events[0].r.start_ns;
+}
+
+static int
+target_compare__(const void* a, const void* b)
+{
+    const trace_target_t* x = a;
+    const trace_target_t* y = b;
+    return (x->total_ns < y->total_ns) - (x->total_ns > y->total_ns);
+}
+
+static void
+report__(trace_t* t, int top)
+{
+    uint64_t span = span_ns__(t);
+    uint64_t total = 0;
+    int buses[256];
+    uint64_t bus_ns[256];
+    uint64_t bus_count[256];
+    int bus_total = 0;
+    int i, j;
+
+    for(i = 0; i < t->target_count; i++) {
+        trace_target_t* tt = t->targets + i;
+        total += tt->total_ns;
+        if(tt->is_file) {
+            continue;
+        }
+        for(j = 0; j < bus_total && buses[j] != tt->bus; j++);
+        if(j == bus_total) {
+            if(bus_total == AIM_ARRAYSIZE(buses)) {
+                continue;
+            }
+            buses[j] = tt->bus;
+            bus_ns[j] = bus_count[j] = 0;
+            bus_total++;
+        }
+        bus_ns[j] += tt->total_ns;
+        bus_count[j] += tt->count;
+    }
+
+    aim_printf(&aim_pvs_stdout, "events=%d span=%.3fs access=%.3fms dropped=%u\n\n",
+               t->event_count, span / 1e9, total / 1e6, t->header.dropped);
+
+    if(bus_total) {
+        aim_printf(&aim_pvs_stdout, "%-8s %10s %12s %7s\n",
+                   "bus", "count", "busy(ms)", "busy%");
+        for(i = 0; i < bus_total; i++) {
+            aim_printf(&aim_pvs_stdout, "i2c-%-4d %10llu %12.3f %6.1f%%\n",
+                       buses[i], (unsigned long long)bus_count[i],
+                       bus_ns[i] / 1e6,
+                       span ? bus_ns[i] * 100.0 / span : 0.0);
+        }
+        aim_printf(&aim_pvs_stdout, "\n");
+    }
+
+    qsort(t->targets, t->target_count, sizeof(*t->targets), target_compare__);
+
+    aim_printf(&aim_pvs_stdout, "%-48s %8s %6s %10s %11s %9s %9s %6s\n",
+               "target", "count", "errors", "bytes", "total(ms)",
+               "avg(us)", "max(us)", "share");
+    for(i = 0; i < t->target_count && (top <= 0 || i < top); i++) {
+        trace_target_t* tt = t->targets + i;
+        char name[256];
+        target_name__(tt, name, sizeof(name));
+        aim_printf(&aim_pvs_stdout, "%-48s %8llu %6llu %10llu %11.3f %9.1f %9.1f %5.1f%%\n",
+                   name, (unsigned long long)tt->count,
+                   (unsigned long long)tt->errors,
+                   (unsigned long long)tt->bytes,
+                   tt->total_ns / 1e6,
+                   tt->total_ns / 1e3 / tt->count,
+                   tt->max_ns / 1e3,
+                   total ? tt->total_ns * 100.0 / total : 0.0);
+    }
+}
+
+static void
+dump__(trace_t* t, int show_data)
+{
+    uint64_t base = t->event_count ? t->events[0].r.start_ns : 0;
+    int i, j;
+
+    for(i = 0; i < t->event_count; i++) {
+        trace_event_t* e = t->events + i;
+        char name[256];
+
+        target_name__(t->targets + e->target, name, sizeof(name));
+        aim_printf(&aim_pvs_stdout, "%12.3f %9.1f %-14s %s",
+                   (e->r.start_ns - base) / 1e3, e->r.duration_ns / 1e3,
+                   onlp_trace_op_name(e->r.op), name);
+        if(ONLP_TRACE_OP_IS_I2C(e->r.op)) {
+            aim_printf(&aim_pvs_stdout, " offset=0x%02x", e->r.offset);
+        }
+        aim_printf(&aim_pvs_stdout, " len=%u rv=%d", e->r.length, e->r.rv);
+        if(show_data && e->r.size) {
+            aim_printf(&aim_pvs_stdout, " data=");
+            for(j = 0; j < e->r.size && j < 32; j++) {
+                aim_printf(&aim_pvs_stdout, "%02x", e->data[j]);
+            }
+            if(e->r.size > 32) {
+                aim_printf(&aim_pvs_stdout, "...");
+            }
+        }
+        aim_printf(&aim_pvs_stdout, "\n");
+    }
+}
+
+static int
+mkdirs__(char* path)
+{
+    char* p;
+    for(p = path + 1; *p; p++) {
+        if(*p == '/') {
+            *p = 0;
+            if(mkdir(path, 0755) < 0 && errno != EEXIST) {
+                AIM_LOG_ERROR("mkdir(%s): %{errno}", path, errno);
+                *p = '/';
+                return ONLP_STATUS_E_INTERNAL;
+            }
+            *p = '/';
+        }
+    }
+    return 0;
+}
+
+static int
+file_seed__(const char* path, const uint8_t* data, int size)
+{
+    char fname[PATH_MAX];
+    int fd, rv = 0;
+
+    ONLP_PLATFORM_MOCK_SNPRINTF(fname, sizeof(fname), "%s/replay%s%s",
+                                onlp_platform_mock.root,
+                                (*path == '/') ? "" : "/", path);
+    if(mkdirs__(fname) < 0) {
+        return ONLP_STATUS_E_INTERNAL;
+    }
+    if((fd = open(fname, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+        AIM_LOG_ERROR("open(%s): %{errno}", fname, errno);
+        return ONLP_STATUS_E_INTERNAL;
+    }
+    if(size && write(fd, data, size) != size) {
+        AIM_LOG_ERROR("write(%s): %{errno}", fname, errno);
+        rv = ONLP_STATUS_E_INTERNAL;
+    }
+    close(fd);
+    return rv;
+}
+
+/*
+ * Build the simulated devices and files from the first successful
+ * read of every byte and file in the trace.
+ */
+static int
+replay_seed__(trace_t* t)
+{
+    int i, j;
+
+    for(i = 0; i < t->event_count; i++) {
+        trace_event_t* e = t->events + i;
+        trace_target_t* tt = t->targets + e->target;
+
+        if(e->r.rv < 0) {
+            continue;
+        }
+        switch(e->r.op)
+            {
+            case ONLP_TRACE_OP_I2C_READ:
+            case ONLP_TRACE_OP_I2C_BLOCK_READ:
+            case ONLP_TRACE_OP_I2C_READW:
+                for(j = 0; j < e->r.size && e->r.offset + j < 256; j++) {
+                    if(!tt->valid[e->r.offset + j]) {
+                        tt->image[e->r.offset + j] = e->data[j];
+                        tt->valid[e->r.offset + j] = 1;
+                    }
+                }
+                break;
+            case ONLP_TRACE_OP_FILE_READ:
+                if(!tt->seeded) {
+                    ONLP_IF_ERROR_RETURN(file_seed__(tt->path, e->data, e->r.size));
+                    tt->seeded = 1;
+                }
+                break;
+            case ONLP_TRACE_OP_FILE_WRITE:
+                tt->written = 1;
+                break;
+            default:
+                break;
+            }
+    }
+
+    for(i = 0; i < t->target_count; i++) {
+        trace_target_t* tt = t->targets + i;
+        if(tt->is_file) {
+            if(!tt->seeded && tt->written) {
+                /* Written but never read. */
+                ONLP_IF_ERROR_RETURN(file_seed__(tt->path, NULL, 0));
+            }
+        }
+        else {
+            ONLP_IF_ERROR_RETURN(onlp_platform_mock_bus_image_set(tt->bus, tt->addr,
+                                                                  tt->image));
+        }
+    }
+    return 0;
+}
+
+static int
+replay_event__(trace_t* t, trace_event_t* e, uint8_t* buffer, int max)
+{
+    trace_target_t* tt = t->targets + e->target;
+    int size = e->r.length;
+    int len;
+
+    if(ONLP_TRACE_OP_IS_I2C(e->r.op) && e->r.offset + size > 256) {
+        size = 256 - e->r.offset;
+    }
+    if(size > max) {
+        size = max;
+    }
+
+    /* Captured data may be truncated. The rest is written as zeros. */
+    ONLP_PLATFORM_MOCK_MEMSET(buffer, 0, size);
+    if(e->r.size) {
+        ONLP_PLATFORM_MOCK_MEMCPY(buffer, e->data, (e->r.size < size) ? e->r.size : size);
+    }
+
+    switch(e->r.op)
+        {
+        case ONLP_TRACE_OP_I2C_READ:
+        case ONLP_TRACE_OP_I2C_BLOCK_READ:
+        case ONLP_TRACE_OP_I2C_READW:
+            return onlp_platform_mock_bus_read(tt->bus, tt->addr, e->r.offset,
+                                               buffer, size);
+        case ONLP_TRACE_OP_I2C_WRITE:
+        case ONLP_TRACE_OP_I2C_WRITEW:
+            return onlp_platform_mock_bus_write(tt->bus, tt->addr, e->r.offset,
+                                                buffer, size);
+        case ONLP_TRACE_OP_FILE_READ:
+            return onlp_file_read(buffer, max, &len, "%s/replay%s%s",
+                                  onlp_platform_mock.root,
+                                  (*tt->path == '/') ? "" : "/", tt->path);
+        case ONLP_TRACE_OP_FILE_WRITE:
+            return onlp_file_write(buffer, size, "%s/replay%s%s",
+                                   onlp_platform_mock.root,
+                                   (*tt->path == '/') ? "" : "/", tt->path);
+        default:
+            return ONLP_STATUS_E_PARAM;
+        }
+}
+
+static void
+sleep_until__(uint64_t when)
+{
+    struct timespec ts;
+    ts.tv_sec = when / 1000000000ULL;
+    ts.tv_nsec = when % 1000000000ULL;
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+}
+
+static int
+replay__(trace_t* t, int paced, double speed)
+{
+    uint64_t captured[ONLP_TRACE_OP_COUNT] = { 0 };
+    uint64_t replayed[ONLP_TRACE_OP_COUNT] = { 0 };
+    int counts[ONLP_TRACE_OP_COUNT] = { 0 };
+    int mismatches[ONLP_TRACE_OP_COUNT] = { 0 };
+    uint64_t base, trace_base, start, elapsed;
+    uint8_t buffer[4096];
+    int i, rv;
+
+    if((rv = onlp_platform_mock_init()) < 0 || (rv = replay_seed__(t)) < 0) {
+        AIM_LOG_ERROR("Failed to prepare the replay tree in %s", onlp_platform_mock.root);
+        return rv;
+    }
+
+    trace_base = t->event_count ? t->events[0].r.start_ns : 0;
+    base = onlp_trace_now();
+
+    for(i = 0; i < t->event_count; i++) {
+        trace_event_t* e = t->events + i;
+
+        if(paced) {
+            sleep_until__(base + (uint64_t)((e->r.start_ns - trace_base) / speed));
+        }
+
+        start = onlp_trace_now();
+        rv = replay_event__(t, e, buffer, sizeof(buffer));
+        replayed[e->r.op] += onlp_trace_now() - start;
+        captured[e->r.op] += e->r.duration_ns;
+        counts[e->r.op]++;
+        /* The access succeeded in the trace but not here, or vice versa. */
+        if((rv < 0) != (e->r.rv < 0)) {
+            mismatches[e->r.op]++;
+        }
+    }
+    elapsed = onlp_trace_now() - base;
+
+    aim_printf(&aim_pvs_stdout, "replayed %d events in %.3fs (captured span %.3fs)\n\n",
+               t->event_count, elapsed / 1e9, span_ns__(t) / 1e9);
+    aim_printf(&aim_pvs_stdout, "%-16s %8s %13s %13s %10s\n",
+               "op", "count", "captured(ms)", "replayed(ms)", "mismatch");
+    for(i = 0; i < ONLP_TRACE_OP_COUNT; i++) {
+        if(counts[i]) {
+            aim_printf(&aim_pvs_stdout, "%-16s %8d %13.3f %13.3f %10d\n",
+                       onlp_trace_op_name(i), counts[i],
+                       captured[i] / 1e6, replayed[i] / 1e6, mismatches[i]);
+        }
+    }
+    return 0;
+}
+
+static int
+usage__(const char* name, int rv)
+{
+    printf("Usage: %s report [-n N] FILE\n", name);
+    printf("       %s dump [-d] FILE\n", name);
+    printf("       %s replay [-p] [-s SPEED] [-R ROOT] FILE\n", name);
+    printf("  -n N      Show the top N targets (0 for all). Default 20.\n");
+    printf("  -d        Show the captured data.\n");
+    printf("  -p        Keep the original spacing between accesses.\n");
+    printf("  -s SPEED  Speed up (>1) or slow down (<1) a paced replay.\n");
+    printf("  -R ROOT   The simulated platform root. Default $ONLP_MOCK_ROOT.\n");
+    return rv;
+}
+
+int
+onlp_trace_main(int argc, char* argv[])
+{
+    const char* name = argv[0];
+    const char* command;
+    int top = 20;
+    int show_data = 0;
+    int paced = 0;
+    double speed = 1.0;
+    trace_t t;
+    int c, rv = 0;
+
+    if(argc < 2) {
+        return usage__(name, 1);
+    }
+    command = argv[1];
+    argc--;
+    argv++;
+
+    while( (c = getopt(argc, argv, "n:dps:R:h")) != -1) {
+        switch(c)
+            {
+            case 'n': top = atoi(optarg); break;
+            case 'd': show_data = 1; break;
+            case 'p': paced = 1; break;
+            case 's': speed = atof(optarg); break;
+            case 'R': setenv("ONLP_MOCK_ROOT", optarg, 1); break;
+            default: return usage__(name, (c == 'h') ? 0 : 1);
+            }
+    }
+
+    if(optind != argc - 1 || speed <= 0) {
+        return usage__(name, 1);
+    }
+
+    if(trace_load__(&t, argv[optind]) < 0) {
+        return 1;
+    }
+
+    if(!strcmp(command, "report")) {
+        report__(&t, top);
+    }
+    else if(!strcmp(command, "dump")) {
+        dump__(&t, show_data);
+    }
+    else if(!strcmp(command, "replay")) {
+        rv = (replay__(&t, paced, speed) < 0) ? 1 : 0;
+    }
+    else {
+        rv = usage__(name, 1);
+    }
+
+    trace_free__(&t);
+    return rv;
+}
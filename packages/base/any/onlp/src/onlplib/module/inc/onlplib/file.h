@@ -118,9 +118,54 @@ int onlp_file_read_int(int* value, const char* fmt, ...);
  * @brief Read and return the maximum integer value contained in the given files.
  * @param value Receives the maximum integer value.
  * @param files Null terminated file list.
+ * @note The files of a list are kept open and are re-read on the next
+ * call with the same list. The first file which fails ends the read.
  */
 int onlp_file_read_int_max(int* value, char** files);
 
+/**
+ * @brief Read the integer contents of multiple files.
+ * @param paths The filenames.
+ * @param values Receives the integer value of each file.
+ * @param status Receives the status of each read (optional).
+ * @param n The number of files.
+ * @returns The number of files successfully read, or a negative
+ * error code if the arguments are invalid.
+ * @note Entries which fail leave their value untouched.
+ * @note The files of recently read lists are kept open and are re-read
+ * on the next call with the same paths.
+ */
+int onlp_file_read_ints(const char** paths, int* values, int* status, int n);
+
+/**
+ * A set of integer files which are opened once and read repeatedly.
+ */
+typedef struct onlp_file_ints_s onlp_file_ints_t;
+
+/**
+ * @brief Open a set of integer files.
+ * @param paths The filenames. These may contain the search asterisk
+ * supported by onlp_file_open().
+ * @param n The number of files.
+ * @note Files which cannot be opened are retried on every read.
+ */
+onlp_file_ints_t* onlp_file_ints_open(const char** paths, int n);
+
+/**
+ * @brief Read the current integer contents of all files in the set.
+ * @param set The file set.
+ * @param values Receives the integer value of each file.
+ * @param status Receives the status of each read (optional).
+ * @returns The number of files successfully read.
+ */
+int onlp_file_ints_read(onlp_file_ints_t* set, int* values, int* status);
+
+/**
+ * @brief Close a set of integer files.
+ * @param set The file set.
+ */
+void onlp_file_ints_close(onlp_file_ints_t* set);
+
 /**
  * @brief Write data to the given file.
  * @param data The data to write.
@@ -0,0 +1,86 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ *
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ ************************************************************
+ *
+ * Deferred, rate-limited logging for platform management.
+ *
+ * Messages are formatted into a lock-free ring by the caller and
+ * written to the log (and optionally syslog) by a low-priority
+ * writer thread, so the platform manager never blocks on the
+ * syslog socket.
+ *
+ * Each message has an id: a static key string and an instance
+ * number (the PSU or fan OID, for example). A message is written
+ * at most once per ONLPLIB_CONFIG_LOGRING_INTERVAL_MS for its id.
+ * Repeats within the interval are counted and reported as a
+ * single "repeated N times" message when it expires, or before
+ * any other message for the same instance.
+ *
+ * When the writer is not running messages are logged directly.
+ *
+ ***********************************************************/
+#ifndef __ONLPLIB_LOGRING_H__
+#define __ONLPLIB_LOGRING_H__
+
+#include <onlplib/onlplib_config.h>
+
+typedef enum onlp_logring_level_e {
+    ONLP_LOGRING_LEVEL_INFO,
+    ONLP_LOGRING_LEVEL_WARN,
+    ONLP_LOGRING_LEVEL_ERROR,
+    ONLP_LOGRING_LEVEL_CRIT,
+} onlp_logring_level_t;
+
+/** Also send the message to syslog. */
+#define ONLP_LOGRING_F_SYSLOG 0x1
+
+/**
+ * @brief Start the writer thread.
+ * @note Starting a running writer does nothing.
+ */
+int onlp_logring_start(void);
+
+/**
+ * @brief Stop the writer thread.
+ * Pending messages and repeat counts are written first.
+ */
+void onlp_logring_stop(void);
+
+/**
+ * @brief Post a message.
+ * @param key The message id key. Compared by address, so this must
+ * be a static string. NULL disables rate limiting for the message.
+ * This is also the syslog message name.
+ * @param desc The static syslog message description, or NULL.
+ * @param instance The message id instance.
+ * @param level The log level.
+ * @param flags ONLP_LOGRING_F_*
+ * @param fmt The message format.
+ * @note Messages are dropped (and counted) if the ring is full.
+ */
+void onlp_logring_post(const char* key, const char* desc, int instance,
+                       onlp_logring_level_t level, int flags,
+                       const char* fmt, ...)
+    __attribute__((format(printf, 6, 7)));
+
+/** Messages dropped because the ring was full. */
+uint32_t onlp_logring_dropped(void);
+
+#endif /* __ONLPLIB_LOGRING_H__ */
@@ -165,6 +165,66 @@
 #define ONLPLIB_CONFIG_INCLUDE_I2C_SMBUS 0
 #endif
 
+/**
+ * ONLPLIB_CONFIG_TRACE_DATA_MAX
+ *
+ * Maximum data bytes captured per traced access. */
+
+
+#ifndef ONLPLIB_CONFIG_TRACE_DATA_MAX
+#define ONLPLIB_CONFIG_TRACE_DATA_MAX 256
+#endif
+
+/**
+ * ONLPLIB_CONFIG_TRACE_RING_SIZE
+ *
+ * Default trace ring size in bytes when enabled from the environment. */
+
+
+#ifndef ONLPLIB_CONFIG_TRACE_RING_SIZE
+#define ONLPLIB_CONFIG_TRACE_RING_SIZE 1048576
+#endif
+
+/**
+ * ONLPLIB_CONFIG_LOGRING_SIZE
+ *
+ * Number of messages the platform log ring can hold. Must be a power of 2. */
+
+
+#ifndef ONLPLIB_CONFIG_LOGRING_SIZE
+#define ONLPLIB_CONFIG_LOGRING_SIZE 256
+#endif
+
+/**
+ * ONLPLIB_CONFIG_LOGRING_MSG_MAX
+ *
+ * Maximum length of a platform log ring message. */
+
+
+#ifndef ONLPLIB_CONFIG_LOGRING_MSG_MAX
+#define ONLPLIB_CONFIG_LOGRING_MSG_MAX 256
+#endif
+
+/**
+ * ONLPLIB_CONFIG_LOGRING_IDS
+ *
+ * Number of message ids tracked for rate limiting. */
+
+
+#ifndef ONLPLIB_CONFIG_LOGRING_IDS
+#define ONLPLIB_CONFIG_LOGRING_IDS 64
+#endif
+
+/**
+ * ONLPLIB_CONFIG_LOGRING_INTERVAL_MS
+ *
+ * Minimum interval between two messages with the same id. Repeats are coalesced. */
+
+
+#ifndef ONLPLIB_CONFIG_LOGRING_INTERVAL_MS
+#define ONLPLIB_CONFIG_LOGRING_INTERVAL_MS 60000
+#endif
+
 
 
 /**
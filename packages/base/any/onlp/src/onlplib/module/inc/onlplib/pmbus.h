@@ -0,0 +1,200 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ *
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ ************************************************************
+ *
+ * Common PMBus PSU telemetry support.
+ *
+ * A session represents a single PMBus device. The VOUT_MODE
+ * exponent and the MFR_* strings are read once and cached until
+ * the session is invalidated (e.g. when the PSU is removed).
+ * Telemetry readings are refreshed together, at most once per TTL.
+ *
+ ***********************************************************/
+#ifndef __ONLPLIB_PMBUS_H__
+#define __ONLPLIB_PMBUS_H__
+
+#include <onlplib/onlplib_config.h>
+#include <stdint.h>
+
+/** PMBus command codes. */
+#define ONLP_PMBUS_CMD_PAGE             0x00
+#define ONLP_PMBUS_CMD_VOUT_MODE        0x20
+#define ONLP_PMBUS_CMD_STATUS_WORD      0x79
+#define ONLP_PMBUS_CMD_READ_VIN         0x88
+#define ONLP_PMBUS_CMD_READ_IIN         0x89
+#define ONLP_PMBUS_CMD_READ_VOUT        0x8B
+#define ONLP_PMBUS_CMD_READ_IOUT        0x8C
+#define ONLP_PMBUS_CMD_READ_TEMPERATURE_1 0x8D
+#define ONLP_PMBUS_CMD_READ_TEMPERATURE_2 0x8E
+#define ONLP_PMBUS_CMD_READ_TEMPERATURE_3 0x8F
+#define ONLP_PMBUS_CMD_READ_FAN_SPEED_1 0x90
+#define ONLP_PMBUS_CMD_READ_FAN_SPEED_2 0x91
+#define ONLP_PMBUS_CMD_READ_POUT        0x96
+#define ONLP_PMBUS_CMD_READ_PIN         0x97
+#define ONLP_PMBUS_CMD_MFR_ID           0x99
+#define ONLP_PMBUS_CMD_MFR_MODEL        0x9A
+#define ONLP_PMBUS_CMD_MFR_REVISION     0x9B
+#define ONLP_PMBUS_CMD_MFR_SERIAL       0x9E
+
+/**
+ * Telemetry fields.
+ */
+typedef enum onlp_pmbus_field_e {
+    ONLP_PMBUS_FIELD_VIN,       /* millivolts */
+    ONLP_PMBUS_FIELD_IIN,       /* milliamps */
+    ONLP_PMBUS_FIELD_VOUT,      /* millivolts */
+    ONLP_PMBUS_FIELD_IOUT,      /* milliamps */
+    ONLP_PMBUS_FIELD_PIN,       /* milliwatts */
+    ONLP_PMBUS_FIELD_POUT,      /* milliwatts */
+    ONLP_PMBUS_FIELD_TEMP1,     /* millicelsius */
+    ONLP_PMBUS_FIELD_TEMP2,     /* millicelsius */
+    ONLP_PMBUS_FIELD_TEMP3,     /* millicelsius */
+    ONLP_PMBUS_FIELD_FAN1,      /* rpm */
+    ONLP_PMBUS_FIELD_FAN2,      /* rpm */
+    ONLP_PMBUS_FIELD_STATUS_WORD,
+    ONLP_PMBUS_FIELD_COUNT,
+} onlp_pmbus_field_t;
+
+#define ONLP_PMBUS_FIELD_MASK(_f) (1 << (_f))
+
+/** The input/output power, voltage and current fields. */
+#define ONLP_PMBUS_FIELDS_POWER                         \
+    (ONLP_PMBUS_FIELD_MASK(ONLP_PMBUS_FIELD_VIN) |      \
+     ONLP_PMBUS_FIELD_MASK(ONLP_PMBUS_FIELD_IIN) |      \
+     ONLP_PMBUS_FIELD_MASK(ONLP_PMBUS_FIELD_VOUT) |     \
+     ONLP_PMBUS_FIELD_MASK(ONLP_PMBUS_FIELD_IOUT) |     \
+     ONLP_PMBUS_FIELD_MASK(ONLP_PMBUS_FIELD_PIN) |      \
+     ONLP_PMBUS_FIELD_MASK(ONLP_PMBUS_FIELD_POUT))
+
+/** Default telemetry TTL. */
+#define ONLP_PMBUS_TTL_MS_DEFAULT 1000
+
+/**
+ * Telemetry readings.
+ */
+typedef struct onlp_pmbus_readings_s {
+    /** Fields successfully read during the last refresh. */
+    uint32_t valid;
+    /** Decoded values, indexed by onlp_pmbus_field_t */
+    int values[ONLP_PMBUS_FIELD_COUNT];
+} onlp_pmbus_readings_t;
+
+/**
+ * Static manufacturer information.
+ */
+typedef struct onlp_pmbus_mfr_s {
+    char id[33];
+    char model[33];
+    char revision[33];
+    char serial[33];
+} onlp_pmbus_mfr_t;
+
+/**
+ * Device access operations. All return a negative value on error.
+ */
+typedef struct onlp_pmbus_ops_s {
+    /** Read a byte command. Returns the byte. */
+    int (*readb)(void* cookie, uint8_t command);
+    /** Read a word command. Returns the word. */
+    int (*readw)(void* cookie, uint8_t command);
+    /**
+     * Read an SMBus block command. The data (not including the
+     * count byte) is stored in data. Returns the data length.
+     */
+    int (*block_read)(void* cookie, uint8_t command, uint8_t* data, int max);
+} onlp_pmbus_ops_t;
+
+typedef struct onlp_pmbus_session_s onlp_pmbus_session_t;
+
+/**
+ * @brief Decode a LINEAR11 value.
+ * @param raw The raw word.
+ * @param scale Multiplier applied before the exponent (1000 for milli-units).
+ */
+int onlp_pmbus_linear11_decode(uint16_t raw, int scale);
+
+/**
+ * @brief Decode a LINEAR16 (VOUT) value.
+ * @param raw The raw word.
+ * @param vout_mode The VOUT_MODE byte.
+ * @param scale Multiplier applied before the exponent (1000 for milli-units).
+ */
+int onlp_pmbus_linear16_decode(uint16_t raw, uint8_t vout_mode, int scale);
+
+/**
+ * @brief Create a session.
+ * @param ops The device access operations.
+ * @param cookie Passed to all ops.
+ * @param fields The telemetry fields to refresh (ONLP_PMBUS_FIELD_MASK()).
+ * @param ttl_ms Telemetry lifetime in milliseconds. 0 disables caching.
+ */
+onlp_pmbus_session_t* onlp_pmbus_session_create(const onlp_pmbus_ops_t* ops,
+                                                void* cookie,
+                                                uint32_t fields,
+                                                int ttl_ms);
+
+#if ONLPLIB_CONFIG_INCLUDE_I2C == 1
+/**
+ * @brief Create a session using the onlplib i2c routines.
+ * @param bus The i2c bus.
+ * @param addr The PMBus device address.
+ * @param fields The telemetry fields to refresh.
+ * @param ttl_ms Telemetry lifetime in milliseconds.
+ */
+onlp_pmbus_session_t* onlp_pmbus_i2c_session_create(int bus, uint8_t addr,
+                                                    uint32_t fields,
+                                                    int ttl_ms);
+#endif
+
+/**
+ * @brief Destroy a session.
+ */
+void onlp_pmbus_session_destroy(onlp_pmbus_session_t* session);
+
+/**
+ * @brief Change the telemetry TTL.
+ */
+void onlp_pmbus_session_ttl_set(onlp_pmbus_session_t* session, int ttl_ms);
+
+/**
+ * @brief Drop all cached state.
+ * @note Call this when the PSU is removed or replaced. Device access
+ * errors invalidate the session automatically.
+ */
+void onlp_pmbus_session_invalidate(onlp_pmbus_session_t* session);
+
+/**
+ * @brief Get the telemetry readings, refreshing them if stale.
+ * @param session The session.
+ * @param[out] readings Receives the readings.
+ * @returns ONLP_STATUS_OK if all requested fields were read.
+ */
+int onlp_pmbus_readings_get(onlp_pmbus_session_t* session,
+                            onlp_pmbus_readings_t* readings);
+
+/**
+ * @brief Get the manufacturer information.
+ * @param session The session.
+ * @param[out] mfr Receives the information.
+ * @note The strings are read from the device on first use only.
+ */
+int onlp_pmbus_mfr_get(onlp_pmbus_session_t* session, onlp_pmbus_mfr_t* mfr);
+
+#endif /* __ONLPLIB_PMBUS_H__ */
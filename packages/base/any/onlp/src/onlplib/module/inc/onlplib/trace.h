@@ -0,0 +1,177 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ *
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ ************************************************************
+ *
+ * I2C and file access tracing.
+ *
+ * When enabled, every onlp_i2c_* transaction and every onlp_file_*
+ * read or write is recorded with its start time, duration,
+ * target and data. Records are kept in an in-memory ring (the
+ * oldest records are dropped when it is full) or streamed
+ * directly to a file.
+ *
+ * Tracing is off by default and costs a single flag test per
+ * access. It can be enabled by the application or by setting
+ * ONLP_TRACE=<file>[:<ring-bytes>] in the environment, in which
+ * case the trace is written when the process exits.
+ *
+ * Trace file layout:
+ *    onlp_trace_file_header_t
+ *    onlp_trace_record_t + data[record.size], ...
+ *
+ * File paths are interned. A STRING record defines the path for
+ * an id and always precedes the first event that uses it.
+ *
+ ***********************************************************/
+#ifndef __ONLPLIB_TRACE_H__
+#define __ONLPLIB_TRACE_H__
+
+#include <onlplib/onlplib_config.h>
+#include <stdint.h>
+
+#define ONLP_TRACE_MAGIC   0x544C4E4F   /* "ONLT" */
+#define ONLP_TRACE_VERSION 1
+
+typedef enum onlp_trace_op_e {
+    ONLP_TRACE_OP_STRING,
+    ONLP_TRACE_OP_I2C_READ,
+    ONLP_TRACE_OP_I2C_BLOCK_READ,
+    ONLP_TRACE_OP_I2C_WRITE,
+    ONLP_TRACE_OP_I2C_READW,
+    ONLP_TRACE_OP_I2C_WRITEW,
+    ONLP_TRACE_OP_FILE_READ,
+    ONLP_TRACE_OP_FILE_WRITE,
+    ONLP_TRACE_OP_COUNT,
+} onlp_trace_op_t;
+
+#define ONLP_TRACE_OP_IS_I2C(_op)                               \
+    ((_op) >= ONLP_TRACE_OP_I2C_READ && (_op) <= ONLP_TRACE_OP_I2C_WRITEW)
+
+typedef struct __attribute__((packed)) onlp_trace_file_header_s {
+    uint32_t magic;
+    uint16_t version;
+    /** sizeof(onlp_trace_record_t) */
+    uint16_t record_size;
+    /** Records dropped because the ring was full. */
+    uint32_t dropped;
+    uint32_t reserved;
+} onlp_trace_file_header_t;
+
+typedef struct __attribute__((packed)) onlp_trace_record_s {
+    /** onlp_trace_op_t */
+    uint8_t op;
+    uint8_t addr;
+    /** Bytes of data following this record. */
+    uint16_t size;
+    /** Path id for FILE ops and STRING records. */
+    uint32_t id;
+    /** CLOCK_MONOTONIC nanoseconds. */
+    uint64_t start_ns;
+    uint32_t duration_ns;
+    /** Return value of the access. */
+    int32_t rv;
+    int16_t bus;
+    uint16_t offset;
+    /** Requested length. The captured data may be truncated. */
+    uint32_t length;
+} onlp_trace_record_t;
+
+/** Non-zero while tracing. Test this before calling the recorders. */
+extern volatile int onlp_trace_active;
+
+/**
+ * @brief Start tracing.
+ * @param path The trace file.
+ * @param ring_bytes The ring size. The trace is written to the file
+ * when tracing is stopped or dumped. 0 streams every record to the file.
+ */
+int onlp_trace_start(const char* path, int ring_bytes);
+
+/**
+ * @brief Stop tracing and write or flush the trace file.
+ */
+int onlp_trace_stop(void);
+
+/**
+ * @brief Write the current ring contents to a file without stopping.
+ * @param path The output file. NULL uses the start path.
+ */
+int onlp_trace_dump(const char* path);
+
+/**
+ * @brief Start tracing if ONLP_TRACE is set in the environment.
+ */
+void onlp_trace_env_init(void);
+
+/** Current CLOCK_MONOTONIC time in nanoseconds. */
+uint64_t onlp_trace_now(void);
+
+/** Start timestamp for a traced access, 0 if tracing is off. */
+#define ONLP_TRACE_START() (onlp_trace_active ? onlp_trace_now() : 0)
+
+/**
+ * @brief Record an I2C transaction.
+ * @param start The ONLP_TRACE_START() value. Nothing is recorded if 0.
+ */
+void onlp_trace_i2c(onlp_trace_op_t op, uint64_t start, int bus,
+                    uint8_t addr, uint16_t offset, int length,
+                    const uint8_t* data, int rv);
+
+/**
+ * @brief Record a file access.
+ * @param start The ONLP_TRACE_START() value. Nothing is recorded if 0.
+ */
+void onlp_trace_file(onlp_trace_op_t op, uint64_t start, const char* path,
+                     const uint8_t* data, int length, int rv);
+
+
+/**
+ * Trace file reader.
+ */
+typedef struct onlp_trace_reader_s onlp_trace_reader_t;
+
+/**
+ * @brief Open a trace file.
+ * @param path The trace file.
+ * @param[out] header Receives the file header (optional).
+ */
+onlp_trace_reader_t* onlp_trace_reader_open(const char* path,
+                                            onlp_trace_file_header_t* header);
+
+/**
+ * @brief Read the next event.
+ * @param reader The reader.
+ * @param[out] record The event record.
+ * @param[out] data The captured data. Valid until the next call.
+ * @param[out] path The path for FILE events, NULL otherwise.
+ * @returns 1 if an event was read, 0 at the end of the trace, or
+ * ONLP_STATUS_E_PARAM if the record has an unknown op.
+ * @note STRING records are consumed internally.
+ */
+int onlp_trace_reader_next(onlp_trace_reader_t* reader,
+                           onlp_trace_record_t* record,
+                           const uint8_t** data, const char** path);
+
+void onlp_trace_reader_close(onlp_trace_reader_t* reader);
+
+/** Short name for an op. */
+const char* onlp_trace_op_name(onlp_trace_op_t op);
+
+#endif /* __ONLPLIB_TRACE_H__ */
@@ -25,6 +25,7 @@
 #include <onlplib/onlplib_config.h>
 #include "onlplib_log.h"
 #include <onlplib/file.h>
+#include <onlplib/trace.h>
 #include <limits.h>
 #include <unistd.h>
 #include <fcntl.h>
@@ -34,6 +35,7 @@
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <sys/stat.h>
+#include <pthread.h>
 
 /**
  * @brief Connects to a unix domain socket.
@@ -162,6 +164,7 @@ onlp_file_vread(uint8_t* data, int max, int* len, const char* fmt, va_list vargs
     int fd;
     char* fname = NULL;
     int rv;
+    uint64_t start = ONLP_TRACE_START();
 
     if ((fd = vopen__(&fname, O_RDONLY, fmt, vargs)) < 0) {
         rv = fd;
@@ -177,6 +180,8 @@ onlp_file_vread(uint8_t* data, int max, int* len, const char* fmt, va_list vargs
         }
         close(fd);
     }
+    onlp_trace_file(ONLP_TRACE_OP_FILE_READ, start, fname ? fname : fmt,
+                    data, (rv < 0) ? 0 : *len, rv);
     aim_free(fname);
     return rv;
 }
@@ -284,11 +289,225 @@ onlp_file_read_int(int* value, const char* fmt, ...)
     return rv;
 }
 
+/*
+ * Integer file sets.
+ *
+ * Regular files (sysfs attributes) are opened once and re-read with
+ * pread() at offset zero, which makes sysfs regenerate the contents.
+ * Domain sockets cannot be rewound and are reconnected on every read.
+ */
+struct onlp_file_ints_s {
+    int count;
+    char** paths;
+    int* fds;
+};
+
+static int
+open__(char** dst, int flags, const char* fmt, ...)
+{
+    int rv;
+    va_list vargs;
+    va_start(vargs, fmt);
+    rv = vopen__(dst, flags, fmt, vargs);
+    va_end(vargs);
+    return rv;
+}
+
+static int
+ints_read__(onlp_file_ints_t* set, int i, int* value)
+{
+    int fd = set->fds[i];
+    int rewind = 1;
+    int len;
+    char data[32];
+    struct stat sb;
+    uint64_t start = ONLP_TRACE_START();
+
+    if(fd < 0) {
+        if((fd = open__(NULL, O_RDONLY | O_CLOEXEC, "%s", set->paths[i])) < 0) {
+            onlp_trace_file(ONLP_TRACE_OP_FILE_READ, start, set->paths[i],
+                            NULL, 0, fd);
+            return fd;
+        }
+        if(fstat(fd, &sb) == 0 && S_ISSOCK(sb.st_mode)) {
+            rewind = 0;
+        }
+        else {
+            set->fds[i] = fd;
+        }
+    }
+
+    if(rewind) {
+        len = pread(fd, data, sizeof(data)-1, 0);
+    }
+    else {
+        len = read(fd, data, sizeof(data)-1);
+        close(fd);
+    }
+
+    if(len <= 0) {
+        AIM_LOG_ERROR("Failed to read input file '%s'", set->paths[i]);
+        if(rewind) {
+            /* Reopen on the next read in case the attribute was recreated. */
+            close(fd);
+            set->fds[i] = -1;
+        }
+        onlp_trace_file(ONLP_TRACE_OP_FILE_READ, start, set->paths[i],
+                        NULL, 0, ONLP_STATUS_E_INTERNAL);
+        return ONLP_STATUS_E_INTERNAL;
+    }
+
+    onlp_trace_file(ONLP_TRACE_OP_FILE_READ, start, set->paths[i],
+                    (uint8_t*)data, len, ONLP_STATUS_OK);
+    data[len] = 0;
+    *value = ONLPLIB_ATOI(data);
+    return ONLP_STATUS_OK;
+}
+
+onlp_file_ints_t*
+onlp_file_ints_open(const char** paths, int n)
+{
+    int i;
+    onlp_file_ints_t* set;
+
+    if(paths == NULL || n <= 0) {
+        return NULL;
+    }
+
+    set = aim_zmalloc(sizeof(*set));
+    set->count = n;
+    set->paths = aim_zmalloc(n * sizeof(*set->paths));
+    set->fds = aim_zmalloc(n * sizeof(*set->fds));
+
+    for(i = 0; i < n; i++) {
+        set->paths[i] = aim_strdup(paths[i]);
+        set->fds[i] = -1;
+    }
+    return set;
+}
+
+int
+onlp_file_ints_read(onlp_file_ints_t* set, int* values, int* status)
+{
+    int i;
+    int rv;
+    int count = 0;
+
+    if(set == NULL || values == NULL) {
+        return ONLP_STATUS_E_PARAM;
+    }
+
+    for(i = 0; i < set->count; i++) {
+        rv = ints_read__(set, i, values + i);
+        if(status) {
+            status[i] = rv;
+        }
+        if(rv >= 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void
+onlp_file_ints_close(onlp_file_ints_t* set)
+{
+    int i;
+
+    if(set == NULL) {
+        return;
+    }
+
+    for(i = 0; i < set->count; i++) {
+        if(set->fds[i] >= 0) {
+            close(set->fds[i]);
+        }
+        aim_free(set->paths[i]);
+    }
+    aim_free(set->paths);
+    aim_free(set->fds);
+    aim_free(set);
+}
+
+/*
+ * Platforms call onlp_file_read_ints() and onlp_file_read_int_max() with
+ * the same path lists on every poll, so the sets for the most recently
+ * used lists are kept open. Lists are matched by their contents since
+ * callers often rebuild them in local buffers on each call.
+ */
+#define INTS_CACHE_SIZE__ 32
+
+static struct {
+    onlp_file_ints_t* set;
+    uint64_t used;
+} ints_cache__[INTS_CACHE_SIZE__];
+static uint64_t ints_cache_tick__;
+static pthread_mutex_t ints_cache_lock__ = PTHREAD_MUTEX_INITIALIZER;
+
+static int
+ints_match__(onlp_file_ints_t* set, const char** paths, int n)
+{
+    int i;
+
+    if(set->count != n) {
+        return 0;
+    }
+    for(i = 0; i < n; i++) {
+        if(strcmp(set->paths[i], paths[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Called with ints_cache_lock__ held. */
+static onlp_file_ints_t*
+ints_cached__(const char** paths, int n)
+{
+    int i;
+    int slot = 0;
+
+    for(i = 0; i < INTS_CACHE_SIZE__; i++) {
+        if(ints_cache__[i].set && ints_match__(ints_cache__[i].set, paths, n)) {
+            slot = i;
+            goto found;
+        }
+        if(ints_cache__[i].used < ints_cache__[slot].used) {
+            slot = i;
+        }
+    }
+
+    /* Replace the least recently used set. Unused slots come first. */
+    onlp_file_ints_close(ints_cache__[slot].set);
+    ints_cache__[slot].set = onlp_file_ints_open(paths, n);
+
+ found:
+    ints_cache__[slot].used = ++ints_cache_tick__;
+    return ints_cache__[slot].set;
+}
+
+int
+onlp_file_read_ints(const char** paths, int* values, int* status, int n)
+{
+    int rv;
+
+    if(paths == NULL || values == NULL || n <= 0) {
+        return ONLP_STATUS_E_PARAM;
+    }
+
+    pthread_mutex_lock(&ints_cache_lock__);
+    rv = onlp_file_ints_read(ints_cached__(paths, n), values, status);
+    pthread_mutex_unlock(&ints_cache_lock__);
+    return rv;
+}
+
 int
 onlp_file_read_int_max(int* value, char** files)
 {
-    char** s = NULL;
+    int i, n;
+    int rv = 0;
     int max = 0;
+    onlp_file_ints_t* set;
 
     if(value == NULL || files == NULL || *files == NULL) {
         return ONLP_STATUS_E_PARAM;
@@ -296,19 +515,28 @@ onlp_file_read_int_max(int* value, char** files)
 
     *value = 0;
 
-    for(s = files; *s; s++) {
-        int value = 0;
-        int rv = onlp_file_read_int(&value, *s);
-        if(rv < 0) {
-            return rv;
+    for(n = 0; files[n]; n++);
+
+    pthread_mutex_lock(&ints_cache_lock__);
+
+    set = ints_cached__((const char**)files, n);
+    for(i = 0; i < n; i++) {
+        int v = 0;
+        if((rv = ints_read__(set, i, &v)) < 0) {
+            break;
         }
-        if(max < value) {
-            max = value;
+        if(max < v) {
+            max = v;
         }
     }
 
-    *value = max;
-    return 0;
+    pthread_mutex_unlock(&ints_cache_lock__);
+
+    if(rv >= 0) {
+        *value = max;
+        rv = 0;
+    }
+    return rv;
 }
 
 int
@@ -318,6 +546,7 @@ onlp_file_vwrite(uint8_t* data, int len, const char* fmt, va_list vargs)
     char* fname = NULL;
     int rv;
     int wlen;
+    uint64_t start = ONLP_TRACE_START();
 
     if ((fd = vopen__(&fname, O_WRONLY, fmt, vargs)) < 0) {
         rv = fd;
@@ -332,6 +561,8 @@ onlp_file_vwrite(uint8_t* data, int len, const char* fmt, va_list vargs)
         }
         close(fd);
     }
+    onlp_trace_file(ONLP_TRACE_OP_FILE_WRITE, start, fname ? fname : fmt,
+                    data, len, rv);
     aim_free(fname);
     return rv;
 }
@@ -27,6 +27,7 @@
 #if ONLPLIB_CONFIG_INCLUDE_I2C == 1
 
 #include <onlplib/file.h>
+#include <onlplib/trace.h>
 #include <fcntl.h>
 #include <unistd.h>
 
@@ -84,9 +85,9 @@ onlp_i2c_open(int bus, uint8_t addr, uint32_t flags)
     return ONLP_STATUS_E_I2C;
 }
 
-int
-onlp_i2c_block_read(int bus, uint8_t addr, uint8_t offset, int size,
-                    uint8_t* rdata, uint32_t flags)
+static int
+i2c_block_read__(int bus, uint8_t addr, uint8_t offset, int size,
+                 uint8_t* rdata, uint32_t flags)
 {
     int fd;
 
@@ -136,8 +137,19 @@ onlp_i2c_block_read(int bus, uint8_t addr, uint8_t offset, int size,
 }
 
 int
-onlp_i2c_read(int bus, uint8_t addr, uint8_t offset, int size,
-              uint8_t* rdata, uint32_t flags)
+onlp_i2c_block_read(int bus, uint8_t addr, uint8_t offset, int size,
+                    uint8_t* rdata, uint32_t flags)
+{
+    uint64_t start = ONLP_TRACE_START();
+    int rv = i2c_block_read__(bus, addr, offset, size, rdata, flags);
+    onlp_trace_i2c(ONLP_TRACE_OP_I2C_BLOCK_READ, start, bus, addr, offset,
+                   size, rdata, rv);
+    return rv;
+}
+
+static int
+i2c_read__(int bus, uint8_t addr, uint8_t offset, int size,
+           uint8_t* rdata, uint32_t flags)
 {
     int i;
     int fd;
@@ -175,8 +187,19 @@ onlp_i2c_read(int bus, uint8_t addr, uint8_t offset, int size,
 
 
 int
-onlp_i2c_write(int bus, uint8_t addr, uint8_t offset, int size,
-               uint8_t* data, uint32_t flags)
+onlp_i2c_read(int bus, uint8_t addr, uint8_t offset, int size,
+              uint8_t* rdata, uint32_t flags)
+{
+    uint64_t start = ONLP_TRACE_START();
+    int rv = i2c_read__(bus, addr, offset, size, rdata, flags);
+    onlp_trace_i2c(ONLP_TRACE_OP_I2C_READ, start, bus, addr, offset,
+                   size, rdata, rv);
+    return rv;
+}
+
+static int
+i2c_write__(int bus, uint8_t addr, uint8_t offset, int size,
+            uint8_t* data, uint32_t flags)
 {
     int i;
     int fd;
@@ -203,6 +226,17 @@ onlp_i2c_write(int bus, uint8_t addr, uint8_t offset, int size,
     return ONLP_STATUS_E_I2C;
 }
 
+int
+onlp_i2c_write(int bus, uint8_t addr, uint8_t offset, int size,
+               uint8_t* data, uint32_t flags)
+{
+    uint64_t start = ONLP_TRACE_START();
+    int rv = i2c_write__(bus, addr, offset, size, data, flags);
+    onlp_trace_i2c(ONLP_TRACE_OP_I2C_WRITE, start, bus, addr, offset,
+                   size, data, rv);
+    return rv;
+}
+
 int
 onlp_i2c_readb(int bus, uint8_t addr, uint8_t offset, uint32_t flags)
 {
@@ -235,16 +269,23 @@ onlp_i2c_readw(int bus, uint8_t addr, uint8_t offset, uint32_t flags)
 {
     int fd;
     int rv;
+    uint64_t start = ONLP_TRACE_START();
 
     fd = onlp_i2c_open(bus, addr, flags);
 
     if(fd < 0) {
-        return fd;
+        rv = fd;
+    }
+    else {
+        rv = i2c_smbus_read_word_data(fd, offset);
+        close(fd);
     }
 
-    rv = i2c_smbus_read_word_data(fd, offset);
-
-    close(fd);
+    if(start) {
+        uint8_t word[2] = { rv & 0xFF, (rv >> 8) & 0xFF };
+        onlp_trace_i2c(ONLP_TRACE_OP_I2C_READW, start, bus, addr, offset,
+                       2, word, rv);
+    }
     return rv;
 }
 
@@ -255,17 +296,24 @@ onlp_i2c_writew(int bus, uint8_t addr, uint8_t offset, uint16_t word,
     int fd;
     int rv;
 
+    uint64_t start = ONLP_TRACE_START();
+
     fd = onlp_i2c_open(bus, addr, flags);
 
     if(fd < 0) {
-        return fd;
+        rv = fd;
+    }
+    else {
+        rv = i2c_smbus_write_word_data(fd, offset, word);
+        close(fd);
     }
 
-    rv = i2c_smbus_write_word_data(fd, offset, word);
-
-    close(fd);
+    if(start) {
+        uint8_t data[2] = { word & 0xFF, word >> 8 };
+        onlp_trace_i2c(ONLP_TRACE_OP_I2C_WRITEW, start, bus, addr, offset,
+                       2, data, rv);
+    }
     return rv;
-
 }
 
 int
@@ -0,0 +1,426 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ *
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ ************************************************************
+ *
+ * Deferred, rate-limited logging for platform management.
+ *
+ * The ring is a bounded multi-producer, single-consumer queue.
+ * Each slot carries a sequence number: a producer claims a slot
+ * by advancing the enqueue position and publishes it by setting
+ * the slot sequence to position + 1. The writer frees it by
+ * setting the sequence to position + ring size.
+ *
+ * Rate limiting and coalescing are done by the writer only, so
+ * the id table needs no locking.
+ *
+ ***********************************************************/
+#include <onlplib/logring.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include "onlplib_log.h"
+
+#define RING_MASK (ONLPLIB_CONFIG_LOGRING_SIZE - 1)
+
+#if (ONLPLIB_CONFIG_LOGRING_SIZE & RING_MASK) != 0
+#error "ONLPLIB_CONFIG_LOGRING_SIZE must be a power of 2"
+#endif
+
+/* Nice value of the writer thread. */
+#define WRITER_NICE 10
+
+typedef struct slot_s {
+    uint32_t seq;
+    const char* key;
+    const char* desc;
+    int instance;
+    uint8_t level;
+    uint8_t flags;
+    uint64_t time_ms;
+    char msg[ONLPLIB_CONFIG_LOGRING_MSG_MAX];
+} slot_t;
+
+typedef struct rate_s {
+    const char* key;
+    const char* desc;
+    int instance;
+    uint8_t level;
+    uint8_t flags;
+    uint64_t last_ms;
+    uint32_t repeated;
+    char msg[ONLPLIB_CONFIG_LOGRING_MSG_MAX];
+} rate_t;
+
+static slot_t ring__[ONLPLIB_CONFIG_LOGRING_SIZE];
+static uint32_t enqueue__;
+static uint32_t dequeue__;
+static uint32_t dropped__;
+static uint32_t dropped_reported__;
+
+/* Writer state */
+static rate_t rates__[ONLPLIB_CONFIG_LOGRING_IDS];
+static pthread_t thread__;
+static int eventfd__ = -1;
+static volatile int running__;
+static volatile int stopping__;
+
+static uint64_t
+now_ms__(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * Syslog messages are written with the name and description they
+ * were posted with. Messages posted without them use these.
+ */
+static void
+emit__(int level, int flags, const char* name, const char* desc,
+       const char* msg)
+{
+    if(flags & ONLP_LOGRING_F_SYSLOG) {
+        switch(level)
+            {
+            case ONLP_LOGRING_LEVEL_INFO:
+                AIM_SYSLOG_INFO(name ? name : "Platform <event>.",
+                                desc ? desc : "A platform management event.",
+                                "%s", msg);
+                break;
+            case ONLP_LOGRING_LEVEL_WARN:
+                AIM_SYSLOG_WARN(name ? name : "Platform <event>.",
+                                desc ? desc : "A platform management warning.",
+                                "%s", msg);
+                break;
+            case ONLP_LOGRING_LEVEL_ERROR:
+                AIM_SYSLOG_ERROR(name ? name : "Platform <event>.",
+                                 desc ? desc : "A platform management error.",
+                                 "%s", msg);
+                break;
+            default:
+                AIM_SYSLOG_CRIT(name ? name : "Platform <event>.",
+                                desc ? desc : "A critical platform management event.",
+                                "%s", msg);
+                break;
+            }
+        return;
+    }
+
+    switch(level)
+        {
+        case ONLP_LOGRING_LEVEL_INFO:
+            AIM_LOG_INFO("%s", msg);
+            break;
+        case ONLP_LOGRING_LEVEL_WARN:
+            AIM_LOG_WARN("%s", msg);
+            break;
+        default:
+            AIM_LOG_ERROR("%s", msg);
+            break;
+        }
+}
+
+static void
+emit_repeated__(rate_t* r)
+{
+    char msg[ONLPLIB_CONFIG_LOGRING_MSG_MAX + 32];
+    int len = strlen(r->msg);
+
+    /* Some messages carry their own line endings */
+    while(len && (r->msg[len-1] == '\n' || r->msg[len-1] == '\r')) {
+        len--;
+    }
+    snprintf(msg, sizeof(msg), "%.*s [repeated %u times]", len, r->msg, r->repeated);
+    emit__(r->level, r->flags, r->key, r->desc, msg);
+    r->repeated = 0;
+}
+
+/*
+ * Returns the rate entry for the id. An unused entry is taken first,
+ * then the least recently written one (its repeats are flushed).
+ */
+static rate_t*
+rate_get__(const char* key, int instance)
+{
+    int i;
+    rate_t* victim = rates__;
+
+    for(i = 0; i < AIM_ARRAYSIZE(rates__); i++) {
+        rate_t* r = rates__ + i;
+        if(r->key == key && r->instance == instance) {
+            return r;
+        }
+        if(victim->key && (r->key == NULL || r->last_ms < victim->last_ms)) {
+            victim = r;
+        }
+    }
+
+    if(victim->repeated) {
+        emit_repeated__(victim);
+    }
+    memset(victim, 0, sizeof(*victim));
+    victim->key = key;
+    victim->instance = instance;
+    return victim;
+}
+
+static void
+handle__(slot_t* s)
+{
+    int i;
+    rate_t* r;
+
+    if(s->key == NULL) {
+        emit__(s->level, s->flags, NULL, s->desc, s->msg);
+        return;
+    }
+
+    r = rate_get__(s->key, s->instance);
+
+    /*
+     * Only repeats of the same id are coalesced. Repeats still held
+     * for other messages about the same instance (a failure before
+     * this recovery, for example) are written first, so transitions
+     * of one object are never reordered.
+     */
+    for(i = 0; i < AIM_ARRAYSIZE(rates__); i++) {
+        rate_t* o = rates__ + i;
+        if(o != r && o->key && o->instance == s->instance && o->repeated) {
+            emit_repeated__(o);
+        }
+    }
+
+    if(r->last_ms && s->time_ms - r->last_ms < ONLPLIB_CONFIG_LOGRING_INTERVAL_MS) {
+        /* Coalesce, remembering the latest text */
+        r->repeated++;
+        r->level = s->level;
+        r->flags = s->flags;
+        r->desc = s->desc;
+        strcpy(r->msg, s->msg);
+        return;
+    }
+
+    if(r->repeated) {
+        emit_repeated__(r);
+    }
+    emit__(s->level, s->flags, s->key, s->desc, s->msg);
+    r->level = s->level;
+    r->flags = s->flags;
+    r->desc = s->desc;
+    r->last_ms = s->time_ms;
+    strcpy(r->msg, s->msg);
+}
+
+/*
+ * Write repeat counts whose interval has expired, or all of them,
+ * and report any messages lost to a full ring.
+ */
+static void
+flush__(int all)
+{
+    int i;
+    uint64_t now = now_ms__();
+    uint32_t dropped = __atomic_load_n(&dropped__, __ATOMIC_RELAXED);
+
+    if(dropped != dropped_reported__) {
+        AIM_LOG_WARN("logring: %u messages dropped", dropped - dropped_reported__);
+        dropped_reported__ = dropped;
+    }
+
+    for(i = 0; i < AIM_ARRAYSIZE(rates__); i++) {
+        rate_t* r = rates__ + i;
+        if(r->repeated &&
+           (all || now - r->last_ms >= ONLPLIB_CONFIG_LOGRING_INTERVAL_MS)) {
+            emit_repeated__(r);
+            r->last_ms = now;
+        }
+    }
+}
+
+static void
+drain__(void)
+{
+    for(;;) {
+        slot_t* s = ring__ + (dequeue__ & RING_MASK);
+        if(__atomic_load_n(&s->seq, __ATOMIC_ACQUIRE) != dequeue__ + 1) {
+            break;
+        }
+        handle__(s);
+        __atomic_store_n(&s->seq, dequeue__ + ONLPLIB_CONFIG_LOGRING_SIZE,
+                         __ATOMIC_RELEASE);
+        dequeue__++;
+    }
+}
+
+static void*
+writer__(void* arg)
+{
+    struct pollfd pfd;
+    uint64_t count;
+
+    prctl(PR_SET_NAME, "onlp.logring", 0, 0, 0);
+    /* Logging must not compete with platform management. */
+    setpriority(PRIO_PROCESS, syscall(SYS_gettid), WRITER_NICE);
+
+    pfd.fd = eventfd__;
+    pfd.events = POLLIN;
+
+    while(!stopping__) {
+        if(poll(&pfd, 1, 1000) > 0) {
+            if(read(eventfd__, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+                AIM_LOG_ERROR("logring: eventfd read failed: %{errno}", errno);
+            }
+        }
+        drain__();
+        flush__(0);
+    }
+    return NULL;
+}
+
+void
+onlp_logring_post(const char* key, const char* desc, int instance,
+                  onlp_logring_level_t level, int flags,
+                  const char* fmt, ...)
+{
+    va_list vargs;
+    uint32_t pos;
+    slot_t* s;
+
+    if(!__atomic_load_n(&running__, __ATOMIC_ACQUIRE)) {
+        char msg[ONLPLIB_CONFIG_LOGRING_MSG_MAX];
+        va_start(vargs, fmt);
+        vsnprintf(msg, sizeof(msg), fmt, vargs);
+        va_end(vargs);
+        emit__(level, flags, key, desc, msg);
+        return;
+    }
+
+    pos = __atomic_load_n(&enqueue__, __ATOMIC_RELAXED);
+    for(;;) {
+        int32_t diff;
+        s = ring__ + (pos & RING_MASK);
+        diff = (int32_t)(__atomic_load_n(&s->seq, __ATOMIC_ACQUIRE) - pos);
+        if(diff == 0) {
+            if(__atomic_compare_exchange_n(&enqueue__, &pos, pos + 1, 1,
+                                           __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        }
+        else if(diff < 0) {
+            /* Full */
+            __atomic_add_fetch(&dropped__, 1, __ATOMIC_RELAXED);
+            return;
+        }
+        else {
+            pos = __atomic_load_n(&enqueue__, __ATOMIC_RELAXED);
+        }
+    }
+
+    s->key = key;
+    s->desc = desc;
+    s->instance = instance;
+    s->level = level;
+    s->flags = flags;
+    s->time_ms = now_ms__();
+    va_start(vargs, fmt);
+    vsnprintf(s->msg, sizeof(s->msg), fmt, vargs);
+    va_end(vargs);
+    __atomic_store_n(&s->seq, pos + 1, __ATOMIC_RELEASE);
+
+    if(eventfd__ >= 0) {
+        uint64_t one = 1;
+        /* Non-blocking; a full counter already means a wakeup is pending. */
+        if(write(eventfd__, &one, sizeof(one)) < 0) {
+            /* Ignored */
+        }
+    }
+}
+
+uint32_t
+onlp_logring_dropped(void)
+{
+    return __atomic_load_n(&dropped__, __ATOMIC_RELAXED);
+}
+
+int
+onlp_logring_start(void)
+{
+    uint32_t i;
+
+    if(running__) {
+        return 0;
+    }
+
+    if((eventfd__ = eventfd(0, EFD_NONBLOCK)) < 0) {
+        AIM_LOG_ERROR("logring: eventfd create failed: %{errno}", errno);
+        return -1;
+    }
+
+    for(i = 0; i < ONLPLIB_CONFIG_LOGRING_SIZE; i++) {
+        ring__[i].seq = i;
+    }
+    enqueue__ = dequeue__ = 0;
+    stopping__ = 0;
+
+    if(pthread_create(&thread__, NULL, writer__, NULL) != 0) {
+        AIM_LOG_ERROR("logring: pthread create failed.");
+        close(eventfd__);
+        eventfd__ = -1;
+        return -1;
+    }
+
+    __atomic_store_n(&running__, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void
+onlp_logring_stop(void)
+{
+    uint64_t one = 1;
+
+    if(!running__) {
+        return;
+    }
+
+    /* New messages are logged directly from here on. */
+    __atomic_store_n(&running__, 0, __ATOMIC_RELEASE);
+    stopping__ = 1;
+    if(write(eventfd__, &one, sizeof(one)) < 0) {
+        AIM_LOG_ERROR("logring: eventfd write failed: %{errno}", errno);
+    }
+    pthread_join(thread__, NULL);
+
+    /* Anything posted while stopping */
+    drain__();
+    flush__(1);
+
+    close(eventfd__);
+    eventfd__ = -1;
+}
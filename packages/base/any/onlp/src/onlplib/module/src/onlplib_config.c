@@ -89,6 +89,36 @@ onlplib_config_settings_t onlplib_config_settings[] =
     { __onlplib_config_STRINGIFY_NAME(ONLPLIB_CONFIG_INCLUDE_I2C_SMBUS), __onlplib_config_STRINGIFY_VALUE(ONLPLIB_CONFIG_INCLUDE_I2C_SMBUS) },
 #else
 { ONLPLIB_CONFIG_INCLUDE_I2C_SMBUS(__onlplib_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLPLIB_CONFIG_TRACE_DATA_MAX
+    { __onlplib_config_STRINGIFY_NAME(ONLPLIB_CONFIG_TRACE_DATA_MAX), __onlplib_config_STRINGIFY_VALUE(ONLPLIB_CONFIG_TRACE_DATA_MAX) },
+#else
+{ ONLPLIB_CONFIG_TRACE_DATA_MAX(__onlplib_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLPLIB_CONFIG_TRACE_RING_SIZE
+    { __onlplib_config_STRINGIFY_NAME(ONLPLIB_CONFIG_TRACE_RING_SIZE), __onlplib_config_STRINGIFY_VALUE(ONLPLIB_CONFIG_TRACE_RING_SIZE) },
+#else
+{ ONLPLIB_CONFIG_TRACE_RING_SIZE(__onlplib_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLPLIB_CONFIG_LOGRING_SIZE
+    { __onlplib_config_STRINGIFY_NAME(ONLPLIB_CONFIG_LOGRING_SIZE), __onlplib_config_STRINGIFY_VALUE(ONLPLIB_CONFIG_LOGRING_SIZE) },
+#else
+{ ONLPLIB_CONFIG_LOGRING_SIZE(__onlplib_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLPLIB_CONFIG_LOGRING_MSG_MAX
+    { __onlplib_config_STRINGIFY_NAME(ONLPLIB_CONFIG_LOGRING_MSG_MAX), __onlplib_config_STRINGIFY_VALUE(ONLPLIB_CONFIG_LOGRING_MSG_MAX) },
+#else
+{ ONLPLIB_CONFIG_LOGRING_MSG_MAX(__onlplib_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLPLIB_CONFIG_LOGRING_IDS
+    { __onlplib_config_STRINGIFY_NAME(ONLPLIB_CONFIG_LOGRING_IDS), __onlplib_config_STRINGIFY_VALUE(ONLPLIB_CONFIG_LOGRING_IDS) },
+#else
+{ ONLPLIB_CONFIG_LOGRING_IDS(__onlplib_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLPLIB_CONFIG_LOGRING_INTERVAL_MS
+    { __onlplib_config_STRINGIFY_NAME(ONLPLIB_CONFIG_LOGRING_INTERVAL_MS), __onlplib_config_STRINGIFY_VALUE(ONLPLIB_CONFIG_LOGRING_INTERVAL_MS) },
+#else
+{ ONLPLIB_CONFIG_LOGRING_INTERVAL_MS(__onlplib_config_STRINGIFY_NAME), "__undefined__" },
 #endif
     { NULL, NULL }
 };
@@ -24,6 +24,7 @@
  ***********************************************************/
 
 #include <onlplib/onlplib_config.h>
+#include <onlplib/trace.h>
 
 #include "onlplib_log.h"
 
@@ -39,5 +40,6 @@ void __onlplib_module_init__(void)
 {
     AIM_LOG_STRUCT_REGISTER();
     datatypes_init__();
+    onlp_trace_env_init();
 }
 
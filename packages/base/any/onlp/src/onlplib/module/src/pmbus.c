@@ -0,0 +1,358 @@
+/**************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ *
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ **************************************************************
+ *
+ * Common PMBus PSU telemetry support.
+ *
+ ************************************************************/
+#include <onlplib/pmbus.h>
+#include <onlplib/i2c.h>
+#include <onlp/onlp.h>
+#include <AIM/aim_time.h>
+#include <unistd.h>
+#include "onlplib_log.h"
+
+typedef enum pmbus_format_e {
+    PMBUS_FORMAT_LINEAR11,
+    PMBUS_FORMAT_LINEAR16,
+    PMBUS_FORMAT_RAW,
+} pmbus_format_t;
+
+typedef struct pmbus_command_s {
+    uint8_t command;
+    pmbus_format_t format;
+    int scale;
+} pmbus_command_t;
+
+/* Indexed by onlp_pmbus_field_t */
+static const pmbus_command_t pmbus_commands__[ONLP_PMBUS_FIELD_COUNT] = {
+    { ONLP_PMBUS_CMD_READ_VIN, PMBUS_FORMAT_LINEAR11, 1000 },
+    { ONLP_PMBUS_CMD_READ_IIN, PMBUS_FORMAT_LINEAR11, 1000 },
+    { ONLP_PMBUS_CMD_READ_VOUT, PMBUS_FORMAT_LINEAR16, 1000 },
+    { ONLP_PMBUS_CMD_READ_IOUT, PMBUS_FORMAT_LINEAR11, 1000 },
+    { ONLP_PMBUS_CMD_READ_PIN, PMBUS_FORMAT_LINEAR11, 1000 },
+    { ONLP_PMBUS_CMD_READ_POUT, PMBUS_FORMAT_LINEAR11, 1000 },
+    { ONLP_PMBUS_CMD_READ_TEMPERATURE_1, PMBUS_FORMAT_LINEAR11, 1000 },
+    { ONLP_PMBUS_CMD_READ_TEMPERATURE_2, PMBUS_FORMAT_LINEAR11, 1000 },
+    { ONLP_PMBUS_CMD_READ_TEMPERATURE_3, PMBUS_FORMAT_LINEAR11, 1000 },
+    { ONLP_PMBUS_CMD_READ_FAN_SPEED_1, PMBUS_FORMAT_LINEAR11, 1 },
+    { ONLP_PMBUS_CMD_READ_FAN_SPEED_2, PMBUS_FORMAT_LINEAR11, 1 },
+    { ONLP_PMBUS_CMD_STATUS_WORD, PMBUS_FORMAT_RAW, 1 },
+};
+
+struct onlp_pmbus_session_s {
+    onlp_pmbus_ops_t ops;
+    void* cookie;
+    /* The cookie was allocated by us. */
+    int free_cookie;
+    uint32_t fields;
+    int ttl_ms;
+
+    int vout_mode_valid;
+    uint8_t vout_mode;
+
+    int mfr_valid;
+    onlp_pmbus_mfr_t mfr;
+
+    /* Monotonic time of the last refresh, 0 if none. */
+    uint64_t updated;
+    int status;
+    onlp_pmbus_readings_t readings;
+};
+
+static int
+scale_exponent__(int64_t value, int exponent)
+{
+    if(exponent >= 0) {
+        value <<= exponent;
+    }
+    else {
+        value /= ((int64_t)1 << -exponent);
+    }
+    return (int)value;
+}
+
+int
+onlp_pmbus_linear11_decode(uint16_t raw, int scale)
+{
+    /* 5 bit two's complement exponent, 11 bit two's complement mantissa */
+    int exponent = ((int16_t)raw) >> 11;
+    int mantissa = ((int16_t)(raw << 5)) >> 5;
+    return scale_exponent__((int64_t)mantissa * scale, exponent);
+}
+
+int
+onlp_pmbus_linear16_decode(uint16_t raw, uint8_t vout_mode, int scale)
+{
+    /* The exponent is the 5 bit two's complement field of VOUT_MODE */
+    int exponent = ((int8_t)(vout_mode << 3)) >> 3;
+    return scale_exponent__((int64_t)raw * scale, exponent);
+}
+
+onlp_pmbus_session_t*
+onlp_pmbus_session_create(const onlp_pmbus_ops_t* ops, void* cookie,
+                          uint32_t fields, int ttl_ms)
+{
+    onlp_pmbus_session_t* session;
+
+    if(ops == NULL || ops->readw == NULL) {
+        return NULL;
+    }
+
+    session = aim_zmalloc(sizeof(*session));
+    session->ops = *ops;
+    session->cookie = cookie;
+    session->fields = fields;
+    session->ttl_ms = ttl_ms;
+    return session;
+}
+
+void
+onlp_pmbus_session_destroy(onlp_pmbus_session_t* session)
+{
+    if(session == NULL) {
+        return;
+    }
+    if(session->free_cookie) {
+        aim_free(session->cookie);
+    }
+    aim_free(session);
+}
+
+void
+onlp_pmbus_session_ttl_set(onlp_pmbus_session_t* session, int ttl_ms)
+{
+    session->ttl_ms = ttl_ms;
+}
+
+void
+onlp_pmbus_session_invalidate(onlp_pmbus_session_t* session)
+{
+    session->vout_mode_valid = 0;
+    session->mfr_valid = 0;
+    session->updated = 0;
+}
+
+static int
+pmbus_refresh__(onlp_pmbus_session_t* session)
+{
+    onlp_pmbus_readings_t* r = &session->readings;
+    int rv = ONLP_STATUS_OK;
+    int f;
+
+    r->valid = 0;
+
+    if((session->fields & ONLP_PMBUS_FIELD_MASK(ONLP_PMBUS_FIELD_VOUT)) &&
+       !session->vout_mode_valid) {
+        int mode = session->ops.readb ?
+            session->ops.readb(session->cookie, ONLP_PMBUS_CMD_VOUT_MODE) : -1;
+        if(mode >= 0) {
+            session->vout_mode = mode;
+            session->vout_mode_valid = 1;
+        }
+    }
+
+    for(f = 0; f < ONLP_PMBUS_FIELD_COUNT; f++) {
+        const pmbus_command_t* c = pmbus_commands__ + f;
+        int raw;
+
+        if(!(session->fields & ONLP_PMBUS_FIELD_MASK(f))) {
+            continue;
+        }
+
+        if(c->format == PMBUS_FORMAT_LINEAR16 && !session->vout_mode_valid) {
+            rv = ONLP_STATUS_E_I2C;
+            continue;
+        }
+
+        if((raw = session->ops.readw(session->cookie, c->command)) < 0) {
+            rv = ONLP_STATUS_E_I2C;
+            continue;
+        }
+
+        switch(c->format)
+            {
+            case PMBUS_FORMAT_LINEAR11:
+                r->values[f] = onlp_pmbus_linear11_decode(raw, c->scale);
+                break;
+            case PMBUS_FORMAT_LINEAR16:
+                r->values[f] = onlp_pmbus_linear16_decode(raw, session->vout_mode,
+                                                          c->scale);
+                break;
+            case PMBUS_FORMAT_RAW:
+                r->values[f] = raw;
+                break;
+            }
+        r->valid |= ONLP_PMBUS_FIELD_MASK(f);
+    }
+
+    if(rv < 0) {
+        /* The device may have been replaced. Reload static data next time. */
+        session->vout_mode_valid = 0;
+        session->mfr_valid = 0;
+    }
+
+    return rv;
+}
+
+int
+onlp_pmbus_readings_get(onlp_pmbus_session_t* session,
+                        onlp_pmbus_readings_t* readings)
+{
+    uint64_t now = aim_time_monotonic();
+
+    if(session->updated == 0 || session->ttl_ms <= 0 ||
+       now - session->updated >= (uint64_t)session->ttl_ms * 1000) {
+        session->status = pmbus_refresh__(session);
+        /* Failed refreshes are retried on the next request. */
+        session->updated = (session->status < 0) ? 0 : now;
+    }
+
+    if(readings) {
+        *readings = session->readings;
+    }
+    return session->status;
+}
+
+static int
+pmbus_mfr_string__(onlp_pmbus_session_t* session, uint8_t command,
+                   char* dst, int size)
+{
+    int len = session->ops.block_read(session->cookie, command,
+                                      (uint8_t*)dst, size - 1);
+    if(len < 0) {
+        return len;
+    }
+    if(len > size - 1) {
+        len = size - 1;
+    }
+    dst[len] = 0;
+    return 0;
+}
+
+int
+onlp_pmbus_mfr_get(onlp_pmbus_session_t* session, onlp_pmbus_mfr_t* mfr)
+{
+    if(!session->mfr_valid) {
+        onlp_pmbus_mfr_t* m = &session->mfr;
+
+        if(session->ops.block_read == NULL) {
+            return ONLP_STATUS_E_UNSUPPORTED;
+        }
+
+        ONLPLIB_MEMSET(m, 0, sizeof(*m));
+        /* Model and serial are required, id and revision are optional. */
+        if(pmbus_mfr_string__(session, ONLP_PMBUS_CMD_MFR_MODEL,
+                              m->model, sizeof(m->model)) < 0 ||
+           pmbus_mfr_string__(session, ONLP_PMBUS_CMD_MFR_SERIAL,
+                              m->serial, sizeof(m->serial)) < 0) {
+            return ONLP_STATUS_E_I2C;
+        }
+        pmbus_mfr_string__(session, ONLP_PMBUS_CMD_MFR_ID,
+                           m->id, sizeof(m->id));
+        pmbus_mfr_string__(session, ONLP_PMBUS_CMD_MFR_REVISION,
+                           m->revision, sizeof(m->revision));
+        session->mfr_valid = 1;
+    }
+
+    if(mfr) {
+        *mfr = session->mfr;
+    }
+    return ONLP_STATUS_OK;
+}
+
+#if ONLPLIB_CONFIG_INCLUDE_I2C == 1
+
+/* SMBus block transfers carry at most 32 bytes */
+#define PMBUS_BLOCK_MAX 32
+
+typedef struct pmbus_i2c_s {
+    int bus;
+    uint8_t addr;
+} pmbus_i2c_t;
+
+static int
+pmbus_i2c_readb__(void* cookie, uint8_t command)
+{
+    pmbus_i2c_t* dev = cookie;
+    return onlp_i2c_readb(dev->bus, dev->addr, command, 0);
+}
+
+static int
+pmbus_i2c_readw__(void* cookie, uint8_t command)
+{
+    pmbus_i2c_t* dev = cookie;
+    return onlp_i2c_readw(dev->bus, dev->addr, command, 0);
+}
+
+static int
+pmbus_i2c_block_read__(void* cookie, uint8_t command, uint8_t* data, int max)
+{
+    pmbus_i2c_t* dev = cookie;
+    uint8_t block[PMBUS_BLOCK_MAX];
+    int fd;
+    int count;
+
+    if((fd = onlp_i2c_open(dev->bus, dev->addr, 0)) < 0) {
+        return fd;
+    }
+    /* A single SMBus block read, the adapter consumes the count byte */
+    count = i2c_smbus_read_block_data(fd, command, block);
+    close(fd);
+
+    if(count < 0) {
+        return ONLP_STATUS_E_I2C;
+    }
+    if(count > PMBUS_BLOCK_MAX) {
+        count = PMBUS_BLOCK_MAX;
+    }
+    if(count > max) {
+        count = max;
+    }
+    ONLPLIB_MEMCPY(data, block, count);
+    return count;
+}
+
+static const onlp_pmbus_ops_t pmbus_i2c_ops__ = {
+    pmbus_i2c_readb__,
+    pmbus_i2c_readw__,
+    pmbus_i2c_block_read__,
+};
+
+onlp_pmbus_session_t*
+onlp_pmbus_i2c_session_create(int bus, uint8_t addr, uint32_t fields,
+                              int ttl_ms)
+{
+    onlp_pmbus_session_t* session;
+    pmbus_i2c_t* dev = aim_zmalloc(sizeof(*dev));
+
+    dev->bus = bus;
+    dev->addr = addr;
+    session = onlp_pmbus_session_create(&pmbus_i2c_ops__, dev, fields, ttl_ms);
+    if(session == NULL) {
+        aim_free(dev);
+    }
+    else {
+        session->free_cookie = 1;
+    }
+    return session;
+}
+
+#endif /* ONLPLIB_CONFIG_INCLUDE_I2C */
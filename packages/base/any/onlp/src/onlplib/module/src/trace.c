@@ -0,0 +1,593 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ *
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ ************************************************************
+ *
+ * I2C and file access tracing.
+ *
+ * The recorders must not use the onlp_file_* or onlp_i2c_*
+ * routines themselves. All output goes through stdio.
+ *
+ ***********************************************************/
+#include <onlplib/trace.h>
+#include <onlp/onlp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include "onlplib_log.h"
+
+volatile int onlp_trace_active;
+
+static pthread_mutex_t lock__ = PTHREAD_MUTEX_INITIALIZER;
+
+static char* path__;
+
+/* Streaming mode */
+static FILE* fp__;
+
+/* Ring mode */
+static uint8_t* ring__;
+static uint32_t ring_size__;
+static uint32_t head__;
+static uint32_t tail__;
+static uint32_t used__;
+static uint32_t dropped__;
+
+/*
+ * Interned paths. strings__[id] is the path for id, starting at 1.
+ * The hash table holds ids and is kept at most half full.
+ */
+static char** strings__;
+static uint32_t string_count__;
+static uint32_t string_max__;
+static uint32_t* hash__;
+static uint32_t hash_size__;
+
+static const char* op_names__[ONLP_TRACE_OP_COUNT] = {
+    "string",
+    "i2c_read",
+    "i2c_block_read",
+    "i2c_write",
+    "i2c_readw",
+    "i2c_writew",
+    "file_read",
+    "file_write",
+};
+
+const char*
+onlp_trace_op_name(onlp_trace_op_t op)
+{
+    return (op < ONLP_TRACE_OP_COUNT) ? op_names__[op] : "unknown";
+}
+
+uint64_t
+onlp_trace_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint32_t
+hash_string__(const char* s)
+{
+    /* FNV-1a */
+    uint32_t h = 2166136261U;
+    while(*s) {
+        h ^= (uint8_t)*s++;
+        h *= 16777619U;
+    }
+    return h;
+}
+
+static void
+strings_clear__(void)
+{
+    uint32_t i;
+    for(i = 1; i <= string_count__; i++) {
+        aim_free(strings__[i]);
+    }
+    aim_free(strings__);
+    aim_free(hash__);
+    strings__ = NULL;
+    hash__ = NULL;
+    string_count__ = string_max__ = hash_size__ = 0;
+}
+
+static void
+hash_insert__(uint32_t id)
+{
+    uint32_t i = hash_string__(strings__[id]) & (hash_size__ - 1);
+    while(hash__[i]) {
+        i = (i + 1) & (hash_size__ - 1);
+    }
+    hash__[i] = id;
+}
+
+static void
+write__(const void* data, int size)
+{
+    if(size && fwrite(data, size, 1, fp__) != 1) {
+        AIM_LOG_ERROR("trace: writing %s failed: %{errno}", path__, errno);
+    }
+}
+
+/*
+ * Returns the id for the path, defining it if necessary.
+ * Called with the lock held.
+ */
+static uint32_t
+intern__(const char* path)
+{
+    uint32_t i, id;
+
+    if(hash_size__) {
+        i = hash_string__(path) & (hash_size__ - 1);
+        while((id = hash__[i]) != 0) {
+            if(!strcmp(strings__[id], path)) {
+                return id;
+            }
+            i = (i + 1) & (hash_size__ - 1);
+        }
+    }
+
+    if(string_count__ + 1 >= string_max__) {
+        string_max__ = string_max__ ? string_max__ * 2 : 64;
+        strings__ = aim_realloc(strings__, string_max__ * sizeof(*strings__));
+    }
+    id = ++string_count__;
+    strings__[id] = aim_strdup(path);
+
+    if(string_count__ * 2 >= hash_size__) {
+        aim_free(hash__);
+        hash_size__ = hash_size__ ? hash_size__ * 2 : 128;
+        hash__ = aim_zmalloc(hash_size__ * sizeof(*hash__));
+        for(i = 1; i <= string_count__; i++) {
+            hash_insert__(i);
+        }
+    }
+    else {
+        hash_insert__(id);
+    }
+
+    if(ring__ == NULL) {
+        /* Streaming. Define the string before its first use. */
+        onlp_trace_record_t r;
+        ONLPLIB_MEMSET(&r, 0, sizeof(r));
+        r.op = ONLP_TRACE_OP_STRING;
+        r.id = id;
+        r.size = strlen(path);
+        r.length = r.size;
+        write__(&r, sizeof(r));
+        write__(path, r.size);
+    }
+
+    return id;
+}
+
+static void
+ring_copy_in__(const void* src, uint32_t size)
+{
+    uint32_t first = ring_size__ - head__;
+    if(first > size) {
+        first = size;
+    }
+    ONLPLIB_MEMCPY(ring__ + head__, src, first);
+    ONLPLIB_MEMCPY(ring__, (const uint8_t*)src + first, size - first);
+    head__ = (head__ + size) % ring_size__;
+    used__ += size;
+}
+
+static void
+ring_copy_out__(void* dst, uint32_t from, uint32_t size)
+{
+    uint32_t first = ring_size__ - from;
+    if(first > size) {
+        first = size;
+    }
+    ONLPLIB_MEMCPY(dst, ring__ + from, first);
+    ONLPLIB_MEMCPY((uint8_t*)dst + first, ring__, size - first);
+}
+
+static void
+ring_put__(const onlp_trace_record_t* r, const uint8_t* data)
+{
+    uint32_t need = sizeof(*r) + r->size;
+
+    if(need > ring_size__) {
+        dropped__++;
+        return;
+    }
+
+    /* Drop the oldest records until the new one fits. */
+    while(ring_size__ - used__ < need) {
+        onlp_trace_record_t old;
+        uint32_t size;
+        ring_copy_out__(&old, tail__, sizeof(old));
+        size = sizeof(old) + old.size;
+        tail__ = (tail__ + size) % ring_size__;
+        used__ -= size;
+        dropped__++;
+    }
+
+    ring_copy_in__(r, sizeof(*r));
+    ring_copy_in__(data, r->size);
+}
+
+static void
+record__(onlp_trace_op_t op, uint64_t start, const char* path, int bus,
+         uint8_t addr, uint16_t offset, int length, const uint8_t* data,
+         int rv)
+{
+    onlp_trace_record_t r;
+    uint64_t duration = onlp_trace_now() - start;
+
+    ONLPLIB_MEMSET(&r, 0, sizeof(r));
+    r.op = op;
+    r.addr = addr;
+    r.start_ns = start;
+    r.duration_ns = (duration > UINT32_MAX) ? UINT32_MAX : duration;
+    r.rv = rv;
+    r.bus = bus;
+    r.offset = offset;
+    r.length = (length < 0) ? 0 : length;
+
+    /* Only data that was actually transferred is captured. */
+    if(data && length > 0 && rv >= 0) {
+        r.size = (length > ONLPLIB_CONFIG_TRACE_DATA_MAX) ?
+            ONLPLIB_CONFIG_TRACE_DATA_MAX : length;
+    }
+
+    pthread_mutex_lock(&lock__);
+    if(onlp_trace_active) {
+        if(path) {
+            r.id = intern__(path);
+        }
+        if(ring__) {
+            ring_put__(&r, data);
+        }
+        else {
+            write__(&r, sizeof(r));
+            write__(data, r.size);
+        }
+    }
+    pthread_mutex_unlock(&lock__);
+}
+
+void
+onlp_trace_i2c(onlp_trace_op_t op, uint64_t start, int bus,
+               uint8_t addr, uint16_t offset, int length,
+               const uint8_t* data, int rv)
+{
+    if(start) {
+        record__(op, start, NULL, bus, addr, offset, length, data, rv);
+    }
+}
+
+void
+onlp_trace_file(onlp_trace_op_t op, uint64_t start, const char* path,
+                const uint8_t* data, int length, int rv)
+{
+    if(start) {
+        record__(op, start, path ? path : "", -1, 0, 0, length, data, rv);
+    }
+}
+
+static void
+header_write__(void)
+{
+    onlp_trace_file_header_t h;
+    ONLPLIB_MEMSET(&h, 0, sizeof(h));
+    h.magic = ONLP_TRACE_MAGIC;
+    h.version = ONLP_TRACE_VERSION;
+    h.record_size = sizeof(onlp_trace_record_t);
+    h.dropped = dropped__;
+    write__(&h, sizeof(h));
+}
+
+/*
+ * Write the interned strings and the ring contents, oldest first.
+ * Called with the lock held.
+ */
+static int
+ring_write__(const char* path)
+{
+    FILE* save = fp__;
+    const char* save_path = path__;
+    uint32_t i, first;
+    int rv = 0;
+
+    if((fp__ = fopen(path, "w")) == NULL) {
+        AIM_LOG_ERROR("trace: open(%s): %{errno}", path, errno);
+        fp__ = save;
+        return ONLP_STATUS_E_INTERNAL;
+    }
+    path__ = (char*)path;
+
+    header_write__();
+    for(i = 1; i <= string_count__; i++) {
+        onlp_trace_record_t r;
+        ONLPLIB_MEMSET(&r, 0, sizeof(r));
+        r.op = ONLP_TRACE_OP_STRING;
+        r.id = i;
+        r.size = strlen(strings__[i]);
+        r.length = r.size;
+        write__(&r, sizeof(r));
+        write__(strings__[i], r.size);
+    }
+
+    first = ring_size__ - tail__;
+    if(first > used__) {
+        first = used__;
+    }
+    write__(ring__ + tail__, first);
+    write__(ring__, used__ - first);
+
+    if(fclose(fp__) != 0) {
+        rv = ONLP_STATUS_E_INTERNAL;
+    }
+    fp__ = save;
+    path__ = (char*)save_path;
+    return rv;
+}
+
+int
+onlp_trace_start(const char* path, int ring_bytes)
+{
+    int rv = ONLP_STATUS_OK;
+
+    if(path == NULL || ring_bytes < 0) {
+        return ONLP_STATUS_E_PARAM;
+    }
+
+    pthread_mutex_lock(&lock__);
+
+    if(onlp_trace_active) {
+        AIM_LOG_ERROR("trace: already tracing to %s", path__);
+        rv = ONLP_STATUS_E_PARAM;
+        goto done;
+    }
+
+    dropped__ = head__ = tail__ = used__ = 0;
+
+    if(ring_bytes == 0) {
+        if((fp__ = fopen(path, "w")) == NULL) {
+            AIM_LOG_ERROR("trace: open(%s): %{errno}", path, errno);
+            rv = ONLP_STATUS_E_INTERNAL;
+            goto done;
+        }
+        path__ = aim_strdup(path);
+        header_write__();
+    }
+    else {
+        /* Always room for at least one maximum sized record. */
+        if(ring_bytes < 2*(sizeof(onlp_trace_record_t) + ONLPLIB_CONFIG_TRACE_DATA_MAX)) {
+            ring_bytes = 2*(sizeof(onlp_trace_record_t) + ONLPLIB_CONFIG_TRACE_DATA_MAX);
+        }
+        ring__ = aim_zmalloc(ring_bytes);
+        ring_size__ = ring_bytes;
+        path__ = aim_strdup(path);
+    }
+
+    onlp_trace_active = 1;
+
+ done:
+    pthread_mutex_unlock(&lock__);
+    return rv;
+}
+
+int
+onlp_trace_dump(const char* path)
+{
+    int rv = ONLP_STATUS_OK;
+
+    pthread_mutex_lock(&lock__);
+    if(!onlp_trace_active) {
+        rv = ONLP_STATUS_E_PARAM;
+    }
+    else if(ring__) {
+        rv = ring_write__(path ? path : path__);
+    }
+    else if(fflush(fp__) != 0) {
+        rv = ONLP_STATUS_E_INTERNAL;
+    }
+    pthread_mutex_unlock(&lock__);
+    return rv;
+}
+
+int
+onlp_trace_stop(void)
+{
+    int rv = ONLP_STATUS_OK;
+
+    pthread_mutex_lock(&lock__);
+    if(!onlp_trace_active) {
+        pthread_mutex_unlock(&lock__);
+        return ONLP_STATUS_OK;
+    }
+    onlp_trace_active = 0;
+
+    if(ring__) {
+        rv = ring_write__(path__);
+        aim_free(ring__);
+        ring__ = NULL;
+        ring_size__ = 0;
+    }
+    else {
+        if(fclose(fp__) != 0) {
+            AIM_LOG_ERROR("trace: writing %s failed: %{errno}", path__, errno);
+            rv = ONLP_STATUS_E_INTERNAL;
+        }
+        fp__ = NULL;
+    }
+
+    if(dropped__) {
+        AIM_LOG_WARN("trace: %u records were dropped from %s", dropped__, path__);
+    }
+
+    aim_free(path__);
+    path__ = NULL;
+    strings_clear__();
+    pthread_mutex_unlock(&lock__);
+    return rv;
+}
+
+static void
+trace_atexit__(void)
+{
+    onlp_trace_stop();
+}
+
+void
+onlp_trace_env_init(void)
+{
+    char* env = getenv("ONLP_TRACE");
+    char* path;
+    char* size;
+    int ring_bytes = ONLPLIB_CONFIG_TRACE_RING_SIZE;
+
+    if(env == NULL || *env == 0) {
+        return;
+    }
+
+    path = aim_strdup(env);
+    if((size = strrchr(path, ':')) != NULL) {
+        *size++ = 0;
+        ring_bytes = atoi(size);
+    }
+
+    if(onlp_trace_start(path, ring_bytes) >= 0) {
+        atexit(trace_atexit__);
+    }
+    aim_free(path);
+}
+
+
+/*
+ * Trace file reader.
+ */
+struct onlp_trace_reader_s {
+    FILE* fp;
+    char** strings;
+    uint32_t string_max;
+    uint8_t* data;
+    uint32_t data_max;
+};
+
+onlp_trace_reader_t*
+onlp_trace_reader_open(const char* path, onlp_trace_file_header_t* header)
+{
+    onlp_trace_reader_t* reader;
+    onlp_trace_file_header_t h;
+    FILE* fp;
+
+    if((fp = fopen(path, "r")) == NULL) {
+        AIM_LOG_ERROR("trace: open(%s): %{errno}", path, errno);
+        return NULL;
+    }
+
+    if(fread(&h, sizeof(h), 1, fp) != 1 ||
+       h.magic != ONLP_TRACE_MAGIC) {
+        AIM_LOG_ERROR("trace: %s is not a trace file.", path);
+        fclose(fp);
+        return NULL;
+    }
+    if(h.version != ONLP_TRACE_VERSION ||
+       h.record_size != sizeof(onlp_trace_record_t)) {
+        AIM_LOG_ERROR("trace: %s: unsupported version %d.", path, h.version);
+        fclose(fp);
+        return NULL;
+    }
+
+    reader = aim_zmalloc(sizeof(*reader));
+    reader->fp = fp;
+    if(header) {
+        *header = h;
+    }
+    return reader;
+}
+
+int
+onlp_trace_reader_next(onlp_trace_reader_t* reader,
+                       onlp_trace_record_t* record,
+                       const uint8_t** data, const char** path)
+{
+    for(;;) {
+        if(fread(record, sizeof(*record), 1, reader->fp) != 1) {
+            return 0;
+        }
+
+        if(record->size + 1 > reader->data_max) {
+            reader->data_max = record->size + 1;
+            reader->data = aim_realloc(reader->data, reader->data_max);
+        }
+        if(record->size &&
+           fread(reader->data, record->size, 1, reader->fp) != 1) {
+            /* Truncated trace. */
+            return 0;
+        }
+        reader->data[record->size] = 0;
+
+        if(record->op >= ONLP_TRACE_OP_COUNT) {
+            AIM_LOG_ERROR("trace: invalid record op %u", record->op);
+            return ONLP_STATUS_E_PARAM;
+        }
+
+        if(record->op != ONLP_TRACE_OP_STRING) {
+            break;
+        }
+
+        if(record->id >= reader->string_max) {
+            uint32_t max = (record->id + 1) * 2;
+            reader->strings = aim_realloc(reader->strings,
+                                          max * sizeof(*reader->strings));
+            ONLPLIB_MEMSET(reader->strings + reader->string_max, 0,
+                           (max - reader->string_max) * sizeof(*reader->strings));
+            reader->string_max = max;
+        }
+        aim_free(reader->strings[record->id]);
+        reader->strings[record->id] = aim_strdup((char*)reader->data);
+    }
+
+    *data = reader->data;
+    *path = NULL;
+    if(!ONLP_TRACE_OP_IS_I2C(record->op) && record->id < reader->string_max) {
+        *path = reader->strings[record->id];
+    }
+    return 1;
+}
+
+void
+onlp_trace_reader_close(onlp_trace_reader_t* reader)
+{
+    uint32_t i;
+
+    if(reader == NULL) {
+        return;
+    }
+    for(i = 0; i < reader->string_max; i++) {
+        aim_free(reader->strings[i]);
+    }
+    aim_free(reader->strings);
+    aim_free(reader->data);
+    fclose(reader->fp);
+    aim_free(reader);
+}
@@ -2,6 +2,16 @@
 #define SFF_A0_BASE 0x0
 #define SFF_A2_BASE 0x100
 
+/**
+ * OOM_SHIM_PRESENCE_REFRESH_MS
+ * Maximum age of the cached port presence used by memory reads.
+ * oom_get_portlist() always refreshes it. If presence was not sampled
+ * for twice this period, cached static pages are dropped.
+ */
+#ifndef OOM_SHIM_PRESENCE_REFRESH_MS
+#define OOM_SHIM_PRESENCE_REFRESH_MS 1000
+#endif
+
 /**
  * SFF_EEPROM_DATA_DEBUG
  * For printing the eeprom hex data for debugging. 
@@ -23,6 +23,8 @@
  *
  ***********************************************************/
 #include <errno.h>
+#include <pthread.h>
+#include <time.h>
 #include <onlp/onlp.h>
 #include <onlp/sfp.h>
 #include <sff/sff.h>
@@ -39,83 +41,219 @@ void __oom_shim_module_init__(void) {
     onlp_init();
 }
 
+/*
+ * Port table.
+ *
+ * Presence is refreshed from a single onlp_sfp_presence_bitmap_get()
+ * call. Every insertion gets a new generation number. Static EEPROM
+ * contents are cached against the generation they were read in, so
+ * they are only read again after the module has been replaced.
+ *
+ * Presence is only sampled when the shim is called. If no sample was
+ * taken for a full refresh period, a module may have been swapped
+ * unseen, so every present port gets a new generation.
+ */
+typedef struct oom_port_entry_s {
+    int present;
+    uint32_t generation;
+    /* Generation of the cached pages, 0 if none. */
+    uint32_t a0_generation;
+    uint32_t a2_generation;
+    uint8_t* a0;
+    uint8_t* a2;
+} oom_port_entry_t;
+
+static oom_port_entry_t ports__[MAXPORTS];
+static onlp_sfp_bitmap_t valid__;
+static int valid_init__;
+static uint32_t generation__;
+static uint64_t presence_updated__;
+static pthread_mutex_t lock__ = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t now_ms__(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void port_presence_set__(int port, int present, int unseen) {
+    oom_port_entry_t* e = &ports__[port];
+    if(present != e->present || (present && unseen)) {
+        /* Inserted, removed or possibly replaced. Anything cached is stale. */
+        e->present = present;
+        e->generation = ++generation__;
+    }
+}
+
+/* Caller holds lock__. */
+static void ports_refresh__(int force) {
+    onlp_sfp_bitmap_t present;
+    uint64_t now = now_ms__();
+    int port, unseen;
+
+    if(!valid_init__) {
+        onlp_sfp_bitmap_t_init(&valid__);
+        onlp_sfp_bitmap_get(&valid__);
+        valid_init__ = 1;
+        force = 1;
+    }
+
+    if(!force && (now - presence_updated__) < OOM_SHIM_PRESENCE_REFRESH_MS) {
+        return;
+    }
+
+    unseen = presence_updated__ &&
+        (now - presence_updated__) >= 2 * OOM_SHIM_PRESENCE_REFRESH_MS;
+
+    onlp_sfp_bitmap_t_init(&present);
+    if(onlp_sfp_presence_bitmap_get(&present) >= 0) {
+        AIM_BITMAP_ITER(&valid__, port) {
+            if(port < MAXPORTS) {
+                port_presence_set__(port, AIM_BITMAP_GET(&present, port) ? 1 : 0,
+                                    unseen);
+            }
+        }
+    }
+    else {
+        /* No bitmap support on this platform. */
+        AIM_BITMAP_ITER(&valid__, port) {
+            if(port < MAXPORTS) {
+                port_presence_set__(port, onlp_sfp_is_present(port) > 0, unseen);
+            }
+        }
+    }
+    presence_updated__ = now;
+}
+
 /*Gets the portlist of the SFP ports on the switch*/
 int oom_get_portlist(oom_port_t portlist[], int listsize){
     
     int port,i=0;
     oom_port_t* pptr;
     
-
-    onlp_sfp_bitmap_t bitmap;
-    onlp_sfp_bitmap_t_init(&bitmap);
-    onlp_sfp_bitmap_get(&bitmap);
+    pthread_mutex_lock(&lock__);
+    ports_refresh__(1);
    
     if ((portlist == NULL) && (listsize == 0)){ /* asking # of ports */
-        if(AIM_BITMAP_COUNT(&bitmap) == 0){
-            return 0;
-        }
-        else
-            return AIM_BITMAP_COUNT(&bitmap);
+        i = AIM_BITMAP_COUNT(&valid__);
+        pthread_mutex_unlock(&lock__);
+        return i;
     }
 
-    AIM_BITMAP_ITER(&bitmap, port){
-        int rv;
-        
+    AIM_BITMAP_ITER(&valid__, port){
+        if(i >= listsize) {
+            break;
+        }
         pptr = &portlist[i];
         pptr->handle = (void *)(uintptr_t)port+1;
         pptr->oom_class = OOM_PORT_CLASS_SFF; 
         sprintf(pptr->name, "port%d", port+1);
         i++;
         
-        rv = onlp_sfp_is_present(port);
-        if(rv == 0){
-            /* aim_printf(&aim_pvs_stdout, "module %d is not present\n", port);*/
-            pptr->oom_class = OOM_PORT_CLASS_UNKNOWN;
-            continue;
-        }
-
-        if(rv < 0){
-            aim_printf(&aim_pvs_stdout, "%4d  Error %{onlp_status}\n", port, rv);
+        if(port >= MAXPORTS || !ports__[port].present){
             pptr->oom_class = OOM_PORT_CLASS_UNKNOWN;
-            continue;
         }
     }
+    pthread_mutex_unlock(&lock__);
     return 0;
 }
 
+/*
+ * Static ranges of a page.
+ *
+ * SFP (SFF-8472): all of A0 and the A2 alarm thresholds and
+ * calibration constants (0-95). The A2 diagnostics, status and
+ * user EEPROM are volatile.
+ *
+ * QSFP (SFF-8636) and CMIS: the upper half of page 00h. The lower
+ * page holds monitors, flags and controls and is volatile.
+ */
+static int page_static__(uint8_t id, int address, int offset, int len) {
+    int end = offset + len;
+    switch(id) {
+    case 0x0C: /* QSFP */
+    case 0x0D: /* QSFP+ */
+    case 0x11: /* QSFP28 */
+    case 0x18: /* QSFP-DD (CMIS) */
+    case 0x19: /* OSFP (CMIS) */
+    case 0x1E: /* QSFP+ or later with CMIS */
+        return (address == 0xa0 && offset >= 128);
+    default:
+        return (address == 0xa0) || (address == 0xa2 && end <= 96);
+    }
+}
+
+static int page_read__(int port, int address, uint8_t** data) {
+    return (address == 0xa0) ?
+        onlp_sfp_eeprom_read(port, data) : onlp_sfp_dom_read(port, data);
+}
 
 int oom_get_memory_sff(oom_port_t* port, int address, int page, int offset, int len, uint8_t* data){
     int rv;
     unsigned int port_num; 
     uint8_t* idprom = NULL;
+    oom_port_entry_t* e;
+    uint8_t** cache;
+    uint32_t* cache_generation;
 
     port_num = (unsigned int)(uintptr_t)port->handle;
     port_num -= 1;
 
-    if (offset >= 256)
+    if (offset < 0 || len < 0 || offset + len > 256)
         return -1;  /* out of range */
 
-    /** 
-     * place holder implementation until onlp_sfp_eeprom_read() 
-     * can be improved to handle partial page gets
-     **/
-
-    if (address == 0xa0) {
-        rv = onlp_sfp_eeprom_read(port_num, &idprom);
-    } else if (address == 0xa2) {
-        rv = onlp_sfp_dom_read(port_num, &idprom);
-    } else {
+    if (address != 0xa0 && address != 0xa2) {
         aim_printf(&aim_pvs_stdout, "Error invalid address: 0x%02x\n", address);
         return -EINVAL;
     }
 
-    if(rv < 0) {
-        aim_printf(&aim_pvs_stdout, "Error reading eeprom: %{onlp_status}\n");
+    if (port_num >= MAXPORTS || page != 0) {
+        /* Not cached */
+        if((rv = page_read__(port_num, address, &idprom)) < 0) {
+            aim_printf(&aim_pvs_stdout, "Error reading eeprom: %{onlp_status}\n", rv);
+            return -1;
+        }
+        memcpy(data, &idprom[offset], len);
+        aim_free(idprom);
+        return 0;
+    }
+
+    pthread_mutex_lock(&lock__);
+    ports_refresh__(0);
+    e = &ports__[port_num];
+    cache = (address == 0xa0) ? &e->a0 : &e->a2;
+    cache_generation = (address == 0xa0) ? &e->a0_generation : &e->a2_generation;
+
+    /*
+     * The identifier is needed to know which ranges are static,
+     * so the A0 page is always cached first.
+     */
+    if (e->present && e->a0_generation == e->generation && *cache_generation == e->generation &&
+        page_static__(e->a0[0], address, offset, len)) {
+        memcpy(data, *cache + offset, len);
+        pthread_mutex_unlock(&lock__);
+        return 0;
+    }
+
+    /* Volatile or not yet cached. Read the hardware. */
+    if((rv = page_read__(port_num, address, &idprom)) < 0) {
+        pthread_mutex_unlock(&lock__);
+        aim_printf(&aim_pvs_stdout, "Error reading eeprom: %{onlp_status}\n", rv);
         return -1;
     }
-    memcpy(data, &idprom[offset], len); 
+    memcpy(data, &idprom[offset], len);
+
+    if (e->present && *cache_generation != e->generation &&
+        (address == 0xa0 || e->a0_generation == e->generation)) {
+        if(*cache == NULL) {
+            *cache = aim_zmalloc(256);
+        }
+        memcpy(*cache, idprom, 256);
+        *cache_generation = e->generation;
+    }
+    pthread_mutex_unlock(&lock__);
+
     aim_free(idprom);
-    
     return 0;
 }
 
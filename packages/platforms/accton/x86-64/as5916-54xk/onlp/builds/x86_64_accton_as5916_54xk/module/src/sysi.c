@@ -293,7 +293,7 @@ sysi_fanctrl_overall_thermal_sensor_policy,
 };
 
 int
-onlp_sysi_platform_manage_fans(void)
+onlp_sysi_platform_manage_fans_status(onlp_sys_manage_status_t* status)
 {
     int i, rc;
     onlp_fan_info_t fi[CHASSIS_FAN_COUNT];
@@ -305,7 +305,7 @@ onlp_sysi_platform_manage_fans(void)
     /* Get fan status
      */
     for (i = 0; i < CHASSIS_FAN_COUNT; i++) {
-        rc = onlp_fani_info_get(ONLP_FAN_ID_CREATE(i+1), &fi[i]);
+        rc = onlp_sys_manage_status_fan_get(status, ONLP_FAN_ID_CREATE(i+1), &fi[i]);
 
         if (rc != ONLP_STATUS_OK) {
             onlp_fani_percentage_set(ONLP_FAN_ID_CREATE(1), FAN_DUTY_MAX);
@@ -316,7 +316,7 @@ onlp_sysi_platform_manage_fans(void)
     /* Get thermal sensor status
      */
     for (i = 0; i < CHASSIS_THERMAL_COUNT; i++) {
-        rc = onlp_thermali_info_get(ONLP_THERMAL_ID_CREATE(i+1), &ti[i]);
+        rc = onlp_sys_manage_status_thermal_get(status, ONLP_THERMAL_ID_CREATE(i+1), &ti[i]);
         
         if (rc != ONLP_STATUS_OK) {
             onlp_fani_percentage_set(ONLP_FAN_ID_CREATE(1), FAN_DUTY_MAX);
@@ -30,6 +30,9 @@
 #include <linux/ipmi.h>
 #include <linux/ipmi_smi.h>
 #include <linux/platform_device.h>
+#include <linux/ktime.h>
+#include <linux/spinlock.h>
+#include "accton_ipmi_request.h"
 
 #define DRVNAME "as5916_54xks_sfp"
 #define ACCTON_IPMI_NETFN       0x34
@@ -47,6 +50,8 @@
 #define NUM_OF_SFP              48
 #define NUM_OF_QSFP             6
 #define NUM_OF_PORT             (NUM_OF_SFP + NUM_OF_QSFP)
+#define NUM_OF_STATUS_REGS      8 /* sfp: present, tx-disable, tx-fault, rx-los
+                                     qsfp: present, tx-disable, reset, lpmode */
 
 #define PHY_FORMAT "module_phy_%d"
 #define NUM_OF_PHY_REGISTERS    32
@@ -60,6 +65,9 @@
 #define IPMI_PHY_DATA_LEN(reg_count)  (IPMI_PHY_HEADER_LEN + (reg_count * IPMI_PHY_PER_REG_DATA_LEN))
 
 static void ipmi_msg_handler(struct ipmi_recv_msg *msg, void *user_msg_data);
+static ssize_t show_ipmi_latency(struct device *dev, struct device_attribute *da, char *buf);
+static ssize_t set_ipmi_latency(struct device *dev, struct device_attribute *da,
+			const char *buf, size_t count);
 static ssize_t set_sfp(struct device *dev, struct device_attribute *da,
 			const char *buf, size_t count);
 static ssize_t show_sfp(struct device *dev, struct device_attribute *da, char *buf);
@@ -83,6 +91,12 @@ static struct as5916_54xks_sfp_data *as5916_54xks_sfp_update_rxlos(void);
 static struct as5916_54xks_sfp_data *as5916_54xks_qsfp_update_present(void);
 static struct as5916_54xks_sfp_data *as5916_54xks_qsfp_update_txdisable(void);
 static struct as5916_54xks_sfp_data *as5916_54xks_qsfp_update_reset(void);
+static struct as5916_54xks_sfp_data *as5916_54xks_sfp_update_status(void);
+
+/* Lifetime of the cached module status registers, in milliseconds */
+static unsigned int status_ttl_ms = 1000;
+module_param(status_ttl_ms, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(status_ttl_ms, "Lifetime of the cached module status registers (ms)");
 
 struct ipmi_data {
 	struct completion   read_complete;
@@ -99,6 +113,10 @@ struct ipmi_data {
 	int              rx_recv_type;
 
 	struct ipmi_user_hndl ipmi_hndlrs;
+
+	/* Outstanding requests and latency statistics */
+	struct ipmi_requests requests;
+	u64              tx_start;
 };
 
 enum module_status {
@@ -134,6 +152,8 @@ struct ipmi_sfp_resp_data {
     unsigned long qsfp_last_updated[NUM_OF_QSFP_STATUS]; /* In jiffies */
     unsigned char qsfp_resp[NUM_OF_QSFP_STATUS][NUM_OF_QSFP]; /* 0: present, 1: tx-disable, 
                                                                  2: reset  , 3: low power mode */
+    char          status_valid;        /* != 0 if all the registers above were read in one burst */
+    unsigned long status_last_updated; /* In jiffies */
 };
 
 struct as5916_54xks_sfp_data {
@@ -142,6 +162,7 @@ struct as5916_54xks_sfp_data {
     struct ipmi_data ipmi;
     struct ipmi_sfp_resp_data ipmi_resp;
     unsigned char ipmi_tx_data[3];
+    struct ipmi_request status_req[NUM_OF_STATUS_REGS];
     struct bin_attribute eeprom[NUM_OF_PORT*2]; /* eeprom data */
     struct bin_attribute phy_reg[NUM_OF_SFP]; /* phy register data */
 };
@@ -338,6 +359,8 @@ DECLARE_QSFP_SENSOR_DEVICE_ATTR(52);
 DECLARE_QSFP_SENSOR_DEVICE_ATTR(53);
 DECLARE_QSFP_SENSOR_DEVICE_ATTR(54);
 
+static DEVICE_ATTR(ipmi_latency, S_IWUSR | S_IRUGO, show_ipmi_latency, set_ipmi_latency);
+
 static struct attribute *as5916_54xks_sfp_attributes[] = {
     /* sfp attributes */
     DECLARE_SFP_ATTR(1),
@@ -397,6 +420,7 @@ static struct attribute *as5916_54xks_sfp_attributes[] = {
     &sensor_dev_attr_module_present_all.dev_attr.attr,
     &sensor_dev_attr_module_rxlos_all.dev_attr.attr,
     &sensor_dev_attr_module_phy_set.dev_attr.attr,
+    &dev_attr_ipmi_latency.attr,
     NULL
 };
 
@@ -540,6 +564,7 @@ static int init_ipmi_data(struct ipmi_data *ipmi, int iface,
 	int err;
 
 	init_completion(&ipmi->read_complete);
+	ipmi_requests_init(&ipmi->requests);
 
 	/* Initialize IPMI address */
 	ipmi->address.addr_type = IPMI_SYSTEM_INTERFACE_ADDR_TYPE;
@@ -583,6 +608,7 @@ static int _ipmi_send_message(struct ipmi_data *ipmi, unsigned char cmd,
 		goto addr_err;
 
 	ipmi->tx_msgid++;
+	ipmi->tx_start = ktime_get_ns();
 	err = ipmi_request_settime(ipmi->user, &ipmi->address, ipmi->tx_msgid,
 				   &ipmi->tx_message, ipmi, 0, 0, 0);
 	if (err)
@@ -631,12 +657,25 @@ static int ipmi_send_message(struct ipmi_data *ipmi, unsigned char cmd,
     return status;
 }
 
+/* Send several IPMI commands with all the requests outstanding at once */
+static int ipmi_send_messages(struct ipmi_data *ipmi, struct ipmi_request *reqs, int count)
+{
+	return ipmi_requests_send(&ipmi->requests, ipmi->user, &ipmi->address,
+				  &ipmi->tx_msgid, ACCTON_IPMI_NETFN, reqs, count,
+				  IPMI_TIMEOUT, IPMI_ERR_RETRY_TIMES, &data->pdev->dev);
+}
+
 /* Dispatch IPMI messages to callers */
 static void ipmi_msg_handler(struct ipmi_recv_msg *msg, void *user_msg_data)
 {
 	unsigned short rx_len;
 	struct ipmi_data *ipmi = user_msg_data;
 
+	if (msg->user_msg_data != ipmi) {
+		ipmi_request_done(&ipmi->requests, msg);
+		return;
+	}
+
 	if (msg->msgid != ipmi->tx_msgid) {
 		dev_err(&data->pdev->dev, "Mismatch between received msgid "
 			"(%02x) and transmitted msgid (%02x)!\n",
@@ -661,272 +700,134 @@ static void ipmi_msg_handler(struct ipmi_recv_msg *msg, void *user_msg_data)
 	} else
 		ipmi->rx_msg_len = 0;
 
+	ipmi_latency_update(&ipmi->requests, ktime_get_ns() - ipmi->tx_start);
 	ipmi_free_recv_msg(msg);
 	complete(&ipmi->read_complete);
 }
 
-static struct as5916_54xks_sfp_data *as5916_54xks_sfp_update_present(void)
+/* Status registers refreshed together by as5916_54xks_sfp_update_status() */
+static const struct {
+    unsigned char cmd;
+    unsigned char reg;
+    int           is_qsfp;
+    int           index;
+} status_regs[NUM_OF_STATUS_REGS] = {
+    { IPMI_SFP_READ_CMD,  0x10, 0, SFP_PRESENT },
+    { IPMI_SFP_READ_CMD,  0x01, 0, SFP_TXDISABLE },
+    { IPMI_SFP_READ_CMD,  0x12, 0, SFP_TXFAULT },
+    { IPMI_SFP_READ_CMD,  0x13, 0, SFP_RXLOS },
+    { IPMI_QSFP_READ_CMD, 0x10, 1, QSFP_PRESENT },
+    { IPMI_QSFP_READ_CMD, 0x01, 1, QSFP_TXDISABLE },
+    { IPMI_QSFP_READ_CMD, 0x11, 1, QSFP_RESET },
+    { IPMI_QSFP_READ_CMD, 0x12, 1, QSFP_LPMODE },
+};
+
+/* Read every status register with all the requests outstanding at once.
+ * The per-type caches are refreshed as well, so every module attribute
+ * shares the status_ttl_ms lifetime.
+ */
+static struct as5916_54xks_sfp_data *as5916_54xks_sfp_update_status(void)
 {
     int status = 0;
+    int i;
+    struct ipmi_request *req;
 
-    if (time_before(jiffies, data->ipmi_resp.sfp_last_updated[SFP_PRESENT] + HZ) && 
-        data->ipmi_resp.sfp_valid[SFP_PRESENT]) {
+    if (time_before(jiffies, data->ipmi_resp.status_last_updated + msecs_to_jiffies(status_ttl_ms)) &&
+        data->ipmi_resp.status_valid) {
         return data;
     }
 
-    data->ipmi_resp.sfp_valid[SFP_PRESENT] = 0;
+    data->ipmi_resp.status_valid = 0;
 
-    /* Get status from ipmi */
-    data->ipmi_tx_data[0] = 0x10;
-    status = ipmi_send_message(&data->ipmi, IPMI_SFP_READ_CMD, 
-                                data->ipmi_tx_data, 1,
-                                data->ipmi_resp.sfp_resp[SFP_PRESENT], 
-                                sizeof(data->ipmi_resp.sfp_resp[SFP_PRESENT]));
-    if (unlikely(status != 0)) {
-        goto exit;
-    }
+    for (i = 0; i < NUM_OF_STATUS_REGS; i++) {
+        int index = status_regs[i].index;
 
-    if (unlikely(data->ipmi.rx_result != 0)) {
-        status = -EIO;
-        goto exit;
+        req = &data->status_req[i];
+        req->cmd = status_regs[i].cmd;
+        req->tx_data[0] = status_regs[i].reg;
+        req->tx_len = 1;
+
+        if (status_regs[i].is_qsfp) {
+            data->ipmi_resp.qsfp_valid[index] = 0;
+            req->rx_msg_data = data->ipmi_resp.qsfp_resp[index];
+            req->rx_msg_len  = sizeof(data->ipmi_resp.qsfp_resp[index]);
+        }
+        else {
+            data->ipmi_resp.sfp_valid[index] = 0;
+            req->rx_msg_data = data->ipmi_resp.sfp_resp[index];
+            req->rx_msg_len  = sizeof(data->ipmi_resp.sfp_resp[index]);
+        }
     }
 
-    data->ipmi_resp.sfp_last_updated[SFP_PRESENT] = jiffies;
-    data->ipmi_resp.sfp_valid[SFP_PRESENT] = 1;
+    /* Get status from ipmi */
+    status = ipmi_send_messages(&data->ipmi, data->status_req, NUM_OF_STATUS_REGS);
 
-exit:
-    return data;
-}
+    for (i = 0; i < NUM_OF_STATUS_REGS; i++) {
+        int index = status_regs[i].index;
 
-static struct as5916_54xks_sfp_data *as5916_54xks_sfp_update_txdisable(void)
-{
-    int status = 0;
+        if (data->status_req[i].status != 0) {
+            continue;
+        }
 
-    if (time_before(jiffies, data->ipmi_resp.sfp_last_updated[SFP_TXDISABLE] + HZ * 5) && 
-        data->ipmi_resp.sfp_valid[SFP_TXDISABLE]) {
-        return data;
+        if (status_regs[i].is_qsfp) {
+            data->ipmi_resp.qsfp_last_updated[index] = jiffies;
+            data->ipmi_resp.qsfp_valid[index] = 1;
+        }
+        else {
+            data->ipmi_resp.sfp_last_updated[index] = jiffies;
+            data->ipmi_resp.sfp_valid[index] = 1;
+        }
     }
 
-    data->ipmi_resp.sfp_valid[SFP_TXDISABLE] = 0;
-
-    /* Get status from ipmi */
-    data->ipmi_tx_data[0] = 0x01;
-    status = ipmi_send_message(&data->ipmi, IPMI_SFP_READ_CMD, 
-                                data->ipmi_tx_data, 1,
-                                data->ipmi_resp.sfp_resp[SFP_TXDISABLE], 
-                                sizeof(data->ipmi_resp.sfp_resp[SFP_TXDISABLE]));
     if (unlikely(status != 0)) {
         goto exit;
     }
 
-    if (unlikely(data->ipmi.rx_result != 0)) {
-        status = -EIO;
-        goto exit;
-    }
-
-    data->ipmi_resp.sfp_last_updated[SFP_TXDISABLE] = jiffies;
-    data->ipmi_resp.sfp_valid[SFP_TXDISABLE] = 1;
+    data->ipmi_resp.status_last_updated = jiffies;
+    data->ipmi_resp.status_valid = 1;
 
 exit:
     return data;
 }
 
-static struct as5916_54xks_sfp_data *as5916_54xks_sfp_update_txfault(void)
+static struct as5916_54xks_sfp_data *as5916_54xks_sfp_update_present(void)
 {
-    int status = 0;
-
-    if (time_before(jiffies, data->ipmi_resp.sfp_last_updated[SFP_TXFAULT] + HZ * 5) && 
-        data->ipmi_resp.sfp_valid[SFP_TXFAULT]) {
-        return data;
-    }
-
-    data->ipmi_resp.sfp_valid[SFP_TXFAULT] = 0;
-
-    /* Get status from ipmi */
-    data->ipmi_tx_data[0] = 0x12;
-    status = ipmi_send_message(&data->ipmi, IPMI_SFP_READ_CMD, 
-                                data->ipmi_tx_data, 1,
-                                data->ipmi_resp.sfp_resp[SFP_TXFAULT], 
-                                sizeof(data->ipmi_resp.sfp_resp[SFP_TXFAULT]));
-    if (unlikely(status != 0)) {
-        goto exit;
-    }
-
-    if (unlikely(data->ipmi.rx_result != 0)) {
-        status = -EIO;
-        goto exit;
-    }
+    return as5916_54xks_sfp_update_status();
+}
 
-    data->ipmi_resp.sfp_last_updated[SFP_TXFAULT] = jiffies;
-    data->ipmi_resp.sfp_valid[SFP_TXFAULT] = 1;
+static struct as5916_54xks_sfp_data *as5916_54xks_sfp_update_txdisable(void)
+{
+    return as5916_54xks_sfp_update_status();
+}
 
-exit:
-    return data;
+static struct as5916_54xks_sfp_data *as5916_54xks_sfp_update_txfault(void)
+{
+    return as5916_54xks_sfp_update_status();
 }
 
 static struct as5916_54xks_sfp_data *as5916_54xks_sfp_update_rxlos(void)
 {
-    int status = 0;
-
-    if (time_before(jiffies, data->ipmi_resp.sfp_last_updated[SFP_RXLOS] + HZ * 5) && 
-        data->ipmi_resp.sfp_valid[SFP_RXLOS]) {
-        return data;
-    }
-
-    data->ipmi_resp.sfp_valid[SFP_RXLOS] = 0;
-
-    /* Get status from ipmi */
-    data->ipmi_tx_data[0] = 0x13;
-    status = ipmi_send_message(&data->ipmi, IPMI_SFP_READ_CMD, 
-                                data->ipmi_tx_data, 1,
-                                data->ipmi_resp.sfp_resp[SFP_RXLOS], 
-                                sizeof(data->ipmi_resp.sfp_resp[SFP_RXLOS]));
-    if (unlikely(status != 0)) {
-        goto exit;
-    }
-
-    if (unlikely(data->ipmi.rx_result != 0)) {
-        status = -EIO;
-        goto exit;
-    }
-
-    data->ipmi_resp.sfp_last_updated[SFP_RXLOS] = jiffies;
-    data->ipmi_resp.sfp_valid[SFP_RXLOS] = 1;
-
-exit:
-    return data;
+    return as5916_54xks_sfp_update_status();
 }
 
 static struct as5916_54xks_sfp_data *as5916_54xks_qsfp_update_present(void)
 {
-    int status = 0;
-
-    if (time_before(jiffies, data->ipmi_resp.qsfp_last_updated[QSFP_PRESENT] + HZ) && 
-        data->ipmi_resp.qsfp_valid[QSFP_PRESENT]) {
-        return data;
-    }
-
-    data->ipmi_resp.qsfp_valid[QSFP_PRESENT] = 0;
-
-    /* Get status from ipmi */
-    data->ipmi_tx_data[0] = 0x10;
-    status = ipmi_send_message(&data->ipmi, IPMI_QSFP_READ_CMD, 
-                                data->ipmi_tx_data, 1,
-                                data->ipmi_resp.qsfp_resp[QSFP_PRESENT], 
-                                sizeof(data->ipmi_resp.qsfp_resp[QSFP_PRESENT]));
-    if (unlikely(status != 0)) {
-        goto exit;
-    }
-
-    if (unlikely(data->ipmi.rx_result != 0)) {
-        status = -EIO;
-        goto exit;
-    }
-
-    data->ipmi_resp.qsfp_last_updated[QSFP_PRESENT] = jiffies;
-    data->ipmi_resp.qsfp_valid[QSFP_PRESENT] = 1;
-
-exit:
-    return data;
+    return as5916_54xks_sfp_update_status();
 }
 
 static struct as5916_54xks_sfp_data *as5916_54xks_qsfp_update_txdisable(void)
 {
-    int status = 0;
-
-    if (time_before(jiffies, data->ipmi_resp.qsfp_last_updated[QSFP_TXDISABLE] + HZ * 5) && 
-        data->ipmi_resp.qsfp_valid[QSFP_TXDISABLE]) {
-        return data;
-    }
-
-    data->ipmi_resp.qsfp_valid[QSFP_TXDISABLE] = 0;
-
-    /* Get status from ipmi */
-    data->ipmi_tx_data[0] = 0x01;
-    status = ipmi_send_message(&data->ipmi, IPMI_QSFP_READ_CMD, 
-                                data->ipmi_tx_data, 1,
-                                data->ipmi_resp.qsfp_resp[QSFP_TXDISABLE], 
-                                sizeof(data->ipmi_resp.qsfp_resp[QSFP_TXDISABLE]));
-    if (unlikely(status != 0)) {
-        goto exit;
-    }
-
-    if (unlikely(data->ipmi.rx_result != 0)) {
-        status = -EIO;
-        goto exit;
-    }
-
-    data->ipmi_resp.qsfp_last_updated[QSFP_TXDISABLE] = jiffies;
-    data->ipmi_resp.qsfp_valid[QSFP_TXDISABLE] = 1;
-
-exit:
-    return data;
+    return as5916_54xks_sfp_update_status();
 }
 
 static struct as5916_54xks_sfp_data *as5916_54xks_qsfp_update_reset(void)
 {
-    int status = 0;
-
-    if (time_before(jiffies, data->ipmi_resp.qsfp_last_updated[QSFP_RESET] + HZ * 5) && 
-        data->ipmi_resp.qsfp_valid[QSFP_RESET]) {
-        return data;
-    }
-
-    data->ipmi_resp.qsfp_valid[QSFP_RESET] = 0;
-
-    /* Get status from ipmi */
-    data->ipmi_tx_data[0] = 0x11;
-    status = ipmi_send_message(&data->ipmi, IPMI_QSFP_READ_CMD, 
-                                data->ipmi_tx_data, 1,
-                                data->ipmi_resp.qsfp_resp[QSFP_RESET], 
-                                sizeof(data->ipmi_resp.qsfp_resp[QSFP_RESET]));
-    if (unlikely(status != 0)) {
-        goto exit;
-    }
-
-    if (unlikely(data->ipmi.rx_result != 0)) {
-        status = -EIO;
-        goto exit;
-    }
-
-    data->ipmi_resp.qsfp_last_updated[QSFP_RESET] = jiffies;
-    data->ipmi_resp.qsfp_valid[QSFP_RESET] = 1;
-
-exit:
-    return data;
+    return as5916_54xks_sfp_update_status();
 }
 
 static struct as5916_54xks_sfp_data *as5916_54xks_qsfp_update_lpmode(void)
 {
-    int status = 0;
-
-    if (time_before(jiffies, data->ipmi_resp.qsfp_last_updated[QSFP_LPMODE] + HZ * 5) && 
-        data->ipmi_resp.qsfp_valid[QSFP_LPMODE]) {
-        return data;
-    }
-
-    data->ipmi_resp.qsfp_valid[QSFP_LPMODE] = 0;
-
-    /* Get status from ipmi */
-    data->ipmi_tx_data[0] = 0x12;
-    status = ipmi_send_message(&data->ipmi, IPMI_QSFP_READ_CMD, 
-                                data->ipmi_tx_data, 1,
-                                data->ipmi_resp.qsfp_resp[QSFP_LPMODE], 
-                                sizeof(data->ipmi_resp.qsfp_resp[QSFP_LPMODE]));
-    if (unlikely(status != 0)) {
-        goto exit;
-    }
-
-    if (unlikely(data->ipmi.rx_result != 0)) {
-        status = -EIO;
-        goto exit;
-    }
-
-    data->ipmi_resp.qsfp_last_updated[QSFP_LPMODE] = jiffies;
-    data->ipmi_resp.qsfp_valid[QSFP_LPMODE] = 1;
-
-exit:
-    return data;
+    return as5916_54xks_sfp_update_status();
 }
 
 static ssize_t show_all(struct device *dev, struct device_attribute *da, char *buf)
@@ -2142,6 +2043,19 @@ alloc_err:
     return ret;
 }
 
+static ssize_t show_ipmi_latency(struct device *dev, struct device_attribute *da, char *buf)
+{
+    return ipmi_latency_show(&data->ipmi.requests, buf);
+}
+
+/* Any write clears the latency statistics */
+static ssize_t set_ipmi_latency(struct device *dev, struct device_attribute *da,
+			const char *buf, size_t count)
+{
+    ipmi_latency_clear(&data->ipmi.requests);
+    return count;
+}
+
 static int as5916_54xks_sfp_probe(struct platform_device *pdev)
 {
     int status = -1;
@@ -30,6 +30,9 @@
 #include <linux/ipmi.h>
 #include <linux/ipmi_smi.h>
 #include <linux/platform_device.h>
+#include <linux/ktime.h>
+#include <linux/spinlock.h>
+#include "accton_ipmi_request.h"
 
 #define DRVNAME "as5916_54xks_sys"
 #define ACCTON_IPMI_NETFN       0x34
@@ -54,6 +57,7 @@
 #define MAINBOARD_CPLD2_ADDR    0x62
 #define CPU_CPLD_ADDR           0x65
 #define FAN_CPLD_ADDR           0x66
+#define NUM_OF_CPLD             4
 
 #define IPMI_CPLD_READ_CMD      0x22
 #define IPMI_CPLD_WRITE_CMD     0x23
@@ -65,6 +69,9 @@
 #define MAINBOARD_CPLD1_SYS_RESET_5     0x50
 
 static void ipmi_msg_handler(struct ipmi_recv_msg *msg, void *user_msg_data);
+static ssize_t show_ipmi_latency(struct device *dev, struct device_attribute *da, char *buf);
+static ssize_t set_ipmi_latency(struct device *dev, struct device_attribute *da,
+			const char *buf, size_t count);
 static int as5916_54xks_sys_probe(struct platform_device *pdev);
 static int as5916_54xks_sys_remove(struct platform_device *pdev);
 static ssize_t show_sys_reset_6(struct device *dev, struct device_attribute *da, char *buf);
@@ -96,6 +103,10 @@ struct ipmi_data {
 	int              rx_recv_type;
 
 	struct ipmi_user_hndl ipmi_hndlrs;
+
+	/* Outstanding requests and latency statistics */
+	struct ipmi_requests requests;
+	u64              tx_start;
 };
 
 struct as5916_54xks_sys_data {
@@ -118,6 +129,10 @@ struct as5916_54xks_sys_data {
                                             Bit 0 : TCAM_CPLD1_GIO_L_1
                                             Bit 1 : TCAM_CPLD1_GIO_L_0 */
     unsigned char    ipmi_resp_cpld;
+    char             cpld_ver_valid;        /* != 0 if ipmi_resp_cpld_ver is valid */
+    unsigned long    cpld_ver_last_updated; /* In jiffies */
+    unsigned char    ipmi_resp_cpld_ver[NUM_OF_CPLD];
+    struct ipmi_request cpld_ver_req[NUM_OF_CPLD];
     unsigned char    ipmi_tx_data[3];
     struct bin_attribute eeprom;      /* eeprom data */
 };
@@ -177,6 +192,8 @@ static SENSOR_DEVICE_ATTR(cpu_cpld_last_reset_reson, S_IRUGO, show_watchdog, NUL
 static SENSOR_DEVICE_ATTR(mb_cpld1_system_reset1, S_IWUSR | S_IRUGO, show_watchdog, set_watchdog, MB_CPLD_SR1);
 static SENSOR_DEVICE_ATTR(bios_flash_id, S_IRUGO, show_bios_flash_id, NULL, BIOS_FLASH_ID);
 
+static DEVICE_ATTR(ipmi_latency, S_IWUSR | S_IRUGO, show_ipmi_latency, set_ipmi_latency);
+
 static struct attribute *as5916_54xks_sys_attributes[] = {
     &sensor_dev_attr_mac_rst.dev_attr.attr,
     &sensor_dev_attr_tcam_rst_c.dev_attr.attr,
@@ -196,6 +213,7 @@ static struct attribute *as5916_54xks_sys_attributes[] = {
     &sensor_dev_attr_cpu_cpld_last_reset_reson.dev_attr.attr,
     &sensor_dev_attr_mb_cpld1_system_reset1.dev_attr.attr,
     &sensor_dev_attr_bios_flash_id.dev_attr.attr,
+    &dev_attr_ipmi_latency.attr,
     NULL
 };
 
@@ -212,6 +230,7 @@ static int init_ipmi_data(struct ipmi_data *ipmi, int iface,
 	int err;
 
 	init_completion(&ipmi->read_complete);
+	ipmi_requests_init(&ipmi->requests);
 
 	/* Initialize IPMI address */
 	ipmi->address.addr_type = IPMI_SYSTEM_INTERFACE_ADDR_TYPE;
@@ -255,6 +274,7 @@ static int _ipmi_send_message(struct ipmi_data *ipmi, unsigned char cmd,
 		goto addr_err;
 
 	ipmi->tx_msgid++;
+	ipmi->tx_start = ktime_get_ns();
 	err = ipmi_request_settime(ipmi->user, &ipmi->address, ipmi->tx_msgid,
 				   &ipmi->tx_message, ipmi, 0, 0, 0);
 	if (err)
@@ -303,12 +323,25 @@ static int ipmi_send_message(struct ipmi_data *ipmi, unsigned char cmd,
     return status;
 }
 
+/* Send several IPMI commands with all the requests outstanding at once */
+static int ipmi_send_messages(struct ipmi_data *ipmi, struct ipmi_request *reqs, int count)
+{
+	return ipmi_requests_send(&ipmi->requests, ipmi->user, &ipmi->address,
+				  &ipmi->tx_msgid, ACCTON_IPMI_NETFN, reqs, count,
+				  IPMI_TIMEOUT, IPMI_ERR_RETRY_TIMES, &data->pdev->dev);
+}
+
 /* Dispatch IPMI messages to callers */
 static void ipmi_msg_handler(struct ipmi_recv_msg *msg, void *user_msg_data)
 {
 	unsigned short rx_len;
 	struct ipmi_data *ipmi = user_msg_data;
 
+	if (msg->user_msg_data != ipmi) {
+		ipmi_request_done(&ipmi->requests, msg);
+		return;
+	}
+
 	if (msg->msgid != ipmi->tx_msgid) {
 		dev_err(&data->pdev->dev, "Mismatch between received msgid "
 			"(%02x) and transmitted msgid (%02x)!\n",
@@ -333,6 +366,7 @@ static void ipmi_msg_handler(struct ipmi_recv_msg *msg, void *user_msg_data)
 	} else
 		ipmi->rx_msg_len = 0;
 
+	ipmi_latency_update(&ipmi->requests, ktime_get_ns() - ipmi->tx_start);
 	ipmi_free_recv_msg(msg);
 	complete(&ipmi->read_complete);
 }
@@ -708,25 +742,44 @@ exit:
     return status;
 }
 
-static struct as5916_54xks_sys_data *as5916_54xks_sys_update_cpld_ver(unsigned char cpld_addr)
+/* CPLD addresses, in MB_CPLD1_VER -> FAN_CPLD_VER order */
+static const unsigned char cpld_addrs[NUM_OF_CPLD] = {
+    MAINBOARD_CPLD1_ADDR,
+    MAINBOARD_CPLD2_ADDR,
+    CPU_CPLD_ADDR,
+    FAN_CPLD_ADDR
+};
+
+/* Read the version of every CPLD with all the requests outstanding at once */
+static struct as5916_54xks_sys_data *as5916_54xks_sys_update_cpld_ver(void)
 {
     int status = 0;
+    int i;
+    struct ipmi_request *req;
 
-    data->valid = 0;
-    data->ipmi_tx_data[0] = cpld_addr;
-    status = ipmi_send_message(&data->ipmi, IPMI_GET_CPLD_VER_CMD, data->ipmi_tx_data, 1,
-                               &data->ipmi_resp_cpld, sizeof(data->ipmi_resp_cpld));
-    if (unlikely(status != 0)) {
-        goto exit;
+    if (time_before(jiffies, data->cpld_ver_last_updated + HZ * 5) &&
+        data->cpld_ver_valid) {
+        return data;
     }
 
-    if (unlikely(data->ipmi.rx_result != 0)) {
-        status = -EIO;
+    data->cpld_ver_valid = 0;
+
+    for (i = 0; i < NUM_OF_CPLD; i++) {
+        req = &data->cpld_ver_req[i];
+        req->cmd = IPMI_GET_CPLD_VER_CMD;
+        req->tx_data[0] = cpld_addrs[i];
+        req->tx_len = 1;
+        req->rx_msg_data = &data->ipmi_resp_cpld_ver[i];
+        req->rx_msg_len  = sizeof(data->ipmi_resp_cpld_ver[i]);
+    }
+
+    status = ipmi_send_messages(&data->ipmi, data->cpld_ver_req, NUM_OF_CPLD);
+    if (unlikely(status != 0)) {
         goto exit;
     }
 
-    data->last_updated = jiffies;
-    data->valid = 1;
+    data->cpld_ver_last_updated = jiffies;
+    data->cpld_ver_valid = 1;
 
 exit:
     return data;
@@ -735,41 +788,28 @@ exit:
 static ssize_t show_cpld_version(struct device *dev, struct device_attribute *da, char *buf)
 {
     struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
-    unsigned char cpld_addr = 0, value = 0;
+    unsigned char value = 0;
     int error = 0;
 
-    switch (attr->index) {
-        case MB_CPLD1_VER:
-            cpld_addr = MAINBOARD_CPLD1_ADDR;
-            break;
-        case MB_CPLD2_VER:
-            cpld_addr = MAINBOARD_CPLD2_ADDR;
-            break;
-        case CPU_CPLD_VER:
-            cpld_addr = CPU_CPLD_ADDR;
-            break;
-        case FAN_CPLD_VER:
-            cpld_addr = FAN_CPLD_ADDR;
-            break;
-        default:
-            return -EINVAL;
+    if (attr->index < MB_CPLD1_VER || attr->index > FAN_CPLD_VER) {
+        return -EINVAL;
     }
 
     mutex_lock(&data->update_lock);
 
-    data = as5916_54xks_sys_update_cpld_ver(cpld_addr);
-    if (!data->valid) {
+    data = as5916_54xks_sys_update_cpld_ver();
+    if (!data->cpld_ver_valid) {
         error = -EIO;
         goto exit;
     }
 
-    value = data->ipmi_resp_cpld;
+    value = data->ipmi_resp_cpld_ver[attr->index - MB_CPLD1_VER];
     mutex_unlock(&data->update_lock);
     return sprintf(buf, "%d\n", value);
 
 exit:
     mutex_unlock(&data->update_lock);
-    return error;    
+    return error;
 }
 
 static struct as5916_54xks_sys_data *as5916_54xks_sys_update_watchdog(unsigned char cpld_addr, 
@@ -949,6 +989,19 @@ exit:
     return status;
 }
 
+static ssize_t show_ipmi_latency(struct device *dev, struct device_attribute *da, char *buf)
+{
+    return ipmi_latency_show(&data->ipmi.requests, buf);
+}
+
+/* Any write clears the latency statistics */
+static ssize_t set_ipmi_latency(struct device *dev, struct device_attribute *da,
+			const char *buf, size_t count)
+{
+    ipmi_latency_clear(&data->ipmi.requests);
+    return count;
+}
+
 static int as5916_54xks_sys_probe(struct platform_device *pdev)
 {
     int status = -1;
@@ -27,6 +27,7 @@
 #include <fcntl.h>
 
 #include <onlplib/file.h>
+#include <onlplib/logring.h>
 #include <onlp/platformi/sysi.h>
 #include <onlp/platformi/ledi.h>
 #include <onlp/platformi/thermali.h>
@@ -152,6 +153,35 @@ fan_ctrl_policy_t  fan_ctrl_policy_b2f[] = {
 #define FAN_DUTY_CYCLE_MAX  100
 #define FAN_SPEED_CTRL_PATH "/sys/bus/i2c/devices/2-0066/fan_duty_cycle_percentage"
 
+#define FAN_NODE(id, node) "/sys/bus/i2c/devices/2-0066/fan"#id"_"#node
+#define FAN_SWEEP_NODES(id) FAN_NODE(id, present), FAN_NODE(id, fault), FAN_NODE(id, direction)
+
+enum fan_sweep_node {
+    FAN_SWEEP_PRESENT,
+    FAN_SWEEP_FAULT,
+    FAN_SWEEP_DIRECTION,
+    FAN_SWEEP_NODE_COUNT
+};
+
+/* Fan state checked on each management tick, followed by the duty cycle */
+static const char* fan_sweep_files[] = {
+    FAN_SWEEP_NODES(1),
+    FAN_SWEEP_NODES(2),
+    FAN_SWEEP_NODES(3),
+    FAN_SWEEP_NODES(4),
+    FAN_SWEEP_NODES(5),
+    FAN_SWEEP_NODES(6),
+    FAN_SPEED_CTRL_PATH,
+};
+#define FAN_SWEEP_DUTY_CYCLE (NUM_OF_FAN_ON_MAIN_BROAD * FAN_SWEEP_NODE_COUNT)
+
+/* LM75(48), LM75(49) and LM75(4A) */
+static const char* thermal_sweep_files[] = {
+    "/sys/bus/i2c/devices/3-0048*temp1_input",
+    "/sys/bus/i2c/devices/3-0049*temp1_input",
+    "/sys/bus/i2c/devices/3-004a*temp1_input",
+};
+
 /*
  * For AC power Front to Back :
  *	* If any fan fail, please fan speed register to 15
@@ -182,40 +212,48 @@ onlp_sysi_platform_manage_fans(void)
     int i = 0, arr_size, temp;
     fan_ctrl_policy_t *policy;
     int cur_duty_cycle, new_duty_cycle;
-    onlp_thermal_info_t thermal_1, thermal_2, thermal_3;
+    int fan_values[AIM_ARRAYSIZE(fan_sweep_files)];
+    int fan_status[AIM_ARRAYSIZE(fan_sweep_files)];
+    int temps[AIM_ARRAYSIZE(thermal_sweep_files)];
 
-    int  fd, len;
-    char  buf[10] = {0};
-
-    /* Get each fan status
+    /* Get each fan status and the current fan speed in one read
      */
+    onlp_file_read_ints(fan_sweep_files, fan_values, fan_status,
+                        AIM_ARRAYSIZE(fan_sweep_files));
+
     for (i = 1; i <= NUM_OF_FAN_ON_MAIN_BROAD; i++)
     {
-        onlp_fan_info_t fan_info;
-
-        if (onlp_fani_info_get(ONLP_FAN_ID_CREATE(i), &fan_info) != ONLP_STATUS_OK) {
-            AIM_LOG_ERROR("Unable to get fan(%d) status\r\n", i);
+        int *value  = fan_values + (i-1) * FAN_SWEEP_NODE_COUNT;
+        int *status = fan_status + (i-1) * FAN_SWEEP_NODE_COUNT;
+
+        if (status[FAN_SWEEP_PRESENT] < 0 ||
+            (value[FAN_SWEEP_PRESENT] &&
+             (status[FAN_SWEEP_FAULT] < 0 || status[FAN_SWEEP_DIRECTION] < 0))) {
+            onlp_logring_post("fan status", NULL, i, ONLP_LOGRING_LEVEL_ERROR, 0,
+                              "Unable to get fan(%d) status\r\n", i);
             return ONLP_STATUS_E_INTERNAL;
         }
 
         /* Decision 1: Set fan as full speed if any fan is failed.
          */
-        if (fan_info.status & ONLP_FAN_STATUS_FAILED) {
-            AIM_LOG_ERROR("Fan(%d) is not working, set the other fans as full speed\r\n", i);
+        if (value[FAN_SWEEP_PRESENT] && value[FAN_SWEEP_FAULT] > 0) {
+            onlp_logring_post("fan failed", NULL, i, ONLP_LOGRING_LEVEL_ERROR, 0,
+                              "Fan(%d) is not working, set the other fans as full speed\r\n", i);
             return onlp_fani_percentage_set(ONLP_FAN_ID_CREATE(1), FAN_DUTY_CYCLE_MAX);
         }
 
         /* Decision 1.1: Set fan as full speed if any fan is not present.
          */
-        if (!(fan_info.status & ONLP_FAN_STATUS_PRESENT)) {
-            AIM_LOG_ERROR("Fan(%d) is not present, set the other fans as full speed\r\n", i);
+        if (!value[FAN_SWEEP_PRESENT]) {
+            onlp_logring_post("fan not present", NULL, i, ONLP_LOGRING_LEVEL_ERROR, 0,
+                              "Fan(%d) is not present, set the other fans as full speed\r\n", i);
             return onlp_fani_percentage_set(ONLP_FAN_ID_CREATE(1), FAN_DUTY_CYCLE_MAX);
         }
 
         /* Get fan direction (Only get the first one since all fan direction are the same)
          */
         if (i == 1) {
-            if (fan_info.status & ONLP_FAN_STATUS_F2B) {
+            if (value[FAN_SWEEP_DIRECTION]) { /* F2B */
                 policy   = fan_ctrl_policy_f2b;
                 arr_size = AIM_ARRAYSIZE(fan_ctrl_policy_f2b);
             }
@@ -228,19 +266,11 @@ onlp_sysi_platform_manage_fans(void)
 
     /* Get current fan speed
      */
-    fd = open(FAN_SPEED_CTRL_PATH, O_RDONLY);
-    if (fd == -1){
-        AIM_LOG_ERROR("Unable to open fan speed control node (%s)", FAN_SPEED_CTRL_PATH);
-        return ONLP_STATUS_E_INTERNAL;
-    }
-
-    len = read(fd, buf, sizeof(buf));
-    close(fd);
-    if (len <= 0) {
+    if (fan_status[FAN_SWEEP_DUTY_CYCLE] < 0) {
         AIM_LOG_ERROR("Unable to read fan speed from (%s)", FAN_SPEED_CTRL_PATH);
         return ONLP_STATUS_E_INTERNAL;
     }
-    cur_duty_cycle = atoi(buf);
+    cur_duty_cycle = fan_values[FAN_SWEEP_DUTY_CYCLE];
 
 
     /* Decision 2: If no matched fan speed is found from the policy,
@@ -259,13 +289,12 @@ onlp_sysi_platform_manage_fans(void)
 
     /* Get current temperature
      */
-    if (onlp_thermali_info_get(ONLP_THERMAL_ID_CREATE(2), &thermal_1) != ONLP_STATUS_OK ||
-        onlp_thermali_info_get(ONLP_THERMAL_ID_CREATE(3), &thermal_2) != ONLP_STATUS_OK ||
-        onlp_thermali_info_get(ONLP_THERMAL_ID_CREATE(4), &thermal_3) != ONLP_STATUS_OK) {
+    if (onlp_file_read_ints(thermal_sweep_files, temps, NULL,
+                            AIM_ARRAYSIZE(thermal_sweep_files)) != (int)AIM_ARRAYSIZE(thermal_sweep_files)) {
         AIM_LOG_ERROR("Unable to read thermal status");
         return ONLP_STATUS_E_INTERNAL;
     }
-    temp = thermal_1.mcelsius + thermal_2.mcelsius + thermal_3.mcelsius;
+    temp = temps[0] + temps[1] + temps[2];
 
 
     /* Decision 3: Decide new fan speed depend on fan direction/current fan speed/temperature
@@ -312,7 +312,7 @@ onlp_sysi_platform_manage_fans(void)
     return ONLP_STATUS_OK;
 }
 int
-onlp_sysi_platform_manage_leds(void)
+onlp_sysi_platform_manage_leds_status(onlp_sys_manage_status_t* status)
 {
 	int i = 0, fan_fault = 0;
 
@@ -322,7 +322,7 @@ onlp_sysi_platform_manage_leds(void)
     {
         onlp_fan_info_t fan_info;
 
-        if (onlp_fani_info_get(ONLP_FAN_ID_CREATE(i), &fan_info) != ONLP_STATUS_OK) {
+        if (onlp_sys_manage_status_fan_get(status, ONLP_FAN_ID_CREATE(i), &fan_info) != ONLP_STATUS_OK) {
             AIM_LOG_ERROR("Unable to get fan(%d) status\r\n", i);
             return ONLP_STATUS_E_INTERNAL;
         }
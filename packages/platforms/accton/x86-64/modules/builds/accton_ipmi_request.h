@@ -0,0 +1,273 @@
+/*
+ * Copyright (C)  Accton Technology Corporation.
+ *
+ * Outstanding IPMI requests for the BMC based accton platform drivers.
+ *
+ * ipmi_requests_send() queues several requests before waiting for any of
+ * them, so the BMC round trips overlap. Responses are received into a
+ * buffer of the request and are only copied to the caller's destination
+ * by the sender, once the request completed, so a response which arrives
+ * after its request timed out never touches the caller's data.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __ACCTON_IPMI_REQUEST_H__
+#define __ACCTON_IPMI_REQUEST_H__
+
+#include <linux/device.h>
+#include <linux/completion.h>
+#include <linux/spinlock.h>
+#include <linux/jiffies.h>
+#include <linux/ktime.h>
+#include <linux/string.h>
+#include <linux/ipmi.h>
+
+#define IPMI_REQUEST_RX_MAX     64
+
+/* Shared by the requests of one IPMI user */
+struct ipmi_requests {
+	spinlock_t       lock;          /* Request completion and statistics */
+
+	/* Request latency statistics, in nanoseconds */
+	u32              lat_count;
+	u64              lat_last;
+	u64              lat_max;
+	u64              lat_total;
+};
+
+/* One of several outstanding requests sent by ipmi_requests_send() */
+struct ipmi_request {
+	unsigned char    cmd;
+	unsigned char    tx_data[2];
+	unsigned short   tx_len;
+	void            *rx_msg_data;   /* Destination, written by the sender only */
+	unsigned short   rx_msg_len;
+
+	struct completion      complete;
+	struct kernel_ipmi_msg tx_message;
+	long             msgid;
+	int              pending;       /* Sent, neither answered nor timed out */
+	int              queued;        /* Sent by the current round */
+	u64              start;
+	unsigned char    rx_result;
+	unsigned char    rx_buf[IPMI_REQUEST_RX_MAX];
+	unsigned short   rx_len;
+	int              status;
+};
+
+static inline void ipmi_requests_init(struct ipmi_requests *r)
+{
+	spin_lock_init(&r->lock);
+}
+
+static inline void __ipmi_latency_update(struct ipmi_requests *r, u64 ns)
+{
+	r->lat_count++;
+	r->lat_last = ns;
+	r->lat_total += ns;
+	if (ns > r->lat_max)
+		r->lat_max = ns;
+}
+
+static inline void ipmi_latency_update(struct ipmi_requests *r, u64 ns)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&r->lock, flags);
+	__ipmi_latency_update(r, ns);
+	spin_unlock_irqrestore(&r->lock, flags);
+}
+
+static inline ssize_t ipmi_latency_show(struct ipmi_requests *r, char *buf)
+{
+	unsigned long flags;
+	u32 count;
+	u64 last, max, avg = 0;
+
+	spin_lock_irqsave(&r->lock, flags);
+	count = r->lat_count;
+	last  = r->lat_last;
+	max   = r->lat_max;
+	if (count)
+		avg = div_u64(r->lat_total, count);
+	spin_unlock_irqrestore(&r->lock, flags);
+
+	return sprintf(buf, "count:%u last_us:%llu avg_us:%llu max_us:%llu\n", count,
+		       div_u64(last, NSEC_PER_USEC), div_u64(avg, NSEC_PER_USEC),
+		       div_u64(max, NSEC_PER_USEC));
+}
+
+static inline void ipmi_latency_clear(struct ipmi_requests *r)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&r->lock, flags);
+	r->lat_count = 0;
+	r->lat_last  = 0;
+	r->lat_max   = 0;
+	r->lat_total = 0;
+	spin_unlock_irqrestore(&r->lock, flags);
+}
+
+/* Complete a request sent by ipmi_requests_send(), from the IPMI receive handler */
+static inline void ipmi_request_done(struct ipmi_requests *r, struct ipmi_recv_msg *msg)
+{
+	unsigned long flags;
+	unsigned short rx_len = 0;
+	struct ipmi_request *req = msg->user_msg_data;
+
+	spin_lock_irqsave(&r->lock, flags);
+
+	if (!req->pending || msg->msgid != req->msgid) {
+		/* Late response to a request which has already timed out */
+		spin_unlock_irqrestore(&r->lock, flags);
+		ipmi_free_recv_msg(msg);
+		return;
+	}
+
+	if (msg->msg.data_len > 0)
+		req->rx_result = msg->msg.data[0];
+	else
+		req->rx_result = IPMI_UNKNOWN_ERR_COMPLETION_CODE;
+
+	if (msg->msg.data_len > 1) {
+		rx_len = msg->msg.data_len - 1;
+		if (rx_len > sizeof(req->rx_buf))
+			rx_len = sizeof(req->rx_buf);
+		memcpy(req->rx_buf, msg->msg.data + 1, rx_len);
+	}
+	req->rx_len = rx_len;
+	req->pending = 0;
+	__ipmi_latency_update(r, ktime_get_ns() - req->start);
+	complete(&req->complete);
+
+	spin_unlock_irqrestore(&r->lock, flags);
+
+	ipmi_free_recv_msg(msg);
+}
+
+static inline void ipmi_requests_queue(struct ipmi_requests *r, ipmi_user_t user,
+				       struct ipmi_addr *addr, long *tx_msgid,
+				       unsigned char netfn, struct ipmi_request *req,
+				       struct device *dev)
+{
+	unsigned long flags;
+
+	init_completion(&req->complete);
+	req->tx_message.netfn    = netfn;
+	req->tx_message.cmd      = req->cmd;
+	req->tx_message.data     = req->tx_data;
+	req->tx_message.data_len = req->tx_len;
+
+	spin_lock_irqsave(&r->lock, flags);
+	req->rx_result = IPMI_UNKNOWN_ERR_COMPLETION_CODE;
+	req->rx_len = 0;
+	req->msgid = ++(*tx_msgid);
+	req->start = ktime_get_ns();
+	req->pending = 1;
+	spin_unlock_irqrestore(&r->lock, flags);
+
+	req->status = ipmi_request_settime(user, addr, req->msgid,
+					   &req->tx_message, req, 0, 0, 0);
+	req->queued = !req->status;
+	if (req->status) {
+		spin_lock_irqsave(&r->lock, flags);
+		req->pending = 0;
+		spin_unlock_irqrestore(&r->lock, flags);
+		dev_err(dev, "request_settime=%x\n", req->status);
+	}
+}
+
+/* Send several IPMI commands and wait for all of them against one deadline.
+ * Requests which fail are sent again, up to retries more times. The response
+ * of each successful request is copied to its rx_msg_data, and rx_msg_len is
+ * set to the copied length. Returns the first error, or 0.
+ */
+static inline int ipmi_requests_send(struct ipmi_requests *r, ipmi_user_t user,
+				     struct ipmi_addr *addr, long *tx_msgid,
+				     unsigned char netfn, struct ipmi_request *reqs,
+				     int count, unsigned long timeout, int retries,
+				     struct device *dev)
+{
+	int err, i, retry;
+	int status = 0;
+	long left;
+	unsigned long flags;
+	unsigned long deadline;
+	struct ipmi_request *req;
+
+	err = ipmi_validate_addr(addr, sizeof(*addr));
+	if (err) {
+		dev_err(dev, "validate_addr=%x\n", err);
+		return err;
+	}
+
+	for (i = 0; i < count; i++)
+		reqs[i].status = -EAGAIN;
+
+	for (retry = 0; retry <= retries; retry++) {
+		/* Only the requests which have not succeeded yet */
+		for (i = 0; i < count; i++) {
+			if (reqs[i].status != 0)
+				ipmi_requests_queue(r, user, addr, tx_msgid, netfn, &reqs[i], dev);
+		}
+
+		deadline = jiffies + timeout;
+		status = 0;
+
+		for (i = 0; i < count; i++) {
+			req = &reqs[i];
+
+			if (req->queued) {
+				req->queued = 0;
+
+				left = (long)(deadline - jiffies);
+				wait_for_completion_timeout(&req->complete, left > 0 ? left : 1);
+
+				spin_lock_irqsave(&r->lock, flags);
+				if (req->pending) {
+					/* Any later response is dropped by ipmi_request_done() */
+					req->pending = 0;
+					req->status = -ETIMEDOUT;
+				}
+				else if (req->rx_result != 0) {
+					req->status = -EIO;
+				}
+				spin_unlock_irqrestore(&r->lock, flags);
+
+				if (req->status == -ETIMEDOUT)
+					dev_err(dev, "request_timeout=%x\n", req->status);
+			}
+
+			if (req->status && !status)
+				status = req->status;
+		}
+
+		if (status == 0)
+			break;
+
+		dev_err(dev, "ipmi_requests_send_%d err status(%d)\n", retry, status);
+	}
+
+	for (i = 0; i < count; i++) {
+		req = &reqs[i];
+		if (req->status)
+			continue;
+		if (req->rx_msg_len > req->rx_len)
+			req->rx_msg_len = req->rx_len;
+		memcpy(req->rx_msg_data, req->rx_buf, req->rx_msg_len);
+	}
+
+	return status;
+}
+
+#endif /* __ACCTON_IPMI_REQUEST_H__ */
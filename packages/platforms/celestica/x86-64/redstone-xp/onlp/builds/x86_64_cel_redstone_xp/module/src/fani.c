@@ -94,10 +94,13 @@ onlp_fani_info_get(onlp_oid_t id, onlp_fan_info_t* info)
 
     *info = f_info[fan_id];
 
+    i2cLeaseBegin();
     if (!getFanPresent(fan_id))
         info->status |= ONLP_FAN_STATUS_PRESENT;
-    else
+    else {
+        i2cLeaseEnd();
         return ONLP_STATUS_E_MISSING;
+    }
 
     if (getFanAirflow(fan_id))
         info->status |= ONLP_FAN_STATUS_F2B;
@@ -106,6 +109,7 @@ onlp_fani_info_get(onlp_oid_t id, onlp_fan_info_t* info)
 
     fanSpeedGet(fan_id, &(info->rpm));
     fanPwmGet(fan_id, &(info->percentage));
+    i2cLeaseEnd();
 
     return ONLP_STATUS_OK;
 }
@@ -8,6 +8,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/time.h>
+#include <time.h>
 
 
 #include "i2c_dev.h"
@@ -70,6 +71,124 @@ static unsigned char cpu_id = 0x00;
 unsigned long in_sus_val = 0x00000000;
 unsigned long in_core_val = 0x00000000;
 
+/*
+ * Bus lease.
+ *
+ * Every transfer on the chip side of the board normally claims the
+ * master selector (PCA9541), opens a mux channel, does one access and
+ * closes the channel again. While a lease is held the selector is
+ * claimed by the first getCtrlOfBus(), and channels are left open
+ * between accesses and only switched when another one is needed.
+ * Later getCtrlOfBus() calls re-read the selector control register
+ * (one transaction) in case the BMC took the bus back; a lost grant
+ * or any failed transfer forgets the mux state, so the next access
+ * arbitrates again and rewrites the channel. Everything is closed
+ * when the outermost lease ends.
+ */
+#define MUX_NUM		2
+#define MUX_UNKNOWN	0xFF
+static const char mux_addr[MUX_NUM] = {0x71, 0x73};
+static unsigned char mux_open[MUX_NUM];
+static int lease_depth = 0;
+static int lease_granted = 0;
+static unsigned int lease_errors = 0;
+
+static int muxIndex(char sw_addr)
+{
+	int i;
+	for(i = 0; i < MUX_NUM; i++)
+	{
+		if(sw_addr == mux_addr[i])
+			return i;
+	}
+	return -1;
+}
+
+/* After a failed access the selector and mux state are unknown */
+static void leaseReset(void)
+{
+	int i;
+	lease_granted = 0;
+	for(i = 0; i < MUX_NUM; i++)
+		mux_open[i] = MUX_UNKNOWN;
+}
+
+static int muxSelect(char sw_addr, unsigned char data)
+{
+	int ret;
+	int i;
+	int idx = muxIndex(sw_addr);
+
+	if(lease_depth == 0 || idx < 0)
+		return chips_write_byte(sw_addr, 0x0, data);
+
+	if(mux_open[idx] == data)
+		return 0;
+
+	/* Only one channel is open at a time, as without a lease */
+	for(i = 0; i < MUX_NUM; i++)
+	{
+		if(i != idx && mux_open[i])
+		{
+			if((ret = chips_write_byte(mux_addr[i], 0x0, 0x0)) < 0)
+			{
+				leaseReset();
+				return ret;
+			}
+			mux_open[i] = 0;
+		}
+	}
+
+	if((ret = chips_write_byte(sw_addr, 0x0, data)) < 0)
+	{
+		leaseReset();
+		return ret;
+	}
+	mux_open[idx] = data;
+	return ret;
+}
+
+static int muxDeselect(char sw_addr)
+{
+	/* Closed when the lease ends */
+	if(lease_depth && muxIndex(sw_addr) >= 0)
+		return 0;
+
+	return chips_write_byte(sw_addr, 0x0, 0x0);
+}
+
+void i2cLeaseBegin(void)
+{
+	if(lease_depth++ == 0)
+	{
+		int i;
+		lease_granted = 0;
+		for(i = 0; i < MUX_NUM; i++)
+			mux_open[i] = 0;
+	}
+}
+
+int i2cLeaseEnd(void)
+{
+	int ret = 0;
+	int i;
+
+	if(lease_depth == 0 || --lease_depth > 0)
+		return 0;
+
+	for(i = 0; i < MUX_NUM; i++)
+	{
+		if(mux_open[i])
+		{
+			if(chips_write_byte(mux_addr[i], 0x0, 0x0) < 0)
+				ret = -1;
+			mux_open[i] = 0;
+		}
+	}
+	lease_granted = 0;
+	return ret;
+}
+
 int openChannel(unsigned char dev_id)
 {
 	unsigned char data;
@@ -80,7 +199,7 @@ int openChannel(unsigned char dev_id)
 		if(dev_id ==  i2c_dev[i].dev_id)
 		{
 			data = 0x0 | (0x1 << i2c_dev[i].channel) ;
-			ret = chips_write_byte(i2c_dev[i].sw_addr, 0x0, data);
+			ret = muxSelect(i2c_dev[i].sw_addr, data);
 			if(ret < 0)
 				return ret;
 		}
@@ -96,7 +215,7 @@ int closeChannel(unsigned char dev_id)
 	{
 		if(dev_id ==  i2c_dev[i].dev_id)
 		{
-			ret = chips_write_byte(i2c_dev[i].sw_addr, 0x0, 0x0);
+			ret = muxDeselect(i2c_dev[i].sw_addr);
 			if(ret < 0)
 				return ret;
 		}
@@ -328,7 +447,7 @@ int enableChip(char addr)
 		if(addr ==  i2c_chips[i].addr)
 		{
 			data = 0x0 | (0x1 << i2c_chips[i].channel) ;
-			ret = chips_write_byte(i2c_chips[i].sw_addr, 0x0, data);
+			ret = muxSelect(i2c_chips[i].sw_addr, data);
 			if(ret < 0)
 				return ret;
 		}
@@ -344,7 +463,7 @@ int disableChip(char addr)
 	{
 		if(addr ==  i2c_chips[i].addr)
 		{
-			ret = chips_write_byte(i2c_chips[i].sw_addr, 0x0, 0x0);
+			ret = muxDeselect(i2c_chips[i].sw_addr);
 			if(ret < 0)
 				return ret;
 		}
@@ -440,6 +559,8 @@ static int getCtrlOfBus_9541(void)
     errStatus = chips_read_byte(I2C_MASTER_SELECTOR_DEV_ADDR,
                               I2C_MASTER_SELECTOR_DEV_CR,
                               &data);
+    if (errStatus < 0)
+        return errStatus;
 
     mask = Get_Control_Bus_Mask(data);
 
@@ -455,7 +576,34 @@ static int getCtrlOfBus_9541(void)
 
 int getCtrlOfBus(void)
 {
-	return getCtrlOfBus_9541();
+	int ret;
+
+	if(lease_depth && lease_granted)
+	{
+		unsigned char data;
+
+		if(i2c_dev_errors == lease_errors &&
+		   chips_read_byte(I2C_MASTER_SELECTOR_DEV_ADDR,
+				   I2C_MASTER_SELECTOR_DEV_CR, &data) >= 0 &&
+		   Get_Control_Bus_Mask(data) == 0xff)
+			return 0;
+
+		/* Lost the grant or a transfer failed: mux state unknown */
+		leaseReset();
+	}
+
+	ret = getCtrlOfBus_9541();
+	if(lease_depth)
+	{
+		if(ret >= 0)
+		{
+			lease_granted = 1;
+			lease_errors = i2c_dev_errors;
+		}
+		else
+			leaseReset();
+	}
+	return ret;
 }
 
 const struct fan_cpld_reg fan_cpld_reg[FAN_NUM] = {
@@ -534,6 +682,142 @@ int read_ram_short_from_cpld(const unsigned short ram_offset, unsigned short *va
 	return ret;
 }
 
+/*
+ * The CPLD may advance the RAM address on every data register read.
+ * This is detected once by reading the low address byte back around
+ * a data read; a CPLD whose address register does not read back is
+ * treated as not incrementing.
+ */
+#define CPLD_RAM_PROBE_OFFSET	(0x10)
+static int ram_autoinc = -1;
+
+static int cpldRamAutoInc(void)
+{
+	unsigned char addr, data;
+
+	if(ram_autoinc >= 0)
+		return ram_autoinc;
+
+	ram_autoinc = 0;
+	if(write_cpld(CPLD_RAM_ADDR_HIGH_BYTE_REG, 0) < 0 ||
+	   write_cpld(CPLD_RAM_ADDR_LOW_BYTE_REG, CPLD_RAM_PROBE_OFFSET) < 0)
+		return ram_autoinc;
+	if(read_cpld(CPLD_RAM_ADDR_LOW_BYTE_REG, &addr) < 0 ||
+	   addr != CPLD_RAM_PROBE_OFFSET)
+		return ram_autoinc;
+	if(read_cpld(CPLD_RAM_READ_REG, &data) < 0 ||
+	   read_cpld(CPLD_RAM_ADDR_LOW_BYTE_REG, &addr) < 0)
+		return ram_autoinc;
+	if(addr == CPLD_RAM_PROBE_OFFSET + 1)
+		ram_autoinc = 1;
+	return ram_autoinc;
+}
+
+/* Read len contiguous RAM bytes, setting the address only once if possible */
+int read_ram_block_from_cpld(const unsigned short ram_offset, unsigned char *buf, int len)
+{
+	int ret = 0;
+	int i;
+
+	if(!cpldRamAutoInc())
+	{
+		for(i = 0; i < len; i++)
+		{
+			if((ret = read_ram_from_cpld(ram_offset + i, &buf[i])) < 0)
+				return ret;
+		}
+		return ret;
+	}
+
+	for(i = 0; i < len; i++)
+	{
+		unsigned short off = ram_offset + i;
+
+		/* Set again where the low byte wraps, the carry is not specified */
+		if(i == 0 || (off & 0xff) == 0)
+		{
+			if((ret = write_cpld(CPLD_RAM_ADDR_HIGH_BYTE_REG, (off & 0xff00) >> 8)) < 0)
+				return ret;
+			if((ret = write_cpld(CPLD_RAM_ADDR_LOW_BYTE_REG, off & 0xff)) < 0)
+				return ret;
+		}
+		if((ret = read_cpld(CPLD_RAM_READ_REG, &buf[i])) < 0)
+			return ret;
+	}
+	return ret;
+}
+
+/*
+ * Snapshot of the PSoC RAM telemetry: temperatures from 6, fan status
+ * from 15, fan speeds from 20, PSU state at 50 and the PSU readings up
+ * to 101. It is shared by the fan, PSU and thermal calls of a poll and
+ * dropped once it is PSOC_RAM_SNAPSHOT_MS old. With an incrementing
+ * CPLD it is read in one block; otherwise bytes are read as first used.
+ */
+#define PSOC_RAM_SNAPSHOT_LEN	(102)
+#define PSOC_RAM_SNAPSHOT_MS	(500)
+static unsigned char psoc_ram[PSOC_RAM_SNAPSHOT_LEN];
+static unsigned char psoc_ram_have[PSOC_RAM_SNAPSHOT_LEN];
+static struct timespec psoc_ram_time;
+
+static void psocRamExpire(void)
+{
+	struct timespec now;
+	long ms;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	ms = (now.tv_sec - psoc_ram_time.tv_sec) * 1000 +
+		(now.tv_nsec - psoc_ram_time.tv_nsec) / 1000000;
+	if(ms >= PSOC_RAM_SNAPSHOT_MS || ms < 0)
+	{
+		memset(psoc_ram_have, 0, sizeof(psoc_ram_have));
+		psoc_ram_time = now;
+	}
+}
+
+static int read_ram_cached(const unsigned short ram_offset, unsigned char *value)
+{
+	int ret;
+
+	if(ram_offset >= PSOC_RAM_SNAPSHOT_LEN)
+		return read_ram_from_cpld(ram_offset, value);
+
+	psocRamExpire();
+	if(!psoc_ram_have[ram_offset])
+	{
+		if(cpldRamAutoInc())
+		{
+			if((ret = read_ram_block_from_cpld(0, psoc_ram, PSOC_RAM_SNAPSHOT_LEN)) < 0)
+				return ret;
+			memset(psoc_ram_have, 1, sizeof(psoc_ram_have));
+		}
+		else
+		{
+			if((ret = read_ram_from_cpld(ram_offset, &psoc_ram[ram_offset])) < 0)
+				return ret;
+			psoc_ram_have[ram_offset] = 1;
+		}
+	}
+	*value = psoc_ram[ram_offset];
+	return 0;
+}
+
+static int read_ram_short_cached(const unsigned short ram_offset, unsigned short *value)
+{
+	int ret;
+	unsigned char data;
+
+	ret = read_ram_cached(ram_offset + 1, &data);
+	if(ret < 0)
+		return ret;
+
+	*value = data << 8;
+
+	ret = read_ram_cached(ram_offset, &data);
+	*value |= data;
+	return ret;
+}
+
 #define PSOC_WATCHDOG_STATE 	(2)
 #define PSOC_RXP_SXP_FLAG 		(4)
 #define PSOC_PWM_RAM_REG  		(18)
@@ -660,7 +944,7 @@ int tsTempGet(int id, short *temp)
 
     if(getCpuId() == PSOC_CTRL_SMBUS)
 	{
-		ret = read_ram_from_cpld(ROA_TEMP_REM_REG + id, &data);
+		ret = read_ram_cached(ROA_TEMP_REM_REG + id, &data);
 		//printf("getPsuStatus: data=%u\n", data);
 		if(ret >= 0)
 			*temp = (short)data;
@@ -690,7 +974,7 @@ int tsOsGet(int id, unsigned short *temp)
 
 	if(getCpuId() == PSOC_CTRL_SMBUS)
 	{
-		ret = read_ram_from_cpld(ROA_TEMP_REM_REG + id, &data);
+		ret = read_ram_cached(ROA_TEMP_REM_REG + id, &data);
 		//printf("getPsuStatus: data=%u\n", data);
 		if(ret >= 0)
 			*temp = (short)data;
@@ -721,7 +1005,7 @@ int getTsShutdown(int id)
 
     if(getCpuId() == PSOC_CTRL_SMBUS)
 	{
-		ret = read_ram_from_cpld(ROA_TEMP_REM_REG + id, &data);
+		ret = read_ram_cached(ROA_TEMP_REM_REG + id, &data);
 		//printf("getPsuStatus: data=%u\n", data);
 		if(ret >= 0)
 			ret = (short)data;
@@ -907,19 +1191,19 @@ int getPsuInfo(int id, struct psuInfo * info)
 			return -1;
 
 		if(status == 0) {//PSU-L present
-			if ((ret = read_ram_short_from_cpld(PSU_RAM_VIN_LOW(id), &vin)) < 0)
+			if ((ret = read_ram_short_cached(PSU_RAM_VIN_LOW(id), &vin)) < 0)
 				return -1;
-			if ((ret = read_ram_short_from_cpld(PSU_RAM_IIN_LOW(id), &iin)) < 0)
+			if ((ret = read_ram_short_cached(PSU_RAM_IIN_LOW(id), &iin)) < 0)
 				return -1;
-			if ((ret = read_ram_short_from_cpld(PSU_RAM_VOUT_LOW(id), &vout)) < 0)
+			if ((ret = read_ram_short_cached(PSU_RAM_VOUT_LOW(id), &vout)) < 0)
 				return -1;
-			if ((ret = read_ram_short_from_cpld(PSU_RAM_IOUT_LOW(id), &iout)) < 0)
+			if ((ret = read_ram_short_cached(PSU_RAM_IOUT_LOW(id), &iout)) < 0)
 				return -1;
-			if ((ret = read_ram_short_from_cpld(PSU_RAM_POUT_LOW(id), &pout)) < 0)
+			if ((ret = read_ram_short_cached(PSU_RAM_POUT_LOW(id), &pout)) < 0)
 				return -1;
-			if ((ret = read_ram_short_from_cpld(PSU_RAM_PIN_LOW(id), &pin)) < 0)
+			if ((ret = read_ram_short_cached(PSU_RAM_PIN_LOW(id), &pin)) < 0)
 				return -1;
-			if ((ret = read_ram_short_from_cpld(PSU_RAM_TEMP1_LOW(id), &temp)) < 0)
+			if ((ret = read_ram_short_cached(PSU_RAM_TEMP1_LOW(id), &temp)) < 0)
 				return -1;
 
 			info->vin = convert_linear((char *)&vin) * 10;
@@ -982,7 +1266,7 @@ int getPsuPresent(int id)
 
 	if(getCpuId() == PSOC_CTRL_SMBUS)
 	{
-		ret = read_ram_from_cpld(PSU_STATE_RAM, &data);
+		ret = read_ram_cached(PSU_STATE_RAM, &data);
 		if(ret >= 0) {
 			ret = (data >> (1-id)) & 0x1;
 			ret = (ret == 0) ? 1 : 0;
@@ -1382,9 +1666,9 @@ int getFanPresent(int id)
 			off = id - FAN_NUM;
 
 		if(id <= (FAN_NUM - 1))
-			ret = read_ram_from_cpld(FAN_PRES_STATUS, &data);
+			ret = read_ram_cached(FAN_PRES_STATUS, &data);
 		else
-			ret = read_ram_from_cpld(PSU_PRES_STATUS, &data);
+			ret = read_ram_cached(PSU_PRES_STATUS, &data);
 
 		if(id <= (FAN_NUM - 1))
 			ret = (data >> off) & 0x1;
@@ -1427,14 +1711,14 @@ int getFanStatus(int id)
 		if(getCpuId() == PSOC_CTRL_SMBUS)
 		{
 			if(id % 2) {//front
-				ret = read_ram_from_cpld(FRONT_FAN_STATUS, &data);
+				ret = read_ram_cached(FRONT_FAN_STATUS, &data);
 				//printf("getFanStatus, front: id=%d, data=%u, ret=%d\n", id, data, ret);
 				if(ret < 0)
 					return ret;
 				else
 					ret = (data >> (id / 2)) & 0x1;
 			}else { //rear
-				ret = read_ram_from_cpld(REAR_FAN_STATUS, &data);
+				ret = read_ram_cached(REAR_FAN_STATUS, &data);
 				if(ret < 0)
 					return ret;
 				else
@@ -1511,11 +1795,11 @@ int getFanAirflow(int id)
 				return ret;
 		}
 
-		ret = read_ram_from_cpld(PSOC_9506PORT_RAM_BASE + 1, &data_io1);
+		ret = read_ram_cached(PSOC_9506PORT_RAM_BASE + 1, &data_io1);
 		if(ret < 0)
 			return -1;
 
-		ret = read_ram_from_cpld(PSOC_9506PORT_RAM_BASE + 2, &data_io2);
+		ret = read_ram_cached(PSOC_9506PORT_RAM_BASE + 2, &data_io2);
 		if(ret < 0)
 			return -1;
 
@@ -1731,7 +2015,7 @@ int fanPwmGet(int id, int *pwm)
 
 	if(getCpuId() == 0x01)
 	{
-		ret = read_ram_from_cpld(PSOC_PWM_RAM_REG, &data);
+		ret = read_ram_cached(PSOC_PWM_RAM_REG, &data);
 		//printf("getWdFromCpldRam: ret=%d, data=%u\n", ret, data);
 		if(ret >= 0)
 			*pwm = (data * 100)/255;
@@ -1794,20 +2078,14 @@ int fanSpeedGet(int id, int *speed)
 	if(getCpuId() == PSOC_CTRL_SMBUS)
 	{
 		if(id <= FAN_NUM - 1) {
-			ret = read_ram_from_cpld(FAN1_RAM_SPEED_LOW + id * 2 + 1, &data);
+			ret = read_ram_short_cached(FAN1_RAM_SPEED_LOW + id * 2, &value);
 			if(ret < 0) {
 				return ret;
 			}
 
-		*speed = data << 8;
-
-			ret = read_ram_from_cpld(FAN1_RAM_SPEED_LOW + id * 2, &data);
-			if(ret >= 0) {
-				*speed |= data ;
-			} else {
-			}
+			*speed = value;
 		} else {
-			if ((ret = read_ram_short_from_cpld(PSU_RAM_FAN_SPEED_LOW(id-8), &value)) < 0)
+			if ((ret = read_ram_short_cached(PSU_RAM_FAN_SPEED_LOW(id-8), &value)) < 0)
 				return -1;
 			//*speed = value;
 			*speed = convert_linear((char *)&value)/100;
@@ -1881,11 +2159,12 @@ int fanInit()
 	}
 	else
 	{
+		i2cLeaseBegin();
 		for (id = 0; id < FAN_NUM; id++) {
 			if((ret = getCtrlOfBus()) < 0)
-				return ret;
+				break;
 			if((ret = enableChip(fan[id].emc_addr)) < 0)
-				return ret;
+				break;
 
 			/* set minimum drive to 20% */
 			ret = chips_write_byte(fan[id].emc_addr, (fan[id].driver_reg-0x30)/0x10+0x38, 0x33);
@@ -1893,11 +2172,12 @@ int fanInit()
 			if(ret < 0)
 			{
 				disableChip(fan[id].emc_addr);
-				return ret;
+				break;
 			}
 
 			disableChip(fan[id].emc_addr);
 		}
+		i2cLeaseEnd();
 	}
 	return ret;
 }
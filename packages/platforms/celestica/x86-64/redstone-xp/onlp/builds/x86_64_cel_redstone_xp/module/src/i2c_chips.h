@@ -133,6 +133,12 @@ struct led_gpio
 
 
 int getCtrlOfBus(void);
+/*
+ * Hold the bus master grant and mux channels across a batch of
+ * accesses. Leases nest; the channels are closed by the outermost end.
+ */
+void i2cLeaseBegin(void);
+int i2cLeaseEnd(void);
 int enableChip(char addr);
 int disableChip(char addr);
 
@@ -8,6 +8,9 @@
 
 #include "i2c_dev.h"
 
+/* Failed transfers, so a bus lease can tell the mux state is unknown */
+unsigned int i2c_dev_errors = 0;
+
 static int
 i2c_write_2b(char addr, __u8 buf[2])
 {
@@ -54,6 +57,8 @@ i2c_smbus_access(int file, char read_write, __u8 command,
     args.data = data;
 
 	ret = ioctl(file, I2C_SMBUS, &args);
+	if(ret < 0)
+		i2c_dev_errors++;
 
     return ret;
 }
@@ -276,6 +281,8 @@ int i2c_smbus_read_16reg(int busNum, short addr, short reg,
 		ioctl_data.nmsgs= 2;
 		ioctl_data.msgs= msgs;
 		ret = ioctl(fd, I2C_RDWR, &ioctl_data);
+		if(ret < 0)
+			i2c_dev_errors++;
 		if(ret)
 			break;
 	}
@@ -312,6 +319,8 @@ int i2c_smbus_write_16reg(int busNum, short addr, short reg,
 		ioctl_data.nmsgs= 1;
 		ioctl_data.msgs= &msg;
 		ret = ioctl(fd, I2C_RDWR, &ioctl_data);
+		if(ret < 0)
+			i2c_dev_errors++;
 		if(ret)
 			break;
 	}
@@ -347,6 +356,8 @@ int i2c_smbus_write_16reg_8byte(int busNum, short addr, short reg,
 		ioctl_data.nmsgs= 1;
 		ioctl_data.msgs= &msg;
 		ret = ioctl(fd, I2C_RDWR, &ioctl_data);
+		if(ret < 0)
+			i2c_dev_errors++;
 		if(ret)
 			break;
 	}
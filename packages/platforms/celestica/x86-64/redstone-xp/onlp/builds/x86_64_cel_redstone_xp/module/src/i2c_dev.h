@@ -152,6 +152,8 @@ int chips_write_word(char addr, __u8 reg, unsigned short data);
 int chips_write_word_pec(char addr, __u8 reg, unsigned short data, int pec_flag);
 
 
+extern unsigned int i2c_dev_errors;
+
 int eeprom_read_byte(char addr, __u16 mem_addr, __u8 *data);
 int eeprom_write_byte(char addr, __u16 mem_addr, __u8 data);
 
@@ -29,12 +29,16 @@ onlp_psui_info_get(onlp_oid_t id, onlp_psu_info_t* info)
     psu_id = ONLP_OID_ID_GET(id) - 1;
     *info = psu_info[psu_id];
 
+    i2cLeaseBegin();
     if (!getPsuPresent(psu_id))
         info->status |= ONLP_PSU_STATUS_PRESENT;
-    else
+    else {
+        i2cLeaseEnd();
         return ONLP_STATUS_E_MISSING;
+    }
 
     getPsuInfo(psu_id, &psu);
+    i2cLeaseEnd();
 
     info->mvin = psu.vin;
     info->mvout = psu.vout;
@@ -8,6 +8,7 @@
 
 #include "x86_64_cel_redstone_xp_log.h"
 #include "platform.h"
+#include "i2c_chips.h"
 #include "sys_eeprom.h"
 #include "redstone_cpld.h"
 
@@ -115,6 +116,8 @@ onlp_sysi_platform_manage_fans(void)
     static int o_speed = 0, o_psu_speed[2] = {0,0};
     onlp_thermal_info_t t_info;
 
+    /* One bus grant for the whole sweep */
+    i2cLeaseBegin();
     for (i = 1; i < PSU_FAN; i++) {
         onlp_thermali_info_get(ONLP_THERMAL_ID_CREATE(i), &t_info);
         if (t_info.mcelsius) {
@@ -143,6 +146,7 @@ onlp_sysi_platform_manage_fans(void)
             }
         }
     }
+    i2cLeaseEnd();
 
     return ONLP_STATUS_OK;
 }
@@ -51,6 +51,7 @@ onlp_thermali_info_get(onlp_oid_t id, onlp_thermal_info_t* info)
 
     *info = thermal_info[sensor_id];
 
+    i2cLeaseBegin();
     switch (sensor_id) {
       case THERMAL_MAIN_BOARD_REAR:
       case THERMAL_MAIN_BOARD_FRONT:
@@ -68,6 +69,7 @@ onlp_thermali_info_get(onlp_oid_t id, onlp_thermal_info_t* info)
         info->mcelsius = psu.temp;
         break;
     }
+    i2cLeaseEnd();
     return ONLP_STATUS_OK;
 }
 
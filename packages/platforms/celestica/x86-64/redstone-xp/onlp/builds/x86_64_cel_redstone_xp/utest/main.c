@@ -0,0 +1,327 @@
+/**************************************************************************//**
+ *
+ * Bus lease test.
+ *
+ * The chip side of the board is reached through a PCA9541 master
+ * selector shared with the BMC and two PCA9548 muxes. i2c_chips.c is
+ * built here against a simulated bus so a telemetry sweep can be run
+ * with and without a lease, counting transactions and checking that no
+ * device is accessed without the grant and its channel selected.
+ *
+ *****************************************************************************/
+#include <x86_64_cel_redstone_xp/x86_64_cel_redstone_xp_config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/io.h>
+#include <AIM/aim.h>
+
+/* No port I/O or delays in the simulation; getCpuId() sees a non-PSoC board */
+static int sim_iopl__(int level) { return 0; }
+static unsigned int sim_inl__(unsigned short port) { return 0; }
+static void sim_outl__(unsigned int value, unsigned short port) { }
+static int sim_usleep__(useconds_t us) { return 0; }
+
+#define iopl            sim_iopl__
+#define inl_p           sim_inl__
+#define outl_p          sim_outl__
+#define usleep          sim_usleep__
+
+#include "../module/src/i2c_chips.c"
+
+#define SEL_ADDR        0x70
+#define SEL_CR          0x01
+#define SEL_CR_OWNED    0x04    /* Get_Control_Bus_Mask() == 0xff */
+#define SEL_CR_OTHER    0x01
+
+static struct {
+    int owned;
+    unsigned char mux[MUX_NUM];
+    unsigned char pca9506[0x28];
+
+    /* Transactions */
+    int sel_reads;
+    int sel_writes;
+    int mux_writes;
+    int dev;
+
+    /* Accesses to a device that was not reachable */
+    int violations;
+    /* Accesses failed on purpose */
+    int failed;
+
+    /* BMC takes the bus before the next selector read */
+    int steal;
+    /* Device transaction that fails and resets the muxes, 0 for none */
+    int glitch_at;
+} sim;
+
+unsigned int i2c_dev_errors = 0;
+
+static int
+sim_error__(void)
+{
+    i2c_dev_errors++;
+    return -1;
+}
+
+static int
+sim_device__(char addr)
+{
+    int i;
+    int m;
+
+    sim.dev++;
+    if(sim.glitch_at && sim.dev == sim.glitch_at) {
+        memset(sim.mux, 0, sizeof(sim.mux));
+        sim.failed++;
+        return sim_error__();
+    }
+
+    for(i = 0; i < NUM_CHIPS; i++) {
+        if(i2c_chips[i].addr != addr) {
+            continue;
+        }
+        if(!sim.owned) {
+            break;
+        }
+        for(m = 0; m < MUX_NUM; m++) {
+            unsigned char want = (mux_addr[m] == i2c_chips[i].sw_addr) ?
+                (1 << i2c_chips[i].channel) : 0;
+            if(sim.mux[m] != want) {
+                break;
+            }
+        }
+        if(m == MUX_NUM) {
+            return 0;
+        }
+        break;
+    }
+
+    sim.violations++;
+    return sim_error__();
+}
+
+int
+chips_read_byte(char addr, __u8 reg, __u8 *data)
+{
+    if(addr == SEL_ADDR) {
+        sim.sel_reads++;
+        if(sim.steal) {
+            sim.steal = 0;
+            sim.owned = 0;
+            /* The BMC leaves a channel of its own open */
+            sim.mux[0] = 0x01;
+            sim.mux[1] = 0x00;
+        }
+        *data = sim.owned ? SEL_CR_OWNED : SEL_CR_OTHER;
+        return 0;
+    }
+    if(sim_device__(addr) < 0) {
+        return -1;
+    }
+    *data = (addr == PCA9506_ADDR && reg < sizeof(sim.pca9506)) ?
+        sim.pca9506[reg] : 0x10;
+    return 0;
+}
+
+int
+chips_write_byte(char addr, __u8 reg, const __u8 data)
+{
+    int m;
+
+    if(addr == SEL_ADDR) {
+        sim.sel_writes++;
+        if(reg == SEL_CR) {
+            sim.owned = 1;
+        }
+        return 0;
+    }
+    if((m = muxIndex(addr)) >= 0) {
+        sim.mux_writes++;
+        if(!sim.owned) {
+            sim.violations++;
+            return sim_error__();
+        }
+        sim.mux[m] = data;
+        return 0;
+    }
+    if(sim_device__(addr) < 0) {
+        return -1;
+    }
+    if(addr == PCA9506_ADDR && reg < sizeof(sim.pca9506)) {
+        sim.pca9506[reg] = data;
+    }
+    return 0;
+}
+
+int
+chips_read_word(char addr, __u8 reg, unsigned short *data)
+{
+    if(sim_device__(addr) < 0) {
+        return -1;
+    }
+    *data = 0x0190;
+    return 0;
+}
+
+int
+chips_write_word_pec(char addr, __u8 reg, unsigned short data, int pec_flag)
+{
+    return sim_device__(addr);
+}
+
+int
+read_cpld(int reg, unsigned char *value)
+{
+    *value = 0;
+    return 0;
+}
+
+int
+write_cpld(int reg, unsigned char value)
+{
+    return 0;
+}
+
+static void
+sim_clear__(void)
+{
+    sim.sel_reads = sim.sel_writes = sim.mux_writes = sim.dev = 0;
+    sim.violations = sim.failed = 0;
+    sim.steal = sim.glitch_at = 0;
+}
+
+/* What the fan, PSU and thermal info calls read in one sweep */
+static int
+sweep__(int lease)
+{
+    int errors = 0;
+    int i;
+    int v;
+    short t;
+    struct psuInfo psu;
+
+    if(lease) {
+        i2cLeaseBegin();
+    }
+    for(i = 0; i < 4; i++) {
+        errors += tsTempGet(i, &t) < 0;
+    }
+    for(i = 0; i < 2; i++) {
+        errors += getPsuPresent(i) != 0;
+        errors += getPsuInfo(i, &psu) < 0;
+    }
+    for(i = 0; i < FAN_NUM; i++) {
+        errors += getFanPresent(i) != 0;
+        errors += getFanAirflow(i) < 0;
+        errors += fanSpeedGet(i, &v) < 0;
+        errors += fanPwmGet(i, &v) < 0;
+    }
+    if(lease) {
+        errors += i2cLeaseEnd() < 0;
+    }
+    return errors;
+}
+
+static int failures = 0;
+
+#define CHECK(_expr)                                                    \
+    do {                                                                \
+        if(!(_expr)) {                                                  \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #_expr); \
+            failures++;                                                 \
+        }                                                               \
+    } while(0)
+
+static void
+show__(const char* what, int errors)
+{
+    printf("%-12s selector %3d read %d write  mux %3d  device %3d  "
+           "errors %d  violations %d\n",
+           what, sim.sel_reads, sim.sel_writes, sim.mux_writes, sim.dev,
+           errors, sim.violations);
+}
+
+int aim_main(int argc, char* argv[])
+{
+    int errors;
+    int sel_reads;
+    int mux_writes;
+    int dev;
+    short t;
+
+    x86_64_cel_redstone_xp_config_show(&aim_pvs_stdout);
+
+    /* Claim the bus once so both sweeps start from the same state */
+    sim.owned = 0;
+    CHECK(getCtrlOfBus() == 0);
+    CHECK(sim.owned);
+    sim_clear__();
+
+    /* Without a lease: every access selects and deselects its channel */
+    errors = sweep__(0);
+    show__("no lease", errors);
+    CHECK(errors == 0);
+    CHECK(sim.violations == 0);
+    CHECK(sim.sel_writes == 0);
+    sel_reads = sim.sel_reads;
+    mux_writes = sim.mux_writes;
+    dev = sim.dev;
+    sim_clear__();
+
+    /*
+     * With a lease: the grant is still confirmed by one read per
+     * getCtrlOfBus(), but channels are only switched when needed.
+     */
+    errors = sweep__(1);
+    show__("lease", errors);
+    CHECK(errors == 0);
+    CHECK(sim.violations == 0);
+    CHECK(sim.sel_reads == sel_reads);
+    CHECK(sim.sel_writes == 0);
+    CHECK(sim.dev == dev);
+    CHECK(sim.mux_writes < mux_writes / 4);
+    CHECK(sim.mux[0] == 0 && sim.mux[1] == 0);
+    sim_clear__();
+
+    /* The BMC takes the bus back part way through a leased sweep */
+    i2cLeaseBegin();
+    CHECK(tsTempGet(0, &t) == 0);
+    sim.steal = 1;
+    CHECK(tsTempGet(1, &t) == 0);
+    CHECK(tsTempGet(2, &t) == 0);
+    errors = i2cLeaseEnd() < 0;
+    show__("lost grant", errors);
+    CHECK(errors == 0);
+    CHECK(sim.violations == 0);
+    CHECK(sim.sel_writes == 1);
+    CHECK(sim.mux[0] == 0 && sim.mux[1] == 0);
+    sim_clear__();
+
+    /*
+     * A failed transfer resets the muxes behind the lease's back, here
+     * on the first PCA9506 access, which is followed by more on the
+     * same channel.
+     */
+    sim.glitch_at = 5;
+    errors = sweep__(1);
+    show__("glitch", errors);
+    CHECK(sim.failed == 1);
+    CHECK(errors <= 1);
+    CHECK(sim.violations == 0);
+    CHECK(sim.mux[0] == 0 && sim.mux[1] == 0);
+    sim_clear__();
+
+    /* Steady state again */
+    errors = sweep__(1);
+    show__("lease", errors);
+    CHECK(errors == 0);
+    CHECK(sim.violations == 0);
+    CHECK(sim.sel_reads == sel_reads);
+
+    printf("%d failures\n", failures);
+    return failures ? 1 : 0;
+}
@@ -89,6 +89,16 @@
 #define X86_64_CEL_SILVERSTONE_CONFIG_INCLUDE_UCLI 0
 #endif
 
+/**
+ * X86_64_CEL_SILVERSTONE_CONFIG_IPMI_CACHE_TTL_MS
+ *
+ * Lifetime of the IPMI sensor and FRU cache. */
+
+
+#ifndef X86_64_CEL_SILVERSTONE_CONFIG_IPMI_CACHE_TTL_MS
+#define X86_64_CEL_SILVERSTONE_CONFIG_IPMI_CACHE_TTL_MS 30000
+#endif
+
 
 
 /**
@@ -0,0 +1,753 @@
+//////////////////////////////////////////////////////////////
+//   IPMI SENSOR AND FRU CACHE                              //
+//////////////////////////////////////////////////////////////
+
+/*
+ * Sensors are taken from the full sensor records of the SDR repository
+ * and read with Get Sensor Reading. Their thresholds are read once,
+ * with the records. FRU devices are taken from the FRU device locator
+ * records and only their common header and board info area are read.
+ * These are read on every refresh, so a swapped PSU or fan tray shows
+ * up on the next one even if the slot never reported empty.
+ *
+ * The SDRs are read again only when the repository reports a change.
+ * A refresh fills a new table and swaps it in under the lock before
+ * the generation is bumped, so readers never see a partial table.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/ipmi.h>
+
+#include <x86_64_cel_silverstone/x86_64_cel_silverstone_config.h>
+#include "x86_64_cel_silverstone_log.h"
+#include "ipmi_cache.h"
+
+#define IPMI_NETFN_SENSOR               0x04
+#define IPMI_NETFN_STORAGE              0x0A
+
+#define IPMI_CMD_GET_SENSOR_THRESHOLDS  0x27
+#define IPMI_CMD_GET_SENSOR_READING     0x2D
+#define IPMI_CMD_GET_FRU_AREA_INFO      0x10
+#define IPMI_CMD_READ_FRU_DATA          0x11
+#define IPMI_CMD_GET_SDR_REPO_INFO      0x20
+#define IPMI_CMD_RESERVE_SDR_REPO       0x22
+#define IPMI_CMD_GET_SDR                0x23
+
+#define IPMI_CC_RESERVATION_CANCELLED   0xC5
+#define IPMI_CC_TIMEOUT                 0xC3
+#define IPMI_CC_REQ_DATA_LEN_INVALID    0xC7
+#define IPMI_CC_REQ_DATA_LEN_EXCEEDED   0xC8
+#define IPMI_CC_CANT_RETURN_BYTES       0xCA
+
+#define IPMI_READING_UNAVAILABLE        0x20
+#define IPMI_SCANNING_ENABLED           0x40
+
+#define SDR_TYPE_FULL                   0x01
+#define SDR_TYPE_FRU_LOCATOR            0x11
+#define SDR_HEADER_LEN                  5
+#define SDR_RECORD_MAX                  128
+#define SDR_LAST_RECORD                 0xFFFF
+#define SDR_MAX_RECORDS                 512
+
+#define FRU_HEADER_LEN                  8
+#define FRU_AREA_MAX                    (255 * 8)
+
+#define IPMI_CACHE_SENSOR_MAX           128
+#define IPMI_CACHE_FRU_MAX              32
+
+#define IPMI_CHUNK                      16
+#define IPMI_TIMEOUT_MS                 5000
+
+/* TTL override in seconds, as used by the ipmitool based cache */
+#define IPMI_CACHE_INTERVAL_PATH        "/var/opt/interval_time.txt"
+
+typedef struct sdr_sensor_s {
+    char name[IPMI_CACHE_NAME_MAX];
+    uint8_t number;
+    uint8_t lun;
+    uint8_t format;
+    uint8_t linear;
+    int16_t m;
+    int16_t b;
+    int8_t k1;
+    int8_t k2;
+    int thresholds;
+    double unc;
+    double ucr;
+    double unr;
+} sdr_sensor_t;
+
+typedef struct sdr_fru_s {
+    char name[IPMI_CACHE_NAME_MAX];
+    uint8_t id;
+} sdr_fru_t;
+
+typedef struct cache_table_s {
+    int sensor_count;
+    ipmi_sensor_t sensors[IPMI_CACHE_SENSOR_MAX];
+    int fru_count;
+    ipmi_fru_t frus[IPMI_CACHE_FRU_MAX];
+} cache_table_t;
+
+static const char *ipmi_dev_paths[] = {
+    "/dev/ipmi0",
+    "/dev/ipmi/0",
+    "/dev/ipmidev/0",
+};
+
+/* The table pointer. Readers copy entries out under it. */
+static pthread_mutex_t table_lock = PTHREAD_MUTEX_INITIALIZER;
+static cache_table_t *table;
+static uint32_t generation;
+
+/* Everything below is only used under refresh_lock. */
+static pthread_mutex_t refresh_lock = PTHREAD_MUTEX_INITIALIZER;
+static int ipmi_fd = -1;
+static long ipmi_msgid;
+static int ttl_ms = -1;
+static uint64_t refresh_ms;
+static int sdr_loaded;
+static uint8_t sdr_stamp[10];
+static int sdr_sensor_count;
+static sdr_sensor_t sdr_sensors[IPMI_CACHE_SENSOR_MAX];
+static int sdr_fru_count;
+static sdr_fru_t sdr_frus[IPMI_CACHE_FRU_MAX];
+
+static uint64_t now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int cache_ttl_ms(void)
+{
+    FILE *fp;
+    int interval;
+
+    if (ttl_ms >= 0)
+        return ttl_ms;
+
+    ttl_ms = X86_64_CEL_SILVERSTONE_CONFIG_IPMI_CACHE_TTL_MS;
+    fp = fopen(IPMI_CACHE_INTERVAL_PATH, "r");
+    if (fp)
+    {
+        if (fscanf(fp, "%d", &interval) == 1 && interval > 0)
+            ttl_ms = interval * 1000;
+        fclose(fp);
+    }
+    return ttl_ms;
+}
+
+static int ipmi_open(void)
+{
+    int i;
+
+    for (i = 0; i < sizeof(ipmi_dev_paths) / sizeof(ipmi_dev_paths[0]); i++)
+    {
+        ipmi_fd = open(ipmi_dev_paths[i], O_RDWR | O_CLOEXEC);
+        if (ipmi_fd >= 0)
+            return 0;
+    }
+    AIM_LOG_ERROR("ipmi: can't open the IPMI device: %{errno}", errno);
+    return -1;
+}
+
+/*
+ * Send a request to the BMC and wait for its response. Returns the
+ * response length, including the completion code in rsp[0], or -1.
+ */
+static int ipmi_cmd(uint8_t netfn, uint8_t cmd, uint8_t lun,
+                    const uint8_t *req, int req_len, uint8_t *rsp, int rsp_max)
+{
+    struct ipmi_system_interface_addr addr;
+    struct ipmi_addr raddr;
+    struct ipmi_req ireq;
+    struct ipmi_recv irecv;
+    struct pollfd pfd;
+    uint8_t buf[IPMI_MAX_MSG_LENGTH];
+    long msgid;
+    int rv;
+
+    if (ipmi_fd < 0 && ipmi_open() < 0)
+        return -1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.addr_type = IPMI_SYSTEM_INTERFACE_ADDR_TYPE;
+    addr.channel = IPMI_BMC_CHANNEL;
+    addr.lun = lun;
+
+    msgid = ++ipmi_msgid;
+    memset(&ireq, 0, sizeof(ireq));
+    ireq.addr = (unsigned char *)&addr;
+    ireq.addr_len = sizeof(addr);
+    ireq.msgid = msgid;
+    ireq.msg.netfn = netfn;
+    ireq.msg.cmd = cmd;
+    ireq.msg.data = (unsigned char *)req;
+    ireq.msg.data_len = req_len;
+
+    if (ioctl(ipmi_fd, IPMICTL_SEND_COMMAND, &ireq) < 0)
+    {
+        AIM_LOG_ERROR("ipmi: netfn 0x%x cmd 0x%x send failed: %{errno}", netfn, cmd, errno);
+        return -1;
+    }
+
+    for (;;)
+    {
+        pfd.fd = ipmi_fd;
+        pfd.events = POLLIN;
+        rv = poll(&pfd, 1, IPMI_TIMEOUT_MS);
+        if (rv < 0 && errno == EINTR)
+            continue;
+        if (rv <= 0)
+        {
+            AIM_LOG_ERROR("ipmi: netfn 0x%x cmd 0x%x timed out", netfn, cmd);
+            return -1;
+        }
+
+        memset(&irecv, 0, sizeof(irecv));
+        irecv.addr = (unsigned char *)&raddr;
+        irecv.addr_len = sizeof(raddr);
+        irecv.msg.data = buf;
+        irecv.msg.data_len = sizeof(buf);
+        if (ioctl(ipmi_fd, IPMICTL_RECEIVE_MSG_TRUNC, &irecv) < 0)
+        {
+            if (errno == EAGAIN || errno == EINTR)
+                continue;
+            AIM_LOG_ERROR("ipmi: netfn 0x%x cmd 0x%x receive failed: %{errno}", netfn, cmd, errno);
+            return -1;
+        }
+
+        /* Late responses to requests that timed out are dropped */
+        if (irecv.recv_type == IPMI_RESPONSE_RECV_TYPE && irecv.msgid == msgid)
+            break;
+    }
+
+    if (irecv.msg.data_len < 1)
+        return -1;
+    rv = irecv.msg.data_len < rsp_max ? irecv.msg.data_len : rsp_max;
+    memcpy(rsp, buf, rv);
+    return rv;
+}
+
+/* Decode an IPMI type/length coded string, trimming spaces. */
+static void field_decode(uint8_t type_len, const uint8_t *data, char *out, int max)
+{
+    static const char bcd_plus[] = "0123456789 -.???";
+    int len = type_len & 0x3f;
+    int i, o = 0;
+
+    switch (type_len >> 6)
+    {
+    case 0: /* binary */
+        for (i = 0; i < len && o + 3 <= max; i++)
+            o += snprintf(out + o, max - o, "%02x", data[i]);
+        break;
+    case 1: /* BCD plus */
+        for (i = 0; i < len && o + 3 <= max; i++)
+        {
+            out[o++] = bcd_plus[data[i] >> 4];
+            out[o++] = bcd_plus[data[i] & 0xf];
+        }
+        break;
+    case 2: /* 6-bit ASCII, packed */
+        for (i = 0; i < len * 8 / 6 && o + 1 < max; i++)
+        {
+            int bit = i * 6;
+            int v = data[bit / 8] >> (bit % 8);
+            if (bit % 8 > 2 && bit / 8 + 1 < len)
+                v |= data[bit / 8 + 1] << (8 - bit % 8);
+            out[o++] = (v & 0x3f) + 0x20;
+        }
+        break;
+    default: /* 8-bit ASCII */
+        for (i = 0; i < len && o + 1 < max; i++)
+            out[o++] = data[i];
+        break;
+    }
+    out[o] = '\0';
+
+    while (o > 0 && out[o - 1] == ' ')
+        out[--o] = '\0';
+    for (i = 0; out[i] == ' '; i++)
+        ;
+    if (i)
+        memmove(out, out + i, o - i + 1);
+}
+
+static int sign_extend(int value, int bits)
+{
+    return (value & (1 << (bits - 1))) ? value - (1 << bits) : value;
+}
+
+static double pow10_int(int k)
+{
+    double p = 1.0;
+    for (; k > 0; k--)
+        p *= 10.0;
+    for (; k < 0; k++)
+        p /= 10.0;
+    return p;
+}
+
+/*
+ * y = L[(M * x + B * 10^K1) * 10^K2]. Linearizations that need libm
+ * (logarithms, exponentials and roots) are not supported.
+ */
+static int sensor_convert(const sdr_sensor_t *s, uint8_t raw, double *value)
+{
+    double x, v;
+
+    switch (s->format)
+    {
+    case 0:
+        x = raw;
+        break;
+    case 1:
+        x = (raw & 0x80) ? -(double)(uint8_t)~raw : raw;
+        break;
+    case 2:
+        x = (int8_t)raw;
+        break;
+    default:
+        return -1;
+    }
+
+    v = (s->m * x + s->b * pow10_int(s->k1)) * pow10_int(s->k2);
+    switch (s->linear)
+    {
+    case 0:
+        break;
+    case 7:
+        if (v == 0)
+            return -1;
+        v = 1.0 / v;
+        break;
+    case 8:
+        v = v * v;
+        break;
+    case 9:
+        v = v * v * v;
+        break;
+    default:
+        return -1;
+    }
+    *value = v;
+    return 0;
+}
+
+static int sdr_reserve(uint16_t *rid)
+{
+    uint8_t rsp[8];
+    int n;
+
+    n = ipmi_cmd(IPMI_NETFN_STORAGE, IPMI_CMD_RESERVE_SDR_REPO, 0, NULL, 0, rsp, sizeof(rsp));
+    if (n < 3 || rsp[0])
+        return -1;
+    *rid = rsp[1] | rsp[2] << 8;
+    return 0;
+}
+
+/* Returns the bytes read, -1 on error or -2 if the reservation was lost. */
+static int sdr_get(uint16_t rid, uint16_t id, uint8_t offset, uint8_t len,
+                   uint8_t *data, uint16_t *next)
+{
+    uint8_t req[6] = { rid & 0xff, rid >> 8, id & 0xff, id >> 8, offset, len };
+    uint8_t rsp[IPMI_CHUNK + 3];
+    int n;
+
+    n = ipmi_cmd(IPMI_NETFN_STORAGE, IPMI_CMD_GET_SDR, 0, req, sizeof(req), rsp, sizeof(rsp));
+    if (n >= 1 && rsp[0] == IPMI_CC_RESERVATION_CANCELLED)
+        return -2;
+    if (n < 3 || rsp[0])
+        return -1;
+    *next = rsp[1] | rsp[2] << 8;
+    n -= 3;
+    if (n > len)
+        n = len;
+    memcpy(data, rsp + 3, n);
+    return n;
+}
+
+/* Read a record in chunks. Longer records are truncated to max. */
+static int sdr_record(uint16_t *rid, uint16_t id, uint8_t *rec, int max, uint16_t *next)
+{
+    int tries, len, off, n;
+
+    for (tries = 0; tries < 3; tries++)
+    {
+        n = sdr_get(*rid, id, 0, SDR_HEADER_LEN, rec, next);
+        if (n == SDR_HEADER_LEN)
+        {
+            len = SDR_HEADER_LEN + rec[4];
+            if (len > max)
+                len = max;
+            for (off = SDR_HEADER_LEN; off < len; off += n)
+            {
+                int want = len - off < IPMI_CHUNK ? len - off : IPMI_CHUNK;
+                if ((n = sdr_get(*rid, id, off, want, rec + off, next)) <= 0)
+                    break;
+            }
+            if (off >= len)
+                return len;
+        }
+        if (n != -2 || sdr_reserve(rid) < 0)
+            return -1;
+    }
+    return -1;
+}
+
+static void sdr_add_sensor(const uint8_t *rec, int len)
+{
+    sdr_sensor_t *s;
+
+    if (sdr_sensor_count >= IPMI_CACHE_SENSOR_MAX || len < 48 ||
+        48 + (rec[47] & 0x1f) > len)
+        return;
+
+    s = &sdr_sensors[sdr_sensor_count++];
+    memset(s, 0, sizeof(*s));
+    field_decode(rec[47] & 0xdf, rec + 48, s->name, sizeof(s->name));
+    s->lun = rec[6] & 0x3;
+    s->number = rec[7];
+    s->format = rec[20] >> 6;
+    s->linear = rec[23] & 0x7f;
+    s->m = sign_extend(rec[24] | (rec[25] & 0xc0) << 2, 10);
+    s->b = sign_extend(rec[26] | (rec[27] & 0xc0) << 2, 10);
+    s->k1 = sign_extend(rec[29] & 0xf, 4);
+    s->k2 = sign_extend(rec[29] >> 4, 4);
+}
+
+static void sdr_add_fru(const uint8_t *rec, int len)
+{
+    sdr_fru_t *f;
+
+    /* Only logical FRU devices are readable with Read FRU Data */
+    if (sdr_fru_count >= IPMI_CACHE_FRU_MAX || len < 16 || !(rec[7] & 0x80) ||
+        16 + (rec[15] & 0x1f) > len)
+        return;
+
+    f = &sdr_frus[sdr_fru_count++];
+    memset(f, 0, sizeof(*f));
+    field_decode(rec[15] & 0xdf, rec + 16, f->name, sizeof(f->name));
+    f->id = rec[6];
+}
+
+static void sdr_read_thresholds(sdr_sensor_t *s)
+{
+    uint8_t rsp[8];
+    double v;
+    int n;
+
+    n = ipmi_cmd(IPMI_NETFN_SENSOR, IPMI_CMD_GET_SENSOR_THRESHOLDS, s->lun,
+                 &s->number, 1, rsp, sizeof(rsp));
+    if (n < 8 || rsp[0])
+        return;
+
+    if ((rsp[1] & IPMI_CACHE_THRESHOLD_UNC) && sensor_convert(s, rsp[5], &v) == 0)
+    {
+        s->thresholds |= IPMI_CACHE_THRESHOLD_UNC;
+        s->unc = v;
+    }
+    if ((rsp[1] & IPMI_CACHE_THRESHOLD_UCR) && sensor_convert(s, rsp[6], &v) == 0)
+    {
+        s->thresholds |= IPMI_CACHE_THRESHOLD_UCR;
+        s->ucr = v;
+    }
+    if ((rsp[1] & IPMI_CACHE_THRESHOLD_UNR) && sensor_convert(s, rsp[7], &v) == 0)
+    {
+        s->thresholds |= IPMI_CACHE_THRESHOLD_UNR;
+        s->unr = v;
+    }
+}
+
+static int sdr_load(void)
+{
+    uint8_t rec[SDR_RECORD_MAX];
+    uint16_t rid, id = 0, next = 0;
+    int i, len, count;
+
+    sdr_sensor_count = 0;
+    sdr_fru_count = 0;
+    if (sdr_reserve(&rid) < 0)
+        return -1;
+
+    for (count = 0; id != SDR_LAST_RECORD && count < SDR_MAX_RECORDS; count++)
+    {
+        if ((len = sdr_record(&rid, id, rec, sizeof(rec), &next)) < 0)
+            return -1;
+        if (rec[3] == SDR_TYPE_FULL)
+            sdr_add_sensor(rec, len);
+        else if (rec[3] == SDR_TYPE_FRU_LOCATOR)
+            sdr_add_fru(rec, len);
+        if (next == id)
+            break;
+        id = next;
+    }
+
+    for (i = 0; i < sdr_sensor_count; i++)
+        sdr_read_thresholds(&sdr_sensors[i]);
+    return 0;
+}
+
+/* Load the SDRs if they are not loaded or the repository has changed. */
+static int sdr_check(void)
+{
+    uint8_t rsp[16];
+    int n;
+
+    n = ipmi_cmd(IPMI_NETFN_STORAGE, IPMI_CMD_GET_SDR_REPO_INFO, 0, NULL, 0, rsp, sizeof(rsp));
+    if (n < 14 || rsp[0])
+        return sdr_loaded ? 0 : -1;
+
+    /* Record count and the last addition and erase times */
+    if (sdr_loaded && memcmp(sdr_stamp, rsp + 2, 2) == 0 &&
+        memcmp(sdr_stamp + 2, rsp + 6, 8) == 0)
+        return 0;
+
+    sdr_loaded = 0;
+    if (sdr_load() < 0)
+        return -1;
+    memcpy(sdr_stamp, rsp + 2, 2);
+    memcpy(sdr_stamp + 2, rsp + 6, 8);
+    sdr_loaded = 1;
+    return 0;
+}
+
+static void sensor_read(const sdr_sensor_t *s, ipmi_sensor_t *out)
+{
+    uint8_t rsp[8];
+    int n;
+
+    memset(out, 0, sizeof(*out));
+    strcpy(out->name, s->name);
+    out->thresholds = s->thresholds;
+    out->unc = s->unc;
+    out->ucr = s->ucr;
+    out->unr = s->unr;
+
+    n = ipmi_cmd(IPMI_NETFN_SENSOR, IPMI_CMD_GET_SENSOR_READING, s->lun,
+                 &s->number, 1, rsp, sizeof(rsp));
+    if (n < 3 || rsp[0] || (rsp[2] & IPMI_READING_UNAVAILABLE) ||
+        !(rsp[2] & IPMI_SCANNING_ENABLED))
+        return;
+    if (sensor_convert(s, rsp[1], &out->value) == 0)
+        out->available = 1;
+}
+
+static int fru_read(uint8_t id, int words, int offset, int len, uint8_t *data)
+{
+    uint8_t req[4];
+    uint8_t rsp[IPMI_CHUNK + 2];
+    int chunk = IPMI_CHUNK;
+    int done = 0;
+    int n, want, got;
+
+    while (done < len)
+    {
+        want = len - done < chunk ? len - done : chunk;
+        req[0] = id;
+        req[1] = ((offset + done) >> words) & 0xff;
+        req[2] = ((offset + done) >> words) >> 8;
+        req[3] = (want + words) >> words;
+
+        n = ipmi_cmd(IPMI_NETFN_STORAGE, IPMI_CMD_READ_FRU_DATA, 0, req, sizeof(req), rsp, sizeof(rsp));
+        if (n >= 1 && chunk > 2 &&
+            (rsp[0] == IPMI_CC_REQ_DATA_LEN_INVALID || rsp[0] == IPMI_CC_REQ_DATA_LEN_EXCEEDED ||
+             rsp[0] == IPMI_CC_CANT_RETURN_BYTES || rsp[0] == IPMI_CC_TIMEOUT))
+        {
+            chunk /= 2;
+            continue;
+        }
+        if (n < 2 || rsp[0] || rsp[1] == 0)
+            return -1;
+
+        got = rsp[1] << words;
+        if (got > n - 2)
+            got = n - 2;
+        if (got > want)
+            got = want;
+        if (got <= 0)
+            return -1;
+        memcpy(data + done, rsp + 2, got);
+        done += got;
+    }
+    return 0;
+}
+
+/* Read the board info area: manufacturer, product, serial, part, file id, extras. */
+static void fru_load(const sdr_fru_t *f, int size, int words, ipmi_fru_t *out)
+{
+    uint8_t hdr[FRU_HEADER_LEN];
+    uint8_t area[FRU_AREA_MAX];
+    int board, len, p, field;
+
+    memset(out, 0, sizeof(*out));
+    strcpy(out->name, f->name);
+
+    if (fru_read(f->id, words, 0, FRU_HEADER_LEN, hdr) < 0)
+        return;
+    out->present = 1;
+
+    board = hdr[3] * 8;
+    if (hdr[0] != 0x01 || board == 0 || board + 2 > size)
+        return;
+    if (fru_read(f->id, words, board, 2, area) < 0)
+        return;
+    len = area[1] * 8;
+    if (len < 8 || board + len > size || fru_read(f->id, words, board, len, area) < 0)
+        return;
+
+    /* Skip version, length, language and the manufacturing date */
+    for (p = 6, field = 0; p < len && area[p] != 0xC1; field++)
+    {
+        char *dst = NULL;
+        int flen = area[p] & 0x3f;
+
+        if (p + 1 + flen > len)
+            break;
+        switch (field)
+        {
+        case 1:
+            dst = out->board_product;
+            break;
+        case 2:
+            dst = out->board_serial;
+            break;
+        case 3:
+            dst = out->board_part_number;
+            break;
+        default:
+            if (field >= 5 && out->board_extra_count < IPMI_CACHE_EXTRA_MAX)
+                dst = out->board_extra[out->board_extra_count++];
+            break;
+        }
+        if (dst)
+            field_decode(area[p], area + p + 1, dst, IPMI_CACHE_FIELD_MAX);
+        p += 1 + flen;
+    }
+}
+
+static void fru_read_info(const sdr_fru_t *f, ipmi_fru_t *out)
+{
+    uint8_t rsp[8];
+    uint8_t req = f->id;
+    int n, size;
+
+    n = ipmi_cmd(IPMI_NETFN_STORAGE, IPMI_CMD_GET_FRU_AREA_INFO, 0, &req, 1, rsp, sizeof(rsp));
+    size = n >= 4 && rsp[0] == 0 ? rsp[1] | rsp[2] << 8 : 0;
+    if (size < FRU_HEADER_LEN)
+    {
+        memset(out, 0, sizeof(*out));
+        strcpy(out->name, f->name);
+        return;
+    }
+    fru_load(f, size, rsp[3] & 0x1, out);
+}
+
+int ipmi_cache_refresh(int force)
+{
+    cache_table_t *t, *old;
+    uint64_t now;
+    int i, rv = 0;
+
+    if (pthread_mutex_trylock(&refresh_lock) != 0)
+    {
+        /* Being refreshed; serve the current contents meanwhile */
+        if (!force && ipmi_cache_generation() != 0)
+            return 0;
+        pthread_mutex_lock(&refresh_lock);
+    }
+
+    now = now_ms();
+    if (!force && refresh_ms && now - refresh_ms < cache_ttl_ms())
+        goto done;
+    /* Also on failure, so an absent BMC is not retried on every call */
+    refresh_ms = now;
+
+    if (sdr_check() < 0)
+    {
+        rv = -1;
+        goto done;
+    }
+
+    t = calloc(1, sizeof(*t));
+    if (t == NULL)
+    {
+        rv = -1;
+        goto done;
+    }
+    for (i = 0; i < sdr_sensor_count; i++)
+        sensor_read(&sdr_sensors[i], &t->sensors[i]);
+    t->sensor_count = sdr_sensor_count;
+    for (i = 0; i < sdr_fru_count; i++)
+        fru_read_info(&sdr_frus[i], &t->frus[i]);
+    t->fru_count = sdr_fru_count;
+
+    pthread_mutex_lock(&table_lock);
+    old = table;
+    table = t;
+    pthread_mutex_unlock(&table_lock);
+    __atomic_add_fetch(&generation, 1, __ATOMIC_RELEASE);
+    free(old);
+
+done:
+    pthread_mutex_unlock(&refresh_lock);
+    return rv;
+}
+
+uint32_t ipmi_cache_generation(void)
+{
+    return __atomic_load_n(&generation, __ATOMIC_ACQUIRE);
+}
+
+int ipmi_cache_sensor_get(const char *name, ipmi_sensor_t *sensor)
+{
+    int i, rv = -1;
+
+    ipmi_cache_refresh(0);
+
+    pthread_mutex_lock(&table_lock);
+    for (i = 0; table && i < table->sensor_count; i++)
+    {
+        if (strcmp(table->sensors[i].name, name) == 0)
+        {
+            *sensor = table->sensors[i];
+            rv = 0;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&table_lock);
+    return rv;
+}
+
+int ipmi_cache_fru_get(const char *name, ipmi_fru_t *fru)
+{
+    int i, rv = -1;
+
+    ipmi_cache_refresh(0);
+
+    pthread_mutex_lock(&table_lock);
+    for (i = 0; table && i < table->fru_count; i++)
+    {
+        if (strcmp(table->frus[i].name, name) == 0)
+        {
+            *fru = table->frus[i];
+            rv = 0;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&table_lock);
+    return rv;
+}
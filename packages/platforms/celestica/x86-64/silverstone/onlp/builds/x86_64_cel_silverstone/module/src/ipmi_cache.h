@@ -0,0 +1,53 @@
+#ifndef _IPMI_CACHE_H_
+#define _IPMI_CACHE_H_
+#include <stdint.h>
+
+/*
+ * In-process cache of the BMC sensor readings and FRU board info,
+ * read through the OpenIPMI driver.
+ */
+
+#define IPMI_CACHE_NAME_MAX     17
+#define IPMI_CACHE_FIELD_MAX    64
+#define IPMI_CACHE_EXTRA_MAX    4
+
+/* Readable threshold bits, as in Get Sensor Thresholds */
+#define IPMI_CACHE_THRESHOLD_UNC 0x08
+#define IPMI_CACHE_THRESHOLD_UCR 0x10
+#define IPMI_CACHE_THRESHOLD_UNR 0x20
+
+typedef struct ipmi_sensor_s {
+    char name[IPMI_CACHE_NAME_MAX];
+    int available;          /* 0 where ipmitool shows "na" */
+    double value;
+    int thresholds;         /* IPMI_CACHE_THRESHOLD_* */
+    double unc;
+    double ucr;
+    double unr;
+} ipmi_sensor_t;
+
+typedef struct ipmi_fru_s {
+    char name[IPMI_CACHE_NAME_MAX];
+    int present;
+    char board_product[IPMI_CACHE_FIELD_MAX];
+    char board_serial[IPMI_CACHE_FIELD_MAX];
+    char board_part_number[IPMI_CACHE_FIELD_MAX];
+    char board_extra[IPMI_CACHE_EXTRA_MAX][IPMI_CACHE_FIELD_MAX];
+    int board_extra_count;
+} ipmi_fru_t;
+
+/*
+ * Rebuild the cache if it is older than the TTL, or always if force
+ * is set. Returns 0, or -1 if the BMC could not be read (the previous
+ * contents are kept).
+ */
+int ipmi_cache_refresh(int force);
+
+/* Incremented each time new contents are published. 0 means empty. */
+uint32_t ipmi_cache_generation(void);
+
+/* Copy out an entry by its SDR name. Returns 0, or -1 if there is none. */
+int ipmi_cache_sensor_get(const char *name, ipmi_sensor_t *sensor);
+int ipmi_cache_fru_get(const char *name, ipmi_fru_t *fru);
+
+#endif /* _IPMI_CACHE_H_ */
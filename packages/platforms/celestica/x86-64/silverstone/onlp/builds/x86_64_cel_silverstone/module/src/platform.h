@@ -39,30 +39,11 @@
 #define LED_PSU_H   3
 #define NELEMS(x)  (sizeof(x) / sizeof((x)[0]))
 
-#define ONLP_SENSOR_CACHE_SHARED "/onlp-sensor-cache-shared"
-#define ONLP_FRU_CACHE_SHARED "/onlp-fru-cache-shared"
-#define ONLP_SENSOR_LIST_CACHE_SHARED "/onlp-sensor-list-cache-shared"
-
-#define ONLP_SENSOR_CACHE_SEM "/onlp-sensor-cache-sem"
-#define ONLP_FRU_CACHE_SEM "/onlp-fru-cache-sem"
-#define ONLP_SENSOR_LIST_SEM "/onlp-sensor-list-cache-sem"
-
-#define ONLP_SENSOR_CACHE_FILE "/tmp/onlp-sensor-cache.txt"
-#define ONLP_FRU_CACHE_FILE "/tmp/onlp-fru-cache.txt"
-#define ONLP_SENSOR_LIST_FILE "/tmp/onlp-sensor-list-cache.txt"
-
 #define PSUL_ID 1
 #define PSUR_ID 2
 
 #define NUM_OF_CPLD 1
 
-#define USE_SHM_METHOD 0
-
-struct shm_map_data{
-    char data[16384]; 
-    int size;
-}; 
-
 struct device_info{
 	char serial_number[256];
 	char model[256];
@@ -113,11 +94,14 @@ typedef struct psuInfo_p
 	unsigned int rtemp;
 }psuInfo_p;
 
+#ifndef SYS_CPLD_PATH
 #define SYS_CPLD_PATH "/sys/devices/platform/sys_cpld/"
+#endif
 #define PLATFORM_PATH "/sys/devices/platform/cls-xcvr/"
 #define I2C_DEVICE_PATH "/sys/bus/i2c/devices/"
 #define PREFIX_PATH_ON_SYS_EEPROM "/sys/bus/i2c/devices/i2c-0/0-0056/eeprom"
 
+uint8_t read_register(uint16_t dev_reg);
 uint8_t get_led_status(int id);
 int get_psu_model_sn(int id,char* model,char* serial_number);
 
@@ -129,12 +113,6 @@ int read_device_node_binary(char *filename, char *buffer, int buf_size, int data
 int read_device_node_string(char *filename, char *buffer, int buf_size, int data_len);
 int get_fan_speed(int id,int* per,int* rpm);
 uint8_t get_psu_status(int id);
-int dump_shared_memory(const char *shm_path, const char *sem_path, struct shm_map_data *shared_mem);
-int fill_shared_memory(const char *shm_path, const char *sem_path, const char *cache_path);
-int open_file(const char *shm_path, const char *sem_path, char **cache_data, int *cache_size);
-int create_cache();
-void update_shm_mem(void);
-int is_cache_exist();
 
 #define DEBUG_MODE 0
 
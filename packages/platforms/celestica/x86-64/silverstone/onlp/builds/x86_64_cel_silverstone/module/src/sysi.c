@@ -10,11 +10,7 @@
 #include "x86_64_cel_silverstone_int.h"
 #include "x86_64_cel_silverstone_log.h"
 #include "platform.h"
-//Below include add for support Cache system
-#include <sys/stat.h>
-#include <time.h>
-#include <sys/mman.h>
-#include <semaphore.h>
+#include "ipmi_cache.h"
 
 static char arr_cplddev_name[NUM_OF_CPLD][10] =
 {
@@ -83,28 +79,19 @@ void onlp_sysi_onie_data_free(uint8_t *data)
 
 int onlp_sysi_platform_manage_init(void)
 {
-    if (is_cache_exist() < 1)
-    {
-        create_cache();
-    }
+    ipmi_cache_refresh(0);
     return ONLP_STATUS_OK;
 }
 
 int onlp_sysi_platform_manage_fans(void)
 {
-    if (is_cache_exist() < 1)
-    {
-        create_cache();
-    }
+    ipmi_cache_refresh(0);
     return ONLP_STATUS_OK;
 }
 
 int onlp_sysi_platform_manage_leds(void)
 {
-    if (is_cache_exist() < 1)
-    {
-        create_cache();
-    }
+    ipmi_cache_refresh(0);
     return ONLP_STATUS_OK;
 }
 
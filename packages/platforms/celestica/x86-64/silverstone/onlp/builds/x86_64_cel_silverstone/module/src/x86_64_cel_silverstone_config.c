@@ -44,6 +44,11 @@ x86_64_cel_silverstone_config_settings_t x86_64_cel_silverstone_config_settings[
     { __x86_64_cel_silverstone_config_STRINGIFY_NAME(X86_64_CEL_SILVERSTONE_CONFIG_INCLUDE_UCLI), __x86_64_cel_silverstone_config_STRINGIFY_VALUE(X86_64_CEL_SILVERSTONE_CONFIG_INCLUDE_UCLI) },
 #else
 { X86_64_CEL_SILVERSTONE_CONFIG_INCLUDE_UCLI(__x86_64_cel_silverstone_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef X86_64_CEL_SILVERSTONE_CONFIG_IPMI_CACHE_TTL_MS
+    { __x86_64_cel_silverstone_config_STRINGIFY_NAME(X86_64_CEL_SILVERSTONE_CONFIG_IPMI_CACHE_TTL_MS), __x86_64_cel_silverstone_config_STRINGIFY_VALUE(X86_64_CEL_SILVERSTONE_CONFIG_IPMI_CACHE_TTL_MS) },
+#else
+{ X86_64_CEL_SILVERSTONE_CONFIG_IPMI_CACHE_TTL_MS(__x86_64_cel_silverstone_config_STRINGIFY_NAME), "__undefined__" },
 #endif
     { NULL, NULL }
 };
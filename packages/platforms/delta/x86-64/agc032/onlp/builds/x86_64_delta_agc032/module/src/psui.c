@@ -58,38 +58,60 @@ int onlp_psui_info_get(onlp_oid_t oid, onlp_psu_info_t *info)
         return ONLP_STATUS_E_INVALID;
 
     if (info->status == ONLP_PSU_STATUS_UNPLUGGED)
+    {
+        if (psu->instance_invalidate)
+            psu->instance_invalidate(busDrv, psu_dev_list[id].bus, psu_dev_list[id].dev, id);
         return ONLP_STATUS_OK;
+    }
 
     vendor_dev_do_oc(psu_o_list[id]);
 
-    if (psu->model_get(
-            busDrv,
-            psu_dev_list[id].bus,
-            psu_dev_list[id].dev,
-            (char *)&info->model) != ONLP_STATUS_OK)
+    if (psu->instance_info_get)
     {
-        AIM_LOG_ERROR("psu->model_get failed.");
-        fail = 1;
+        if (psu->instance_info_get(
+                busDrv,
+                psu_dev_list[id].bus,
+                psu_dev_list[id].dev,
+                id,
+                (char *)&info->model,
+                (char *)&info->serial,
+                &runtimeInfo) != ONLP_STATUS_OK)
+        {
+            AIM_LOG_ERROR("psu->instance_info_get failed.");
+            fail = 1;
+        }
     }
-
-    if (psu->serial_get(
+    else
+    {
+        if (psu->model_get(
+                busDrv,
+                psu_dev_list[id].bus,
+                psu_dev_list[id].dev,
+                (char *)&info->model) != ONLP_STATUS_OK)
+        {
+            AIM_LOG_ERROR("psu->model_get failed.");
+            fail = 1;
+        }
+
+        if (psu->serial_get(
+                busDrv,
+                psu_dev_list[id].bus,
+                psu_dev_list[id].dev,
+                (char *)&info->serial) != ONLP_STATUS_OK)
+        {
+            AIM_LOG_ERROR("psu->serial_get failed.");
+            fail = 1;
+        }
+
+        if (psu->runtime_info_get(
             busDrv,
             psu_dev_list[id].bus,
             psu_dev_list[id].dev,
-            (char *)&info->serial) != ONLP_STATUS_OK)
-    {
-        AIM_LOG_ERROR("psu->serial_get failed.");
-        fail = 1;
-    }
-
-    if (psu->runtime_info_get(
-        busDrv,
-        psu_dev_list[id].bus,
-        psu_dev_list[id].dev,
-        &runtimeInfo))
-    {
-        AIM_LOG_ERROR("psu->runtime_info_get failed.");
-        fail = 1;
+            &runtimeInfo))
+        {
+            AIM_LOG_ERROR("psu->runtime_info_get failed.");
+            fail = 1;
+        }
     }
 
     /* millivolts */
@@ -21,6 +21,7 @@
  ************************************************************/
 #include <onlp/onlp.h>
 #include <onlplib/file.h>
+#include <onlplib/pmbus.h>
 #include <sys/mman.h>
 #include <errno.h>
 #include <string.h>
@@ -28,6 +29,7 @@
 #include <math.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <linux/i2c.h>
 #include <AIM/aim.h>
 #include "vendor_driver_pool.h"
 #include "vendor_i2c_device_list.h"
@@ -116,6 +118,9 @@ int VENDOR_DRV_SMBUS_Read_Block(int bus, uint8_t dev, uint16_t daddr, uint8_t *R
 int VENDOR_DRV_SMBUS_Write_Block(int bus, uint8_t dev, uint16_t daddr, uint8_t *value, uint16_t BufSize);
 int VENDOR_DRV_SMBUS_Read_I2C_Block(int bus, uint8_t dev, uint16_t daddr, uint8_t *ReplyBuf, uint16_t BufSize);
 int VENDOR_DRV_SMBUS_Write_I2C_Block(int bus, uint8_t dev, uint16_t daddr, uint8_t *value, uint16_t BufSize);
+int VENDOR_DRV_SMBUS_Read_I2C_Block16(int bus, uint8_t dev, uint16_t daddr, uint8_t *ReplyBuf, uint16_t BufSize);
+int VENDOR_DRV_SMBUS_Write_Wait(int bus, uint8_t dev);
+int VENDOR_DRV_SMBUS_Read_Block_Data(int bus, uint8_t dev, uint8_t command, uint8_t *ReplyBuf);
 
 int VENDOR_DRV_I2C_SMBUS_Access(int dev_fd, char read_write, uint8_t command, int size, union i2c_smbus_data *data);
 int VENDOR_DRV_I2C_SMBUS_Write_Quick(int dev_fd, uint8_t value);
@@ -142,7 +147,10 @@ static i2c_bus_driver_t smbus_functions = {
     VENDOR_DRV_SMBUS_Write_Block,
     VENDOR_DRV_SMBUS_Read_I2C_Block,
     VENDOR_DRV_SMBUS_Write_I2C_Block,
-    VENDOR_DRV_SMBUS_Probe};
+    VENDOR_DRV_SMBUS_Probe,
+    VENDOR_DRV_SMBUS_Read_I2C_Block16,
+    VENDOR_DRV_SMBUS_Write_Wait,
+    VENDOR_DRV_SMBUS_Read_Block_Data};
 
 static int smbus_driver_init()
 {
@@ -156,98 +164,216 @@ static int smbus_driver_init()
 
 /*================ internal function ================*/
 
-int VENDOR_DRV_SMBUS_Set_Byte(int bus, uint8_t dev, uint16_t daddr, uint8_t alen, uint16_t data, uint8_t dlen)
+/*
+ * /dev/i2c-N descriptors are kept open per bus and the slave address
+ * is only changed when it differs from the last transfer, so each
+ * access costs a single ioctl instead of open/ioctl/ioctl/close.
+ */
+#define SMBUS_FD_CACHE_SIZE 256
+
+typedef struct smbus_fd_cache_s
+{
+    int fd;
+    int slave;
+    unsigned long request;
+    unsigned long funcs;
+} smbus_fd_cache_t;
+
+static smbus_fd_cache_t smbus_fd_cache[SMBUS_FD_CACHE_SIZE];
+static int smbus_fd_cache_init = 0;
+
+/* Write cycle completion polling (EEPROM tWR is at most 10ms, PMBus devices ACK at once) */
+#define SMBUS_WRITE_POLL_TIMEOUT_US 30000
+#define SMBUS_WRITE_POLL_INTERVAL_US 500
+
+static int smbus_fd_get(int bus, uint8_t dev, unsigned long request, const char *tag)
 {
     char dev_path[20];
+    smbus_fd_cache_t *entry = NULL;
     int fd = -1;
-    int res = 0;
+    int index;
 
-    sprintf(dev_path, "/dev/i2c-%d", bus);
+    if (!smbus_fd_cache_init)
+    {
+        for (index = 0; index < SMBUS_FD_CACHE_SIZE; index++)
+        {
+            smbus_fd_cache[index].fd = -1;
+            smbus_fd_cache[index].slave = -1;
+        }
+        smbus_fd_cache_init = 1;
+    }
 
-    /* Open the SMBus device */
-    if ((fd = open(dev_path, O_RDWR | O_SYNC)) < 0)
+    if (bus >= 0 && bus < SMBUS_FD_CACHE_SIZE)
     {
-        AIM_LOG_ERROR("[SET] Can not open %s\n", dev_path);
-        return -1;
+        entry = &smbus_fd_cache[bus];
+        fd = entry->fd;
+    }
+
+    if (fd < 0)
+    {
+        sprintf(dev_path, "/dev/i2c-%d", bus);
+
+        /* Open the SMBus device */
+        if ((fd = open(dev_path, O_RDWR)) < 0)
+        {
+            AIM_LOG_ERROR("[%s] Can not open %s\n", tag, dev_path);
+            return -1;
+        }
+
+        if (entry)
+        {
+            entry->fd = fd;
+            entry->slave = -1;
+            if (ioctl(fd, I2C_FUNCS, &entry->funcs) < 0)
+            {
+                entry->funcs = 0;
+            }
+        }
+    }
+
+    if (entry && entry->slave == dev && entry->request == request)
+    {
+        return fd;
     }
 
     /* set slave address */
-    if (ioctl(fd, I2C_SLAVE, dev) < 0)
+    if (ioctl(fd, request, dev) < 0)
     {
         if (errno != EBUSY)
         {
-            AIM_LOG_ERROR("[SET] Can not set device address 0x%02X,shift=0\n", dev);
+            AIM_LOG_ERROR("[%s] Can not set device address 0x%02X\n", tag, dev);
+        }
+        if (entry)
+        {
+            entry->slave = -1;
+        }
+        else
+        {
+            close(fd);
         }
-        close(fd);
         return -1;
     }
 
-    res = VENDOR_DRV_I2C_SMBUS_Write_Byte(fd, (uint8_t)data);
+    if (entry)
+    {
+        entry->slave = dev;
+        entry->request = request;
+    }
 
-    if (res < 0)
+    return fd;
+}
+
+/*
+ * Only descriptors outside the cache are closed, unless the transfer
+ * failed: the cached descriptor is then dropped and reopened on the
+ * next access, so an adapter which was reset is not kept in use.
+ */
+static void smbus_fd_put(int bus, int fd, int res)
+{
+    if (bus >= 0 && bus < SMBUS_FD_CACHE_SIZE)
     {
-        AIM_LOG_ERROR("[SET] I2C Set Byte Failed,res = %d", res);
-        close(fd);
-        return -1;
+        if (res >= 0 || smbus_fd_cache[bus].fd != fd)
+        {
+            return;
+        }
+        smbus_fd_cache[bus].fd = -1;
+        smbus_fd_cache[bus].slave = -1;
     }
+
     close(fd);
+}
+
+/* Adapter functionality (I2C_FUNC_*) of the bus behind fd */
+static unsigned long smbus_funcs(int bus, int fd)
+{
+    unsigned long funcs;
+
+    if (bus >= 0 && bus < SMBUS_FD_CACHE_SIZE && smbus_fd_cache[bus].fd == fd)
+    {
+        return smbus_fd_cache[bus].funcs;
+    }
+
+    if (ioctl(fd, I2C_FUNCS, &funcs) < 0)
+    {
+        return 0;
+    }
+
+    return funcs;
+}
+
+/*
+ * Poll the device with a quick write until it ACKs its address again,
+ * i.e. until its internal write cycle has finished. Returns -1 without
+ * waiting if the adapter has no SMBus Quick Command.
+ */
+static int smbus_write_wait(int bus, int fd)
+{
+    int waited = 0;
+
+    if (!(smbus_funcs(bus, fd) & I2C_FUNC_SMBUS_QUICK))
+    {
+        return -1;
+    }
+
+    while (VENDOR_DRV_I2C_SMBUS_Write_Quick(fd, I2C_SMBUS_WRITE) < 0)
+    {
+        if (waited >= SMBUS_WRITE_POLL_TIMEOUT_US)
+        {
+            return -1;
+        }
+        usleep(SMBUS_WRITE_POLL_INTERVAL_US);
+        waited += SMBUS_WRITE_POLL_INTERVAL_US;
+    }
 
     return 0;
 }
 
-int VENDOR_DRV_SMBUS_Get_Byte(int bus, uint8_t dev, uint16_t daddr, uint8_t alen, uint16_t *data, uint8_t dlen)
+int VENDOR_DRV_SMBUS_Set_Byte(int bus, uint8_t dev, uint16_t daddr, uint8_t alen, uint16_t data, uint8_t dlen)
 {
-    char dev_path[20];
     int fd = -1;
+    int res = 0;
 
-    sprintf(dev_path, "/dev/i2c-%d", bus);
-
-    /* Open the SMBus device */
-    if ((fd = open(dev_path, O_RDWR | O_SYNC)) < 0)
+    if ((fd = smbus_fd_get(bus, dev, I2C_SLAVE, "SET")) < 0)
     {
-        AIM_LOG_ERROR("[GET] Can not open %s\n", dev_path);
         return -1;
     }
 
-    /* set slave address */
-    if (ioctl(fd, I2C_SLAVE, dev) < 0)
+    res = VENDOR_DRV_I2C_SMBUS_Write_Byte(fd, (uint8_t)data);
+    smbus_fd_put(bus, fd, res);
+
+    if (res < 0)
     {
-        if (errno != EBUSY)
-            AIM_LOG_ERROR("[GET] Can not set device address 0x%02X\n", dev);
+        AIM_LOG_ERROR("[SET] I2C Set Byte Failed,res = %d", res);
+        return -1;
+    }
+
+    return 0;
+}
+
+int VENDOR_DRV_SMBUS_Get_Byte(int bus, uint8_t dev, uint16_t daddr, uint8_t alen, uint16_t *data, uint8_t dlen)
+{
+    int fd = -1;
+    int res;
 
-        close(fd);
+    if ((fd = smbus_fd_get(bus, dev, I2C_SLAVE, "GET")) < 0)
+    {
         return -1;
     }
 
-    *data = VENDOR_DRV_I2C_SMBUS_Read_Byte(fd);
-    close(fd);
+    res = VENDOR_DRV_I2C_SMBUS_Read_Byte(fd);
+    smbus_fd_put(bus, fd, res);
+    *data = res;
     return 0;
 }
 
 int VENDOR_DRV_SMBUS_Set(int bus, uint8_t dev, uint16_t daddr, uint8_t alen, uint16_t data, uint8_t dlen)
 {
-    char dev_path[20];
     uint8_t upr_addr = 0, lwr_addr = 0;
     int fd = -1;
     int res = 0;
 
-    sprintf(dev_path, "/dev/i2c-%d", bus);
-
-    /* Open the SMBus device */
-    if ((fd = open(dev_path, O_RDWR | O_SYNC)) < 0)
+    if ((fd = smbus_fd_get(bus, dev, I2C_SLAVE, "SET")) < 0)
     {
-        AIM_LOG_ERROR("[SET] Can not open %s\n", dev_path);
-        return -1;
-    }
-
-    /* set slave address */
-    if (ioctl(fd, I2C_SLAVE, dev) < 0)
-    {
-        if (errno != EBUSY)
-        {
-            AIM_LOG_ERROR("[SET] Can not set device address 0x%02X,shift=0\n", dev);
-        }
-        close(fd);
         return -1;
     }
 
@@ -273,40 +399,24 @@ int VENDOR_DRV_SMBUS_Set(int bus, uint8_t dev, uint16_t daddr, uint8_t alen, uin
         break;
     }
 
+    smbus_fd_put(bus, fd, res);
+
     if (res < 0)
     {
         AIM_LOG_ERROR("[SET] I2C Set Failed");
-        close(fd);
         return -1;
     }
 
-    close(fd);
-
     return 0;
 }
 
 int VENDOR_DRV_SMBUS_Get(int bus, uint8_t dev, uint16_t daddr, uint8_t alen, uint16_t *data, uint8_t dlen)
 {
-    char dev_path[20];
     int fd = -1;
     int res = -1;
 
-    sprintf(dev_path, "/dev/i2c-%d", bus);
-
-    /* Open the SMBus device */
-    if ((fd = open(dev_path, O_RDWR | O_SYNC)) < 0)
-    {
-        AIM_LOG_ERROR("[GET] Can not open %s\n", dev_path);
-        return -1;
-    }
-
-    /* set slave address */
-    if (ioctl(fd, I2C_SLAVE, dev) < 0)
+    if ((fd = smbus_fd_get(bus, dev, I2C_SLAVE, "GET")) < 0)
     {
-        if (errno != EBUSY)
-            AIM_LOG_ERROR("[GET] Can not set device address 0x%02X\n", dev);
-
-        close(fd);
         return -1;
     }
 
@@ -333,16 +443,16 @@ int VENDOR_DRV_SMBUS_Get(int bus, uint8_t dev, uint16_t daddr, uint8_t alen, uin
         break;
     }
 
+    smbus_fd_put(bus, fd, res);
+
     if (res < 0)
     {
         AIM_LOG_ERROR("[GET] I2C Get Failed");
-        close(fd);
         return -1;
     }
     else
         *data = (uint16_t)res;
 
-    close(fd);
     return 0;
 }
 
@@ -354,192 +464,213 @@ int VENDOR_DRV_SMBUS_Probe(uint8_t ucBus, uint8_t dev)
     return rv;
 }
 
-int VENDOR_DRV_SMBUS_Write_Block(int bus, uint8_t dev, uint16_t daddr, uint8_t *value, uint16_t BufSize)
+int VENDOR_DRV_SMBUS_Write_Wait(int bus, uint8_t dev)
 {
-    char dev_path[20];
     int fd = -1;
     int res;
 
-    sprintf(dev_path, "/dev/i2c-%d", bus);
-
-    /* Open the SMBus device */
-    if ((fd = open(dev_path, O_RDWR)) < 0)
+    if ((fd = smbus_fd_get(bus, dev, I2C_SLAVE, "WRITE-WAIT")) < 0)
     {
-        AIM_LOG_ERROR("[BLOCK-WRITE] Can not open %s\n", dev_path);
         return -1;
     }
 
-    /* set slave address */
-    if (ioctl(fd, I2C_SLAVE, dev) < 0)
+    res = smbus_write_wait(bus, fd);
+    smbus_fd_put(bus, fd, 0);
+
+    return res;
+}
+
+int VENDOR_DRV_SMBUS_Write_Block(int bus, uint8_t dev, uint16_t daddr, uint8_t *value, uint16_t BufSize)
+{
+    int fd = -1;
+    int res;
+
+    if ((fd = smbus_fd_get(bus, dev, I2C_SLAVE, "BLOCK-WRITE")) < 0)
     {
-        if (errno != EBUSY)
-        {
-            AIM_LOG_ERROR("[BLOCK-WRITE] Can not set device address 0x%02X", dev);
-        }
-        close(fd);
         return -1;
     }
 
     res = VENDOR_DRV_I2C_SMBUS_Write_Block_Data(fd, daddr, BufSize, value);
-    usleep(30000);
 
     if (res < 0)
     {
         AIM_LOG_ERROR("[BLOCK-WRITE] I2C WRITE-BLOCK Failed");
         perror("perror");
-        close(fd);
+        smbus_fd_put(bus, fd, res);
         return -1;
     }
 
-    close(fd);
+    /* Fixed delay where the adapter cannot poll for the write cycle */
+    if (smbus_write_wait(bus, fd) < 0)
+    {
+        usleep(30000);
+    }
+    smbus_fd_put(bus, fd, 0);
 
     return 0;
 }
 
 int VENDOR_DRV_SMBUS_Read_Block(int bus, uint8_t dev, uint16_t daddr, uint8_t *ReplyBuf, uint16_t BufSize)
 {
-    char dev_path[20];
     int fd = -1;
     int res;
 
-    unsigned long funcs;
-
-    sprintf(dev_path, "/dev/i2c-%d", bus);
-
-    /* Open the SMBus device */
-    if ((fd = open(dev_path, O_RDWR)) < 0)
+    if ((fd = smbus_fd_get(bus, dev, I2C_SLAVE_FORCE, "BLOCK-READ")) < 0)
     {
-        AIM_LOG_ERROR("[BLOCK-READ] Can not open %s\n", dev_path);
         return -1;
     }
 
-    /* set slave address */
-    if (ioctl(fd, I2C_SLAVE_FORCE, dev) < 0)
+    if (!(smbus_funcs(bus, fd) & I2C_FUNC_SMBUS_READ_BLOCK_DATA))
     {
-        if (errno != EBUSY)
-        {
-            AIM_LOG_ERROR("[BLOCK-READ] Can not set device address 0x%02X", dev);
-        }
-        close(fd);
+        AIM_LOG_ERROR("[BLOCK-READ] i2c-%d has no SMBus block read", bus);
+        smbus_fd_put(bus, fd, 0);
         return -1;
     }
 
-#if 1
-    if (ioctl(fd, I2C_FUNCS, &funcs) < 0)
-    {
-        /* Some kind of error handling */
-    }
-    if (!(funcs & I2C_FUNC_SMBUS_READ_BLOCK_DATA))
-    {
-        /* Oops, the needed functionality (SMBus write_quick function) is not
-       available! */
-    }
-#endif
-
     res = VENDOR_DRV_I2C_SMBUS_Read_Block_Data(fd, daddr, ReplyBuf);
+    smbus_fd_put(bus, fd, res);
     usleep(3000);
 
     if (res < 0)
     {
         AIM_LOG_ERROR("[BLOCK-READ] I2C READ-BLOCK Failed");
-        close(fd);
         return -1;
     }
 
-    close(fd);
-
     return 0;
 }
 
-int VENDOR_DRV_SMBUS_Read_I2C_Block(int bus, uint8_t dev, uint16_t daddr, uint8_t *ReplyBuf, uint16_t BufSize)
+/* Returns the block length, ReplyBuf must hold I2C_SMBUS_BLOCK_MAX bytes */
+int VENDOR_DRV_SMBUS_Read_Block_Data(int bus, uint8_t dev, uint8_t command, uint8_t *ReplyBuf)
 {
-    char dev_path[20];
     int fd = -1;
     int res;
 
-    unsigned long funcs;
-    sprintf(dev_path, "/dev/i2c-%d", bus);
-
-    /* Open the SMBus device */
-    if ((fd = open(dev_path, O_RDWR)) < 0)
+    if ((fd = smbus_fd_get(bus, dev, I2C_SLAVE, "SMBUS-BLOCK-READ")) < 0)
     {
-        AIM_LOG_ERROR("[I2C-BLOCK-READ] Can not open %s\n", dev_path);
         return -1;
     }
-    /* set slave address */
-    if (ioctl(fd, I2C_SLAVE, dev) < 0)
+
+    if (!(smbus_funcs(bus, fd) & I2C_FUNC_SMBUS_READ_BLOCK_DATA))
     {
-        if (errno != EBUSY)
-        {
-            AIM_LOG_ERROR("[I2C-BLOCK-READ] Can not set device address 0x%02X", dev);
-        }
-        close(fd);
+        smbus_fd_put(bus, fd, 0);
         return -1;
     }
 
-#if 1
-    if (ioctl(fd, I2C_FUNCS, &funcs) < 0)
+    res = VENDOR_DRV_I2C_SMBUS_Read_Block_Data(fd, command, ReplyBuf);
+    smbus_fd_put(bus, fd, res);
+
+    return res;
+}
+
+int VENDOR_DRV_SMBUS_Read_I2C_Block(int bus, uint8_t dev, uint16_t daddr, uint8_t *ReplyBuf, uint16_t BufSize)
+{
+    int fd = -1;
+    int res;
+
+    if ((fd = smbus_fd_get(bus, dev, I2C_SLAVE, "I2C-BLOCK-READ")) < 0)
     {
-        /* Some kind of error handling */
+        return -1;
     }
-    if (!(funcs & I2C_FUNC_SMBUS_READ_BLOCK_DATA))
+
+    if (!(smbus_funcs(bus, fd) & I2C_FUNC_SMBUS_READ_I2C_BLOCK))
     {
-        /* Oops, the needed functionality (SMBus write_quick function) is not
-       available! */
+        AIM_LOG_ERROR("[I2C-BLOCK-READ] i2c-%d has no I2C block read", bus);
+        smbus_fd_put(bus, fd, 0);
+        return -1;
     }
-#endif
+
     res = VENDOR_DRV_I2C_SMBUS_Read_I2C_Block_Data(fd, daddr, BufSize, ReplyBuf);
+    smbus_fd_put(bus, fd, res);
 
     if (res < 0)
     {
         AIM_LOG_ERROR("[I2C-BLOCK-READ] I2C I2C-BLOCK-READ Failed");
-        close(fd);
         return -1;
     }
 
-    close(fd);
-
     return 0;
 }
 
-int VENDOR_DRV_SMBUS_Write_I2C_Block(int bus, uint8_t dev, uint16_t daddr, uint8_t *value, uint16_t BufSize)
+/*
+ * Sequential read from a device with a 16-bit offset (e.g. 24C32 and
+ * larger EEPROMs): the two offset bytes and the read are issued as one
+ * combined I2C_RDWR transfer, with the device auto-incrementing its
+ * internal address pointer.
+ */
+int VENDOR_DRV_SMBUS_Read_I2C_Block16(int bus, uint8_t dev, uint16_t daddr, uint8_t *ReplyBuf, uint16_t BufSize)
 {
-    char dev_path[20];
+    struct i2c_rdwr_ioctl_data rdwr;
+    struct i2c_msg msgs[2];
+    uint8_t offset[2];
     int fd = -1;
-    int res = -1;
+    int res;
 
-    sprintf(dev_path, "/dev/i2c-%d", bus);
+    if ((fd = smbus_fd_get(bus, dev, I2C_SLAVE, "I2C-READ16")) < 0)
+    {
+        return -1;
+    }
 
-    /* Open the SMBus device */
-    if ((fd = open(dev_path, O_RDWR)) < 0)
+    /* Callers fall back to byte reads on adapters without plain I2C */
+    if (!(smbus_funcs(bus, fd) & I2C_FUNC_I2C))
     {
-        AIM_LOG_ERROR("[I2C-BLOCK-WRITE] Can not open %s\n", dev_path);
+        smbus_fd_put(bus, fd, 0);
         return -1;
     }
 
-    /* set slave address */
-    if (ioctl(fd, I2C_SLAVE, dev) < 0)
+    offset[0] = (daddr >> 8) & 0xff;
+    offset[1] = daddr & 0xff;
+
+    msgs[0].addr = dev;
+    msgs[0].flags = 0;
+    msgs[0].len = sizeof(offset);
+    msgs[0].buf = offset;
+
+    msgs[1].addr = dev;
+    msgs[1].flags = I2C_M_RD;
+    msgs[1].len = BufSize;
+    msgs[1].buf = ReplyBuf;
+
+    rdwr.msgs = msgs;
+    rdwr.nmsgs = 2;
+
+    res = ioctl(fd, I2C_RDWR, &rdwr);
+    smbus_fd_put(bus, fd, res);
+
+    if (res < 0)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+int VENDOR_DRV_SMBUS_Write_I2C_Block(int bus, uint8_t dev, uint16_t daddr, uint8_t *value, uint16_t BufSize)
+{
+    int fd = -1;
+    int res = -1;
+
+    if ((fd = smbus_fd_get(bus, dev, I2C_SLAVE, "I2C-BLOCK-WRITE")) < 0)
     {
-        if (errno != EBUSY)
-        {
-            AIM_LOG_ERROR("[I2C-BLOCK-WRITE] Can not set device address 0x%02X", dev);
-        }
-        close(fd);
         return -1;
     }
 
     res = VENDOR_DRV_I2C_SMBUS_Write_I2C_Block_Data(fd, daddr, BufSize, value);
-    usleep(30000);
 
     if (res < 0)
     {
         AIM_LOG_ERROR("[I2C-BLOCK-WRITE] I2C I2C-BLOCK-WRITE Failed");
         perror("perror");
-        close(fd);
+        smbus_fd_put(bus, fd, res);
         return -1;
     }
 
-    close(fd);
+    /* Fixed delay where the adapter cannot poll for the write cycle */
+    if (smbus_write_wait(bus, fd) < 0)
+    {
+        usleep(30000);
+    }
+    smbus_fd_put(bus, fd, 0);
 
     return 0;
 }
@@ -732,47 +863,25 @@ int VENDOR_DRV_I2C_SMBUS_Block_Process_Call(int dev_fd, uint8_t command, uint8_t
 
 int VENDOR_DRV_I2C_SMBUS_Probe(uint8_t bus, uint8_t dev)
 {
-    char dev_path[20];
     int dev_fd = -1;
-    int size = sizeof(dev_path);
-    dev_path[size - 1] = '\0';
-
-    sprintf(dev_path, "/dev/i2c-%d", bus);
-    /* open the I2c device */
-    if ((dev_fd = open(dev_path, O_RDWR | O_SYNC)) < 0)
-    {
-        AIM_LOG_ERROR("[PROBE] Can not open %s\n", dev_path);
-        return -1;
-    }
+    int res;
 
-    /* set slave address */
-    if (ioctl(dev_fd, I2C_SLAVE, dev) < 0)
+    if ((dev_fd = smbus_fd_get(bus, dev, I2C_SLAVE, "PROBE")) < 0)
     {
-        if (errno != EBUSY)
-        {
-            AIM_LOG_ERROR("[PROBE] Can not set device address 0x%02X,shift=0\n", dev);
-        }
-        close(dev_fd);
         return -1;
     }
 
     if ((dev >= 0x30 && dev <= 0x37) || (dev >= 0x50 && dev <= 0x57))
     {
-        if (VENDOR_DRV_I2C_SMBUS_Read_Byte(dev_fd) < 0)
-        {
-            return -1;
-        }
+        res = VENDOR_DRV_I2C_SMBUS_Read_Byte(dev_fd);
     }
     else
     {
-        if (VENDOR_DRV_I2C_SMBUS_Write_Quick(dev_fd, I2C_SMBUS_WRITE) < 0)
-        {
-            close(dev_fd);
-            return -1;
-        }
+        res = VENDOR_DRV_I2C_SMBUS_Write_Quick(dev_fd, I2C_SMBUS_WRITE);
     }
-    close(dev_fd);
-    return 0;
+    smbus_fd_put(bus, dev_fd, 0);
+
+    return (res < 0) ? -1 : 0;
 }
 
 static int ipmb_readb(int bus, uint8_t dev, uint16_t addr, uint8_t alen, uint16_t *data, uint8_t dlen)
@@ -1314,6 +1423,15 @@ static int cpld_driver_init()
 /* CPLD DEVICE END*/
 
 /* EEPROM DEVICE START*/
+static void eeprom_write_wait(i2c_bus_driver_t *i2c, int bus, uint8_t dev)
+{
+    /* Wait for the write cycle by ACK polling where the bus supports it */
+    if (i2c->write_wait == NULL || i2c->write_wait(bus, dev) < 0)
+    {
+        usleep(5000);
+    }
+}
+
 static int eeprom_readb(
     void *busDrvPtr, int bus, uint8_t dev, uint16_t addr, uint8_t alen, uint8_t *buf, uint16_t len)
 {
@@ -1344,11 +1462,11 @@ static int eeprom_writeb(
     for (index = 0; index < len; index++)
     {
         rv = i2c->set(bus, dev, addr + index, alen, *(buf + index), 1);
-        usleep(5000);
         if (rv < 0)
         {
             return ONLP_STATUS_E_INTERNAL;
         }
+        eeprom_write_wait(i2c, bus, dev);
     }
 
     return 0;
@@ -1381,11 +1499,11 @@ static int eeprom_writew(
     for (index = 0; index < len; index++)
     {
         rv = i2c->set(bus, dev, addr + index, alen, *(buf + index), 2);
-        usleep(5000);
         if (rv < 0)
         {
             return ONLP_STATUS_E_INTERNAL;
         }
+        eeprom_write_wait(i2c, bus, dev);
     }
 
     return 0;
@@ -1401,7 +1519,7 @@ static int eeprom_load(
     {
         i2c->i2c_block_read(bus, dev, start_addr, buf, 256);
     }
-    else
+    else if (i2c->i2c_read16 == NULL || i2c->i2c_read16(bus, dev, start_addr, buf, 256) < 0)
     {
         for (index = 0; index < 256; index++)
         {
@@ -2273,29 +2391,6 @@ static int get_pmbus_algorithm_result(pmbus_algorithm_t algorithm, uint16_t *dat
     return 0;
 }
 
-static pmbus_command_t get_pmbus_command_parm_type(vendor_psu_parm_type_t parmType)
-{
-    switch (parmType)
-    {
-    case PSU_PARM_VIN:
-        return PMBUS_CMD_AC_VOLTAGE_IN;
-    case PSU_PARM_IIN:
-        return PMBUS_CMD_AC_AMPERE_IN;
-    case PSU_PARM_VOUT:
-        return PMBUS_CMD_DC_VOLTAGE_OUT;
-    case PSU_PARM_IOUT:
-        return PMBUS_CMD_DC_AMPERE_OUT;
-    case PSU_PARM_POUT:
-        return PMBUS_CMD_DC_WATT_OUT;
-    case PSU_PARM_PIN:
-        return PMBUS_CMD_AC_WATT_IN;
-
-    default:
-        AIM_LOG_ERROR("VENDOR: Wrong parm type in PMBUS driver.");
-        return PMBUS_CMD_UNKNOW;
-    }
-}
-
 static pmbus_command_info_t *get_pmbus_command_info(pmbus_command_t command)
 {
     int i, cnt = sizeof(pmbus_command_info) / sizeof(pmbus_command_info_t);
@@ -2330,173 +2425,302 @@ static int pmbus_command_data_get(
     return 0;
 }
 
-static int pmbus_command_string_get(
-    i2c_bus_driver_t *i2c,
-    int bus,
-    uint8_t dev,
-    pmbus_command_info_t *info,
-    char *string)
+/*
+ * PMBus PSU telemetry is served from one onlplib PMBus session per PSU.
+ * The PSUs share a bus address behind a mux, so sessions are keyed by
+ * the PSU instance id which psui passes along with the address.
+ */
+#define PMBUS_PSU_SESSION_MAX 8
+#define PMBUS_PSU_TTL_MS ONLP_PMBUS_TTL_MS_DEFAULT
+
+typedef struct pmbus_psu_session_s
 {
-    int rv = 0;
-    uint16_t len;
+    i2c_bus_driver_t *i2c;
+    int bus;
+    uint8_t dev;
+    int id;
+    onlp_pmbus_session_t *session;
+} pmbus_psu_session_t;
 
-    if (info == NULL)
-        return ONLP_STATUS_E_INTERNAL;
+static pmbus_psu_session_t pmbus_psu_sessions[PMBUS_PSU_SESSION_MAX];
 
-    rv = i2c->get(bus, dev, info->command, 1, &len, 1);
-    if (rv < 0)
-        return ONLP_STATUS_E_INTERNAL;
+static int pmbus_psu_readb(void *cookie, uint8_t command)
+{
+    pmbus_psu_session_t *s = (pmbus_psu_session_t *)cookie;
+    uint16_t data = 0;
 
-    rv = i2c->block_read(bus, dev, info->command, (uint8_t *)string, len);
+    if (s->i2c->get(s->bus, s->dev, command, 1, &data, 1) < 0)
+        return ONLP_STATUS_E_I2C;
 
-    return rv;
+    return data & 0xff;
 }
 
-static int pmbus_model_get(void *busDrvPtr, int bus, uint8_t dev, char *model)
+static int pmbus_psu_readw(void *cookie, uint8_t command)
 {
-    i2c_bus_driver_t *i2c = (i2c_bus_driver_t *)busDrvPtr;
-    int rv = 0;
-    pmbus_command_info_t *info = get_pmbus_command_info(PMBUS_CMD_MODEL_NAME);
-    rv = pmbus_command_string_get(i2c, bus, dev, info, model);
-    return rv;
+    pmbus_psu_session_t *s = (pmbus_psu_session_t *)cookie;
+    uint16_t data = 0;
+
+    if (s->i2c->get(s->bus, s->dev, command, 1, &data, 2) < 0)
+        return ONLP_STATUS_E_I2C;
+
+    return data;
 }
 
-static int pmbus_serial_get(void *busDrvPtr, int bus, uint8_t dev, char *serial)
+static int pmbus_psu_block_read(void *cookie, uint8_t command, uint8_t *data, int max)
 {
-    i2c_bus_driver_t *i2c = (i2c_bus_driver_t *)busDrvPtr;
-    int rv = 0;
-    pmbus_command_info_t *info = get_pmbus_command_info(PMBUS_CMD_SERIAL_NUMBER);
-    rv = pmbus_command_string_get(i2c, bus, dev, info, serial);
-    return rv;
+    pmbus_psu_session_t *s = (pmbus_psu_session_t *)cookie;
+    uint8_t block[I2C_SMBUS_BLOCK_MAX + 1];
+    uint16_t len = 0;
+    int rv;
+
+    if (s->i2c->smbus_block_read)
+    {
+        /* One SMBus block read, the adapter consumes the count byte */
+        if ((rv = s->i2c->smbus_block_read(s->bus, s->dev, command, block)) < 0)
+            return ONLP_STATUS_E_I2C;
+
+        len = (rv > I2C_SMBUS_BLOCK_MAX) ? I2C_SMBUS_BLOCK_MAX : rv;
+        if (len > max)
+            len = max;
+        memcpy(data, block, len);
+
+        return len;
+    }
+
+    if (s->i2c->get(s->bus, s->dev, command, 1, &len, 1) < 0)
+        return ONLP_STATUS_E_I2C;
+
+    /* The count byte and the data must fit a single I2C block read */
+    if (len > I2C_SMBUS_BLOCK_MAX - 1)
+        len = I2C_SMBUS_BLOCK_MAX - 1;
+
+    if (s->i2c->block_read(s->bus, s->dev, command, block, len + 1) < 0)
+        return ONLP_STATUS_E_I2C;
+
+    if (len > max)
+        len = max;
+    memcpy(data, block + 1, len);
+
+    return len;
 }
 
-static int pmbus_volt_get(void *busDrvPtr, int bus, uint8_t dev, int *volt)
+static const onlp_pmbus_ops_t pmbus_psu_ops = {
+    pmbus_psu_readb,
+    pmbus_psu_readw,
+    pmbus_psu_block_read};
+
+static pmbus_psu_session_t *pmbus_psu_session_find(void *busDrvPtr, int bus, uint8_t dev, int id)
 {
-    i2c_bus_driver_t *i2c = (i2c_bus_driver_t *)busDrvPtr;
-    int rv = 0;
+    int i;
 
-    uint16_t pmbus_data[2] = {0};
-    pmbus_command_info_t *info = NULL;
-    info = get_pmbus_command_info(PMBUS_CMD_DC_VOLTAGE_OUT);
-    rv = pmbus_command_data_get(i2c, bus, dev, info, &pmbus_data[0]);
-    if (rv < 0)
-        return ONLP_STATUS_E_INTERNAL;
+    for (i = 0; i < PMBUS_PSU_SESSION_MAX; i++)
+    {
+        pmbus_psu_session_t *s = &pmbus_psu_sessions[i];
 
-    info = get_pmbus_command_info(PMBUS_CMD_VOUT_MODE);
-    rv = pmbus_command_data_get(i2c, bus, dev, info, &pmbus_data[1]);
-    if (rv < 0)
+        if (s->session && s->i2c == busDrvPtr && s->bus == bus && s->dev == dev && s->id == id)
+            return s;
+    }
+
+    return NULL;
+}
+
+static onlp_pmbus_session_t *pmbus_psu_session_get(void *busDrvPtr, int bus, uint8_t dev, int id)
+{
+    pmbus_psu_session_t *s = pmbus_psu_session_find(busDrvPtr, bus, dev, id);
+    int i;
+
+    if (s)
+        return s->session;
+
+    /* A free slot, or the last one if the table is full */
+    for (i = 0; i < PMBUS_PSU_SESSION_MAX - 1; i++)
+    {
+        if (pmbus_psu_sessions[i].session == NULL)
+            break;
+    }
+    s = &pmbus_psu_sessions[i];
+
+    onlp_pmbus_session_destroy(s->session);
+    s->i2c = (i2c_bus_driver_t *)busDrvPtr;
+    s->bus = bus;
+    s->dev = dev;
+    s->id = id;
+    s->session = onlp_pmbus_session_create(
+        &pmbus_psu_ops, s, ONLP_PMBUS_FIELDS_POWER, PMBUS_PSU_TTL_MS);
+
+    return s->session;
+}
+
+static void pmbus_instance_invalidate(void *busDrvPtr, int bus, uint8_t dev, int id)
+{
+    pmbus_psu_session_t *s = pmbus_psu_session_find(busDrvPtr, bus, dev, id);
+
+    /* Static data is reloaded once the PSU is inserted again */
+    if (s)
+        onlp_pmbus_session_invalidate(s->session);
+}
+
+static int pmbus_psu_readings_get(void *busDrvPtr, int bus, uint8_t dev, int id, onlp_pmbus_readings_t *readings)
+{
+    onlp_pmbus_session_t *session = pmbus_psu_session_get(busDrvPtr, bus, dev, id);
+
+    if (session == NULL)
         return ONLP_STATUS_E_INTERNAL;
 
-    *volt = get_pmbus_algorithm_result(info->algorithm, pmbus_data);
+    if (onlp_pmbus_readings_get(session, readings) < 0)
+        return ONLP_STATUS_E_INTERNAL;
 
-    return rv;
+    return 0;
 }
 
-static int pmbus_amp_get(void *busDrvPtr, int bus, uint8_t dev, int *amp)
+static int pmbus_mfr_get(void *busDrvPtr, int bus, uint8_t dev, int id, onlp_pmbus_mfr_t *mfr)
 {
-    i2c_bus_driver_t *i2c = (i2c_bus_driver_t *)busDrvPtr;
-    int rv = 0;
+    onlp_pmbus_session_t *session = pmbus_psu_session_get(busDrvPtr, bus, dev, id);
 
-    uint16_t pmbus_data = 0;
-    pmbus_command_info_t *info = get_pmbus_command_info(PMBUS_CMD_DC_AMPERE_OUT);
-    rv = pmbus_command_data_get(i2c, bus, dev, info, &pmbus_data);
-    if (rv != 0)
+    if (session == NULL)
         return ONLP_STATUS_E_INTERNAL;
 
-    *amp = get_pmbus_algorithm_result(info->algorithm, &pmbus_data);
+    if (onlp_pmbus_mfr_get(session, mfr) < 0)
+        return ONLP_STATUS_E_INTERNAL;
+
+    return 0;
+}
+
+/*
+ * The calls without an instance id cannot tell the PSUs behind the mux
+ * apart. Each one reads through a session of its own, which caches
+ * nothing across calls and refreshes only the fields it returns.
+ */
+static int pmbus_oneshot_readings_get(void *busDrvPtr, int bus, uint8_t dev, uint32_t fields, onlp_pmbus_readings_t *readings)
+{
+    pmbus_psu_session_t s = {(i2c_bus_driver_t *)busDrvPtr, bus, dev, 0, NULL};
+    int rv = ONLP_STATUS_E_INTERNAL;
+
+    s.session = onlp_pmbus_session_create(&pmbus_psu_ops, &s, fields, 0);
+    if (s.session && onlp_pmbus_readings_get(s.session, readings) >= 0)
+        rv = 0;
+    onlp_pmbus_session_destroy(s.session);
 
     return rv;
 }
 
-static int pmbus_watt_get(void *busDrvPtr, int bus, uint8_t dev, int *watt)
+static int pmbus_oneshot_mfr_get(void *busDrvPtr, int bus, uint8_t dev, onlp_pmbus_mfr_t *mfr)
 {
-    i2c_bus_driver_t *i2c = (i2c_bus_driver_t *)busDrvPtr;
-    int rv = 0;
+    pmbus_psu_session_t s = {(i2c_bus_driver_t *)busDrvPtr, bus, dev, 0, NULL};
+    int rv = ONLP_STATUS_E_INTERNAL;
 
-    uint16_t pmbus_data = 0;
-    pmbus_command_info_t *info = get_pmbus_command_info(PMBUS_CMD_DC_WATT_OUT);
-    rv = pmbus_command_data_get(i2c, bus, dev, info, &pmbus_data);
-    if (rv != 0)
-        return ONLP_STATUS_E_INTERNAL;
+    s.session = onlp_pmbus_session_create(&pmbus_psu_ops, &s, 0, 0);
+    if (s.session && onlp_pmbus_mfr_get(s.session, mfr) >= 0)
+        rv = 0;
+    onlp_pmbus_session_destroy(s.session);
 
-    *watt = get_pmbus_algorithm_result(info->algorithm, &pmbus_data);
+    return rv;
+}
+
+static int pmbus_model_get(void *busDrvPtr, int bus, uint8_t dev, char *model)
+{
+    onlp_pmbus_mfr_t mfr;
+    int rv = pmbus_oneshot_mfr_get(busDrvPtr, bus, dev, &mfr);
+
+    if (rv == 0)
+        strcpy(model, mfr.model);
 
     return rv;
 }
 
-static int psu_runtime_parm_get(
-    void *busDrvPtr, int bus, uint8_t dev,
-    vendor_psu_parm_type_t parmType,
-    int *parameter)
+static int pmbus_serial_get(void *busDrvPtr, int bus, uint8_t dev, char *serial)
 {
-    i2c_bus_driver_t *i2c = (i2c_bus_driver_t *)busDrvPtr;
-    int rv = 0;
+    onlp_pmbus_mfr_t mfr;
+    int rv = pmbus_oneshot_mfr_get(busDrvPtr, bus, dev, &mfr);
 
-    uint16_t pmbusData = 0;
-    pmbus_command_t command = get_pmbus_command_parm_type(parmType);
+    if (rv == 0)
+        strcpy(serial, mfr.serial);
 
-    if (command == PMBUS_CMD_UNKNOW)
-    {
-        return ONLP_STATUS_E_INTERNAL;
-    }
+    return rv;
+}
 
-    if (command == PMBUS_CMD_DC_VOLTAGE_OUT)
-    {
-        rv = pmbus_volt_get(busDrvPtr, bus, dev, parameter);
-        return rv;
-    }
+static int pmbus_volt_get(void *busDrvPtr, int bus, uint8_t dev, int *volt)
+{
+    onlp_pmbus_readings_t readings;
+    int rv = pmbus_oneshot_readings_get(busDrvPtr, bus, dev,
+                                        ONLP_PMBUS_FIELD_MASK(ONLP_PMBUS_FIELD_VOUT), &readings);
 
-    pmbus_command_info_t *info = get_pmbus_command_info(command);
-    rv = pmbus_command_data_get(i2c, bus, dev, info, &pmbusData);
-    if (rv != 0)
-        return ONLP_STATUS_E_INTERNAL;
+    if (rv == 0)
+        *volt = readings.values[ONLP_PMBUS_FIELD_VOUT];
+
+    return rv;
+}
+
+static int pmbus_amp_get(void *busDrvPtr, int bus, uint8_t dev, int *amp)
+{
+    onlp_pmbus_readings_t readings;
+    int rv = pmbus_oneshot_readings_get(busDrvPtr, bus, dev,
+                                        ONLP_PMBUS_FIELD_MASK(ONLP_PMBUS_FIELD_IOUT), &readings);
+
+    if (rv == 0)
+        *amp = readings.values[ONLP_PMBUS_FIELD_IOUT];
+
+    return rv;
+}
+
+static int pmbus_watt_get(void *busDrvPtr, int bus, uint8_t dev, int *watt)
+{
+    onlp_pmbus_readings_t readings;
+    int rv = pmbus_oneshot_readings_get(busDrvPtr, bus, dev,
+                                        ONLP_PMBUS_FIELD_MASK(ONLP_PMBUS_FIELD_POUT), &readings);
 
-    *parameter = get_pmbus_algorithm_result(info->algorithm, &pmbusData);
+    if (rv == 0)
+        *watt = readings.values[ONLP_PMBUS_FIELD_POUT];
 
     return rv;
 }
 
+static void pmbus_runtime_info_fill(onlp_pmbus_readings_t *readings, vendor_psu_runtime_info_t *runtimeInfo)
+{
+    runtimeInfo->vin = readings->values[ONLP_PMBUS_FIELD_VIN];
+    runtimeInfo->iin = readings->values[ONLP_PMBUS_FIELD_IIN];
+    runtimeInfo->vout = readings->values[ONLP_PMBUS_FIELD_VOUT];
+    runtimeInfo->iout = readings->values[ONLP_PMBUS_FIELD_IOUT];
+    runtimeInfo->pout = readings->values[ONLP_PMBUS_FIELD_POUT];
+    runtimeInfo->pin = readings->values[ONLP_PMBUS_FIELD_PIN];
+}
+
 static int pmbus_runtime_info_get(
     void *busDrvPtr, int bus, uint8_t dev,
     vendor_psu_runtime_info_t *runtimeInfo)
 {
-    int rv = 0;
-    int parameter = 0;
-    vendor_psu_parm_type_t parmType = PSU_PARM_MIN;
+    onlp_pmbus_readings_t readings;
+    int rv = pmbus_oneshot_readings_get(busDrvPtr, bus, dev, ONLP_PMBUS_FIELDS_POWER, &readings);
 
-    for (parmType = PSU_PARM_MIN; parmType < PSU_PARM_MAX; parmType++)
-    {
-        rv = psu_runtime_parm_get(busDrvPtr, bus, dev, parmType, &parameter);
-        if (rv != 0)
-            return ONLP_STATUS_E_INTERNAL;
+    if (rv == 0)
+        pmbus_runtime_info_fill(&readings, runtimeInfo);
 
-        switch (parmType)
-        {
-        case PSU_PARM_VIN:
-            runtimeInfo->vin = parameter;
-            break;
-        case PSU_PARM_IIN:
-            runtimeInfo->iin = parameter;
-            break;
-        case PSU_PARM_VOUT:
-            runtimeInfo->vout = parameter;
-            break;
-        case PSU_PARM_IOUT:
-            runtimeInfo->iout = parameter;
-            break;
-        case PSU_PARM_POUT:
-            runtimeInfo->pout = parameter;
-            break;
-        case PSU_PARM_PIN:
-            runtimeInfo->pin = parameter;
-            break;
+    return rv;
+}
 
-        default:
-            AIM_LOG_ERROR("VENDOR: Wrong parm type in PMBUS driver!");
-            return ONLP_STATUS_E_INTERNAL;
-        }
+static int pmbus_instance_info_get(
+    void *busDrvPtr, int bus, uint8_t dev, int id,
+    char *model, char *serial, vendor_psu_runtime_info_t *runtimeInfo)
+{
+    onlp_pmbus_mfr_t mfr;
+    onlp_pmbus_readings_t readings;
+    int rv = 0;
+
+    if (pmbus_mfr_get(busDrvPtr, bus, dev, id, &mfr) == 0)
+    {
+        strcpy(model, mfr.model);
+        strcpy(serial, mfr.serial);
+    }
+    else
+    {
+        rv = ONLP_STATUS_E_INTERNAL;
     }
 
+    if (pmbus_psu_readings_get(busDrvPtr, bus, dev, id, &readings) == 0)
+        pmbus_runtime_info_fill(&readings, runtimeInfo);
+    else
+        rv = ONLP_STATUS_E_INTERNAL;
+
     return rv;
 }
 
@@ -2529,7 +2753,9 @@ static psu_dev_driver_t pmbus_psu_functions = {
     pmbus_volt_get,
     pmbus_amp_get,
     pmbus_watt_get,
-    pmbus_runtime_info_get};
+    pmbus_runtime_info_get,
+    pmbus_instance_info_get,
+    pmbus_instance_invalidate};
 
 static fan_dev_driver_t pmbus_fan_functions = {
     pmbus_fan_rpm_get,
@@ -189,6 +189,12 @@ typedef struct i2c_bus_driver_s
     int (*i2c_block_read)(int bus, uint8_t dev, uint16_t daddr, uint8_t *ReplyBuf, uint16_t BufSize);
     int (*i2c_block_write)(int bus, uint8_t dev, uint16_t daddr, uint8_t *value, uint16_t BufSize);
     int (*probe)(uint8_t bus, uint8_t dev);
+    /* Optional: sequential read with a 16-bit offset */
+    int (*i2c_read16)(int bus, uint8_t dev, uint16_t daddr, uint8_t *ReplyBuf, uint16_t BufSize);
+    /* Optional: wait for the device to complete an internal write cycle */
+    int (*write_wait)(int bus, uint8_t dev);
+    /* Optional: SMBus block read, returns the length of the data stored in ReplyBuf */
+    int (*smbus_block_read)(int bus, uint8_t dev, uint8_t command, uint8_t *ReplyBuf);
 } i2c_bus_driver_t;
 
 typedef struct ipmi_bus_driver_s
@@ -269,6 +275,15 @@ typedef struct psu_dev_driver_s
     int (*amp_get)(void *busDrvPtr, int bus, uint8_t dev, int *amp);
     int (*watt_get)(void *busDrvPtr, int bus, uint8_t dev, int *watt);
     int (*runtime_info_get)(void *busDrvPtr, int bus, uint8_t dev, vendor_psu_runtime_info_t *runtimeInfo);
+    /*
+     * Optional: model, serial and runtime info of PSU instance id, used
+     * instead of the calls above. PSUs behind a mux share bus and dev,
+     * so drivers which cache per device key their state by the id.
+     */
+    int (*instance_info_get)(void *busDrvPtr, int bus, uint8_t dev, int id,
+                             char *model, char *serial, vendor_psu_runtime_info_t *runtimeInfo);
+    /* Optional: drop the cached state of PSU instance id, e.g. once it is unplugged */
+    void (*instance_invalidate)(void *busDrvPtr, int bus, uint8_t dev, int id);
 } psu_dev_driver_t;
 
 typedef enum vendor_sfp_control_s
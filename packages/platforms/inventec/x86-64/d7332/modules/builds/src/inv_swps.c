@@ -12,6 +12,8 @@
 #include <linux/workqueue.h>
 #include <linux/jiffies.h>
 #include <linux/delay.h>
+#include <linux/sched.h>
+#include <linux/ktime.h>
 /*ufile use*/
 #include <linux/fs.h>
 #include <linux/unistd.h>
@@ -36,7 +38,11 @@ struct platform_info_t *pltfmInfo = NULL;
 static void swps_polling_task(struct work_struct *work);
 static void polling_task_1U(void);
 static void polling_task_4U(void);
+static int card_polling_task_1U(struct lc_obj_t *card);
+static int card_polling_task_4U(struct lc_obj_t *card);
 static DECLARE_DELAYED_WORK(swps_polling, swps_polling_task);
+static struct workqueue_struct *swps_wq = NULL;
+static void lc_polling_work_cancel(struct lc_t *card);
 static u8 swps_polling_enabled = 1;
 static int swps_polling_task_start(void);
 static int swps_polling_task_stop(void);
@@ -82,6 +88,7 @@ struct lc_func_t lc_func_4U = {
     .dev_deinit = lc_dev_deinit,
     .dev_hdlr = lc_dev_hdlr,
     .polling_task = polling_task_4U,
+    .card_polling_task = card_polling_task_4U,
     .mux_reset_set = lc_dev_mux_reset_set,
     .mux_reset_get = lc_dummy_get,
     .i2c_is_alive = lc_dev_mux_l1_is_alive,
@@ -108,6 +115,7 @@ struct lc_func_t lc_func_1U = {
     .dev_deinit = io_dev_deinit,
     .dev_hdlr = io_dev_hdlr,
     .polling_task = polling_task_1U,
+    .card_polling_task = card_polling_task_1U,
     .mux_reset_set = io_dev_mux_reset_set,
     .mux_reset_get = io_dev_mux_reset_get,
     .i2c_is_alive = ioexp_is_channel_ready,
@@ -403,15 +411,27 @@ static lc_fsm_st_t lc_fsm_st_get(struct lc_obj_t *card)
 }
 /* <TBD> if it's 4U platform , get the info from lc_dev_prs_get()
  * if it's 1u return 1*/
-static void lc_insert(struct lc_obj_t *obj)
+/*called from the shared polling task, the card worker may be running the card fsm:
+ *don't wait for it, return false and let the next scan try again*/
+static bool lc_insert(struct lc_obj_t *obj)
 {
+    if (!mutex_trylock(&obj->poll_lock)) {
+        return false;
+    }
     SWPS_LOG_INFO("%s insert\n", obj->name);
     lc_fsm_st_set(obj, LC_FSM_ST_INSERT);
+    mutex_unlock(&obj->poll_lock);
+    return true;
 }
-static void lc_remove(struct lc_obj_t *obj)
+static bool lc_remove(struct lc_obj_t *obj)
 {
+    if (!mutex_trylock(&obj->poll_lock)) {
+        return false;
+    }
     SWPS_LOG_INFO("%s remove\n", obj->name);
     lc_fsm_st_set(obj, LC_FSM_ST_REMOVE);
+    mutex_unlock(&obj->poll_lock);
+    return true;
 }
 #if 0
 static int lc_prs_scan(struct lc_t *self)
@@ -576,22 +596,28 @@ static int lc_prs_scan(struct lc_t *self)
             if (LC_EJ_IS_LOCKED_FLAG == ej_st) {
                 lc_obj->prs_locked_cnt++;
             } else if (LC_EJ_IS_UNLOCKED_FLAG == ej_st) {
-                lc_obj->posi_st = LC_POSI_RELEASED_ST;                    
-                lc_remove(lc_obj);
+                /*card busy: stay here, the next scan removes it*/
+                if (lc_remove(lc_obj)) {
+                    lc_obj->posi_st = LC_POSI_RELEASED_ST;                    
+                }
+                break;
             }
             
             if (lc_obj->prs_locked_cnt >= LC_PRS_LOCKED_NUM) {
-                lc_obj->prs_locked_cnt = 0;
-                lc_insert(lc_obj);
-                lc_obj->posi_st = LC_POSI_LOCKED_ST;                    
+                /*card busy: keep the count, the next scan inserts it*/
+                if (lc_insert(lc_obj)) {
+                    lc_obj->prs_locked_cnt = 0;
+                    lc_obj->posi_st = LC_POSI_LOCKED_ST;                    
+                }
             }
                  
             break;
         case LC_POSI_LOCKED_ST:
             
             if (LC_EJ_IS_UNLOCKED_FLAG == ej_st) {
-                lc_obj->posi_st = LC_POSI_RELEASED_ST;                    
-                lc_remove(lc_obj);
+                if (lc_remove(lc_obj)) {
+                    lc_obj->posi_st = LC_POSI_RELEASED_ST;                    
+                }
             }
             
             break;
@@ -608,8 +634,6 @@ static int lc_prs_scan(struct lc_t *self)
 
 
 #endif
-static int lc_fsm_run_4U(struct lc_t *card);
-static int lc_fsm_run_1U(struct lc_t *card);
 /*struct sff_mgr_t Sff;*/
 
 #define to_swps_kobj(x) container_of(x, struct swps_kobj_t, kobj)
@@ -656,6 +680,27 @@ struct monitor_para_t *monitor_para_find(int type)
 static int sscanf_to_int(const char *buf, int *value);
 static bool match(const char *str1, const char *str2);
 
+/*if the caller is a card polling worker, don't sleep between retries:
+ *mark the card so that its worker is requeued after I2C_RETRY_DELAY_MS
+ *and let the fsm step run again then*/
+static bool i2c_retry_is_deferred(void)
+{
+    int i = 0;
+    struct lc_obj_t *card = NULL;
+
+    if (!p_valid(lcMgr.obj)) {
+        return false;
+    }
+    for (i = 0; i < lcMgr.lc_num; i++) {
+        card = &(lcMgr.obj[i]);
+        if (current == card->poll_task) {
+            card->poll_retry = true;
+            return true;
+        }
+    }
+    return false;
+}
+
 int i2c_smbus_write_byte_data_retry(struct i2c_client *client, u8 offset, u8 data)
 {
     int ret = 0;
@@ -664,6 +709,9 @@ int i2c_smbus_write_byte_data_retry(struct i2c_client *client, u8 offset, u8 dat
     for (i = 0; i < I2C_RETRY_NUM; i++) {
         ret = i2c_smbus_write_byte_data(client, offset, data);
         if (ret < 0) {
+            if (i2c_retry_is_deferred()) {
+                break;
+            }
             msleep(I2C_RETRY_DELAY_MS);
             continue;
         }
@@ -685,6 +733,9 @@ int i2c_smbus_read_byte_data_retry(struct i2c_client *client, u8 offset)
 
         ret = i2c_smbus_read_byte_data(client, offset);
         if (ret < 0) {
+            if (i2c_retry_is_deferred()) {
+                break;
+            }
             msleep(I2C_RETRY_DELAY_MS);
             continue;
         }
@@ -706,6 +757,9 @@ int i2c_smbus_read_word_data_retry(struct i2c_client *client, u8 offset)
     for (i = 0; i < I2C_RETRY_NUM; i++) {
         ret = i2c_smbus_read_word_data(client, offset);
         if (ret < 0) {
+            if (i2c_retry_is_deferred()) {
+                break;
+            }
             msleep(I2C_RETRY_DELAY_MS);
             continue;
         }
@@ -727,6 +781,9 @@ int i2c_smbus_write_word_data_retry(struct i2c_client *client, u8 offset, u16 bu
     for(i=0; i< I2C_RETRY_NUM; i++) {
         ret = i2c_smbus_write_word_data(client, offset, buf);
         if (ret < 0) {
+            if (i2c_retry_is_deferred()) {
+                break;
+            }
             msleep(I2C_RETRY_DELAY_MS);
             continue;
         }
@@ -773,6 +830,9 @@ int i2c_smbus_read_i2c_block_data_retry(struct i2c_client *client, u8 offset, in
     for (i = 0; i < I2C_RETRY_NUM; i++) {
         ret = inv_i2c_smbus_read_i2c_block_data(client, offset, len, buf);
         if (ret < 0) {
+            if (i2c_retry_is_deferred()) {
+                break;
+            }
             msleep(I2C_RETRY_DELAY_MS);
             continue;
         }
@@ -1836,6 +1896,33 @@ static ssize_t fsm_st_show(struct swps_kobj_t *swps_kobj, struct swps_attribute
     st = sff_fsm_st_get(sff_obj);
     return scnprintf(buf, BUF_SIZE, "%s\n", sff_fsm_st_str[st]);
 }
+static ssize_t fsm_stats_show(struct swps_kobj_t *swps_kobj, struct swps_attribute *attr,
+                              char *buf)
+{
+    struct sff_obj_t *sff_obj = swps_kobj->sff_obj;
+    struct sff_fsm_stat_t stat = sff_obj->fsm.stat;
+    u64 avg_ns = 0;
+
+    if (stat.run_cnt) {
+        avg_ns = div_u64(stat.total_ns, stat.run_cnt);
+    }
+    return scnprintf(buf, BUF_SIZE, "run_cnt:%u err_cnt:%u last_us:%llu avg_us:%llu max_us:%llu\n",
+                     stat.run_cnt, stat.err_cnt,
+                     div_u64(stat.last_ns, NSEC_PER_USEC),
+                     div_u64(avg_ns, NSEC_PER_USEC),
+                     div_u64(stat.max_ns, NSEC_PER_USEC));
+}
+static ssize_t fsm_stats_store(struct swps_kobj_t *swps_kobj, struct swps_attribute *attr,
+                               const char *buf, size_t count)
+{
+    struct sff_obj_t *sff_obj = swps_kobj->sff_obj;
+
+    if (!match(buf, CLEAR_CMD)) {
+        return -EINVAL;
+    }
+    memset(&(sff_obj->fsm.stat), 0, sizeof(sff_obj->fsm.stat));
+    return count;
+}
 static ssize_t lc_fsm_st_show(struct swps_kobj_t *swps_kobj, struct swps_attribute *attr,
                            char *buf)
 {
@@ -2439,6 +2526,8 @@ static struct swps_attribute sff_transvr_type_attr =
 
 static struct swps_attribute sff_fsm_st_attr =
     __ATTR(fsm_st, S_IRUGO, fsm_st_show, NULL);
+static struct swps_attribute sff_fsm_stats_attr =
+    __ATTR(fsm_stats, S_IWUSR|S_IRUGO, fsm_stats_show, fsm_stats_store);
 
 static struct swps_attribute sff_prs_all_attr =
     __ATTR(prs, S_IRUGO, sff_prs_all_show, NULL);
@@ -2585,6 +2674,7 @@ static struct attribute *sfp_attributes[] = {
     /*transceiver identified info attribute*/
     &sff_transvr_type_attr.attr,
     &sff_fsm_st_attr.attr,
+    &sff_fsm_stats_attr.attr,
     //&sff_eeprom_dump_attr.attr,
     NULL
 
@@ -2623,6 +2713,7 @@ static struct attribute *qsfp_attributes[] = {
     /*transceiver identified info attribute*/
     &sff_transvr_type_attr.attr,
     &sff_fsm_st_attr.attr,
+    &sff_fsm_stats_attr.attr,
     &sff_eeprom_dump_attr.attr,
     &sff_page_attr.attr,
     NULL
@@ -2656,6 +2747,7 @@ static struct attribute *qsfp_dd_attributes[] = {
     /*transceiver identified info attribute*/
     //&sff_transvr_type_attr.attr,
     &sff_fsm_st_attr.attr,
+    &sff_fsm_stats_attr.attr,
     &sff_eeprom_dump_attr.attr,
     &sff_page_attr.attr,
     &sff_page_sel_lock_attr.attr,
@@ -2758,6 +2850,7 @@ static int swps_polling_task_stop(void)
 {
 
     cancel_delayed_work_sync(&swps_polling);
+    lc_polling_work_cancel(&lcMgr);
     return 0;
 
 }
@@ -2932,13 +3025,59 @@ static int lc_kobj_common_create(struct lc_t *card)
     return 0;
 
 }
+/*card fsm (and the sff fsm of its ports) runs in per card work items,
+ *the shared polling task only handles the chassis level devices and kicks them*/
+static void lc_polling_work_queue(struct lc_t *card)
+{
+    int i = 0;
+    int lc_num = card->lc_num;
+
+    for (i = 0; i < lc_num; i++) {
+        /*no-op if the card worker is still pending from a deferred retry*/
+        queue_delayed_work(swps_wq, &(card->obj[i].poll_work), 0);
+    }
+}
+static void lc_polling_work(struct work_struct *work)
+{
+    struct lc_obj_t *card = container_of(to_delayed_work(work), struct lc_obj_t, poll_work);
+    int ret = 0;
+
+    mutex_lock(&card->poll_lock);
+    card->poll_retry = false;
+    card->poll_task = current;
+    ret = card->mgr->lc_func->card_polling_task(card);
+    card->poll_task = NULL;
+    mutex_unlock(&card->poll_lock);
+
+    /*an i2c retry was deferred: run the failed step again after the retry delay*/
+    if (ret < 0 && card->poll_retry &&
+        swps_polling_is_enabled()) {
+        queue_delayed_work(swps_wq, &card->poll_work, SWPS_POLLING_RETRY_PERIOD);
+    }
+}
+static void lc_polling_work_init(struct lc_t *card)
+{
+    int i = 0;
+    int lc_num = card->lc_num;
+
+    for (i = 0; i < lc_num; i++) {
+        mutex_init(&(card->obj[i].poll_lock));
+        INIT_DELAYED_WORK(&(card->obj[i].poll_work), lc_polling_work);
+    }
+}
+static void lc_polling_work_cancel(struct lc_t *card)
+{
+    int i = 0;
+    int lc_num = card->lc_num;
+
+    for (i = 0; i < lc_num; i++) {
+        cancel_delayed_work_sync(&(card->obj[i].poll_work));
+    }
+}
 static void polling_task_1U(void)
 {
     lcMgr.lc_func->dev_hdlr();
-    lc_fsm_run_1U(&lcMgr);
-    if (!i2c_bus_is_alive(&lcMgr.obj[0])) {
-        i2c_bus_recovery(&lcMgr.obj[0]);
-    }
+    lc_polling_work_queue(&lcMgr);
     io_no_init_handler(&lcMgr);
 }
 static void polling_task_4U(void)
@@ -2946,12 +3085,12 @@ static void polling_task_4U(void)
     /*4U real functions
      *self->lc_func->dev_handler(self);
      *lc_prs_scan(self);
-     * lc_fsm_run_4U(&lcMgr);
+     * lc_fsm_run_4U(&lcMgr); (per card work items)
      *  io_no_init_handler(&lcMgr);*/
     lcMgr.lc_func->dev_hdlr();
    // io_dev_hdlr();
     lc_prs_scan(&lcMgr);
-    lc_fsm_run_4U(&lcMgr);
+    lc_polling_work_queue(&lcMgr);
     io_no_init_handler(&lcMgr);
 }
 static int lc_func_load(struct lc_t *obj)
@@ -3543,7 +3682,12 @@ static void io_no_init_handler(struct lc_t *card)
 
     if (io_no_init) {
         for (i = 0; i < lc_num; i++) {
+            /*card worker busy: count it as not ready this tick*/
+            if (!mutex_trylock(&card->obj[i].poll_lock)) {
+                continue;
+            }
             st = lc_fsm_st_get(&card->obj[i]);
+            mutex_unlock(&card->obj[i].poll_lock);
             if (LC_FSM_ST_READY == st) {
                 set_bit(i, &lc_ready);
             }
@@ -3557,25 +3701,45 @@ static void io_no_init_handler(struct lc_t *card)
     }
 
 }
+static void sff_fsm_stat_update(struct sff_obj_t *sff_obj, u64 ns, int ret)
+{
+    struct sff_fsm_stat_t *stat = &(sff_obj->fsm.stat);
+
+    stat->run_cnt++;
+    if (ret < 0) {
+        stat->err_cnt++;
+    }
+    stat->last_ns = ns;
+    stat->total_ns += ns;
+    if (ns > stat->max_ns) {
+        stat->max_ns = ns;
+    }
+}
+/*a failing port no longer stops the remaining ports of the card,
+ *the first error is reported once every port had its turn*/
 static int sff_fsm_run(struct sff_mgr_t *sff)
 {
     int port = 0;
     int ret = 0;
+    int err = 0;
+    u64 start = 0;
     struct sff_obj_t *sff_obj = NULL;
     int port_num = sff->valid_port_num;
 
     for(port = 0; port < port_num; port++) {
         sff_obj = &(sff->obj[port]);
         if (sff_fsm_delay_cnt_is_hit(sff_obj)) {
+            start = ktime_get_ns();
             ret = sff_obj->fsm.task(sff_obj);
-            if (ret < 0) {
-                break;
+            sff_fsm_stat_update(sff_obj, ktime_get_ns() - start, ret);
+            if (ret < 0 && 0 == err) {
+                err = ret;
             }
         }
         sff_fsm_cnt_run(sff_obj);
     }
-    if (ret < 0) {
-        return ret;
+    if (err < 0) {
+        return err;
     }
     return 0;
 }
@@ -3944,10 +4108,13 @@ static int _lc_fsm_run_4U(struct lc_obj_t *card)
     return 0;
 }
 
-static int lc_fsm_run_1U(struct lc_t *card)
+static int card_polling_task_1U(struct lc_obj_t *card)
 {
     int ret = 0;
-    ret = _lc_fsm_run_1U(&card->obj[0]);
+    ret = _lc_fsm_run_1U(card);
+    if (!i2c_bus_is_alive(card)) {
+        i2c_bus_recovery(card);
+    }
     if (ret < 0) {
         return ret;
     }
@@ -4279,23 +4446,13 @@ static void i2c_bus_recovery(struct lc_obj_t *card)
     }
 
 }
-static int lc_fsm_run_4U(struct lc_t *card)
+static int card_polling_task_4U(struct lc_obj_t *card)
 {
-    int i = 0;
-    int lc_num = card->lc_num;
     int ret = 0;
 
-    for (i = 0; i < lc_num; i++) {
-        ret = _lc_fsm_run_4U(&card->obj[i]);
-
-        if (ret < 0) {
-            break;
-        }
-    }
-
-
+    ret = _lc_fsm_run_4U(card);
     if (ret < 0) {
-        SWPS_LOG_ERR("something wrong\n");
+        SWPS_LOG_ERR("%s something wrong\n", card->name);
         return ret;
     }
     return 0;
@@ -4479,6 +4636,13 @@ static int __init swps_init(void)
         goto exit_err;
         SWPS_LOG_ERR("drv load fail\n");
     }
+    /*unbound: card workers stuck on a slow bus must not hold back the others*/
+    swps_wq = alloc_workqueue("swps_wq", WQ_UNBOUND, 0);
+    if (!p_valid(swps_wq)) {
+        SWPS_LOG_ERR("alloc_workqueue fail\n");
+        goto exit_err;
+    }
+    lc_polling_work_init(&lcMgr);
     
     if(swps_polling_is_enabled()) {
         swps_polling_task_start();
@@ -4498,6 +4662,7 @@ static void __exit swps_exit(void)
     if(swps_polling_is_enabled()) {
         swps_polling_task_stop();
     }
+    destroy_workqueue(swps_wq);
      
     sff_eeprom_deinit();
     lcMgr.lc_func->dev_deinit();
@@ -2,6 +2,8 @@
 #define __SWPS_H
 
 #include <linux/i2c.h>
+#include <linux/workqueue.h>
+#include <linux/mutex.h>
 #include "sff_spec.h"
 #include "lc_dev.h"
 #include "io_dev.h"
@@ -22,6 +24,8 @@
 #define MUX_CH_NUM  (8)
 
 #define SWPS_POLLING_PERIOD    (msecs_to_jiffies(100))  /* msec */
+/*a card worker hitting an i2c error is requeued after this delay instead of sleeping inline*/
+#define SWPS_POLLING_RETRY_PERIOD    (msecs_to_jiffies(I2C_RETRY_DELAY_MS))
 
 #define DYNAMIC_SFF_KOBJ
 
@@ -242,12 +246,21 @@ struct swps_kobj_t {
 
 typedef struct sff_obj_t sff_obj_type;
 
+/*per port fsm task timing, exposed by fsm_stats attribute*/
+struct sff_fsm_stat_t {
+    u32 run_cnt;
+    u32 err_cnt;
+    u64 last_ns;
+    u64 max_ns;
+    u64 total_ns;
+};
 struct sff_fsm_t {
     sff_fsm_state_t st;
     int (*task)(sff_obj_type *sff_obj);
     int cnt; /*used to count how many fsm loop's been running*/
     int delay_cnt; /*the target count for each state, will be reset during each state transition*/
     struct fsm_period_t *period_tbl;
+    struct sff_fsm_stat_t stat;
 };
 
 struct qsfp_dd_fsm_func_t {
@@ -385,6 +398,12 @@ struct lc_obj_t {
     u32 prs_locked_cnt;
     lc_posi_st_t posi_st;    
     struct mux_ch_t mux_l1;
+    /*each card sits behind its own l1 mux, so it's polled by its own work item*/
+    struct delayed_work poll_work;
+    struct task_struct *poll_task; /*worker currently running poll_work*/
+    bool poll_retry; /*an i2c retry was deferred, requeue soon*/
+    /*held by poll_work; the shared polling task only trylocks it and skips a busy card*/
+    struct mutex poll_lock;
 };
 
 struct sff_io_driver_t {
@@ -428,6 +447,7 @@ struct lc_func_t {
     int (*dev_init)(int platform_id, int io_no_init);
     void (*dev_deinit)(void);
     void (*polling_task)(void);
+    int (*card_polling_task)(struct lc_obj_t *card);
     int (*dev_hdlr)(void);
     bool (*i2c_is_alive)(int lc_id);
     int (*cpld_init)(int lc_id);
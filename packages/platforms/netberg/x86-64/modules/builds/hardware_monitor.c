@@ -11,6 +11,7 @@
 #include <linux/delay.h>
 #include <linux/log2.h>
 #include <linux/kthread.h>
+#include <linux/wait.h>
 #include <linux/slab.h>
 #include <linux/gpio.h>
 
@@ -67,12 +68,39 @@ enum platform_type {
 #define W83795ADG_REG_FANIN10_COUNT   0x37 /* FAN10IN tachometer readout high byte */
 
 #define W83795ADG_REG_VR_LSB      0x3C  /* Monitored channel readout low byte */
+#define W83795ADG_REG_ALARM_CTRL  0x40  /* SMI Control */
+#define W83795ADG_REG_ALARM(i)    (0x41 + (i)) /* SMI#/OVT# Status 1~6 */
+#define W83795ADG_ALARM_COUNT     6
+#define W83795ADG_ALARM_TEMP      2 /* Status 3 holds the temperature alarms, 4~6 the fan alarms */
+#define W83795ADG_ALARM_CTRL_RTSACS  0x80 /* Status registers show real time status */
 
 /* Bank 2 */
 #define W83795ADG_REG_FOMC   0x0F /* Fan Output Mode Control */
 #define W83795ADG_REG_F1OV   0x10 /* Fan Output Value for FANCTL1 */
 #define W83795ADG_REG_F2OV   0x11 /* Fan Output Value for FANCTL2 */
 
+/*
+ * The W83795ADG readings are refreshed every hwmon_fast_ms while
+ * temperatures are changing, near a fan control threshold or a fan has
+ * failed, and every hwmon_slow_ms otherwise. In between, only the
+ * latched temperature and fan alarm status registers are checked, every
+ * hwmon_alarm_ms, and any alarm triggers an immediate refresh.
+ */
+static unsigned int hwmon_fast_ms = 1000;
+module_param(hwmon_fast_ms, uint, 0644);
+MODULE_PARM_DESC(hwmon_fast_ms, "Hardware monitor update period while temperatures are changing (ms)");
+
+static unsigned int hwmon_slow_ms = 4000;
+module_param(hwmon_slow_ms, uint, 0644);
+MODULE_PARM_DESC(hwmon_slow_ms, "Hardware monitor update period in steady state (ms)");
+
+static unsigned int hwmon_alarm_ms = 2000;
+module_param(hwmon_alarm_ms, uint, 0644);
+MODULE_PARM_DESC(hwmon_alarm_ms, "Hardware monitor alarm check period between updates (ms)");
+
+#define HWMON_TEMP_NEAR_MARGIN      3    /* degree C */
+#define HWMON_WD_REFRESH_MAX_MS     4000 /* half the shortest watchdog delay */
+
 /* CPLD register */
 #define CPLD_REG_GENERAL_0x00   0x00 /* Board Type and Revision Register */
 #define CPLD_REG_GENERAL_0x01   0x01 /* CPLD Revision Register */
@@ -366,6 +394,8 @@ struct i2c_bus0_hardware_monitor_data {
     struct mutex lock;
     struct task_struct *auto_update;
     struct completion auto_update_stop;
+    wait_queue_head_t update_wq;
+    int update_request;
 
     char hardware_monitor_data_valid;
     unsigned long hardware_monitor_last_updated; /* In jiffies */
@@ -389,6 +419,7 @@ struct i2c_bus0_hardware_monitor_data {
     unsigned int fanSpeed[W83795ADG_FAN_COUNT];
     unsigned int vSen[W83795ADG_VSEN_COUNT];
     unsigned int vSenLsb[W83795ADG_VSEN_COUNT];
+    unsigned int alarm[W83795ADG_ALARM_COUNT];
 
     char psuPG;
     char psuABS;
@@ -764,6 +795,51 @@ int eepromDataRead(struct i2c_client *client, char *buf)
     return 0;
 }
 
+static void i2c_bus0_hardware_monitor_kick(struct i2c_bus0_hardware_monitor_data *data)
+{
+    data->update_request = 1;
+    wake_up_interruptible(&data->update_wq);
+}
+
+/* Returns non-zero if the W83795ADG latched any alarm since the last check. */
+static int w83795adg_alarm_pending(struct i2c_client *client, struct i2c_bus0_hardware_monitor_data *data)
+{
+    int i, value, pending = 0;
+
+    /* Choose W83795ADG bank 0 */
+    i2c_smbus_write_byte_data(client, W83795ADG_REG_BANK, 0x00);
+    /* Voltage alarms (status 1~2) stay latched, they do not affect fan control */
+    for (i=W83795ADG_ALARM_TEMP; i<W83795ADG_ALARM_COUNT; i++)
+    {
+        /* Status bits are cleared by reading */
+        value = i2c_smbus_read_byte_data(client, W83795ADG_REG_ALARM(i));
+        if (value < 0)
+        {
+            /* Can't tell, do a full update */
+            pending = 1;
+            continue;
+        }
+        data->alarm[i] = value;
+        if (value != 0)
+            pending = 1;
+    }
+    return pending;
+}
+
+static int w83795adg_temp_near_threshold(const ControlTable_t *cTable, unsigned int temp)
+{
+    int i;
+
+    for (i=0; i<3; i++)
+    {
+        if (abs((int)temp - (int)cTable->tempLow2HighThreshold[i]) <= HWMON_TEMP_NEAR_MARGIN)
+            return 1;
+        if (abs((int)temp - (int)cTable->tempHigh2LowThreshold[i]) <= HWMON_TEMP_NEAR_MARGIN)
+            return 1;
+    }
+    return 0;
+}
+
 static int i2c_bus0_hardware_monitor_update_thread(void *p)
 {
     struct i2c_client *client = p;
@@ -778,6 +854,11 @@ static int i2c_bus0_hardware_monitor_update_thread(void *p)
     unsigned short port_status;
     int j, port;
     unsigned int configByte;
+    unsigned long nextUpdate = jiffies;
+    unsigned long nextAlarm = jiffies;
+    unsigned int period, prevMaxTemp = 0;
+    long timeout;
+    int fast;
 
     while (!kthread_should_stop())
     {
@@ -785,6 +866,23 @@ static int i2c_bus0_hardware_monitor_update_thread(void *p)
         {
             mutex_lock(&data->lock);
 
+            if (time_before(jiffies, nextUpdate) && !data->update_request)
+            {
+                if (time_before(jiffies, nextAlarm))
+                {
+                    mutex_unlock(&data->lock);
+                    goto wait;
+                }
+                nextAlarm = jiffies + msecs_to_jiffies(max(hwmon_alarm_ms, 100U));
+                if (!w83795adg_alarm_pending(client, data))
+                {
+                    mutex_unlock(&data->lock);
+                    goto wait;
+                }
+            }
+            data->update_request = 0;
+            fast = 0;
+
             /* Get Fan Speed and display status */
             fanErr = 0;
             for (i=0; i<W83795ADG_FAN_COUNT; i++)
@@ -881,6 +979,11 @@ static int i2c_bus0_hardware_monitor_update_thread(void *p)
                 /* FAN Control */
                 cTable = get_platform_control_table();
 
+                /* Keep polling fast while the temperature moves or is close to a threshold */
+                if (fanErr || (maxTemp != prevMaxTemp) || w83795adg_temp_near_threshold(cTable, maxTemp))
+                    fast = 1;
+                prevMaxTemp = maxTemp;
+
                 if (fanErr)
                 {
                     fanDuty = cTable->fanDutySet[2];
@@ -951,7 +1054,10 @@ static int i2c_bus0_hardware_monitor_update_thread(void *p)
             }
 
             if (fanCtrlDelay > 0)
+            {
                 fanCtrlDelay --;
+                fast = 1;
+            }
 
             data->psuPG =  platformPsuPG = i2c_smbus_read_byte_data(&cpld_client, CPLD_REG_GENERAL_0x02);
             data->psuABS =  platformPsuABS = i2c_smbus_read_byte_data(&cpld_client, CPLD_REG_GENERAL_0x03);
@@ -1079,12 +1185,32 @@ static int i2c_bus0_hardware_monitor_update_thread(void *p)
                     data->wdEnable = 1;
                 }
             }
+
+            period = fast ? hwmon_fast_ms : max(hwmon_slow_ms, hwmon_fast_ms);
+            /* The watchdog is refreshed from here */
+            if ((data->cpldRev != 0) && (data->wdRefreshControl == 0))
+                period = min_t(unsigned int, period, HWMON_WD_REFRESH_MAX_MS);
+            nextUpdate = jiffies + msecs_to_jiffies(period);
+            nextAlarm = jiffies + msecs_to_jiffies(max(hwmon_alarm_ms, 100U));
             mutex_unlock(&data->lock);
         }
 
+wait:
         if (kthread_should_stop())
             break;
-        msleep_interruptible(1000);
+        /* Sleep until the next update or alarm check, whichever is first */
+        timeout = msecs_to_jiffies(max(hwmon_fast_ms, 100U));
+        if (isBMCSupport == 0)
+        {
+            timeout = (long)(nextUpdate - jiffies);
+            if (time_before(nextAlarm, nextUpdate))
+                timeout = (long)(nextAlarm - jiffies);
+            if (timeout < 1)
+                timeout = 1;
+        }
+        wait_event_interruptible_timeout(data->update_wq,
+                                         data->update_request || kthread_should_stop(),
+                                         timeout);
     }
 
     complete_all(&data->auto_update_stop);
@@ -2654,6 +2780,7 @@ static ssize_t set_mac_temp(struct device *dev, struct device_attribute *devattr
     mutex_lock(&data->lock);
     data->macTemp = temp;
     mutex_unlock(&data->lock);
+    i2c_bus0_hardware_monitor_kick(data);
 
     return count;
 }
@@ -2681,6 +2808,7 @@ static ssize_t set_wd_refresh(struct device *dev, struct device_attribute *devat
     mutex_lock(&data->lock);
     data->wdRefreshControlFlag = temp;
     mutex_unlock(&data->lock);
+    i2c_bus0_hardware_monitor_kick(data);
 
     return count;
 }
@@ -2708,6 +2836,7 @@ static ssize_t set_wd_refresh_control(struct device *dev, struct device_attribut
     mutex_lock(&data->lock);
     data->wdRefreshControl = temp;
     mutex_unlock(&data->lock);
+    i2c_bus0_hardware_monitor_kick(data);
 
     return count;
 }
@@ -2736,6 +2865,7 @@ static ssize_t set_wd_refresh_time(struct device *dev, struct device_attribute *
     data->wdRefreshTimeSelect = temp;
     data->wdRefreshTimeSelectFlag = 1;
     mutex_unlock(&data->lock);
+    i2c_bus0_hardware_monitor_kick(data);
 
     return count;
 }
@@ -2764,6 +2894,7 @@ static ssize_t set_wd_timeout_occurrence(struct device *dev, struct device_attri
     data->wdTimeoutSelect = temp;
     data->wdTimeoutSelectFlag = 1;
     mutex_unlock(&data->lock);
+    i2c_bus0_hardware_monitor_kick(data);
 
     return count;
 }
@@ -7879,7 +8010,7 @@ static void i2c_bus0_hardware_monitor_hw_default_config(struct i2c_client *clien
 {
     struct i2c_bus0_hardware_monitor_data *data = i2c_get_clientdata(client);
     unsigned int hiByte, lowByte, configByte;
-    int i;
+    int i, value;
 
     i2c_bus0_devices_client_address_init(client);
 
@@ -7945,6 +8076,11 @@ static void i2c_bus0_hardware_monitor_hw_default_config(struct i2c_client *clien
         /* set FANCTL2 to enable FANIN9 and FANIN10 monitoring */
         i2c_smbus_write_byte_data(client, W83795ADG_REG_FANIN_CTRL2, 0x03);
 
+        /* Latch alarms in the status registers until they are read */
+        value = i2c_smbus_read_byte_data(client, W83795ADG_REG_ALARM_CTRL);
+        if (value >= 0)
+            i2c_smbus_write_byte_data(client, W83795ADG_REG_ALARM_CTRL, value & ~W83795ADG_ALARM_CTRL_RTSACS);
+
         /* Enable monitoring operations */
         configByte |= 0x01;
         i2c_smbus_write_byte_data(client, W83795ADG_REG_CONFIG, configByte);
@@ -8500,6 +8636,7 @@ static int w83795adg_hardware_monitor_probe(struct i2c_client *client,
             }
 
             init_completion(&data->auto_update_stop);
+            init_waitqueue_head(&data->update_wq);
             data->auto_update = kthread_run(i2c_bus0_hardware_monitor_update_thread, client, dev_name(data->hwmon_dev));
             if (IS_ERR(data->auto_update)) {
                 err = PTR_ERR(data->auto_update);
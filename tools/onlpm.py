@@ -22,6 +22,7 @@ import re
 import json
 import lsb_release
 import cPickle as pickle
+import multiprocessing
 
 g_dist_codename = lsb_release.get_distro_information().get('CODENAME')
 
@@ -143,8 +144,23 @@ class OnlPackage(object):
         'DISTS' : g_dist_codename,
         }
 
+    @staticmethod
+    def package_defaults_files(pkg):
+        """All [.]PKG_DEFAULTS[.yml] files that apply to the given package file,
+        from the package directory up to the root."""
+        files = []
+        searchdir = os.path.dirname(pkg)
+        while searchdir != '/':
+            for prefix in [ '', '.']:
+                for name in [ "%sPKG_DEFAULTS.yml" % prefix, "%sPKG_DEFAULTS" % prefix ]:
+                    f = os.path.join(searchdir, name)
+                    if os.path.exists(f):
+                        files.append(f)
+            searchdir = os.path.dirname(searchdir)
+        return files
+
     @classmethod
-    def package_defaults_get(klass, pkg):
+    def package_defaults_get(klass, pkg, loaded=None):
         # Default key value dictionary
         ddict = klass.DEFAULTS.copy()
 
@@ -164,7 +180,7 @@ class OnlPackage(object):
                 for prefix in [ '', '.']:
                     f = os.path.join(searchdir, "%sPKG_DEFAULTS.yml" % prefix)
                     if os.path.exists(f):
-                        results.append(onlyaml.loadf(f))
+                        results.append(onlyaml.loadf(f, loaded=loaded))
                     f = os.path.join(searchdir, "%sPKG_DEFAULTS" % prefix)
                     if os.path.exists(f) and os.access(f, os.X_OK):
                         results.append(yaml.load(subprocess.check_output(f, shell=True)))
@@ -581,9 +597,12 @@ class OnlPackageGroup(object):
         if not os.path.exists(pkg):
             raise OnlPackageError("Package file '%s' does not exist." % pkg)
 
-        ddict = OnlPackage.package_defaults_get(pkg)
+        # Every yaml file read, including !include files, for the package cache
+        loaded = []
 
-        pkg_data = onlyaml.loadf(pkg, ddict)
+        ddict = OnlPackage.package_defaults_get(pkg, loaded)
+
+        pkg_data = onlyaml.loadf(pkg, ddict, loaded)
 
         pkglist = []
 
@@ -611,6 +630,7 @@ class OnlPackageGroup(object):
         self._pkgs['__source'] = os.path.abspath(pkg)
         self._pkgs['__directory'] = os.path.dirname(self._pkgs['__source'])
         self._pkgs['__mtime'] = os.path.getmtime(pkg)
+        self._pkgs['__loaded'] = sorted(set(loaded))
 
     def reload(self):
         """Reload our package file if it has changed."""
@@ -944,13 +964,37 @@ class OnlPackageRepo(object):
         with self.lock:
             return self.r.contents(pkg)
 
+def load_package_group(pkg):
+    """Parse a single package file.
+
+    This runs in the parse pool, so package and yaml errors are
+    returned as (kind, message) instead of being raised; they
+    do not survive pickling back to the parent."""
+    pg = OnlPackageGroup()
+    try:
+        logger.debug('Loading package file %s...' % pkg)
+        pg.load(pkg)
+        logger.debug('  Loaded package file %s' % pkg)
+    except OnlPackageError, e:
+        return (None, ('package', str(e)))
+    except onlyaml.OnlYamlError, e:
+        return (None, ('yaml', str(e)))
+    return (pg, None)
+
 class OnlPackageManager(object):
 
-    def __init__(self):
+    def __init__(self, jobs=None):
         # Stores all loaded package groups.
         self.package_groups = []
         self.opr = None
 
+        # Package file index, see __build_cache()
+        self.dir_index = {}
+        self.pkg_index = {}
+
+        # Number of processes used to parse package files
+        self.jobs = jobs or multiprocessing.cpu_count()
+
     def set_repo(self, repodir, packagedir='packages'):
         self.opr = OnlPackageRepo(repodir, packagedir=packagedir)
 
@@ -963,77 +1007,169 @@ class OnlPackageManager(object):
             if not pg.archcheck(arches):
                 pg.filtered = True
 
+    # Bump when the package cache layout changes.
+    CACHE_VERSION = 3
+
     def __cache_name(self, basedir):
         return os.path.join(basedir, '.PKGs.cache.%s' % g_dist_codename)
 
     def __write_cache(self, basedir):
         cache = self.__cache_name(basedir)
         logger.debug("Writing the package cache %s..." % cache)
-        pickle.dump(self.package_groups, open(cache, "wb"))
-
-    def __load_cache(self, basedir, ro):
-        cache=self.__cache_name(basedir)
-
-        # Lock the cache file
-        with onlu.Lock(cache + ".lock"):
-            if os.path.exists(cache):
-                logger.debug("Loading from package cache %s" % cache)
-
-                try:
-                    self.package_groups = pickle.load(open(cache, "rb"))
-                except Exception, e:
-                    logger.warn("The existing package cache is corrupted. It will be rebuilt.")
-                    return False
-
-                if ro:
-                    return True
-
-                # Validate and update the cache
-                for pg in self.package_groups:
-                    pg.reload()
-
-                self.__write_cache(basedir)
-                return True
-
-        return False
-
+        data = dict(version=self.CACHE_VERSION,
+                    dirs=self.dir_index,
+                    pkgs=self.pkg_index)
+        tmp = "%s.%d" % (cache, os.getpid())
+        with open(tmp, "wb") as f:
+            pickle.dump(data, f, pickle.HIGHEST_PROTOCOL)
+        os.rename(tmp, cache)
+
+    def __read_cache(self, basedir):
+        cache = self.__cache_name(basedir)
+        if not os.path.exists(cache):
+            return None
+        logger.debug("Loading from package cache %s" % cache)
+        try:
+            with open(cache, "rb") as f:
+                data = pickle.load(f)
+        except Exception, e:
+            logger.warn("The existing package cache is corrupted. It will be rebuilt.")
+            return None
+        if type(data) is not dict or data.get('version') != self.CACHE_VERSION:
+            logger.debug("The existing package cache is out of date. It will be rebuilt.")
+            return None
+        return data
 
     def __builder_arches(self):
         arches = [ 'all', 'amd64' ]
         arches = arches + subprocess.check_output(['dpkg', '--print-foreign-architectures']).split()
         return arches
 
-    def __build_cache(self, basedir):
+    def __scan(self, basedir, dirs):
+        """Find all package files under basedir.
+
+        'dirs' maps each directory to (mtime, subdirs, package files)
+        from the previous scan. A directory whose mtime is unchanged
+        has the same entries, so only its subdirectories are visited."""
         pkgspec = [ 'PKG.yml', 'pkg.yml' ]
+        index = {}
+        pkgfiles = []
+        stack = [ basedir ]
+        while stack:
+            d = stack.pop()
+            try:
+                mtime = os.stat(d).st_mtime
+            except OSError:
+                continue
+            entry = dirs.get(d, None)
+            if entry is None or entry[0] != mtime:
+                try:
+                    names = sorted(os.listdir(d))
+                except OSError:
+                    continue
+                subdirs = []
+                pkgs = []
+                for f in names:
+                    path = os.path.join(d, f)
+                    if f in pkgspec:
+                        if "%s.disabled" % f in names:
+                            logger.warn("Skipping %s due to .disabled file)." % path)
+                        else:
+                            pkgs.append(path)
+                    elif os.path.isdir(path) and not os.path.islink(path):
+                        subdirs.append(path)
+                entry = (mtime, subdirs, pkgs)
+            index[d] = entry
+            pkgfiles += entry[2]
+            stack += reversed(entry[1])
+        return (index, sorted(pkgfiles))
 
-        builder_arches = self.__builder_arches()
+    @staticmethod
+    def __pkg_stamp(pkg, loaded):
+        """Cheap validation data for a package file, its defaults and
+        the yaml files read while parsing it ((path, mtime) pairs)."""
+        st = os.stat(pkg)
+        defaults = [ (f, os.path.getmtime(f)) for f in OnlPackage.package_defaults_files(pkg) ]
+        files = []
+        for (f, mtime) in loaded:
+            try:
+                files.append((f, os.path.getmtime(f)))
+            except OSError:
+                files.append((f, None))
+        return (st.st_mtime, st.st_size, defaults, files)
+
+    def __build_cache(self, basedir, cached=None):
+        #
+        # Only package files that are new, or that were touched, or
+        # whose defaults or included files were, are parsed again.
+        # The rest come from the previous index.
+        #
+        cached = cached or {}
+        (self.dir_index, pkgfiles) = self.__scan(basedir, cached.get('dirs', {}))
+        oldpkgs = cached.get('pkgs', {})
+        self.pkg_index = {}
+
+        stale = []
+        for pkg in pkgfiles:
+            entry = oldpkgs.get(pkg, None)
+            if entry is not None and not entry['pg']._pkgs.get('reload', False):
+                if entry['stamp'] == self.__pkg_stamp(pkg, entry['pg']._pkgs['__loaded']):
+                    self.pkg_index[pkg] = entry
+                    continue
+            # The files read are only known after the parse
+            stale.append((pkg, self.__pkg_stamp(pkg, [])[:3]))
+
+        if stale:
+            logger.debug("Parsing %d of %d package files..." % (len(stale), len(pkgfiles)))
+            jobs = min(self.jobs, len(stale))
+            if jobs > 1:
+                pool = multiprocessing.Pool(jobs)
+                try:
+                    results = pool.map(load_package_group, [ pkg for (pkg, stamp) in stale ])
+                finally:
+                    pool.terminate()
+            else:
+                results = map(load_package_group, [ pkg for (pkg, stamp) in stale ])
+            for ((pkg, stamp), (pg, error)) in zip(stale, results):
+                if pg is None:
+                    (kind, msg) = error
+                    if kind == 'yaml':
+                        raise onlyaml.OnlYamlError(msg)
+                    logger.error("%s: " % msg)
+                    logger.warn("Skipping %s due to errors." % pkg)
+                    continue
+                # With the mtimes seen when the files were read
+                self.pkg_index[pkg] = dict(stamp=stamp + (pg._pkgs['__loaded'],), pg=pg)
 
-        for root, dirs, files in os.walk(basedir):
-            for f in files:
-                if f in pkgspec:
-                    if "%s.disabled" % f in files:
-                        logger.warn("Skipping %s due to .disabled file)." % os.path.join(root, f))
-                    else:
-                        pg = OnlPackageGroup()
-                        try:
-                            logger.debug('Loading package file %s...' % os.path.join(root, f))
-                            pg.load(os.path.join(root, f))
-                            logger.debug('  Loaded package file %s' % os.path.join(root, f))
-                            if pg.distcheck() and pg.buildercheck(builder_arches):
-                                self.package_groups.append(pg)
-                        except OnlPackageError, e:
-                            logger.error("%s: " % e)
-                            logger.warn("Skipping %s due to errors." % os.path.join(root, f))
+        builder_arches = self.__builder_arches()
+        for pkg in pkgfiles:
+            entry = self.pkg_index.get(pkg, None)
+            if entry is not None:
+                pg = entry['pg']
+                if pg.distcheck() and pg.buildercheck(builder_arches):
+                    self.package_groups.append(pg)
 
     def load(self, basedir, usecache=True, rebuildcache=False, roCache=False):
-        if usecache is True and rebuildcache is False:
-            if self.__load_cache(basedir, roCache):
-                return
+        if not usecache:
+            self.__build_cache(basedir)
+            return
 
-        self.__build_cache(basedir)
+        cache = self.__cache_name(basedir)
+
+        # Lock the cache file
+        with onlu.Lock(cache + ".lock"):
+            cached = None
+            if not rebuildcache:
+                cached = self.__read_cache(basedir)
+            if cached is not None and roCache:
+                builder_arches = self.__builder_arches()
+                for pkg in sorted(cached['pkgs'].keys()):
+                    pg = cached['pkgs'][pkg]['pg']
+                    if pg.distcheck() and pg.buildercheck(builder_arches):
+                        self.package_groups.append(pg)
+                return
 
-        if usecache:
-            # Write the package cache
+            self.__build_cache(basedir, cached)
             self.__write_cache(basedir)
 
 
@@ -1289,6 +1425,7 @@ if __name__ == '__main__':
     ap.add_argument("--rebuild-pkg-cache", action='store_true', default=os.environ.get('ONLPM_OPTION_REBUILD_PKG_CACHE', False))
     ap.add_argument("--no-pkg-cache", action='store_true', default=os.environ.get('ONLPM_OPTION_NO_PKG_CACHE', False))
     ap.add_argument("--ro-cache", action='store_true', help="Assume existing package cache is up-to-date and read-only. Should be specified for parallel builds.")
+    ap.add_argument("--pkg-cache-jobs", type=int, default=int(os.environ.get('ONLPM_OPTION_PKG_CACHE_JOBS', 0)), help="Number of processes used to parse changed package files (default: one per CPU).")
     ap.add_argument("--pkg-info", action='store_true')
     ap.add_argument("--skip-missing", action='store_true')
     ap.add_argument("--try-arches", nargs='+', metavar='ARCH')
@@ -1340,7 +1477,7 @@ if __name__ == '__main__':
 
     try:
 
-        pm = OnlPackageManager()
+        pm = OnlPackageManager(jobs=ops.pkg_cache_jobs)
         if ops.repo:
             logger.debug("Setting repo as '%s'..." % ops.repo)
             pm.set_repo(ops.repo, packagedir=ops.repo_package_dir)
@@ -33,7 +33,7 @@ def dflatten(rv, in_):
         raise OnlYamlError("Element type '%s' cannot be added to the given dictionary." % (type(in_)))
 
 
-def loadf(fname, vard={}):
+def loadf(fname, vard={}, loaded=None):
 
     # Apply variable interpolation:
     def interpolate(s, d):
@@ -84,7 +84,7 @@ def loadf(fname, vard={}):
         if not os.path.exists(fname):
             raise OnlYamlError("Include file '%s' (from %s) does not exist." % (fname, loader.name))
 
-        return loadf(fname, variables)
+        return loadf(fname, variables, loaded)
 
     # Yaml dynamic constructor. Allow dynamically generated yaml.
     def onlyaml_script(loader, node):
@@ -99,6 +99,10 @@ def loadf(fname, vard={}):
     yaml.add_constructor("!include", onlyaml_include)
     yaml.add_constructor("!script", onlyaml_script)
 
+    # Callers which cache the results get every file read, with its mtime
+    if loaded is not None:
+        loaded.append((os.path.abspath(fname), os.path.getmtime(fname)))
+
     # First load: grab the variables dict
     string = open(fname).read()
     try:
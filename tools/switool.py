@@ -3,13 +3,24 @@
 import argparse
 import sys
 import os
+import time
 import zipfile
+import zlib
+import struct
 import json
 import apt_inst
 import onlu
 
 logger = onlu.init_logging('switool')
 
+# The loader loop-mounts the rootfs squashfs directly out of the SWI,
+# so it is stored uncompressed with its data aligned to this boundary.
+ROOTFS_ALIGN = 4096
+
+# Extra field header id used to pad the rootfs local header.
+# Same id as Android's zipalign, so standard tools skip over it.
+ALIGN_EXTRA_ID = 0xd935
+
 class OnlSwitchImage(object):
 
     def __init__(self, fname, mode):
@@ -19,10 +30,61 @@ class OnlSwitchImage(object):
         self.manifest = None
 
     def add(self, fname, arcname=None, compressed=True):
-        self.zipfile.write(fname, arcname=arcname, compress_type = zipfile.ZIP_DEFLATED if compressed else zipefile.ZIP_STORED)
+        self.zipfile.write(fname, arcname=arcname, compress_type = zipfile.ZIP_DEFLATED if compressed else zipfile.ZIP_STORED)
+
+    def add_aligned(self, fname, arcname=None, align=ROOTFS_ALIGN):
+        """Store a file uncompressed with its data at an 'align' boundary.
+
+        The local header is padded with an extra field so that the member
+        data starts on the boundary; see swiprep in the loader."""
+        if arcname is None:
+            arcname = os.path.basename(fname)
+        st = os.stat(fname)
+        zi = zipfile.ZipInfo(arcname, date_time=time.localtime(st.st_mtime)[0:6])
+        zi.external_attr = (st.st_mode & 0xFFFF) << 16
+        zi.compress_type = zipfile.ZIP_STORED
+
+        # 30 byte fixed local header, then the name, then the extra field
+        # (which ends with a 20 byte zip64 field for large files)
+        offset = self.zipfile.fp.tell() + 30 + len(arcname)
+        if st.st_size > zipfile.ZIP64_LIMIT:
+            offset += 20
+        pad = (align - offset % align) % align
+        if pad and pad < 4:
+            pad += align
+        if pad:
+            zi.extra = struct.pack('<HH', ALIGN_EXTRA_ID, pad - 4) + '\0' * (pad - 4)
+
+        # Stream the member the way ZipFile.write() does, rather than
+        # reading the whole rootfs into memory for writestr().
+        zi.file_size = zi.compress_size = st.st_size
+        zi.CRC = 0
+        zi.header_offset = self.zipfile.fp.tell()
+        zip64 = zi.file_size > zipfile.ZIP64_LIMIT
+        self.zipfile._writecheck(zi)
+        self.zipfile._didModify = True
+        self.zipfile.fp.write(zi.FileHeader(zip64))
+
+        crc = 0
+        with open(fname, 'rb') as f:
+            while True:
+                buf = f.read(1024 * 1024)
+                if not buf:
+                    break
+                crc = zlib.crc32(buf, crc) & 0xffffffff
+                self.zipfile.fp.write(buf)
+        zi.CRC = crc
+
+        # Rewrite the local header with the CRC
+        position = self.zipfile.fp.tell()
+        self.zipfile.fp.seek(zi.header_offset, 0)
+        self.zipfile.fp.write(zi.FileHeader(zip64))
+        self.zipfile.fp.seek(position, 0)
+        self.zipfile.filelist.append(zi)
+        self.zipfile.NameToInfo[zi.filename] = zi
 
     def add_rootfs(self, rootfs_sqsh):
-        self.add(rootfs_sqsh)
+        self.add_aligned(rootfs_sqsh)
 
     def add_manifest(self, manifest):
         self.add(manifest, arcname="manifest.json")